@@ -0,0 +1,22 @@
+#include "parallel_for.h"
+#include "../std/compile_std.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+void parallelFor(size_t count, const function<void(size_t)> &body) {
+    size_t threads = _jobs < count ? _jobs : count;
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) body(i);
+    };
+    vector<thread> pool;
+    for (size_t i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+}
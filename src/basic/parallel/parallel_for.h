@@ -0,0 +1,16 @@
+#ifndef COMPILER_PARALLEL_FOR_H
+#define COMPILER_PARALLEL_FOR_H
+
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+/**
+ * Run body(0) ... body(count - 1) on up to _jobs threads, return when all of them are done.
+ * The indices are handed out in order, the bodies must not touch shared mutable state.
+ * With _jobs <= 1 the bodies run serially on the calling thread.
+ */
+extern void parallelFor(size_t count, const function<void(size_t)> &body);
+
+#endif
@@ -0,0 +1,155 @@
+#include "pass_report.h"
+#include "../std/compile_std.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <mutex>
+
+#if !defined(WIN32)
+#include <sys/resource.h>
+#endif
+
+struct PassRecord {
+    PassRecordKind kind;
+    string name;
+    unsigned int calls = 0;
+    double seconds = 0;
+    double maxSeconds = 0;
+    long long insBefore = -1; // sums of the known counts.
+    long long insAfter = -1;
+    long peakRssDelta = 0; // in KB.
+};
+
+vector<PassRecord> passRecords;
+map<pair<PassRecordKind, string>, unsigned int> passRecordIndex;
+mutex passRecordMutex; // passes of different functions may finish on different threads.
+
+long getPeakRss() {
+#if defined(WIN32)
+    return 0;
+#else
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+}
+
+PassRecorder::PassRecorder(PassRecordKind kind, string name, function<long long()> counter)
+        : enabled(_timePasses || _memReport), kind(kind), name(move(name)), counter(move(counter)) {
+    if (!enabled) return;
+    if (this->counter) insBefore = this->counter();
+    peakRssBefore = getPeakRss();
+    startTime = chrono::steady_clock::now();
+}
+
+PassRecorder::~PassRecorder() {
+    if (!enabled) return;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    long peakRssDelta = getPeakRss() - peakRssBefore;
+    long long insAfter = counter ? counter() : -1;
+    auto key = make_pair(kind, name);
+    lock_guard<mutex> lock(passRecordMutex);
+    if (passRecordIndex.count(key) == 0) {
+        passRecordIndex[key] = passRecords.size();
+        passRecords.push_back(PassRecord{kind, name});
+    }
+    PassRecord &record = passRecords.at(passRecordIndex.at(key));
+    ++record.calls;
+    record.seconds += seconds;
+    record.maxSeconds = max(record.maxSeconds, seconds);
+    if (insBefore >= 0) record.insBefore = max(record.insBefore, 0LL) + insBefore;
+    if (insAfter >= 0) record.insAfter = max(record.insAfter, 0LL) + insAfter;
+    record.peakRssDelta += peakRssDelta;
+}
+
+string jsonString(const string &s) {
+    string res = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') res += '\\';
+        res += c;
+    }
+    return res + "\"";
+}
+
+void outputPassReportTable(const vector<PassRecord> &records, const string &title, double totalSeconds) {
+    cerr << "===== " << title << " =====" << endl;
+    if (_timePasses) cerr << setw(11) << "Time(ms)" << setw(8) << "%" << setw(11) << "Max(ms)";
+    cerr << setw(8) << "Calls" << setw(13) << "Ins before" << setw(13) << "Ins after";
+    if (_memReport) cerr << setw(14) << "Peak RSS(KB)";
+    cerr << "  Name" << endl;
+    for (auto &record : records) {
+        cerr << fixed << setprecision(3);
+        if (_timePasses) {
+            cerr << setw(11) << record.seconds * 1000
+                 << setw(7) << setprecision(1) << (totalSeconds > 0 ? record.seconds / totalSeconds * 100 : 0) << "%"
+                 << setw(11) << setprecision(3) << record.maxSeconds * 1000;
+        }
+        cerr << setw(8) << record.calls
+             << setw(13) << (record.insBefore < 0 ? "-" : to_string(record.insBefore))
+             << setw(13) << (record.insAfter < 0 ? "-" : to_string(record.insAfter));
+        if (_memReport) cerr << setw(14) << ("+" + to_string(record.peakRssDelta));
+        cerr << "  " << record.name << endl;
+    }
+    cerr.unsetf(ios::floatfield);
+}
+
+void outputPassReportJson(ofstream &out, const vector<PassRecord> &records) {
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        const PassRecord &record = records.at(i);
+        out << "    {\"name\": " << jsonString(record.name)
+            << ", \"calls\": " << record.calls
+            << ", \"seconds\": " << record.seconds
+            << ", \"maxSeconds\": " << record.maxSeconds
+            << ", \"insBefore\": " << record.insBefore
+            << ", \"insAfter\": " << record.insAfter
+            << ", \"peakRssDeltaKB\": " << record.peakRssDelta << "}"
+            << (i + 1 == records.size() ? "" : ",") << endl;
+    }
+}
+
+void outputPassReport(const string &jsonFile) {
+    if (!_timePasses && !_memReport) return;
+    vector<PassRecord> phases, passes;
+    double totalSeconds = 0;
+    for (auto &record : passRecords) {
+        if (record.kind == PHASE_RECORD) {
+            phases.push_back(record);
+            totalSeconds += record.seconds;
+        } else {
+            passes.push_back(record);
+        }
+    }
+    auto byTime = [](const PassRecord &a, const PassRecord &b) { return a.seconds > b.seconds; };
+    auto byRss = [](const PassRecord &a, const PassRecord &b) { return a.peakRssDelta > b.peakRssDelta; };
+    if (_timePasses) {
+        stable_sort(phases.begin(), phases.end(), byTime);
+        stable_sort(passes.begin(), passes.end(), byTime);
+    } else {
+        stable_sort(phases.begin(), phases.end(), byRss);
+        stable_sort(passes.begin(), passes.end(), byRss);
+    }
+    outputPassReportTable(phases, "Phase Report", totalSeconds);
+    outputPassReportTable(passes, "Pass Report", totalSeconds);
+    if (_memReport) cerr << "Peak RSS: " << getPeakRss() << " KB" << endl;
+
+    ofstream out(jsonFile, ios::out | ios::trunc);
+    if (!out.is_open()) {
+        cerr << "Error occurs in process pass report: cannot open " << jsonFile << "." << endl;
+        return;
+    }
+    out << "{" << endl;
+    out << "  \"totalSeconds\": " << totalSeconds << "," << endl;
+    out << "  \"peakRssKB\": " << getPeakRss() << "," << endl;
+    out << "  \"phases\": [" << endl;
+    outputPassReportJson(out, phases);
+    out << "  ]," << endl;
+    out << "  \"passes\": [" << endl;
+    outputPassReportJson(out, passes);
+    out << "  ]" << endl;
+    out << "}" << endl;
+    out.close();
+}
@@ -0,0 +1,38 @@
+#ifndef COMPILER_PASS_REPORT_H
+#define COMPILER_PASS_REPORT_H
+
+#include <string>
+#include <chrono>
+#include <functional>
+
+using namespace std;
+
+enum PassRecordKind {
+    PHASE_RECORD, // compile phases in main, may contain passes.
+    PASS_RECORD
+};
+
+/**
+ * Scoped record of a phase or pass invocation, only recorded when _timePasses or _memReport is set.
+ * The counter returns the instruction count at both ends of the scope, or -1 if unknown.
+ */
+class PassRecorder {
+private:
+    bool enabled;
+    PassRecordKind kind;
+    string name;
+    function<long long()> counter;
+    chrono::steady_clock::time_point startTime;
+    long long insBefore = -1;
+    long peakRssBefore = 0;
+
+public:
+    PassRecorder(PassRecordKind kind, string name, function<long long()> counter = nullptr);
+
+    ~PassRecorder();
+};
+
+// print the sorted table to stderr and write the json report.
+extern void outputPassReport(const string &jsonFile);
+
+#endif
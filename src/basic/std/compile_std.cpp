@@ -11,3 +11,10 @@ bool _isBuildingIr = true; // Used for IR Phi.
 
 bool _optimizeMachineIr = false;
 bool _optimizeDivAndMul = false;
+
+bool _timePasses = false;
+bool _memReport = false;
+
+unsigned int _jobs = 1;
+unsigned int _unrollFactor = 0;
+bool _vectorize = true;
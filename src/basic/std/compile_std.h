@@ -13,6 +13,13 @@ extern bool _isBuildingIr;
 extern bool _optimizeMachineIr;
 extern bool _optimizeDivAndMul;
 
+extern bool _timePasses;
+extern bool _memReport;
+
+extern unsigned int _jobs; // threads for the per-function phases.
+extern unsigned int _unrollFactor; // 0 chooses the factor by the loop size, 1 disables loop unrolling.
+extern bool _vectorize; // vectorize the innermost counted loops by NEON at -O2 and -O3.
+
 enum OptimizeLevel {
     O0,
     O1,
@@ -30,6 +37,8 @@ enum OptimizeLevel {
 #define _LOOP_WEIGHT_BASE 10
 #define _MAX_DEPTH 6
 #define _MAX_LOOP_WEIGHT 1000000000
+#define _BULK_INIT_MIN_UNITS 16
+#define _BULK_COPY_MIN_UNITS 16
 
 #define _SCO_SUCCESS 0
 #define _SCO_ARG_ERR -1
@@ -39,6 +48,8 @@ enum OptimizeLevel {
 #define _SCO_DBG_PATH_ERR -5
 #define _SCO_OP_ERR -6
 #define _SCO_ST_ERR -7
+#define _SCO_JOBS_ERR -8
+#define _SCO_UNROLL_ERR -9
 
 #define _INIT_SUCCESS 0
 #define _INIT_CRT_ERR -26
@@ -47,6 +58,7 @@ enum OptimizeLevel {
 #define _IR_CHK_ERR -61
 #define _IR_OP_CHK_ERR -62
 #define _MACH_IR_ERR -71
+#define _ARM_OUT_ERR -81
 
 #if defined(WIN32)
 #define _SLASH_CHAR '\\'
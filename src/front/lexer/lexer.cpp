@@ -3,122 +3,149 @@
 
 #include <vector>
 #include <unordered_map>
-#include <algorithm>
+#include <cstring>
 
-using namespace std;
+#if defined(WIN32)
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
-int c;
-string token;
+using namespace std;
 
 std::vector<TokenInfo> tokenInfoList;
 
+// the source code stays mapped since tokens are views into it.
+const char *sourceBuffer = nullptr;
+size_t sourceSize = 0;
+
+std::vector<string_view> identifierNames;
+static unordered_map<string_view, int> identifierIds;
+
 extern string debugMessageDirectory;
 
-std::unordered_map<string, TokenType>
-        reverseTable{ // NOLINT
-        {"int",      INT_TK},
-        {"const",    CONST_TK},
-        {"void",     VOID_TK},
-        {"if",       IF_TK},
-        {"else",     ELSE_TK},
-        {"while",    WHILE_TK},
-        {"break",    BREAK_TK},
-        {"continue", CONTINUE_TK},
-        {"return",   RETURN_TK},
-        {",",        COMMA},
-        {";",        SEMICOLON},
-        {"[",        LBRACKET},
-        {"]",        RBRACKET},
-        {"{",        LBRACE},
-        {"}",        RBRACE},
-        {"(",        LPAREN},
-        {")",        RPAREN},
-        {"=",        ASSIGN},
-        {"+",        PLUS},
-        {"-",        MINUS},
-        {"!",        NOT},
-        {"*",        MULT},
-        {"/",        DIV},
-        {"%",        REMAIN},
-        {"<",        LESS},
-        {">",        LARGE},
-        {"<=",       LEQ},
-        {">=",       LAQ},
-        {"==",       EQUAL},
-        {"!=",       NEQUAL},
-        {"&&",       AND},
-        {"||",       OR}
-};
+int internIdentifier(string_view name) {
+    auto it = identifierIds.find(name);
+    if (it != identifierIds.end()) return it->second;
+    int id = (int) identifierNames.size();
+    identifierIds.emplace(name, id);
+    identifierNames.push_back(name);
+    return id;
+}
 
-// type1:/* */ type2:// //
-void skipComment(int type, FILE *in) {
-    if (type == 1) {
-        while (true) {
-            c = fgetc(in);
-            if (c == '*') {
-                c = fgetc(in);
-                if (c == '/') {
-                    break;
-                }
-            }
-        }
+bool loadSourceFile(const string &file) {
+#if defined(WIN32)
+    static vector<char> buffer;
+    FILE *in = fopen(file.c_str(), "rb");
+    if (!in) return false;
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    buffer.resize(size > 0 ? size : 1);
+    sourceSize = size > 0 ? fread(buffer.data(), 1, size, in) : 0;
+    sourceBuffer = buffer.data();
+    fclose(in);
+    return true;
+#else
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    sourceSize = st.st_size;
+    if (sourceSize == 0) {
+        sourceBuffer = "";
     } else {
-        while (true) {
-            c = fgetc(in);
-            if (c == '\n') {
-                break;
-            }
+        void *addr = mmap(nullptr, sourceSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            return false;
         }
+        madvise(addr, sourceSize, MADV_SEQUENTIAL);
+        sourceBuffer = static_cast<const char *>(addr);
     }
+    close(fd);
+    return true;
+#endif
 }
 
-void skipSpaceOrNewlineOrTab(FILE *in) {
-    while (isSpace() || isNewline() || isTab()) {
-        c = fgetc(in);
-    }
+inline bool matchKeyword(const char *s, const char *keyword, unsigned int len) {
+    return memcmp(s, keyword, len) == 0;
 }
 
-void dealWithKeywordOrIdent(FILE *in) {
-    while ((isLetter() || isDigit())) {
-        catToken();
-        c = fgetc(in);  //if c is not a whitespace, then jump to error
+// keywords are told apart by length and first character.
+TokenType keywordOrIdent(const char *s, unsigned int len) {
+    switch (len) {
+        case 2:
+            if (matchKeyword(s, "if", 2)) return IF_TK;
+            break;
+        case 3:
+            if (matchKeyword(s, "int", 3)) return INT_TK;
+            break;
+        case 4:
+            if (s[0] == 'v' && matchKeyword(s, "void", 4)) return VOID_TK;
+            if (s[0] == 'e' && matchKeyword(s, "else", 4)) return ELSE_TK;
+            break;
+        case 5:
+            if (s[0] == 'c' && matchKeyword(s, "const", 5)) return CONST_TK;
+            if (s[0] == 'w' && matchKeyword(s, "while", 5)) return WHILE_TK;
+            if (s[0] == 'b' && matchKeyword(s, "break", 5)) return BREAK_TK;
+            break;
+        case 6:
+            if (matchKeyword(s, "return", 6)) return RETURN_TK;
+            break;
+        case 8:
+            if (matchKeyword(s, "continue", 8)) return CONTINUE_TK;
+            break;
+        default:
+            break;
     }
-    fseek(in, -1L, 1);
-    string name(token);
-    if (reverseTable.find(token) != reverseTable.end()) {
-        TokenInfo tmp(reverseTable.at(token));
-        tmp.setName(name);
-        tokenInfoList.push_back(tmp);
-    } else {
-        TokenInfo tmp(IDENT);
-        tmp.setName(token);
-        tokenInfoList.push_back(tmp);
+    return IDENT;
+}
+
+// type1:/* */ type2:// //
+const char *skipComment(int type, const char *p, const char *end) {
+    if (type == 1) {
+        while (p < end) {
+            if (*p == '*' && p + 1 < end && p[1] == '/') return p + 2;
+            ++p;
+        }
+        return end;
     }
+    while (p < end && *p != '\n') ++p;
+    return p < end ? p + 1 : end;
+}
+
+const char *dealWithKeywordOrIdent(const char *p, const char *end) {
+    const char *start = p;
+    while (p < end && (isLetter(*p) || isDigit(*p))) ++p;
+    auto len = (unsigned int) (p - start);
+    TokenType type = keywordOrIdent(start, len);
+    tokenInfoList.emplace_back(type, start, len);
+    if (type == IDENT) tokenInfoList.back().setIdentId(internIdentifier({start, len}));
+    return p;
 }
 
-void dealWithConstDigit(FILE *in) {
+const char *dealWithConstDigit(const char *p, const char *end) {
     // deal with 0Xxxx
-    bool isHex = false;
-    bool isOct = false;
-    if (c == '0') {
-        c = fgetc(in);
-        if (c == 'x' || c == 'X') {
-            isHex = true;
-            c = fgetc(in);
+    int base = 10;
+    if (*p == '0') {
+        if (p + 1 < end && (p[1] == 'x' || p[1] == 'X')) {
+            base = 16;
+            p += 2;
         } else {
-            isOct = true;
-            fseek(in, -1L, 1);
-            c = '0';
+            base = 8;
         }
     }
-    while (isDigit()) {
-        catToken();
-        c = fgetc(in);
-    }
-    long long integer = strToInt(isHex, isOct);
-    fseek(in, -1L, 1);
-    TokenInfo tmp(INTCONST);
-    tmp.setName(token);
+    const char *start = p;
+    while (p < end && isDigit(*p)) ++p;
+    long long integer = strToInt(start, p, base);
+    TokenInfo tmp(INTCONST, start, (unsigned int) (p - start));
     if (integer == 2147483648 && tokenInfoList[tokenInfoList.size() - 1].getSym() == MINUS) {
         tokenInfoList.pop_back();
         tmp.setValue(-integer);
@@ -126,90 +153,97 @@ void dealWithConstDigit(FILE *in) {
         tmp.setValue(integer);
     }
     tokenInfoList.push_back(tmp);
+    return p;
 }
 
-void dealWithStr(FILE *in) {
-    while (true) {
-        c = fgetc(in);
-        catToken();
-        if (c == '"') {
-            break;
-        }
-    }
-    TokenInfo tmp(STRCONST);
-    tmp.setName(token);
-    tokenInfoList.push_back(tmp);
+const char *dealWithStr(const char *p, const char *end) {
+    const char *start = ++p; // the name keeps the closing quote only.
+    while (p < end && *p != '"') ++p;
+    if (p < end) ++p;
+    tokenInfoList.emplace_back(STRCONST, start, (unsigned int) (p - start));
+    return p;
 }
 
-void dealWithOtherTk(FILE *in) {
-    switch (c) {
+const char *dealWithOtherTk(const char *p, const char *end) {
+    TokenType type;
+    unsigned int len = 1;
+    switch (*p) {
         case '+':
+            type = PLUS;
+            break;
         case '-':
+            type = MINUS;
+            break;
         case '*':
+            type = MULT;
+            break;
         case '/':
+            type = DIV;
+            break;
         case '%':
-        case ':':
+            type = REMAIN;
+            break;
         case '(':
+            type = LPAREN;
+            break;
         case ')':
+            type = RPAREN;
+            break;
         case '[':
+            type = LBRACKET;
+            break;
         case ']':
+            type = RBRACKET;
+            break;
         case '{':
+            type = LBRACE;
+            break;
         case '}':
+            type = RBRACE;
+            break;
         case ',':
-        case ';': {
-            TokenInfo tmp(reverseTable.at(string(1, c)));
-            tmp.setName(string(1, c));
-            tokenInfoList.push_back(tmp);
+            type = COMMA;
+            break;
+        case ';':
+            type = SEMICOLON;
             break;
-        }
         case '|':
-        case '&': {
-            fgetc(in);
-            TokenInfo tmp(reverseTable.at(string(2, c)));
-            tmp.setName(string(2, c));
-            tokenInfoList.push_back(tmp);
+            type = OR;
+            len = 2;
+            break;
+        case '&':
+            type = AND;
+            len = 2;
             break;
-        }
         case '<':
         case '>':
         case '!':
         case '=': {
-            catToken();
-            c = fgetc(in);
-            if (c == '=') {
-                catToken();
-            } else {
-                fseek(in, -1L, 1);
-            }
-            TokenInfo tmp(reverseTable.at(token));
-            tmp.setName(token);
-            tokenInfoList.push_back(tmp);
+            bool withEqual = p + 1 < end && p[1] == '=';
+            if (*p == '<') type = withEqual ? LEQ : LESS;
+            else if (*p == '>') type = withEqual ? LAQ : LARGE;
+            else if (*p == '!') type = withEqual ? NEQUAL : NOT;
+            else type = withEqual ? EQUAL : ASSIGN;
+            if (withEqual) len = 2;
             break;
         }
         default:
-            break;
-    }
-}
-
-void skipIllegalChar(FILE *in) {
-    while (!isNewline() && c < 32) {
-        c = fgetc(in);
-        if (c == EOF) {
-            break;
-        }
+            return p + 1;
     }
+    if (p + len > end) len = end - p;
+    tokenInfoList.emplace_back(type, p, len);
+    return p + len;
 }
 
 bool lexicalAnalyze(const string &file) {
-    FILE *in = fopen(file.c_str(), "r");
-    if (!in) {
+    if (!loadSourceFile(file)) {
         return false;
     }
-    parseSym(in);
+    parseSym(sourceBuffer, sourceBuffer + sourceSize);
     if (_debugLexer) {
         FILE *out = fopen((debugMessageDirectory + "lexer.txt").c_str(), "w+");
         fprintf(out, "[Lexer]\n");
-        for (TokenInfo tokenInfo : tokenInfoList) {
+        for (TokenInfo &tokenInfo : tokenInfoList) {
             fprintf(out, "%s", tokenInfo.getName().c_str());
             if (tokenInfo.getSym() == INTCONST) {
                 fprintf(out, " %d", tokenInfo.getValue());
@@ -218,84 +252,57 @@ bool lexicalAnalyze(const string &file) {
         }
         fclose(out);
     }
-    fclose(in);
     return true;
 }
 
-void parseSym(FILE *in) {
-    while (c != EOF) {
-        clearToken();
-        c = fgetc(in);
-
-        skipIllegalChar(in);
-        skipSpaceOrNewlineOrTab(in);
+void parseSym(const char *begin, const char *end) {
+    tokenInfoList.reserve(tokenInfoList.size() + (end - begin) / 4 + 1);
+    const char *p = begin;
+    while (p < end) {
+        // spaces, newlines and other control characters.
+        if ((unsigned char) *p <= ' ') {
+            ++p;
+            continue;
+        }
 
         // perhaps comment
-        if (c == '/') {
-            c = fgetc(in);
-            if (c == '/') {
-                skipComment(2, in);
-                continue;
-            } else if (c == '*') {
-                skipComment(1, in);
-                continue;
-            } else {
-                fseek(in, -1L, 1);
-                c = '/';
-            }
+        if (*p == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*')) {
+            p = skipComment(p[1] == '*' ? 1 : 2, p + 2, end);
+            continue;
         }
 
-        if (isLetter()) {
-            dealWithKeywordOrIdent(in);
-        } else if (isDigit()) {
-            dealWithConstDigit(in);
-        } else if (c == '"') {// turn '/' to '/'
-            dealWithStr(in);
+        if (isLetter(*p)) {
+            p = dealWithKeywordOrIdent(p, end);
+        } else if (isDigit(*p)) {
+            p = dealWithConstDigit(p, end);
+        } else if (*p == '"') {// turn '/' to '/'
+            p = dealWithStr(p, end);
         } else {
-            dealWithOtherTk(in);
+            p = dealWithOtherTk(p, end);
         }
-
     }
     tokenInfoList.emplace_back(TokenType::END);
 }
 
-bool isSpace() {
-    return c == ' ';
+bool isLetter(char ch) {
+    return (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || (ch == '_');
 }
 
-bool isLetter() {
-    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c == '_');
+bool isDigit(char ch) {
+    return (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f');
 }
 
-bool isDigit() {
-    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
-}
-
-bool isTab() {
-    return c == '\t';
-}
-
-bool isNewline() {
-    return c == '\n';
-}
-
-void clearToken() {
-    token.clear();
-}
-
-void catToken() {
-    token.push_back(c);
-}
-
-long long strToInt(bool isHex, bool isOct) {
-    long long integer;
-    if (isHex) {
-        sscanf(token.c_str(), "%llx", &integer);
-    } else if (isOct) {
-        sscanf(token.c_str(), "%llo", &integer);
-    } else {
-        sscanf(token.c_str(), "%lld", &integer);
+// parse the leading digits valid in base, the same as sscanf.
+long long strToInt(const char *begin, const char *end, int base) {
+    long long integer = 0;
+    for (const char *p = begin; p < end; ++p) {
+        int digit;
+        if (*p >= '0' && *p <= '9') digit = *p - '0';
+        else if (*p >= 'a' && *p <= 'f') digit = *p - 'a' + 10;
+        else if (*p >= 'A' && *p <= 'F') digit = *p - 'A' + 10;
+        else break;
+        if (digit >= base) break;
+        integer = integer * base + digit;
     }
     return integer;
 }
-
@@ -3,6 +3,7 @@
 
 #include <cwchar>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using namespace std;
@@ -49,8 +50,10 @@ enum TokenType {
 class TokenInfo {
 private:
     TokenType symbol;
-    string name;
+    const char *text = nullptr; // view into the source buffer, alive until the program exits.
+    unsigned int length = 0;
     int value;
+    int identId = -1; // interned id of an IDENT token.
 
     // How to deal with different kinds of value?
     // for each type,
@@ -59,36 +62,39 @@ private:
 public:
     explicit TokenInfo(TokenType sym);
 
+    TokenInfo(TokenType sym, const char *text, unsigned int length);
+
     TokenType getSym();
 
     string getName();
 
+    [[nodiscard]] string_view getNameView() const;
+
     [[nodiscard]] int getValue() const;
 
-    void setName(string na);
+    [[nodiscard]] int getIdentId() const;
+
+    void setName(const char *t, unsigned int len);
 
     void setValue(int i);
+
+    void setIdentId(int id);
 };
 
 extern std::vector<TokenInfo> tokenInfoList;
 
-void parseSym(FILE *in);
-
-bool isSpace();
-
-bool isLetter();
-
-bool isDigit();
+/// interned identifier names indexed by id, the views must stay alive until the program exits.
+extern std::vector<string_view> identifierNames;
 
-bool isTab();
+int internIdentifier(string_view name);
 
-bool isNewline();
+void parseSym(const char *begin, const char *end);
 
-void clearToken();
+bool isLetter(char ch);
 
-void catToken();
+bool isDigit(char ch);
 
-long long strToInt(bool isHex, bool isOct);
+long long strToInt(const char *begin, const char *end, int base);
 
 bool lexicalAnalyze(const string &file);
 
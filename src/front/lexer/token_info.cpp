@@ -5,16 +5,28 @@ TokenInfo::TokenInfo(TokenType sym) {
     this->value = 0;
 }
 
+TokenInfo::TokenInfo(TokenType sym, const char *text, unsigned int length) {
+    this->symbol = sym;
+    this->text = text;
+    this->length = length;
+    this->value = 0;
+}
+
 TokenType TokenInfo::getSym() {
     return symbol;
 }
 
 string TokenInfo::getName() {
-    return name;
+    return string(text == nullptr ? "" : text, length);
+}
+
+string_view TokenInfo::getNameView() const {
+    return {text == nullptr ? "" : text, length};
 }
 
-void TokenInfo::setName(string na) {
-    this->name = std::move(na);
+void TokenInfo::setName(const char *t, unsigned int len) {
+    this->text = t;
+    this->length = len;
 }
 
 int TokenInfo::getValue() const {
@@ -24,3 +36,11 @@ int TokenInfo::getValue() const {
 void TokenInfo::setValue(int i) {
     this->value = i;
 }
+
+int TokenInfo::getIdentId() const {
+    return this->identId;
+}
+
+void TokenInfo::setIdentId(int id) {
+    this->identId = id;
+}
@@ -4,26 +4,48 @@
 #include <utility>
 #include <iostream>
 
-std::shared_ptr<SymbolTableItem> findSymbol(std::pair<int, int> startBlockId, std::string &symbolName, bool isF) {
-    std::string findName = (isF ? "F*" : "V*") + symbolName;
-    if (symbolTable[startBlockId]->symbolTableThisBlock.find(findName) !=
-        symbolTable[startBlockId]->symbolTableThisBlock.end()) {
-        return symbolTable[startBlockId]->symbolTableThisBlock[findName];
-    } else {
-        while (!symbolTable[startBlockId]->isTop) {
-            startBlockId = symbolTable[startBlockId]->fatherBlockId;
-            if (symbolTable[startBlockId]->symbolTableThisBlock.find(findName) !=
-                symbolTable[startBlockId]->symbolTableThisBlock.end()) {
-                return symbolTable[startBlockId]->symbolTableThisBlock[findName];
-            }
-        }
+/// binding stacks indexed by identifier id, the innermost binding is at the back.
+static std::vector<std::vector<std::shared_ptr<SymbolTableItem>>> varBindings; // NOLINT
+static std::vector<std::vector<std::shared_ptr<SymbolTableItem>>> funcBindings; // NOLINT
+
+static int varIdCount = 0;
+
+inline bool isFuncSymbol(const std::shared_ptr<SymbolTableItem> &symbol) {
+    return symbol->symbolType == SymbolType::VOID_FUNC || symbol->symbolType == SymbolType::RET_FUNC;
+}
+
+inline std::vector<std::shared_ptr<SymbolTableItem>> &bindingsOf(int identId, bool isF) {
+    auto &bindings = isF ? funcBindings : varBindings;
+    if (identId >= (int) bindings.size()) bindings.resize(identId + 1);
+    return bindings[identId];
+}
+
+std::shared_ptr<SymbolTableItem> findSymbol(int identId, bool isF) {
+    auto &bindings = isF ? funcBindings : varBindings;
+    if (identId >= 0 && identId < (int) bindings.size() && !bindings[identId].empty()) {
+        return bindings[identId].back();
     }
     cerr << "findSymbol: Source code may have errors." << endl;
     return nullptr;
-} // NOLINT
+}
 
 void insertSymbol(std::pair<int, int> blockId, std::shared_ptr<SymbolTableItem> symbol) {
-    symbolTable[blockId]->symbolTableThisBlock[symbol->uniqueName] = std::move(symbol);
+    symbol->varId = varIdCount++;
+    bindingsOf(symbol->identId, isFuncSymbol(symbol)).push_back(symbol);
+    symbolTable[blockId]->symbolTableThisBlock.push_back(std::move(symbol));
+}
+
+void enterBlock(std::pair<int, int> blockId) {
+    for (auto &symbol : symbolTable[blockId]->symbolTableThisBlock) {
+        bindingsOf(symbol->identId, isFuncSymbol(symbol)).push_back(symbol);
+    }
+}
+
+void exitBlock(std::pair<int, int> blockId) {
+    auto &symbols = symbolTable[blockId]->symbolTableThisBlock;
+    for (auto it = symbols.rbegin(); it != symbols.rend(); ++it) {
+        bindingsOf((*it)->identId, isFuncSymbol(*it)).pop_back();
+    }
 }
 
 void insertBlock(std::pair<int, int> blockId, std::pair<int, int> fatherBlockId) {
@@ -11,17 +11,17 @@
 
 /**
  * @brief: Symbol Table in a particular Block.
- * Include a fatherBlockId to find father block,
- * when find a symbol, and the symbol is not find in this block,
- * if isTop == false. try to find this symbol in its father block.
+ * Include a fatherBlockId to find father block.
  * if isTop == true, fatherBlockId is {0, 0}.
+ * The symbols are kept in define order, their bindings are pushed when the block is entered
+ * and popped when the block is exited.
  */
 class SymbolTablePerBlock {
 public:
     std::pair<int, int> blockId;
     bool isTop;
     std::pair<int, int> fatherBlockId;
-    std::unordered_map<std::string, std::shared_ptr<SymbolTableItem>> symbolTableThisBlock;
+    std::vector<std::shared_ptr<SymbolTableItem>> symbolTableThisBlock;
 
     SymbolTablePerBlock(std::pair<int, int> &blockId, bool &isTop, std::pair<int, int> &fatherBlockId)
             : blockId(blockId), isTop(isTop), fatherBlockId(fatherBlockId) {};
@@ -31,16 +31,29 @@ extern std::unordered_map<std::pair<int, int>, std::shared_ptr<SymbolTablePerBlo
 
 /**
  * @brief about Symbol Table
- * @details find symbol by start block id, Recursion find till the top block.
+ * @details find the innermost binding of the identifier in the blocks entered.
  * Should distinguish Function & Variable, for they may have the same name in one block.
- * @param startBlockId: finding start block id, change in this function during recursion.
- * @param symbolName: name of the finding symbol.
+ * @param identId: interned id of the finding symbol's name.
  * @return SymbolTableItem of the finding item.
  */
-extern std::shared_ptr<SymbolTableItem> findSymbol(std::pair<int, int> startBlockId, std::string &symbolName, bool isF);
+extern std::shared_ptr<SymbolTableItem> findSymbol(int identId, bool isF);
 
+/**
+ * @brief insert the symbol into the innermost entered block and distribute its varId.
+ * symbol->identId should be set before.
+ */
 extern void insertSymbol(std::pair<int, int> blockId, std::shared_ptr<SymbolTableItem> symbol);
 
+/**
+ * @brief push the bindings of the symbols already in the block, used when a block is entered again.
+ */
+extern void enterBlock(std::pair<int, int> blockId);
+
+/**
+ * @brief pop the bindings of the symbols in the block.
+ */
+extern void exitBlock(std::pair<int, int> blockId);
+
 /// record per layer's num.
 /// <2, ...> if ...max is 2, record <2, 2>, next layer2 block id is <2, 3>
 extern std::unordered_map<int, int> blockLayerId2LayerNum;
@@ -216,11 +216,13 @@ shared_ptr<IdentNode> getIdentDefine(bool isF, bool isVoid, bool isConst) {
         std::cout << "--------getIdentDefine--------\n";
     }
     std::string name = nowPointerToken->getName();
+    int identId = nowPointerToken->getIdentId();
     popNextLexer();
     if (isF) {
         SymbolType symbolType = isVoid ? SymbolType::VOID_FUNC : SymbolType::RET_FUNC;
         auto symbolTableItem = std::make_shared<SymbolTableItem>(symbolType, name, nowLayId);
         nowFuncSymbol = symbolTableItem;
+        symbolTableItem->identId = identId;
         insertSymbol(nowLayId, symbolTableItem);
         return std::make_shared<IdentNode>(symbolTableItem);
     }
@@ -238,12 +240,14 @@ shared_ptr<IdentNode> getIdentDefine(bool isF, bool isVoid, bool isConst) {
         if (openFolder && !lockingOpenFolder) {
             lastAssignOrDeclVar = symbolTableItem;
         }
+        symbolTableItem->identId = identId;
         insertSymbol(nowLayId, symbolTableItem);
         return std::make_shared<IdentNode>(symbolTableItem);
     } else {
         SymbolType symbolType = (isConst ? SymbolType::CONST_ARRAY : SymbolType::ARRAY);
         auto symbolTableItem = std::make_shared<SymbolTableItem>(symbolType, dimension, numOfEachDimension, name,
                                                                  nowLayId);
+        symbolTableItem->identId = identId;
         insertSymbol(nowLayId, symbolTableItem);
         return std::make_shared<IdentNode>(symbolTableItem);
     }
@@ -261,6 +265,7 @@ shared_ptr<IdentNode> getIdentDefineInFunction() {
         std::cout << "--------getIdentDefine--------\n";
     }
     std::string name = nowPointerToken->getName();
+    int identId = nowPointerToken->getIdentId();
     popNextLexer();
     int dimension = 0;
     std::vector<int> numOfEachDimension;
@@ -279,12 +284,14 @@ shared_ptr<IdentNode> getIdentDefineInFunction() {
     if (dimension == 0) {
         SymbolType symbolType = (SymbolType::VAR);
         auto symbolTableItem = std::make_shared<SymbolTableItem>(symbolType, name, nowLayId);
+        symbolTableItem->identId = identId;
         insertSymbol(nowLayId, symbolTableItem);
         return std::make_shared<IdentNode>(symbolTableItem);
     } else {
         SymbolType symbolType = (SymbolType::ARRAY);
         auto symbolTableItem = std::make_shared<SymbolTableItem>(symbolType, dimension, numOfEachDimension, name,
                                                                  nowLayId);
+        symbolTableItem->identId = identId;
         insertSymbol(nowLayId, symbolTableItem);
         return std::make_shared<IdentNode>(symbolTableItem);
     }
@@ -305,8 +312,9 @@ shared_ptr<IdentNode> getIdentUsage(bool isF) {
         std::cout << "--------getIdentUsage--------\n";
     }
     std::string name = nowPointerToken->getName();
+    int identId = nowPointerToken->getIdentId();
     popNextLexer();
-    auto symbolInTable = findSymbol(nowLayId, name, isF);
+    auto symbolInTable = findSymbol(identId, isF);
     if (symbolInTable->eachFuncUseNum.find(nowFuncSymbol->usageName) == symbolInTable->eachFuncUseNum.end()) {
         symbolInTable->eachFuncUseNum[nowFuncSymbol->usageName] = 0;
         symbolInTable->eachFunc.push_back(nowFuncSymbol);
@@ -332,8 +340,9 @@ shared_ptr<IdentNode> getIdentUsage(bool isF) {
                 whileControlVarAssignNum += 2;
             }
         }
-        return std::make_shared<IdentNode>(
-                std::make_shared<SymbolTableItem>(symbolInTable->symbolType, name, symbolInTable->blockId));
+        auto symbolInIdent = std::make_shared<SymbolTableItem>(symbolInTable->symbolType, name, symbolInTable->blockId);
+        symbolInIdent->varId = symbolInTable->varId;
+        return std::make_shared<IdentNode>(symbolInIdent);
     } else {
         std::vector<std::shared_ptr<ExpNode>> expressionOfEachDimension;
         while (nowPointerToken->getSym() == TokenType::LBRACKET) {
@@ -350,6 +359,7 @@ shared_ptr<IdentNode> getIdentUsage(bool isF) {
             symbolInIdent->constInitVal = symbolInTable->constInitVal;
         }
         symbolInIdent->numOfEachDimension = symbolInTable->numOfEachDimension;
+        symbolInIdent->varId = symbolInTable->varId;
         return std::make_shared<IdentNode>(symbolInIdent);
     }
 }
@@ -574,9 +584,9 @@ int getConstVarExp() {
     if (_debugSyntax) {
         std::cout << "--------getConstVarExp--------\n";
     }
-    std::string name = nowPointerToken->getName();
+    int identId = nowPointerToken->getIdentId();
     popNextLexer(); // IDENT
-    auto symbolInTable = findSymbol(nowLayId, name, false);
+    auto symbolInTable = findSymbol(identId, false);
     int dimension = symbolInTable->dimension;
     vector<shared_ptr<ConstInitValNode>> valList;
     if (dimension > 0) {
@@ -787,6 +797,7 @@ shared_ptr<FuncDefNode> analyzeFuncDef() {
     }
     popNextLexer(); // RPAREN
     nowLayer--;
+    exitBlock(layIdInFuncFParams);
     nowLayId = fatherLayId;
     auto block = analyzeBlock(true, isVoid, false);
     if (hasParams) {
@@ -835,6 +846,7 @@ shared_ptr<BlockNode> analyzeBlock(bool isFuncBlock, bool isVoid, bool isInWhile
     nowLayer++;
     if (isFuncBlock) {
         nowLayId = layIdInFuncFParams;
+        enterBlock(nowLayId);
     } else {
         nowLayId = distributeBlockId(nowLayer, fatherLayId);
     }
@@ -860,6 +872,7 @@ shared_ptr<BlockNode> analyzeBlock(bool isFuncBlock, bool isVoid, bool isInWhile
     }
     popNextLexer(); // RBRACE
     nowLayer--;
+    exitBlock(nowLayId);
     nowLayId = fatherLayId;
     return std::make_shared<BlockNode>(itemCnt, blockItems);
 }
@@ -1306,9 +1319,9 @@ std::shared_ptr<CompUnitNode> analyzeCompUnit() {
             declList.push_back(analyzeDecl());
         }
     }
-    for (const auto &symbolTableItem : symbolTable[{0, 1}]->symbolTableThisBlock) {
-        if (symbolTableItem.second->isVarSingleUseInUnRecursionFunction()) {
-            usageNameListOfVarSingleUseInUnRecursionFunction[symbolTableItem.second->usageName] = symbolTableItem.second->eachFunc[0]->usageName;
+    for (const auto &symbolTableItem : symbolTable[globalLayId]->symbolTableThisBlock) {
+        if (symbolTableItem->isVarSingleUseInUnRecursionFunction()) {
+            usageNameListOfVarSingleUseInUnRecursionFunction[symbolTableItem->usageName] = symbolTableItem->eachFunc[0]->usageName;
         }
     }
     return std::make_shared<CompUnitNode>(declList, funcDefList);
@@ -1416,10 +1429,12 @@ std::shared_ptr<CompUnitNode> syntaxAnalyze() {
     string voidNames[] = {"putint", "putch", "putarray", "putf", "starttime", "stoptime"};
     for (string &retName : retNames) {
         auto retFunc = std::make_shared<SymbolTableItem>(retFuncType, retName, nowLayId);
+        retFunc->identId = internIdentifier(retFunc->name);
         insertSymbol(nowLayId, retFunc);
     }
     for (string &voidName : voidNames) {
         auto voidFunc = std::make_shared<SymbolTableItem>(voidFuncType, voidName, nowLayId);
+        voidFunc->identId = internIdentifier(voidFunc->name);
         insertSymbol(nowLayId, voidFunc);
     }
     return analyzeCompUnit();
@@ -232,9 +232,6 @@ SymbolTableItem::SymbolTableItem(SymbolType &symbolType, int &dimension,
     this->usageName =
             ((this->symbolType == SymbolType::VOID_FUNC || this->symbolType == SymbolType::RET_FUNC) ? "F_" :
              "V_") + std::to_string(blockId.first) + '_' + std::to_string(blockId.second) + '_' + name;
-    this->uniqueName =
-            ((this->symbolType == SymbolType::VOID_FUNC || this->symbolType == SymbolType::RET_FUNC) ? "F$" :
-             "V$") + name;
 }
 
 SymbolTableItem::SymbolTableItem(SymbolType &symbolType, std::string &name, std::pair<int, int> &blockId) :
@@ -243,12 +240,8 @@ SymbolTableItem::SymbolTableItem(SymbolType &symbolType, std::string &name, std:
     this->usageName =
             ((this->symbolType == SymbolType::VOID_FUNC || this->symbolType == SymbolType::RET_FUNC) ? "F_" :
              "V_") + std::to_string(blockId.first) + "_" + std::to_string(blockId.second) + '_' + name;
-    this->uniqueName =
-            ((this->symbolType == SymbolType::VOID_FUNC || this->symbolType == SymbolType::RET_FUNC) ? "F*" :
-             "V*") + name;
     if (symbolType == SymbolType::RET_FUNC && name == "main") {
         this->usageName = "main";
-        this->uniqueName = "main";
     }
 };
 
@@ -261,9 +254,6 @@ SymbolTableItem::SymbolTableItem(SymbolType &symbolType, int &dimension,
     this->usageName =
             ((this->symbolType == SymbolType::VOID_FUNC || this->symbolType == SymbolType::RET_FUNC) ? "F_" :
              "V_") + std::to_string(blockId.first) + "_" + std::to_string(blockId.second) + '_' + name;
-    this->uniqueName =
-            ((this->symbolType == SymbolType::VOID_FUNC || this->symbolType == SymbolType::RET_FUNC) ? "F*" :
-             "V*") + name;
 }
 
 bool SymbolTableItem::isVarSingleUseInUnRecursionFunction() {
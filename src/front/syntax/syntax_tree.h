@@ -102,9 +102,8 @@ enum SymbolType {
  * usageName is for distinguishing symbols which may have same name in IR.
  * a(int, function) in Block <2, 1> is renamed to F*2_1$a.
  * b(int, VAR) in Block <3, 2> is renamed to V*3_2$b.
- * uniqueName is set to be the key distinguish F & V in the same Block.
- * a(int, function) in Block <2, 1> is renamed to F*a.
- * b(int, VAR) in Block <3, 2> is renamed to V*b.
+ * identId is the interned id of name, used to find the innermost binding in the symbol table.
+ * varId is unique for each defined symbol, used to key local variables when building SSA.
  * @param globalVarInitVal For all the global var's val is 0 or can be calculate,
  * Use ConstInitValNode to calculate it.
  */
@@ -115,9 +114,10 @@ public:
     std::vector<int> numOfEachDimension;
     std::vector<std::shared_ptr<ExpNode>> expressionOfEachDimension;
     std::string name;
-    std::string uniqueName;
     std::string usageName;
     std::pair<int, int> blockId;
+    int identId = -1; // interned id of name.
+    int varId = -1; // unique id of the defined symbol, shared by its usages.
     shared_ptr<ConstInitValNode> constInitVal;
     shared_ptr<InitValNode> initVal;
     shared_ptr<ConstInitValNode> globalVarInitVal;
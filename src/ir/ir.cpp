@@ -1,6 +1,8 @@
 #include "ir.h"
 
 #include <cmath>
+#include <iostream>
+#include <algorithm>
 
 unsigned int Value::valueId = 0;
 
@@ -8,6 +10,89 @@ unsigned int Value::getValueId() {
     return valueId++;
 }
 
+IrOp toIrOp(const string &op) {
+    for (int i = OP_ADD; i <= OP_NOT; ++i) {
+        if (op == irOpInfo[i].name) return (IrOp) i;
+    }
+    cerr << "Error occurs in process IR build: undefined operator '" + op + "'." << endl;
+    return OP_ADD;
+}
+
+void Use::init(Value *u, shared_ptr<Value> *s) {
+    unlink();
+    user = u;
+    slot = s;
+    link();
+}
+
+void Use::link() {
+    if (value != nullptr || slot == nullptr || *slot == nullptr) return;
+    value = slot->get();
+    prev = nullptr;
+    next = value->useHead;
+    if (next != nullptr) next->prev = this;
+    value->useHead = this;
+}
+
+void Use::unlink() {
+    if (value == nullptr) return;
+    if (prev != nullptr) prev->next = next;
+    else value->useHead = next;
+    if (next != nullptr) next->prev = prev;
+    value = nullptr;
+    prev = next = nullptr;
+}
+
+void Use::set(const shared_ptr<Value> &newValue) {
+    unlink();
+    *slot = newValue;
+    link();
+}
+
+bool Value::hasOneUser() const {
+    if (useHead == nullptr) return false;
+    for (Use *use = useHead->next; use != nullptr; use = use->next) {
+        if (use->user != useHead->user) return false;
+    }
+    return true;
+}
+
+bool Value::isUsedBy(const Value *user) const {
+    for (Use *use = useHead; use != nullptr; use = use->next) {
+        if (use->user == user) return true;
+    }
+    return false;
+}
+
+vector<shared_ptr<Value>> Value::getUsers() const {
+    vector<shared_ptr<Value>> users;
+    unordered_set<Value *> visited;
+    for (Use *use = useHead; use != nullptr; use = use->next) {
+        if (visited.insert(use->user).second) {
+            users.push_back(use->user->shared_from_this());
+        }
+    }
+    return users;
+}
+
+/**
+ * Block users only keep phis linked, the same as BasicBlock::replaceUse.
+ */
+void Value::replaceAllUsesWith(const shared_ptr<Value> &replaceValue) {
+    if (replaceValue.get() == this) return;
+    shared_ptr<Value> self = shared_from_this();
+    bool replaceIsPhi = dynamic_cast<PhiInstruction *>(replaceValue.get()) != nullptr;
+    while (useHead != nullptr) {
+        Use *use = useHead;
+        if (use->user->valueType == ValueType::BASIC_BLOCK && !replaceIsPhi) {
+            use->unlink();
+            *use->slot = replaceValue;
+        } else {
+            use->set(replaceValue);
+        }
+    }
+}
+
 ConstantValue::ConstantValue(shared_ptr<ConstDefNode> &constDef) : BaseValue(ValueType::CONSTANT) {
     name = constDef->ident->ident->usageName;
     dimensions = constDef->ident->ident->numOfEachDimension;
@@ -94,17 +179,23 @@ bool Function::fitInline(unsigned int maxInsCnt, unsigned int maxPointerSituatio
 }
 
 void BasicBlock::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
     for (auto &it : localVarSsaMap) {
         if (it.second == toBeReplaced) {
-            toBeReplaced->users.erase(self);
-            it.second = replaceValue;
-            if (dynamic_cast<PhiInstruction *>(replaceValue.get()))
-                replaceValue->users.insert(self);
+            writeLocalVariable(it.first, replaceValue);
         }
     }
 }
 
+void BasicBlock::writeLocalVariable(int varId, const shared_ptr<Value> &value) {
+    shared_ptr<Value> &slot = localVarSsaMap[varId];
+    Use &use = localVarUses[varId];
+    use.unlink();
+    slot = value;
+    if (dynamic_cast<PhiInstruction *>(value.get())) {
+        use.init(this, &slot);
+    }
+}
+
 void BasicBlock::abandonUse() {
     if (!valid) return;
     valid = false;
@@ -155,39 +246,27 @@ bool StringValue::equals(shared_ptr<Value> &value) {
 }
 
 void ReturnInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
-    if (value == toBeReplaced) {
-        value->users.erase(self);
-        value = replaceValue;
-        replaceValue->users.insert(self);
-    }
+    if (value == toBeReplaced) valueUse.set(replaceValue);
 }
 
 void ReturnInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
-    value->users.erase(self);
-    if (value->users.empty() && !dynamic_cast<InvokeInstruction *>(value.get())) {
+    valueUse.unlink();
+    if (value->hasNoUser() && !dynamic_cast<InvokeInstruction *>(value.get())) {
         value->abandonUse();
     }
 }
 
 void BranchInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
-    if (condition == toBeReplaced) {
-        condition->users.erase(self);
-        condition = replaceValue;
-        replaceValue->users.insert(self);
-    }
+    if (condition == toBeReplaced) conditionUse.set(replaceValue);
 }
 
 void BranchInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
-    condition->users.erase(self);
-    if (condition->users.empty() && !dynamic_cast<InvokeInstruction *>(condition.get())) {
+    conditionUse.unlink();
+    if (condition->hasNoUser() && !dynamic_cast<InvokeInstruction *>(condition.get())) {
         condition->abandonUse();
     }
 }
@@ -211,25 +290,26 @@ unordered_map<string, InvokeType> InvokeInstruction::sysFuncMap{ // NOLINT
         {"stoptime",  InvokeType::STOP_TIME}
 };
 
+void InvokeInstruction::linkParams() {
+    paramUses.reset(new Use[params.size()]);
+    for (int i = 0; i < params.size(); ++i) {
+        paramUses[i].init(this, &params[i]);
+    }
+}
+
 void InvokeInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
-    for (auto &arg : params) {
-        if (arg == toBeReplaced) {
-            arg->users.erase(self);
-            arg = replaceValue;
-            replaceValue->users.insert(self);
-        }
+    for (int i = 0; i < params.size(); ++i) {
+        if (params[i] == toBeReplaced) paramUses[i].set(replaceValue);
     }
 }
 
 void InvokeInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
-    for (auto &arg : params) {
-        arg->users.erase(self);
-        if (arg->users.empty() && !dynamic_cast<InvokeInstruction *>(arg.get())) {
-            arg->abandonUse();
+    for (int i = 0; i < params.size(); ++i) {
+        paramUses[i].unlink();
+        if (params[i]->hasNoUser() && !dynamic_cast<InvokeInstruction *>(params[i].get())) {
+            params[i]->abandonUse();
         }
     }
 }
@@ -240,20 +320,14 @@ bool InvokeInstruction::equals(shared_ptr<Value> &value) {
 }
 
 void UnaryInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
-    if (value == toBeReplaced) {
-        value->users.erase(self);
-        value = replaceValue;
-        replaceValue->users.insert(self);
-    }
+    if (value == toBeReplaced) valueUse.set(replaceValue);
 }
 
 void UnaryInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
-    value->users.erase(self);
-    if (value->users.empty() && !dynamic_cast<InvokeInstruction *>(value.get())) {
+    valueUse.unlink();
+    if (value->hasNoUser() && !dynamic_cast<InvokeInstruction *>(value.get())) {
         value->abandonUse();
     }
 }
@@ -268,40 +342,36 @@ bool UnaryInstruction::equals(shared_ptr<Value> &val) {
 }
 
 void BinaryInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
-    if (lhs == toBeReplaced) {
-        lhs->users.erase(self);
-        lhs = replaceValue;
-        replaceValue->users.insert(self);
-    }
-    if (rhs == toBeReplaced) {
-        rhs->users.erase(self);
-        rhs = replaceValue;
-        replaceValue->users.insert(self);
-    }
+    if (lhs == toBeReplaced) lhsUse.set(replaceValue);
+    if (rhs == toBeReplaced) rhsUse.set(replaceValue);
 }
 
 void BinaryInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
-    lhs->users.erase(self);
-    rhs->users.erase(self);
-    if (lhs->users.empty() && !dynamic_cast<InvokeInstruction *>(lhs.get())) {
+    lhsUse.unlink();
+    rhsUse.unlink();
+    if (lhs->hasNoUser() && !dynamic_cast<InvokeInstruction *>(lhs.get())) {
         lhs->abandonUse();
     }
-    if (rhs->users.empty() && !dynamic_cast<InvokeInstruction *>(rhs.get())) {
+    if (rhs->hasNoUser() && !dynamic_cast<InvokeInstruction *>(rhs.get())) {
         rhs->abandonUse();
     }
 }
 
+void BinaryInstruction::swapOperands() {
+    shared_ptr<Value> temp = lhs;
+    lhsUse.set(rhs);
+    rhsUse.set(temp);
+}
+
 bool BinaryInstruction::equals(shared_ptr<Value> &value) {
     shared_ptr<Value> self = shared_from_this();
     if (value == self) return true;
     if (!dynamic_cast<BinaryInstruction *>(value.get())) return false;
     shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(value);
     if (binary->lhs == lhs && binary->rhs == rhs && binary->op == op) return true;
-    if ((binary->op == "+" || binary->op == "*") && binary->op == op) {
+    if (isCommutativeOp(op) && binary->op == op) {
         if (binary->lhs == rhs && binary->rhs == lhs) return true;
         return (binary->lhs->equals(rhs) && binary->rhs->equals(lhs))
                || (binary->lhs->equals(lhs) && binary->rhs->equals(rhs));
@@ -322,58 +392,90 @@ bool AllocInstruction::equals(shared_ptr<Value> &value) {
 }
 
 void StoreInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
-    if (value == toBeReplaced) {
-        value->users.erase(self);
-        value = replaceValue;
-        replaceValue->users.insert(self);
+    if (value == toBeReplaced) valueUse.set(replaceValue);
+    if (address == toBeReplaced) addressUse.set(replaceValue);
+    if (offset == toBeReplaced) offsetUse.set(replaceValue);
+}
+
+void StoreInstruction::abandonUse() {
+    if (!valid) return;
+    valid = false;
+    valueUse.unlink();
+    addressUse.unlink();
+    offsetUse.unlink();
+    if (value->hasNoUser() && !dynamic_cast<InvokeInstruction *>(value.get())) value->abandonUse();
+    if (address->hasNoUser() && !dynamic_cast<InvokeInstruction *>(address.get())) address->abandonUse();
+    if (offset->hasNoUser() && !dynamic_cast<InvokeInstruction *>(offset.get())) offset->abandonUse();
+}
+
+void MemsetInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
+    if (value == toBeReplaced) valueUse.set(replaceValue);
+    if (address == toBeReplaced) addressUse.set(replaceValue);
+}
+
+void MemsetInstruction::abandonUse() {
+    if (!valid) return;
+    valid = false;
+    valueUse.unlink();
+    addressUse.unlink();
+    if (value->hasNoUser() && !dynamic_cast<InvokeInstruction *>(value.get())) value->abandonUse();
+    if (address->hasNoUser() && !dynamic_cast<InvokeInstruction *>(address.get())) address->abandonUse();
+}
+
+void VectorInstruction::linkOperands() {
+    operandUses.reset(new Use[operands.size()]);
+    for (int i = 0; i < operands.size(); ++i) {
+        operandUses[i].init(this, &operands[i]);
     }
-    if (address == toBeReplaced) {
-        address->users.erase(self);
-        address = replaceValue;
-        replaceValue->users.insert(self);
+}
+
+bool VectorInstruction::hasReduction() const {
+    return any_of(ops.begin(), ops.end(), [](const VectorOp &op) { return op.type == V_REDUCE; });
+}
+
+void VectorInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
+    for (int i = 0; i < operands.size(); ++i) {
+        if (operands[i] == toBeReplaced) operandUses[i].set(replaceValue);
     }
-    if (offset == toBeReplaced) {
-        offset->users.erase(self);
-        offset = replaceValue;
-        replaceValue->users.insert(self);
+}
+
+void VectorInstruction::abandonUse() {
+    if (!valid) return;
+    valid = false;
+    for (int i = 0; i < operands.size(); ++i) {
+        operandUses[i].unlink();
+        if (operands[i]->hasNoUser() && !dynamic_cast<InvokeInstruction *>(operands[i].get())) {
+            operands[i]->abandonUse();
+        }
     }
 }
 
-void StoreInstruction::abandonUse() {
+void MemcpyInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
+    if (source == toBeReplaced) sourceUse.set(replaceValue);
+    if (address == toBeReplaced) addressUse.set(replaceValue);
+}
+
+void MemcpyInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
-    value->users.erase(self);
-    address->users.erase(self);
-    offset->users.erase(self);
-    if (value->users.empty() && !dynamic_cast<InvokeInstruction *>(value.get())) value->abandonUse();
-    if (address->users.empty() && !dynamic_cast<InvokeInstruction *>(address.get())) address->abandonUse();
-    if (offset->users.empty() && !dynamic_cast<InvokeInstruction *>(offset.get())) offset->abandonUse();
+    sourceUse.unlink();
+    addressUse.unlink();
+    if (source->hasNoUser() && !dynamic_cast<InvokeInstruction *>(source.get())) source->abandonUse();
+    if (address->hasNoUser() && !dynamic_cast<InvokeInstruction *>(address.get())) address->abandonUse();
 }
 
 void LoadInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
-    if (address == toBeReplaced) {
-        address->users.erase(self);
-        address = replaceValue;
-        replaceValue->users.insert(self);
-    }
-    if (offset == toBeReplaced) {
-        offset->users.erase(self);
-        offset = replaceValue;
-        replaceValue->users.insert(self);
-    }
+    if (address == toBeReplaced) addressUse.set(replaceValue);
+    if (offset == toBeReplaced) offsetUse.set(replaceValue);
 }
 
 void LoadInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
-    address->users.erase(self);
-    offset->users.erase(self);
-    if (address->users.empty() && !dynamic_cast<InvokeInstruction *>(address.get())) address->abandonUse();
-    if (offset->users.empty() && !dynamic_cast<InvokeInstruction *>(offset.get())) offset->abandonUse();
+    addressUse.unlink();
+    offsetUse.unlink();
+    if (address->hasNoUser() && !dynamic_cast<InvokeInstruction *>(address.get())) address->abandonUse();
+    if (offset->hasNoUser() && !dynamic_cast<InvokeInstruction *>(offset.get())) offset->abandonUse();
 }
 
 bool LoadInstruction::equals(shared_ptr<Value> &value) {
@@ -385,35 +487,40 @@ bool LoadInstruction::equals(shared_ptr<Value> &value) {
  * The phi instruction should not only replace value but basic block.
  */
 void PhiInstruction::replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) {
-    shared_ptr<Value> self = shared_from_this();
     for (auto &op : operands) {
-        if (op.second == toBeReplaced) {
-            op.second->users.erase(self);
-            replaceValue->users.insert(self);
-            op.second = replaceValue;
-        }
+        if (op.second == toBeReplaced) operandUses[op.first.get()].set(replaceValue);
     }
 }
 
 void PhiInstruction::replaceUse(shared_ptr<BasicBlock> &toBeReplaced, shared_ptr<BasicBlock> &replaceBlock) {
-    for (auto &op : operands) {
-        if (op.first == toBeReplaced) {
-            shared_ptr<Value> oldVal = op.second;
-            operands.erase(op.first);
-            operands[replaceBlock] = oldVal;
-            oldVal->users.erase(toBeReplaced);
-            return;
-        }
+    if (operands.count(toBeReplaced) == 0) return;
+    shared_ptr<Value> oldVal = operands.at(toBeReplaced);
+    removeOperand(toBeReplaced);
+    setOperand(replaceBlock, oldVal);
+}
+
+void PhiInstruction::setOperand(const shared_ptr<BasicBlock> &bb, const shared_ptr<Value> &val) {
+    shared_ptr<Value> &slot = operands[bb];
+    Use &use = operandUses[bb.get()];
+    if (use.slot == nullptr) {
+        slot = val;
+        use.init(this, &slot);
+    } else {
+        use.set(val);
     }
 }
 
+void PhiInstruction::removeOperand(const shared_ptr<BasicBlock> &bb) {
+    operandUses.erase(bb.get());
+    operands.erase(bb);
+}
+
 void PhiInstruction::abandonUse() {
     if (!valid) return;
     valid = false;
-    shared_ptr<Value> self = shared_from_this();
     for (auto &it : operands) {
-        it.second->users.erase(self);
-        if (it.second->users.empty() && !dynamic_cast<InvokeInstruction *>(it.second.get())) {
+        operandUses[it.first.get()].unlink();
+        if (it.second->hasNoUser() && !dynamic_cast<InvokeInstruction *>(it.second.get())) {
             it.second->abandonUse();
         }
     }
@@ -428,8 +535,8 @@ int PhiInstruction::getOperandValueCount(const shared_ptr<Value> &value) {
 }
 
 bool PhiInstruction::onlyHasBlockUserOrUserEmpty() {
-    for (auto &user : users) {
-        if (user->valueType != ValueType::BASIC_BLOCK) return false;
+    for (Use *use = useHead; use != nullptr; use = use->next) {
+        if (use->user->valueType != ValueType::BASIC_BLOCK) return false;
     }
     return true;
 }
@@ -452,10 +559,22 @@ unordered_map<int, shared_ptr<NumberValue>> numberValueMap;
 
 shared_ptr<NumberValue> getNumberValue(int number) {
     if (numberValueMap.count(number) == 0)
-        numberValueMap[number] = make_shared<NumberValue>(number);
+        numberValueMap[number] = newIr<NumberValue>(number);
     return numberValueMap.at(number);
 }
 
+/**
+ * Drop the handles into the arena before releasing it in one shot.
+ */
+Module::~Module() {
+    globalStrings.clear();
+    globalConstants.clear();
+    globalVariables.clear();
+    functions.clear();
+    numberValueMap.clear();
+    if (IrArena::active == arena.get()) IrArena::active = nullptr;
+}
+
 string generateArgumentLeftValueName(const string &functionName) {
     static unordered_map<string, int> functionCallTimesMap;
     if (functionCallTimesMap.count(functionName) != 0) {
@@ -3,17 +3,21 @@
 
 #include <string>
 #include <vector>
+#include <list>
 #include <map>
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
 
 #include "../front/syntax/syntax_tree.h"
+#include "ir_arena.h"
 
 using namespace std;
 
 class Value;
 
+class Use;
+
 class BasicBlock;
 
 class Function;
@@ -54,10 +58,18 @@ class LoadInstruction;
 
 class StoreInstruction;
 
+class MemsetInstruction;
+
+class MemcpyInstruction;
+
+class VectorInstruction;
+
 class PhiInstruction;
 
 class PhiMoveInstruction;
 
+class FunctionAnalysis;
+
 enum ValueType {
     CONSTANT,
     NUMBER,
@@ -88,7 +100,10 @@ enum InstructionType {
     LOAD,
     STORE,
     PHI,
-    PHI_MOV
+    PHI_MOV,
+    MEMSET,
+    MEMCPY,
+    VECTOR
 };
 
 enum InvokeType {
@@ -110,6 +125,103 @@ enum ResultType {
     OTHER_RESULT
 };
 
+/**
+ * Operators of unary and binary IR, OP_ADD, OP_SUB and OP_NOT are also the unary ones.
+ */
+enum IrOp {
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_AND,
+    OP_OR,
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_NOT
+};
+
+/**
+ * Properties of an operator, indexed by IrOp.
+ * inverse: the operator of !(a op b), swapped: the operator of (b op a), both themselves if not a comparison.
+ */
+struct IrOpInfo {
+    const char *name;
+    bool commutative;
+    bool comparison;
+    IrOp inverse;
+    IrOp swapped;
+};
+
+constexpr IrOpInfo irOpInfo[] = {
+        {"+",  true,  false, OP_ADD, OP_ADD},
+        {"-",  false, false, OP_SUB, OP_SUB},
+        {"*",  true,  false, OP_MUL, OP_MUL},
+        {"/",  false, false, OP_DIV, OP_DIV},
+        {"%",  false, false, OP_MOD, OP_MOD},
+        {"&&", true,  false, OP_AND, OP_AND},
+        {"||", true,  false, OP_OR,  OP_OR},
+        {"==", true,  true,  OP_NE,  OP_EQ},
+        {"!=", true,  true,  OP_EQ,  OP_NE},
+        {"<",  false, true,  OP_GE,  OP_GT},
+        {">",  false, true,  OP_LE,  OP_LT},
+        {"<=", false, true,  OP_GT,  OP_GE},
+        {">=", false, true,  OP_LT,  OP_LE},
+        {"!",  false, false, OP_NOT, OP_NOT}
+};
+
+constexpr const char *irOpName(IrOp op) { return irOpInfo[op].name; }
+
+constexpr bool isCommutativeOp(IrOp op) { return irOpInfo[op].commutative; }
+
+constexpr bool isComparisonOp(IrOp op) { return irOpInfo[op].comparison; }
+
+constexpr IrOp inverseOp(IrOp op) { return irOpInfo[op].inverse; }
+
+constexpr IrOp swappedOp(IrOp op) { return irOpInfo[op].swapped; }
+
+static_assert(sizeof(irOpInfo) / sizeof(irOpInfo[0]) == OP_NOT + 1, "irOpInfo must cover every IrOp.");
+
+/**
+ * Convert the operator string of the syntax tree to IrOp.
+ */
+IrOp toIrOp(const string &op);
+
+/**
+ * One operand slot of a user, linked into the use list of the value held by the slot.
+ * A slot must be changed by set(), never assigned directly, or the use list breaks.
+ */
+class Use {
+public:
+    Value *user = nullptr;
+    shared_ptr<Value> *slot = nullptr; // the operand field of user.
+    Value *value = nullptr; // the value whose use list holds this use, null if unlinked.
+    Use *prev = nullptr;
+    Use *next = nullptr;
+
+    Use() = default;
+
+    Use(Value *user, shared_ptr<Value> *slot) : user(user), slot(slot) { link(); };
+
+    Use(const Use &) = delete;
+
+    Use &operator=(const Use &) = delete;
+
+    ~Use() { unlink(); }
+
+    void init(Value *u, shared_ptr<Value> *s);
+
+    void link();
+
+    void unlink();
+
+    void set(const shared_ptr<Value> &newValue);
+};
+
 class Value : public enable_shared_from_this<Value> {
 private:
     static unsigned int valueId;
@@ -117,7 +229,7 @@ private:
 public:
     unsigned int id;
     ValueType valueType;
-    unordered_set<shared_ptr<Value>> users;
+    Use *useHead = nullptr; // the operand slots holding this value.
 
     bool valid = true;
 
@@ -125,6 +237,16 @@ public:
 
     explicit Value(ValueType valueType) : valueType(valueType), id(valueId++) {};
 
+    bool hasNoUser() const { return useHead == nullptr; }
+
+    bool hasOneUser() const;
+
+    bool isUsedBy(const Value *user) const;
+
+    vector<shared_ptr<Value>> getUsers() const;
+
+    void replaceAllUsesWith(const shared_ptr<Value> &replaceValue);
+
     virtual string toString() = 0;
 
     virtual void replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) = 0;
@@ -134,6 +256,10 @@ public:
     virtual unsigned long long hashCode() = 0;
 
     virtual bool equals(shared_ptr<Value> &value) = 0;
+
+    // the hash of an operand: instructions by id, since value numbering makes equal ones the same instruction,
+    // and the other values by content as their equals does.
+    unsigned long long operandHash() { return valueType == INSTRUCTION ? id : hashCode(); }
 };
 
 class Module : public Value {
@@ -143,7 +269,11 @@ public:
     vector<shared_ptr<Value>> globalVariables;
     vector<shared_ptr<Function>> functions;
 
-    Module() : Value(ValueType::MODULE) {};
+    unique_ptr<IrArena> arena; // owns every IR node created while this module is active.
+
+    Module() : Value(ValueType::MODULE), arena(new IrArena()) { IrArena::active = arena.get(); };
+
+    ~Module();
 
     string toString() override;
 
@@ -168,12 +298,14 @@ public:
     unordered_set<shared_ptr<Function>> callers;
 
     unordered_map<shared_ptr<Value>, unsigned int> variableWeight; // value <--> weight.
-    unordered_map<shared_ptr<Value>, string> variableRegs; // value <--> registers.
+    unordered_map<shared_ptr<Value>, int> variableRegs; // value <--> registers.
     unordered_set<shared_ptr<Value>> variableWithoutReg;
     unsigned int requiredStackSize = 0; // required size in bytes.
 
     bool hasSideEffect = true;
 
+    shared_ptr<FunctionAnalysis> analysis; // cached cfg analyses, see ir_analysis.h.
+
     unordered_map<string, VariableType> variables; // @Deprecated
 
     Function() : Value(ValueType::FUNCTION), funcType(FuncType::FUNC_VOID) {};
@@ -197,16 +329,18 @@ public:
 
     unordered_set<shared_ptr<BasicBlock>> predecessors;
     unordered_set<shared_ptr<BasicBlock>> successors;
-    vector<shared_ptr<Instruction>> instructions;
+    list<shared_ptr<Instruction>> instructions; // iterators stay valid across inserting and erasing.
     unordered_set<shared_ptr<PhiInstruction>> phis;
 
     unsigned int loopDepth = 1; // used for register weight counting.
+    bool unrolled = false; // the header of an unrolled loop or its remainder loop, which is not unrolled again.
     unordered_set<shared_ptr<Value>> aliveValues; // the values which are alive in this basic block.
 
-    unordered_map<string, shared_ptr<Value>> localVarSsaMap;
+    unordered_map<int, shared_ptr<Value>> localVarSsaMap; // keyed by SymbolTableItem::varId.
+    unordered_map<int, Use> localVarUses; // makes the block a user of the phis in localVarSsaMap.
 
     bool sealed = true; // used to mark if this block is sealed.
-    unordered_map<string, shared_ptr<PhiInstruction>> incompletePhis; // store incomplete phis.
+    unordered_map<int, shared_ptr<PhiInstruction>> incompletePhis; // store incomplete phis.
 
     BasicBlock() : Value(ValueType::BASIC_BLOCK) {};
 
@@ -217,6 +351,8 @@ public:
 
     void replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) override;
 
+    void writeLocalVariable(int varId, const shared_ptr<Value> &value);
+
     void abandonUse() override;
 
     unsigned long long hashCode() override { return 0; }
@@ -318,7 +454,7 @@ public:
 
     string getIdent() override;
 
-    unsigned long long hashCode() override { return 0; }
+    unsigned long long hashCode() override { return hash<string>()(name); }
 
     bool equals(shared_ptr<Value> &value) override;
 };
@@ -339,7 +475,7 @@ public:
 
     string getIdent() override;
 
-    unsigned long long hashCode() override { return 0; }
+    unsigned long long hashCode() override { return hash<string>()(name); }
 
     bool equals(shared_ptr<Value> &value) override;
 };
@@ -362,7 +498,7 @@ public:
 
     string getIdent() override;
 
-    unsigned long long hashCode() override { return 0; }
+    unsigned long long hashCode() override { return hash<string>()(name); }
 
     bool equals(shared_ptr<Value> &value) override;
 };
@@ -389,10 +525,11 @@ class ReturnInstruction : public Instruction {
 public:
     FuncType funcType;
     shared_ptr<Value> value;
+    Use valueUse;
 
     ReturnInstruction(FuncType funcType, shared_ptr<Value> &value, shared_ptr<BasicBlock> &bb)
             : Instruction(InstructionType::RET, bb, OTHER_RESULT),
-              funcType(funcType), value(value) {};
+              funcType(funcType), value(value), valueUse(this, &this->value) {};
 
     string toString() override;
 
@@ -413,11 +550,12 @@ public:
     shared_ptr<Value> condition;
     shared_ptr<BasicBlock> trueBlock;
     shared_ptr<BasicBlock> falseBlock;
+    Use conditionUse;
 
     BranchInstruction(shared_ptr<Value> &condition, shared_ptr<BasicBlock> &trueBlock,
                       shared_ptr<BasicBlock> &falseBlock, shared_ptr<BasicBlock> &bb)
             : Instruction(InstructionType::BR, bb, OTHER_RESULT), condition(condition),
-              trueBlock(trueBlock), falseBlock(falseBlock) {};
+              trueBlock(trueBlock), falseBlock(falseBlock), conditionUse(this, &this->condition) {};
 
     string toString() override;
 
@@ -458,16 +596,17 @@ class InvokeInstruction : public Instruction {
 public:
     static unordered_map<string, InvokeType> sysFuncMap;
     shared_ptr<Function> targetFunction;
-    vector<shared_ptr<Value>> params;
+    vector<shared_ptr<Value>> params; // never resized after construction, the uses point into it.
     InvokeType invokeType;
     string targetName; // only used for system call.
+    unique_ptr<Use[]> paramUses;
 
     InvokeInstruction(shared_ptr<Function> &targetFunction, vector<shared_ptr<Value>> &params,
                       shared_ptr<BasicBlock> &bb)
             : Instruction(InstructionType::INVOKE, bb,
                           targetFunction->funcType == FuncType::FUNC_INT ? R_VAL_RESULT
                                                                          : OTHER_RESULT),
-              params(params), invokeType(InvokeType::COMMON), targetFunction(targetFunction) {};
+              params(params), invokeType(InvokeType::COMMON), targetFunction(targetFunction) { linkParams(); };
 
     InvokeInstruction(string &sysFuncName, vector<shared_ptr<Value>> &params, shared_ptr<BasicBlock> &bb)
             : Instruction(InstructionType::INVOKE, bb, sysFuncName == "getint"
@@ -476,7 +615,9 @@ public:
               params(params),
               invokeType(sysFuncMap.at(sysFuncName)), targetName(
                     sysFuncName == "starttime" ? "_sysy_starttime" :
-                    sysFuncName == "stoptime" ? "_sysy_stoptime" : sysFuncName) {};
+                    sysFuncName == "stoptime" ? "_sysy_stoptime" : sysFuncName) { linkParams(); };
+
+    void linkParams();
 
     string toString() override;
 
@@ -494,11 +635,13 @@ public:
  */
 class UnaryInstruction : public Instruction {
 public:
-    string op;
+    IrOp op;
     shared_ptr<Value> value;
+    Use valueUse;
 
-    UnaryInstruction(string &op, shared_ptr<Value> &value, shared_ptr<BasicBlock> &bb)
-            : Instruction(InstructionType::UNARY, bb, R_VAL_RESULT), op(op), value(value) {};
+    UnaryInstruction(IrOp op, shared_ptr<Value> &value, shared_ptr<BasicBlock> &bb)
+            : Instruction(InstructionType::UNARY, bb, R_VAL_RESULT), op(op), value(value),
+              valueUse(this, &this->value) {};
 
     string toString() override;
 
@@ -507,7 +650,7 @@ public:
     void abandonUse() override;
 
     unsigned long long hashCode() override {
-        return (unsigned long long) value.get() * (op.empty() ? 0 : op.at(0));
+        return (value->operandHash() << 4) + op;
     }
 
     bool equals(shared_ptr<Value> &val) override;
@@ -518,41 +661,32 @@ public:
  */
 class BinaryInstruction : public Instruction {
 public:
-    string op;
+    IrOp op;
     shared_ptr<Value> lhs;
     shared_ptr<Value> rhs;
+    Use lhsUse;
+    Use rhsUse;
 
-    BinaryInstruction(string &op, shared_ptr<Value> &lhs, shared_ptr<Value> &rhs, shared_ptr<BasicBlock> &bb)
-            : Instruction(swapOp(op) != op ? InstructionType::CMP : InstructionType::BINARY, bb, R_VAL_RESULT),
-              op(op), lhs(lhs), rhs(rhs) {};
-
-    string toString() override;
+    BinaryInstruction(IrOp op, shared_ptr<Value> &lhs, shared_ptr<Value> &rhs, shared_ptr<BasicBlock> &bb)
+            : Instruction(isComparisonOp(op) ? InstructionType::CMP : InstructionType::BINARY, bb, R_VAL_RESULT),
+              op(op), lhs(lhs), rhs(rhs), lhsUse(this, &this->lhs), rhsUse(this, &this->rhs) {};
 
-    inline static string swapOp(const string &op) {
-        return op == "==" ? "!=" :
-               op == "!=" ? "==" :
-               op == ">" ? "<=" :
-               op == "<" ? ">=" :
-               op == "<=" ? ">" :
-               op == ">=" ? "<" : op;
-    }
+    void swapOperands();
 
-    inline static string swapOpConst(const string &op) {
-        return op == ">" ? "<" :
-               op == "<" ? ">" :
-               op == "<=" ? ">=" :
-               op == ">=" ? "<=" : op;
-    }
+    string toString() override;
 
     void replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) override;
 
     void abandonUse() override;
 
+    /**
+     * Ids and contents instead of addresses keep the hash stable between runs,
+     * commutative operators hash both orders alike.
+     */
     unsigned long long hashCode() override {
-        unsigned long long x = 0;
-        if (!op.empty()) x = x * 5 + op.at(0);
-        if (op.size() > 1) x = x * 5 + op.at(1);
-        return x * ((unsigned long long) lhs.get() + (unsigned long long) rhs.get());
+        unsigned long long l = lhs->operandHash(), r = rhs->operandHash();
+        if (isCommutativeOp(op) && l > r) swap(l, r);
+        return (((l << 24) ^ r) << 4) + op;
     }
 
     bool equals(shared_ptr<Value> &value) override;
@@ -589,10 +723,121 @@ public:
     shared_ptr<Value> value;
     shared_ptr<Value> address;
     shared_ptr<Value> offset;
+    Use valueUse;
+    Use addressUse;
+    Use offsetUse;
 
     StoreInstruction(shared_ptr<Value> &value, shared_ptr<Value> &address,
                      shared_ptr<Value> &offset, shared_ptr<BasicBlock> &bb)
-            : Instruction(InstructionType::STORE, bb, OTHER_RESULT), value(value), address(address), offset(offset) {};
+            : Instruction(InstructionType::STORE, bb, OTHER_RESULT), value(value), address(address), offset(offset),
+              valueUse(this, &this->value), addressUse(this, &this->address), offsetUse(this, &this->offset) {};
+
+    string toString() override;
+
+    void replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) override;
+
+    void abandonUse() override;
+
+    unsigned long long hashCode() override { return 0; }
+
+    bool equals(shared_ptr<Value> &val) override { return false; }
+};
+
+/**
+ * Memory set IR, stores value to the first units words of address.
+ */
+class MemsetInstruction : public Instruction {
+public:
+    shared_ptr<Value> value;
+    shared_ptr<Value> address;
+    int units;
+    Use valueUse;
+    Use addressUse;
+
+    MemsetInstruction(shared_ptr<Value> &value, shared_ptr<Value> &address, int units, shared_ptr<BasicBlock> &bb)
+            : Instruction(InstructionType::MEMSET, bb, OTHER_RESULT), value(value), address(address), units(units),
+              valueUse(this, &this->value), addressUse(this, &this->address) {};
+
+    string toString() override;
+
+    void replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) override;
+
+    void abandonUse() override;
+
+    unsigned long long hashCode() override { return 0; }
+
+    bool equals(shared_ptr<Value> &val) override { return false; }
+};
+
+/**
+ * Memory copy IR, copies the first units words of the constant template source to address.
+ */
+class MemcpyInstruction : public Instruction {
+public:
+    shared_ptr<Value> source;
+    shared_ptr<Value> address;
+    int units;
+    Use sourceUse;
+    Use addressUse;
+
+    MemcpyInstruction(shared_ptr<Value> &source, shared_ptr<Value> &address, int units, shared_ptr<BasicBlock> &bb)
+            : Instruction(InstructionType::MEMCPY, bb, OTHER_RESULT), source(source), address(address),
+              units(units), sourceUse(this, &this->source), addressUse(this, &this->address) {};
+
+    string toString() override;
+
+    void replaceUse(shared_ptr<Value> &toBeReplaced, shared_ptr<Value> &replaceValue) override;
+
+    void abandonUse() override;
+
+    unsigned long long hashCode() override { return 0; }
+
+    bool equals(shared_ptr<Value> &val) override { return false; }
+};
+
+// the ints in one NEON Q register, which a vector loop runs at a time.
+const int VECTOR_LANES = 4;
+
+/**
+ * Operations of a vector loop on the values of VECTOR_LANES consecutive iterations.
+ */
+enum VectorOpType {
+    V_LOAD,   // the words of operands[operand] from the offset operands[operand + 1].
+    V_SPLAT,  // operands[operand] in each lane.
+    V_BINARY, // lhs op rhs in each lane, op is OP_ADD, OP_SUB or OP_MUL.
+    V_STORE,  // lhs to the words of operands[operand] from the offset operands[operand + 1].
+    V_REDUCE  // adds the lanes of lhs to the result.
+};
+
+/**
+ * lhs and rhs are the indexes of the former ops, operand is an index of the scalar operands.
+ */
+struct VectorOp {
+    VectorOpType type;
+    IrOp op;
+    int lhs;
+    int rhs;
+    int operand;
+};
+
+/**
+ * Vector loop IR, runs ops operands[0] > 0 times, on the next VECTOR_LANES words of each array every time.
+ * The result is operands[1] with the reduction added, if there is a V_REDUCE op.
+ */
+class VectorInstruction : public Instruction {
+public:
+    vector<shared_ptr<Value>> operands; // never resized after construction, the uses point into it.
+    vector<VectorOp> ops;
+    unique_ptr<Use[]> operandUses;
+
+    VectorInstruction(vector<shared_ptr<Value>> &operands, vector<VectorOp> &ops, shared_ptr<BasicBlock> &bb)
+            : Instruction(InstructionType::VECTOR, bb, OTHER_RESULT), operands(operands), ops(ops) {
+        linkOperands();
+    };
+
+    void linkOperands();
+
+    bool hasReduction() const;
 
     string toString() override;
 
@@ -612,9 +857,12 @@ class LoadInstruction : public Instruction {
 public:
     shared_ptr<Value> address;
     shared_ptr<Value> offset;
+    Use addressUse;
+    Use offsetUse;
 
     LoadInstruction(shared_ptr<Value> &address, shared_ptr<Value> &offset, shared_ptr<BasicBlock> &bb)
-            : Instruction(InstructionType::LOAD, bb, R_VAL_RESULT), address(address), offset(offset) {};
+            : Instruction(InstructionType::LOAD, bb, R_VAL_RESULT), address(address), offset(offset),
+              addressUse(this, &this->address), offsetUse(this, &this->offset) {};
 
     string toString() override;
 
@@ -633,11 +881,12 @@ public:
 class PhiInstruction : public Instruction {
 public:
     string localVarName;
-    unordered_map<shared_ptr<BasicBlock>, shared_ptr<Value>> operands;
+    unordered_map<shared_ptr<BasicBlock>, shared_ptr<Value>> operands; // change by setOperand & removeOperand.
+    unordered_map<BasicBlock *, Use> operandUses;
 
     shared_ptr<PhiMoveInstruction> phiMove; // used after phi elimination.
 
-    PhiInstruction(string &localVarName, shared_ptr<BasicBlock> &bb)
+    PhiInstruction(const string &localVarName, shared_ptr<BasicBlock> &bb)
             : Instruction(InstructionType::PHI, bb, L_VAL_RESULT), localVarName(localVarName) {
         caughtVarName = localVarName;
     };
@@ -648,6 +897,10 @@ public:
 
     void replaceUse(shared_ptr<BasicBlock> &toBeReplaced, shared_ptr<BasicBlock> &replaceBlock);
 
+    void setOperand(const shared_ptr<BasicBlock> &bb, const shared_ptr<Value> &val);
+
+    void removeOperand(const shared_ptr<BasicBlock> &bb);
+
     void abandonUse() override;
 
     int getOperandValueCount(const shared_ptr<Value> &value);
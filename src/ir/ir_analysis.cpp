@@ -0,0 +1,311 @@
+#include "ir_analysis.h"
+
+#include <iostream>
+#include <algorithm>
+
+const double LOOP_TRIP_COUNT = 10;
+
+void FunctionAnalysis::computeReversePostOrder() {
+    reversePostOrder.clear();
+    rpoIndex.clear();
+    if (function->entryBlock == nullptr) return;
+    // iterative dfs, each stack item holds a block and its unvisited successors.
+    vector<pair<shared_ptr<BasicBlock>, vector<shared_ptr<BasicBlock>>>> stack;
+    unordered_set<BasicBlock *> visit;
+    vector<shared_ptr<BasicBlock>> postOrder;
+    visit.insert(function->entryBlock.get());
+    stack.emplace_back(function->entryBlock, vector<shared_ptr<BasicBlock>>(function->entryBlock->successors.begin(),
+                                                                            function->entryBlock->successors.end()));
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.second.empty()) {
+            postOrder.push_back(top.first);
+            stack.pop_back();
+            continue;
+        }
+        shared_ptr<BasicBlock> next = top.second.back();
+        top.second.pop_back();
+        if (visit.insert(next.get()).second) {
+            stack.emplace_back(next, vector<shared_ptr<BasicBlock>>(next->successors.begin(), next->successors.end()));
+        }
+    }
+    reversePostOrder.assign(postOrder.rbegin(), postOrder.rend());
+    for (unsigned int i = 0; i < reversePostOrder.size(); ++i) {
+        rpoIndex[reversePostOrder.at(i).get()] = i;
+    }
+    valid |= ANALYSIS_RPO;
+}
+
+/**
+ * Cooper, Harvey and Kennedy's iterative dominator algorithm on the reverse post order.
+ */
+void FunctionAnalysis::computeDominatorTree() {
+    getReversePostOrder();
+    const unsigned int size = reversePostOrder.size();
+    immediateDominators.assign(size, -1);
+    if (size == 0) {
+        valid |= ANALYSIS_DOMINATOR;
+        return;
+    }
+    immediateDominators.at(0) = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned int i = 1; i < size; ++i) {
+            int newIdom = -1;
+            for (auto &pred : reversePostOrder.at(i)->predecessors) {
+                auto it = rpoIndex.find(pred.get());
+                if (it == rpoIndex.end() || immediateDominators.at(it->second) == -1) continue;
+                int p = (int) it->second;
+                if (newIdom == -1) {
+                    newIdom = p;
+                    continue;
+                }
+                while (p != newIdom) {
+                    while (p > newIdom) p = immediateDominators.at(p);
+                    while (newIdom > p) newIdom = immediateDominators.at(newIdom);
+                }
+            }
+            if (immediateDominators.at(i) != newIdom) {
+                immediateDominators.at(i) = newIdom;
+                changed = true;
+            }
+        }
+    }
+    dominatorChildren.assign(size, vector<shared_ptr<BasicBlock>>());
+    for (unsigned int i = 1; i < size; ++i) {
+        dominatorChildren.at(immediateDominators.at(i)).push_back(reversePostOrder.at(i));
+    }
+    // number the dominator tree so that a dominates b iff in[a] <= in[b] && out[b] <= out[a].
+    domTreeIn.assign(size, 0);
+    domTreeOut.assign(size, 0);
+    unsigned int counter = 0;
+    vector<pair<unsigned int, unsigned int>> stack{{0, 0}};
+    domTreeIn.at(0) = counter++;
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.second < dominatorChildren.at(top.first).size()) {
+            unsigned int child = rpoIndex.at(dominatorChildren.at(top.first).at(top.second++).get());
+            domTreeIn.at(child) = counter++;
+            stack.emplace_back(child, 0);
+        } else {
+            domTreeOut.at(top.first) = counter++;
+            stack.pop_back();
+        }
+    }
+    valid |= ANALYSIS_DOMINATOR;
+}
+
+void FunctionAnalysis::computeDominanceFrontiers() {
+    if ((valid & ANALYSIS_DOMINATOR) == 0) computeDominatorTree();
+    const unsigned int size = reversePostOrder.size();
+    dominanceFrontiers.assign(size, unordered_set<shared_ptr<BasicBlock>>());
+    for (unsigned int i = 0; i < size; ++i) {
+        shared_ptr<BasicBlock> &bb = reversePostOrder.at(i);
+        if (bb->predecessors.size() < 2) continue;
+        for (auto &pred : bb->predecessors) {
+            auto it = rpoIndex.find(pred.get());
+            if (it == rpoIndex.end()) continue;
+            int runner = (int) it->second;
+            while (runner != immediateDominators.at(i)) {
+                dominanceFrontiers.at(runner).insert(bb);
+                if (runner == 0) break;
+                runner = immediateDominators.at(runner);
+            }
+        }
+    }
+    valid |= ANALYSIS_DOMINANCE_FRONTIER;
+}
+
+/**
+ * Natural loops of the back edges, loops with the same header are merged.
+ */
+void FunctionAnalysis::computeLoops() {
+    if ((valid & ANALYSIS_DOMINATOR) == 0) computeDominatorTree();
+    loops.clear();
+    loopOfBlock.clear();
+    loopOfHeader.clear();
+    for (auto &header : reversePostOrder) {
+        unique_ptr<Loop> loop;
+        for (auto &pred : header->predecessors) {
+            if (rpoIndex.count(pred.get()) == 0 || !dominates(header, pred)) continue;
+            if (loop == nullptr) {
+                loop.reset(new Loop());
+                loop->header = header;
+                loop->blocks.insert(header);
+            }
+            loop->latches.push_back(pred);
+            vector<shared_ptr<BasicBlock>> stack;
+            if (loop->blocks.insert(pred).second) stack.push_back(pred);
+            while (!stack.empty()) {
+                shared_ptr<BasicBlock> top = stack.back();
+                stack.pop_back();
+                for (auto &p : top->predecessors) {
+                    if (rpoIndex.count(p.get()) != 0 && loop->blocks.insert(p).second) stack.push_back(p);
+                }
+            }
+        }
+        if (loop != nullptr) {
+            loopOfHeader[header.get()] = loop.get();
+            loops.push_back(move(loop));
+        }
+    }
+    // a loop nested in another one is strictly smaller.
+    stable_sort(loops.begin(), loops.end(), [](const unique_ptr<Loop> &a, const unique_ptr<Loop> &b) {
+        return a->blocks.size() > b->blocks.size();
+    });
+    for (auto &loop : loops) {
+        auto parent = loopOfBlock.find(loop->header.get());
+        if (parent != loopOfBlock.end()) {
+            loop->parent = parent->second;
+            loop->depth = parent->second->depth + 1;
+            parent->second->children.push_back(loop.get());
+        }
+        for (auto &bb : loop->blocks) {
+            loopOfBlock[bb.get()] = loop.get();
+        }
+    }
+    valid |= ANALYSIS_LOOP;
+}
+
+/**
+ * Static estimate relative to the entry block: branches split evenly, loop headers run
+ * LOOP_TRIP_COUNT times per entry and the exits of a loop share the flow entering it.
+ */
+void FunctionAnalysis::computeFrequencies() {
+    if ((valid & ANALYSIS_LOOP) == 0) computeLoops();
+    const unsigned int size = reversePostOrder.size();
+    frequencies.assign(size, 0);
+    unordered_map<Loop *, double> entryFlows;
+    unordered_map<Loop *, unsigned int> exitCounts;
+    for (auto &loop : loops) {
+        unsigned int cnt = 0;
+        for (auto &bb : loop->blocks) {
+            for (auto &suc : bb->successors) {
+                if (!loop->contains(suc)) ++cnt;
+            }
+        }
+        exitCounts[loop.get()] = cnt;
+    }
+    if (size != 0) frequencies.at(0) = 1;
+    for (unsigned int i = 0; i < size; ++i) {
+        shared_ptr<BasicBlock> &bb = reversePostOrder.at(i);
+        Loop *headerLoop = getLoopWithHeader(bb);
+        if (headerLoop != nullptr) {
+            entryFlows[headerLoop] = i == 0 ? 1 : frequencies.at(i);
+            frequencies.at(i) = entryFlows.at(headerLoop) * LOOP_TRIP_COUNT;
+        }
+        Loop *loop = getLoopFor(bb);
+        unsigned int stayCount = 0;
+        for (auto &suc : bb->successors) {
+            if (loop == nullptr || loop->contains(suc)) ++stayCount;
+        }
+        for (auto &suc : bb->successors) {
+            auto it = rpoIndex.find(suc.get());
+            if (it == rpoIndex.end() || it->second <= i) continue; // back edges.
+            if (loop == nullptr || loop->contains(suc)) {
+                frequencies.at(it->second) += frequencies.at(i) / stayCount;
+            } else {
+                Loop *outermost = loop;
+                while (outermost->parent != nullptr && !outermost->parent->contains(suc)) outermost = outermost->parent;
+                frequencies.at(it->second) += entryFlows.at(outermost) / exitCounts.at(outermost);
+            }
+        }
+    }
+    valid |= ANALYSIS_FREQUENCY;
+}
+
+unsigned int FunctionAnalysis::indexOf(const shared_ptr<BasicBlock> &bb) {
+    getReversePostOrder();
+    auto it = rpoIndex.find(bb.get());
+    if (it == rpoIndex.end()) {
+        cerr << "Error occurs in process function analysis: unreachable block." << endl;
+        return 0;
+    }
+    return it->second;
+}
+
+const vector<shared_ptr<BasicBlock>> &FunctionAnalysis::getReversePostOrder() {
+    if ((valid & ANALYSIS_RPO) == 0) computeReversePostOrder();
+    return reversePostOrder;
+}
+
+bool FunctionAnalysis::isReachable(const shared_ptr<BasicBlock> &bb) {
+    getReversePostOrder();
+    return rpoIndex.count(bb.get()) != 0;
+}
+
+shared_ptr<BasicBlock> FunctionAnalysis::getImmediateDominator(const shared_ptr<BasicBlock> &bb) {
+    if ((valid & ANALYSIS_DOMINATOR) == 0) computeDominatorTree();
+    unsigned int index = indexOf(bb);
+    if (index == 0) return nullptr;
+    return reversePostOrder.at(immediateDominators.at(index));
+}
+
+const vector<shared_ptr<BasicBlock>> &FunctionAnalysis::getDominatorChildren(const shared_ptr<BasicBlock> &bb) {
+    if ((valid & ANALYSIS_DOMINATOR) == 0) computeDominatorTree();
+    return dominatorChildren.at(indexOf(bb));
+}
+
+bool FunctionAnalysis::dominates(const shared_ptr<BasicBlock> &a, const shared_ptr<BasicBlock> &b) {
+    if ((valid & ANALYSIS_DOMINATOR) == 0) computeDominatorTree();
+    if (!isReachable(a) || !isReachable(b)) return false;
+    unsigned int x = rpoIndex.at(a.get()), y = rpoIndex.at(b.get());
+    return domTreeIn.at(x) <= domTreeIn.at(y) && domTreeOut.at(y) <= domTreeOut.at(x);
+}
+
+const unordered_set<shared_ptr<BasicBlock>> &FunctionAnalysis::getDominanceFrontier(const shared_ptr<BasicBlock> &bb) {
+    if ((valid & ANALYSIS_DOMINANCE_FRONTIER) == 0) computeDominanceFrontiers();
+    return dominanceFrontiers.at(indexOf(bb));
+}
+
+const vector<unique_ptr<Loop>> &FunctionAnalysis::getLoops() {
+    if ((valid & ANALYSIS_LOOP) == 0) computeLoops();
+    return loops;
+}
+
+Loop *FunctionAnalysis::getLoopFor(const shared_ptr<BasicBlock> &bb) {
+    if ((valid & ANALYSIS_LOOP) == 0) computeLoops();
+    auto it = loopOfBlock.find(bb.get());
+    return it == loopOfBlock.end() ? nullptr : it->second;
+}
+
+Loop *FunctionAnalysis::getLoopWithHeader(const shared_ptr<BasicBlock> &bb) {
+    if ((valid & ANALYSIS_LOOP) == 0) computeLoops();
+    auto it = loopOfHeader.find(bb.get());
+    return it == loopOfHeader.end() ? nullptr : it->second;
+}
+
+unsigned int FunctionAnalysis::getLoopDepth(const shared_ptr<BasicBlock> &bb) {
+    Loop *loop = getLoopFor(bb);
+    return loop == nullptr ? 0 : loop->depth;
+}
+
+double FunctionAnalysis::getBlockFrequency(const shared_ptr<BasicBlock> &bb) {
+    if ((valid & ANALYSIS_FREQUENCY) == 0) computeFrequencies();
+    if (!isReachable(bb)) return 0;
+    return frequencies.at(rpoIndex.at(bb.get()));
+}
+
+void FunctionAnalysis::invalidate(unsigned int preserved) {
+    valid &= preserved;
+    // drop the analyses depending on an invalid one.
+    if ((valid & ANALYSIS_RPO) == 0) valid = ANALYSIS_NONE;
+    if ((valid & ANALYSIS_DOMINATOR) == 0) valid &= ~(ANALYSIS_DOMINANCE_FRONTIER | ANALYSIS_LOOP);
+    if ((valid & ANALYSIS_LOOP) == 0) valid &= ~ANALYSIS_FREQUENCY;
+}
+
+FunctionAnalysis &getFunctionAnalysis(const shared_ptr<Function> &func) {
+    if (func->analysis == nullptr) func->analysis = make_shared<FunctionAnalysis>(func.get());
+    return *func->analysis;
+}
+
+void invalidateFunctionAnalysis(const shared_ptr<Function> &func, unsigned int preserved) {
+    if (func->analysis != nullptr) func->analysis->invalidate(preserved);
+}
+
+void invalidateModuleAnalysis(const shared_ptr<Module> &module, unsigned int preserved) {
+    for (auto &func : module->functions) {
+        invalidateFunctionAnalysis(func, preserved);
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef COMPILER_IR_ANALYSIS_H
+#define COMPILER_IR_ANALYSIS_H
+
+#include "ir.h"
+
+// the analyses cached for a function, used as bit masks of preserved analyses.
+enum AnalysisType : unsigned int {
+    ANALYSIS_NONE = 0,
+    ANALYSIS_RPO = 1u << 0,
+    ANALYSIS_DOMINATOR = 1u << 1,
+    ANALYSIS_DOMINANCE_FRONTIER = 1u << 2,
+    ANALYSIS_LOOP = 1u << 3,
+    ANALYSIS_FREQUENCY = 1u << 4,
+    ANALYSIS_ALL = (1u << 5) - 1
+};
+
+// the estimated times a loop body runs for each entry of the loop.
+extern const double LOOP_TRIP_COUNT;
+
+class Loop {
+public:
+    shared_ptr<BasicBlock> header;
+    unordered_set<shared_ptr<BasicBlock>> blocks; // the header and the body, nested loops included.
+    vector<shared_ptr<BasicBlock>> latches;
+    Loop *parent = nullptr;
+    vector<Loop *> children;
+    unsigned int depth = 1;
+
+    bool contains(const shared_ptr<BasicBlock> &bb) const { return blocks.count(bb) != 0; }
+};
+
+/**
+ * Lazily computed CFG analyses of a function.
+ * Only blocks reachable from the entry block take part in the analyses.
+ * A pass which changes the CFG must call invalidateFunctionAnalysis.
+ */
+class FunctionAnalysis {
+private:
+    Function *function;
+    unsigned int valid = ANALYSIS_NONE;
+
+    vector<shared_ptr<BasicBlock>> reversePostOrder;
+    unordered_map<BasicBlock *, unsigned int> rpoIndex;
+
+    vector<int> immediateDominators; // indexed by rpo index.
+    vector<vector<shared_ptr<BasicBlock>>> dominatorChildren;
+    vector<unsigned int> domTreeIn; // dfs numbers in dominator tree for dominate queries.
+    vector<unsigned int> domTreeOut;
+
+    vector<unordered_set<shared_ptr<BasicBlock>>> dominanceFrontiers;
+
+    vector<unique_ptr<Loop>> loops; // outer loops first.
+    unordered_map<BasicBlock *, Loop *> loopOfBlock; // the innermost loop.
+    unordered_map<BasicBlock *, Loop *> loopOfHeader;
+
+    vector<double> frequencies;
+
+    void computeReversePostOrder();
+
+    void computeDominatorTree();
+
+    void computeDominanceFrontiers();
+
+    void computeLoops();
+
+    void computeFrequencies();
+
+    unsigned int indexOf(const shared_ptr<BasicBlock> &bb);
+
+public:
+    explicit FunctionAnalysis(Function *function) : function(function) {};
+
+    const vector<shared_ptr<BasicBlock>> &getReversePostOrder();
+
+    bool isReachable(const shared_ptr<BasicBlock> &bb);
+
+    shared_ptr<BasicBlock> getImmediateDominator(const shared_ptr<BasicBlock> &bb);
+
+    const vector<shared_ptr<BasicBlock>> &getDominatorChildren(const shared_ptr<BasicBlock> &bb);
+
+    bool dominates(const shared_ptr<BasicBlock> &a, const shared_ptr<BasicBlock> &b);
+
+    const unordered_set<shared_ptr<BasicBlock>> &getDominanceFrontier(const shared_ptr<BasicBlock> &bb);
+
+    const vector<unique_ptr<Loop>> &getLoops();
+
+    Loop *getLoopFor(const shared_ptr<BasicBlock> &bb);
+
+    Loop *getLoopWithHeader(const shared_ptr<BasicBlock> &bb);
+
+    unsigned int getLoopDepth(const shared_ptr<BasicBlock> &bb);
+
+    double getBlockFrequency(const shared_ptr<BasicBlock> &bb);
+
+    void invalidate(unsigned int preserved);
+};
+
+extern FunctionAnalysis &getFunctionAnalysis(const shared_ptr<Function> &func);
+
+extern void invalidateFunctionAnalysis(const shared_ptr<Function> &func, unsigned int preserved = ANALYSIS_NONE);
+
+extern void invalidateModuleAnalysis(const shared_ptr<Module> &module, unsigned int preserved = ANALYSIS_NONE);
+
+#endif
@@ -0,0 +1,35 @@
+#include "ir_arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+IrArena *IrArena::active = nullptr;
+
+void *IrArena::allocate(size_t bytes, size_t align) {
+    auto current = reinterpret_cast<uintptr_t>(cursor);
+    uintptr_t aligned = (current + align - 1) & ~(uintptr_t) (align - 1);
+    if (cursor == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(limit)) {
+        // oversized nodes get a chunk of their own.
+        size_t size = bytes + align > CHUNK_SIZE ? bytes + align : CHUNK_SIZE;
+        char *chunk = static_cast<char *>(malloc(size));
+        if (chunk == nullptr) throw bad_alloc();
+        chunks.push_back(chunk);
+        cursor = chunk;
+        limit = chunk + size;
+        current = reinterpret_cast<uintptr_t>(cursor);
+        aligned = (current + align - 1) & ~(uintptr_t) (align - 1);
+    }
+    cursor = reinterpret_cast<char *>(aligned + bytes);
+    allocatedBytes += bytes;
+    return reinterpret_cast<void *>(aligned);
+}
+
+void IrArena::release() {
+    for (auto chunk : chunks) {
+        free(chunk);
+    }
+    chunks.clear();
+    cursor = limit = nullptr;
+    allocatedBytes = 0;
+}
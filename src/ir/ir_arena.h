@@ -0,0 +1,79 @@
+#ifndef COMPILER_IR_ARENA_H
+#define COMPILER_IR_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Bump allocator owning the storage of every IR node of a Module.
+ * Nodes are never freed one by one, the whole arena is released in one shot
+ * when its owner Module is destroyed.
+ * Only the storage comes from the arena: the operands, block links and parent links
+ * between nodes are still shared_ptr and keep their reference counts.
+ */
+class IrArena {
+private:
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    vector<char *> chunks;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    size_t allocatedBytes = 0;
+
+public:
+    static IrArena *active; // the arena where new IR nodes are placed, set by Module.
+
+    IrArena() = default;
+
+    IrArena(const IrArena &) = delete;
+
+    IrArena &operator=(const IrArena &) = delete;
+
+    ~IrArena() { release(); }
+
+    void *allocate(size_t bytes, size_t align);
+
+    void release();
+
+    size_t getAllocatedBytes() const { return allocatedBytes; }
+};
+
+/**
+ * Allocator adapter used by allocate_shared, deallocate is a no-op.
+ */
+template<typename T>
+class IrArenaAllocator {
+public:
+    using value_type = T;
+
+    IrArena *arena;
+
+    explicit IrArenaAllocator(IrArena *arena) : arena(arena) {};
+
+    template<typename U>
+    IrArenaAllocator(const IrArenaAllocator<U> &other) : arena(other.arena) {}; // NOLINT
+
+    T *allocate(size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T *, size_t) {}
+
+    template<typename U>
+    bool operator==(const IrArenaAllocator<U> &other) const { return arena == other.arena; }
+
+    template<typename U>
+    bool operator!=(const IrArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+/**
+ * Create an IR node in the active arena, or on the heap when no Module is alive.
+ */
+template<typename T, typename... Args>
+inline shared_ptr<T> newIr(Args &&... args) {
+    if (IrArena::active == nullptr) return make_shared<T>(std::forward<Args>(args)...);
+    return allocate_shared<T>(IrArenaAllocator<T>(IrArena::active), std::forward<Args>(args)...);
+}
+
+#endif
@@ -3,7 +3,9 @@
 
 #include "ir_build.h"
 
-shared_ptr<Module> module;
+// never destroyed: the module arena goes back to the OS at exit in one piece,
+// instead of being released under the other globals still holding IR handles.
+shared_ptr<Module> &module = *new shared_ptr<Module>(); // NOLINT
 
 unordered_map<string, shared_ptr<Function>> globalFunctionMap; // name <--> Function
 unordered_map<string, shared_ptr<ConstantValue>> globalConstantMap; // name <--> Constant Array
@@ -11,9 +13,6 @@ unordered_map<string, shared_ptr<GlobalValue>> globalVariableMap; // name <--> G
 unordered_map<string, shared_ptr<Value>> localArrayMap; // name <--> Local Array
 unordered_map<string, shared_ptr<StringValue>> globalStringMap; // string <--> string pointer
 
-string mulOp = "*"; // NOLINT
-string addOp = "+"; // NOLINT
-
 unsigned int loopDepth = 0;
 
 void blockToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shared_ptr<BlockNode> &block,
@@ -41,7 +40,7 @@ shared_ptr<Module> buildIrModule(shared_ptr<CompUnitNode> &compUnit) {
         if (dynamic_cast<ConstDeclNode *>(decl.get())) {
             for (auto &def : s_p_c<ConstDeclNode>(decl)->constDefList) {
                 if (def->ident->ident->symbolType == SymbolType::CONST_ARRAY) {
-                    shared_ptr<Value> value = make_shared<ConstantValue>(def);
+                    shared_ptr<Value> value = newIr<ConstantValue>(def);
                     module->globalConstants.push_back(value);
                     globalConstantMap.insert(
                             {def->ident->ident->usageName, s_p_c<ConstantValue>(value)});
@@ -49,15 +48,15 @@ shared_ptr<Module> buildIrModule(shared_ptr<CompUnitNode> &compUnit) {
             }
         } else {
             for (auto &def : s_p_c<VarDeclNode>(decl)->varDefList) {
-                shared_ptr<Value> value = make_shared<GlobalValue>(def);
+                shared_ptr<Value> value = newIr<GlobalValue>(def);
                 module->globalVariables.push_back(value);
                 globalVariableMap.insert({def->ident->ident->usageName, s_p_c<GlobalValue>(value)});
             }
         }
     }
     for (auto &funcNode : compUnit->funcDefList) {
-        shared_ptr<Function> function = make_shared<Function>();
-        shared_ptr<BasicBlock> entryBlock = make_shared<BasicBlock>(function, true, loopDepth);
+        shared_ptr<Function> function = newIr<Function>();
+        shared_ptr<BasicBlock> entryBlock = newIr<BasicBlock>(function, true, loopDepth);
         module->functions.push_back(function);
         function->name = funcNode->ident->ident->usageName;
         function->funcType = funcNode->funcType;
@@ -66,10 +65,10 @@ shared_ptr<Module> buildIrModule(shared_ptr<CompUnitNode> &compUnit) {
         globalFunctionMap.insert({function->name, function});
         if (funcNode->funcFParams) {
             for (auto &param : funcNode->funcFParams->funcParamList) {
-                shared_ptr<Value> paramValue = make_shared<ParameterValue>(function, param);
+                shared_ptr<Value> paramValue = newIr<ParameterValue>(function, param);
                 function->params.push_back(paramValue);
                 if (s_p_c<ParameterValue>(paramValue)->variableType == VariableType::INT) {
-                    writeLocalVariable(entryBlock, s_p_c<ParameterValue>(paramValue)->name, paramValue);
+                    writeLocalVariable(entryBlock, param->ident->ident->varId, paramValue);
                 } else {
                     localArrayMap[param->ident->ident->usageName] = paramValue;
                 }
@@ -96,7 +95,7 @@ void blockToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const sha
             shared_ptr<ConstDeclNode> constDecl = s_p_c<ConstDeclNode>(item);
             for (auto &constDef : constDecl->constDefList) {
                 if (constDef->ident->ident->symbolType == SymbolType::CONST_ARRAY) {
-                    shared_ptr<Value> value = make_shared<ConstantValue>(constDef);
+                    shared_ptr<Value> value = newIr<ConstantValue>(constDef);
                     module->globalConstants.push_back(value);
                     globalConstantMap.insert(
                             {constDef->ident->ident->usageName, s_p_c<ConstantValue>(value)});
@@ -132,38 +131,70 @@ void varDefToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb,
             insExp->resultType = L_VAL_RESULT;
             insExp->caughtVarName = varDef->ident->ident->usageName;
         }
-        writeLocalVariable(bb, varDef->ident->ident->usageName, exp);
+        writeLocalVariable(bb, varDef->ident->ident->varId, exp);
     } else if (varDef->dimension != 0) {
         int units = 1;
         for (const auto &d : varDef->dimensions) units *= d;
-        shared_ptr<Value> alloc = make_shared<AllocInstruction>(varDef->ident->ident->usageName,
-                                                                units * _W_LEN, units, bb);
+        shared_ptr<Value> alloc = newIr<AllocInstruction>(varDef->ident->ident->usageName,
+                                                          units * _W_LEN, units, bb);
         bb->instructions.push_back(s_p_c<Instruction>(alloc));
         localArrayMap.insert({s_p_c<AllocInstruction>(alloc)->name,
                               s_p_c<AllocInstruction>(alloc)});
         if (varDef->type == InitType::INIT) {
             vector<pair<int, shared_ptr<ExpNode>>> initValues = varDef->initVal->toOneDimensionArray(0, units);
-            int curIndex = 0;
-            for (auto &it : initValues) {
-                for (; curIndex < it.first; ++curIndex) {
-                    shared_ptr<Value> zero = getNumberValue(0);;
-                    shared_ptr<Value> offset = getNumberValue(curIndex);;
-                    shared_ptr<Instruction> store = make_shared<StoreInstruction>(zero, alloc, offset, bb);
-                    addUser(store, {zero, alloc, offset});
+            if (units < _BULK_INIT_MIN_UNITS) {
+                int curIndex = 0;
+                for (auto &it : initValues) {
+                    for (; curIndex < it.first; ++curIndex) {
+                        shared_ptr<Value> zero = getNumberValue(0);
+                        shared_ptr<Value> offset = getNumberValue(curIndex);
+                        shared_ptr<Instruction> store = newIr<StoreInstruction>(zero, alloc, offset, bb);
+                        bb->instructions.push_back(store);
+                    }
+                    ++curIndex;
+                    shared_ptr<Value> exp = expToIr(func, bb, it.second);
+                    shared_ptr<Value> offset = getNumberValue(it.first);
+                    shared_ptr<Instruction> store = newIr<StoreInstruction>(exp, alloc, offset, bb);
                     bb->instructions.push_back(store);
                 }
-                ++curIndex;
+                for (; curIndex < units; ++curIndex) {
+                    shared_ptr<Value> zero = getNumberValue(0);
+                    shared_ptr<Value> offset = getNumberValue(curIndex);
+                    shared_ptr<Instruction> store = newIr<StoreInstruction>(zero, alloc, offset, bb);
+                    bb->instructions.push_back(store);
+                }
+                return;
+            }
+            // big arrays are cleared or copied from a constant template at once, then the rest is stored.
+            vector<pair<int, shared_ptr<Value>>> exps;
+            map<int, int> constValues;
+            for (auto &it : initValues) {
                 shared_ptr<Value> exp = expToIr(func, bb, it.second);
-                shared_ptr<Value> offset = getNumberValue(it.first);;
-                shared_ptr<Instruction> store = make_shared<StoreInstruction>(exp, alloc, offset, bb);
-                addUser(store, {exp, alloc, offset});
-                bb->instructions.push_back(store);
+                if (exp->valueType == ValueType::NUMBER) {
+                    if (s_p_c<NumberValue>(exp)->number != 0) constValues[it.first] = s_p_c<NumberValue>(exp)->number;
+                } else {
+                    exps.emplace_back(it.first, exp);
+                }
             }
-            for (; curIndex < units; ++curIndex) {
+            shared_ptr<Instruction> bulk;
+            if (constValues.size() >= _BULK_COPY_MIN_UNITS) {
+                shared_ptr<ConstantValue> constant = newIr<ConstantValue>();
+                constant->name = "T_" + s_p_c<AllocInstruction>(alloc)->name;
+                constant->size = units;
+                constant->dimensions = vector({units});
+                constant->values = constValues;
+                module->globalConstants.push_back(constant);
+                shared_ptr<Value> source = constant;
+                bulk = newIr<MemcpyInstruction>(source, alloc, units, bb);
+            } else {
                 shared_ptr<Value> zero = getNumberValue(0);
-                shared_ptr<Value> offset = getNumberValue(curIndex);
-                shared_ptr<Instruction> store = make_shared<StoreInstruction>(zero, alloc, offset, bb);
-                addUser(store, {zero, alloc, offset});
+                bulk = newIr<MemsetInstruction>(zero, alloc, units, bb);
+                for (auto &it : constValues) exps.emplace_back(it.first, getNumberValue(it.second));
+            }
+            bb->instructions.push_back(bulk);
+            for (auto &it : exps) {
+                shared_ptr<Value> offset = getNumberValue(it.first);
+                shared_ptr<Instruction> store = newIr<StoreInstruction>(it.second, alloc, offset, bb);
                 bb->instructions.push_back(store);
             }
         }
@@ -195,8 +226,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
                 case SymbolType::VAR: {
                     if (identItem->blockId.first == 0) {
                         pointerToIr(stmt->lVal, address, offset, func, bb);
-                        shared_ptr<Instruction> ins = make_shared<StoreInstruction>(value, address, offset, bb);
-                        addUser(ins, {value, address, offset});
+                        shared_ptr<Instruction> ins = newIr<StoreInstruction>(value, address, offset, bb);
                         bb->instructions.push_back(ins);
                     } else {
                         if (value->valueType == ValueType::INSTRUCTION) {
@@ -204,7 +234,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
                             insValue->resultType = L_VAL_RESULT;
                             insValue->caughtVarName = stmt->lVal->ident->ident->usageName;
                         }
-                        writeLocalVariable(bb, stmt->lVal->ident->ident->usageName, value);
+                        writeLocalVariable(bb, stmt->lVal->ident->ident->varId, value);
                     }
                     return;
                 }
@@ -216,8 +246,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
                         insValue->caughtVarName = generateTempLeftValueName();
                     }
                     pointerToIr(stmt->lVal, address, offset, func, bb);
-                    shared_ptr<Instruction> ins = make_shared<StoreInstruction>(value, address, offset, bb);
-                    addUser(ins, {value, address, offset});
+                    shared_ptr<Instruction> ins = newIr<StoreInstruction>(value, address, offset, bb);
                     bb->instructions.push_back(ins);
                     return;
                 }
@@ -228,23 +257,22 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
         }
         case StmtType::STMT_RETURN: {
             shared_ptr<Value> value = expToIr(func, bb, stmt->exp);
-            shared_ptr<Instruction> ins = make_shared<ReturnInstruction>(FuncType::FUNC_INT, value, bb);
-            addUser(ins, {value});
+            shared_ptr<Instruction> ins = newIr<ReturnInstruction>(FuncType::FUNC_INT, value, bb);
             bb->instructions.push_back(ins);
             afterJump = true;
             return;
         }
         case StmtType::STMT_RETURN_VOID: {
             shared_ptr<Value> value = nullptr;
-            shared_ptr<Instruction> ins = make_shared<ReturnInstruction>(FuncType::FUNC_VOID, value, bb);
+            shared_ptr<Instruction> ins = newIr<ReturnInstruction>(FuncType::FUNC_VOID, value, bb);
             bb->instructions.push_back(ins);
             afterJump = true;
             return;
         }
         case StmtType::STMT_IF: {
             // declare if and end.
-            shared_ptr<BasicBlock> endIf = make_shared<BasicBlock>(func, true, loopDepth);
-            shared_ptr<BasicBlock> ifStmt = make_shared<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> endIf = newIr<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> ifStmt = newIr<BasicBlock>(func, true, loopDepth);
             // transform condition.
             conditionToIr(func, bb, stmt->cond, ifStmt, endIf);
             // maintain successors and predecessors.
@@ -261,7 +289,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
             stmtToIr(func, ifStmt, stmt->stmt, loopJudge, loopEnd, ifAfterJump);
             // if no jump happens, add a jump back to the end block, in case of the disordering of the blocks.
             if (!ifAfterJump) {
-                shared_ptr<Instruction> jmp = make_shared<JumpInstruction>(endIf, ifStmt);
+                shared_ptr<Instruction> jmp = newIr<JumpInstruction>(endIf, ifStmt);
                 ifStmt->instructions.push_back(jmp);
                 // maintain if stmt successors and end if block's predecessors.
                 ifStmt->successors.insert(endIf);
@@ -272,9 +300,9 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
             return;
         }
         case StmtType::STMT_IF_ELSE: {
-            shared_ptr<BasicBlock> endIf = make_shared<BasicBlock>(func, true, loopDepth);
-            shared_ptr<BasicBlock> ifStmt = make_shared<BasicBlock>(func, true, loopDepth);
-            shared_ptr<BasicBlock> elseStmt = make_shared<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> endIf = newIr<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> ifStmt = newIr<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> elseStmt = newIr<BasicBlock>(func, true, loopDepth);
             conditionToIr(func, bb, stmt->cond, ifStmt, elseStmt);
             bb->successors.insert({ifStmt, elseStmt});
             ifStmt->predecessors.insert(bb);
@@ -285,7 +313,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
             func->blocks.push_back(ifStmt);
             stmtToIr(func, ifStmt, stmt->stmt, loopJudge, loopEnd, ifAfterJump);
             if (!ifAfterJump) {
-                shared_ptr<Instruction> jmpIf = make_shared<JumpInstruction>(endIf, ifStmt);
+                shared_ptr<Instruction> jmpIf = newIr<JumpInstruction>(endIf, ifStmt);
                 ifStmt->instructions.push_back(jmpIf);
                 // maintain successors and predecessors.
                 ifStmt->successors.insert(endIf);
@@ -295,7 +323,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
             func->blocks.push_back(elseStmt);
             stmtToIr(func, elseStmt, stmt->elseStmt, loopJudge, loopEnd, elseAfterJump);
             if (!elseAfterJump) {
-                shared_ptr<Instruction> jmpElse = make_shared<JumpInstruction>(endIf, elseStmt);
+                shared_ptr<Instruction> jmpElse = newIr<JumpInstruction>(endIf, elseStmt);
                 elseStmt->instructions.push_back(jmpElse);
                 // maintain successors and predecessors.
                 elseStmt->successors.insert(endIf);
@@ -309,9 +337,9 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
         }
         case StmtType::STMT_WHILE: {
             // declare loop head, loop end and loop body.
-            shared_ptr<BasicBlock> whileEnd = make_shared<BasicBlock>(func, true, loopDepth);
-            shared_ptr<BasicBlock> whileJudge = make_shared<BasicBlock>(func, true, loopDepth + 1);
-            shared_ptr<BasicBlock> whileBody = make_shared<BasicBlock>(func, false, loopDepth + 1);
+            shared_ptr<BasicBlock> whileEnd = newIr<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> whileJudge = newIr<BasicBlock>(func, true, loopDepth + 1);
+            shared_ptr<BasicBlock> whileBody = newIr<BasicBlock>(func, false, loopDepth + 1);
             shared_ptr<BasicBlock> preWhileBody = whileBody;
             // transform condition.
             conditionToIr(func, bb, stmt->cond, whileBody, whileEnd);
@@ -329,7 +357,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
             stmtToIr(func, whileBody, stmt->stmt, whileJudge, whileEnd, whileBodyAfterJump);
             --loopDepth;
             if (!whileBodyAfterJump) {
-                shared_ptr<Instruction> jmpJudge = make_shared<JumpInstruction>(whileJudge, whileBody);
+                shared_ptr<Instruction> jmpJudge = newIr<JumpInstruction>(whileJudge, whileBody);
                 whileBody->instructions.push_back(jmpJudge);
                 whileBody->successors.insert(whileJudge);
                 whileJudge->predecessors.insert(whileBody);
@@ -353,7 +381,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
         }
         case StmtType::STMT_BREAK: {
             if (!loopEnd) cerr << "Error occurs in stmt to IR: break without a loop." << endl;
-            shared_ptr<Instruction> jmp = make_shared<JumpInstruction>(loopEnd, bb);
+            shared_ptr<Instruction> jmp = newIr<JumpInstruction>(loopEnd, bb);
             bb->instructions.push_back(jmp);
             bb->successors.insert(loopEnd);
             loopEnd->predecessors.insert(bb);
@@ -362,7 +390,7 @@ void stmtToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const shar
         }
         default:
             if (!loopJudge) cerr << "Error occurs in stmt to IR: continue without a loop." << endl;
-            shared_ptr<Instruction> jmp = make_shared<JumpInstruction>(loopJudge, bb);
+            shared_ptr<Instruction> jmp = newIr<JumpInstruction>(loopJudge, bb);
             bb->instructions.push_back(jmp);
             bb->successors.insert(loopJudge);
             loopJudge->predecessors.insert(bb);
@@ -385,12 +413,11 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
                     case SymbolType::VAR: {
                         if (identItem->blockId.first == 0) {
                             pointerToIr(p->lVal, address, offset, func, bb);
-                            shared_ptr<Instruction> ins = make_shared<LoadInstruction>(address, offset, bb);
-                            addUser(ins, {address, offset});
+                            shared_ptr<Instruction> ins = newIr<LoadInstruction>(address, offset, bb);
                             bb->instructions.push_back(ins);
                             return ins;
                         }
-                        return readLocalVariable(bb, identItem->usageName);
+                        return readLocalVariable(bb, identItem->varId, identItem->usageName);
                     }
                     case SymbolType::CONST_ARRAY:
                     case SymbolType::ARRAY: {
@@ -406,13 +433,11 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
                         } else {
                             pointerToIr(p->lVal, address, offset, func, bb);
                             if (p->lVal->exps.size() == p->lVal->dimension) {
-                                shared_ptr<Instruction> load = make_shared<LoadInstruction>(address, offset, bb);
-                                addUser(load, {address, offset});
+                                shared_ptr<Instruction> load = newIr<LoadInstruction>(address, offset, bb);
                                 bb->instructions.push_back(load);
                                 return load;
                             } else {
-                                shared_ptr<Instruction> pt = make_shared<BinaryInstruction>(addOp, address, offset, bb);
-                                addUser(pt, {address, offset});
+                                shared_ptr<Instruction> pt = newIr<BinaryInstruction>(OP_ADD, address, offset, bb);
                                 bb->instructions.push_back(pt);
                                 return pt;
                             }
@@ -427,7 +452,7 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
                 if (globalStringMap.count(p->str) != 0) {
                     return globalStringMap.at(p->str);
                 }
-                shared_ptr<StringValue> str = make_shared<StringValue>(p->str);
+                shared_ptr<StringValue> str = newIr<StringValue>(p->str);
                 globalStringMap[p->str] = str;
                 module->globalStrings.push_back(str);
                 return str;
@@ -443,8 +468,7 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
             case UnaryExpType::UNARY_PRIMARY: {
                 shared_ptr<Value> value = expToIr(func, bb, p->primaryExp);
                 if (p->op == "+") return value;
-                shared_ptr<Instruction> ins = make_shared<UnaryInstruction>(p->op, value, bb);
-                addUser(ins, {value});
+                shared_ptr<Instruction> ins = newIr<UnaryInstruction>(toIrOp(p->op), value, bb);
                 bb->instructions.push_back(ins);
                 return ins;
             }
@@ -465,26 +489,23 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
                 }
                 shared_ptr<Value> invoke;
                 if (InvokeInstruction::sysFuncMap.count(p->ident->ident->name) != 0) {
-                    invoke = make_shared<InvokeInstruction>(p->ident->ident->name, params, bb);
+                    invoke = newIr<InvokeInstruction>(p->ident->ident->name, params, bb);
                 } else {
                     shared_ptr<Function> targetFunction = globalFunctionMap.at(p->ident->ident->usageName);
                     func->callees.insert(targetFunction);
                     targetFunction->callers.insert(func);
-                    invoke = make_shared<InvokeInstruction>(targetFunction, params, bb);
+                    invoke = newIr<InvokeInstruction>(targetFunction, params, bb);
                 }
-                addUser(invoke, params);
                 bb->instructions.push_back(s_p_c<Instruction>(invoke));
                 if (p->op == "+") return invoke;
-                shared_ptr<Instruction> ins = make_shared<UnaryInstruction>(p->op, invoke, bb);
-                addUser(ins, {invoke});
+                shared_ptr<Instruction> ins = newIr<UnaryInstruction>(toIrOp(p->op), invoke, bb);
                 bb->instructions.push_back(ins);
                 return ins;
             }
             default:
                 shared_ptr<Value> value = expToIr(func, bb, p->unaryExp);
                 if (p->op == "+") return value;
-                shared_ptr<Instruction> ins = make_shared<UnaryInstruction>(p->op, value, bb);
-                addUser(ins, {value});
+                shared_ptr<Instruction> ins = newIr<UnaryInstruction>(toIrOp(p->op), value, bb);
                 bb->instructions.push_back(ins);
                 return ins;
         }
@@ -495,8 +516,7 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
         } else {
             shared_ptr<Value> lhs = expToIr(func, bb, p->mulExp);
             shared_ptr<Value> rhs = expToIr(func, bb, p->unaryExp);
-            shared_ptr<Instruction> ins = make_shared<BinaryInstruction>(p->op, lhs, rhs, bb);
-            addUser(ins, {lhs, rhs});
+            shared_ptr<Instruction> ins = newIr<BinaryInstruction>(toIrOp(p->op), lhs, rhs, bb);
             bb->instructions.push_back(ins);
             return ins;
         }
@@ -507,8 +527,7 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
         } else {
             shared_ptr<Value> lhs = expToIr(func, bb, p->addExp);
             shared_ptr<Value> rhs = expToIr(func, bb, p->mulExp);
-            shared_ptr<Instruction> ins = make_shared<BinaryInstruction>(p->op, lhs, rhs, bb);
-            addUser(ins, {lhs, rhs});
+            shared_ptr<Instruction> ins = newIr<BinaryInstruction>(toIrOp(p->op), lhs, rhs, bb);
             bb->instructions.push_back(ins);
             return ins;
         }
@@ -524,8 +543,7 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
                 s_p_c<Instruction>(lhs)->resultType = L_VAL_RESULT;
                 s_p_c<Instruction>(lhs)->caughtVarName = generateTempLeftValueName();
             }
-            shared_ptr<Instruction> ins = make_shared<BinaryInstruction>(p->op, lhs, rhs, bb);
-            addUser(ins, {lhs, rhs});
+            shared_ptr<Instruction> ins = newIr<BinaryInstruction>(toIrOp(p->op), lhs, rhs, bb);
             bb->instructions.push_back(ins);
             return ins;
         }
@@ -541,8 +559,7 @@ shared_ptr<Value> expToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb
                 s_p_c<Instruction>(lhs)->resultType = L_VAL_RESULT;
                 s_p_c<Instruction>(lhs)->caughtVarName = generateTempLeftValueName();
             }
-            shared_ptr<Instruction> ins = make_shared<BinaryInstruction>(p->op, lhs, rhs, bb);
-            addUser(ins, {lhs, rhs});
+            shared_ptr<Instruction> ins = newIr<BinaryInstruction>(toIrOp(p->op), lhs, rhs, bb);
             bb->instructions.push_back(ins);
             return ins;
         }
@@ -563,7 +580,7 @@ void conditionToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const
             conditionToIr(func, bb, lOrExp->lAndExp, trueBlock, falseBlock);
         } else {
             // declare a new basic block as the 2nd condition judge block.
-            shared_ptr<BasicBlock> logicOrBlock = make_shared<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> logicOrBlock = newIr<BasicBlock>(func, true, loopDepth);
             conditionToIr(func, bb, lOrExp->lOrExp, trueBlock, logicOrBlock);
             // maintain the predecessors and successors of last basic block.
             bb->successors.insert({trueBlock, logicOrBlock});
@@ -579,7 +596,7 @@ void conditionToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const
         const shared_ptr<LAndExpNode> lAndExp = s_p_c<LAndExpNode>(cond);
         if (lAndExp->lAndExp != nullptr) {
             // declare a new basic block as the 2nd condition judge block.
-            shared_ptr<BasicBlock> logicAndBlock = make_shared<BasicBlock>(func, true, loopDepth);
+            shared_ptr<BasicBlock> logicAndBlock = newIr<BasicBlock>(func, true, loopDepth);
             conditionToIr(func, bb, lAndExp->lAndExp, logicAndBlock, falseBlock);
             // maintain the predecessors and successors of last basic block.
             bb->successors.insert({falseBlock, logicAndBlock});
@@ -593,8 +610,7 @@ void conditionToIr(shared_ptr<Function> &func, shared_ptr<BasicBlock> &bb, const
         conditionToIr(func, bb, lAndExp->eqExp, trueBlock, falseBlock);
     } else if (dynamic_cast<EqExpNode *>(cond.get())) {
         shared_ptr<Value> exp = expToIr(func, bb, cond);
-        shared_ptr<Value> ins = make_shared<BranchInstruction>(exp, trueBlock, falseBlock, bb);
-        addUser(ins, {exp});
+        shared_ptr<Value> ins = newIr<BranchInstruction>(exp, trueBlock, falseBlock, bb);
         bb->instructions.push_back(s_p_c<Instruction>(ins));
     } else if (dynamic_cast<CondNode *>(cond.get())) {
         const shared_ptr<LOrExpNode> lOrExp = s_p_c<CondNode>(cond)->lOrExp;
@@ -629,13 +645,11 @@ void pointerToIr(const shared_ptr<LValNode> &lVal, shared_ptr<Value> &address,
             for (int i = 0; i < lVal->exps.size(); ++i) {
                 shared_ptr<Value> number = getNumberValue(size);
                 shared_ptr<Value> off = expToIr(func, bb, lVal->exps.at(i));
-                shared_ptr<Value> mul = make_shared<BinaryInstruction>(mulOp, off, number, bb);
-                addUser(mul, {number, off});
+                shared_ptr<Value> mul = newIr<BinaryInstruction>(OP_MUL, off, number, bb);
                 bb->instructions.push_back(s_p_c<Instruction>(mul));
                 if (offset) {
                     shared_ptr<Value> oldOffset = offset;
-                    offset = make_shared<BinaryInstruction>(addOp, offset, mul, bb);
-                    addUser(offset, {oldOffset, mul});
+                    offset = newIr<BinaryInstruction>(OP_ADD, offset, mul, bb);
                     bb->instructions.push_back(s_p_c<Instruction>(offset));
                 } else {
                     offset = mul;
@@ -645,8 +659,7 @@ void pointerToIr(const shared_ptr<LValNode> &lVal, shared_ptr<Value> &address,
             if (lVal->exps.size() < identItem->numOfEachDimension.size()) {
                 shared_ptr<Value> oldOffset = offset;
                 shared_ptr<Value> four = getNumberValue(_W_LEN);
-                offset = make_shared<BinaryInstruction>(mulOp, offset, four, bb);
-                addUser(offset, {oldOffset, four});
+                offset = newIr<BinaryInstruction>(OP_MUL, offset, four, bb);
                 bb->instructions.push_back(s_p_c<Instruction>(offset));
             }
             if (identItem->symbolType == SymbolType::CONST_ARRAY)
@@ -21,16 +21,16 @@ void phiCheck(const shared_ptr<PhiInstruction> &);
 
 bool irCheck(const shared_ptr<Module> &module) {
     for (auto &cst : module->globalConstants) {
-        for (auto &user : cst->users) if (!user->valid) irError("global constant has invalid users.");
-        if (irUserCheck && cst->users.empty()) irError("constant has no users.");
+        for (auto &user : cst->getUsers()) if (!user->valid) irError("global constant has invalid users.");
+        if (irUserCheck && cst->hasNoUser()) irError("constant has no users.");
     }
     for (auto &glb : module->globalVariables) {
-        for (auto &user : glb->users) if (!user->valid) irError("global variable has invalid users.");
-        if (irUserCheck && glb->users.empty()) irError("global variable has no users.");
+        for (auto &user : glb->getUsers()) if (!user->valid) irError("global variable has invalid users.");
+        if (irUserCheck && glb->hasNoUser()) irError("global variable has no users.");
     }
     for (auto &str : module->globalStrings) {
-        for (auto &user : str->users) if (!user->valid) irError("global string has invalid users.");
-        if (irUserCheck && str->users.empty()) irError("string has no users.");
+        for (auto &user : str->getUsers()) if (!user->valid) irError("global string has invalid users.");
+        if (irUserCheck && str->hasNoUser()) irError("string has no users.");
     }
     for (auto &func : module->functions) {
         functionCheck(func);
@@ -96,9 +96,9 @@ void basicBlockCheck(const shared_ptr<BasicBlock> &bb) {
             irError("successor is not valid.");
     }
     if (!bb->instructions.empty()
-        && (*(bb->instructions.end() - 1))->type != InstructionType::JMP
-        && (*(bb->instructions.end() - 1))->type != InstructionType::BR
-        && (*(bb->instructions.end() - 1))->type != InstructionType::RET) {
+        && bb->instructions.back()->type != InstructionType::JMP
+        && bb->instructions.back()->type != InstructionType::BR
+        && bb->instructions.back()->type != InstructionType::RET) {
         irError("block ends with non-jump instruction.");
     }
     bool cmpMark = false;
@@ -122,18 +122,18 @@ void basicBlockCheck(const shared_ptr<BasicBlock> &bb) {
 }
 
 void instructionCheck(const shared_ptr<Instruction> &ins) {
-    if (irUserCheck && ins->users.empty() && noResultTypes.count(ins->type) == 0)
+    if (irUserCheck && ins->hasNoUser() && noResultTypes.count(ins->type) == 0)
         irError("instruction has no user.");
-    if (ins->users.size() > 1 && ins->resultType == R_VAL_RESULT)
+    if (!ins->hasNoUser() && !ins->hasOneUser() && ins->resultType == R_VAL_RESULT)
         irError("instruction has more than 1 users but is r-val.");
-    if (ins->users.size() == 1 && ins->resultType == R_VAL_RESULT) {
-        auto it = ins->users.begin();
-        if ((*it)->valueType == ValueType::INSTRUCTION && s_p_c<Instruction>(*it)->block != ins->block)
+    if (ins->hasOneUser() && ins->resultType == R_VAL_RESULT) {
+        Value *user = ins->useHead->user;
+        if (user->valueType == ValueType::INSTRUCTION && dynamic_cast<Instruction *>(user)->block != ins->block)
             irError("r-val and its instruction's user is not in the same block.");
     }
-    if (ins->type != InstructionType::PHI && ins->users.count(ins) != 0)
+    if (ins->type != InstructionType::PHI && ins->isUsedBy(ins.get()))
         irError("instruction uses itself.");
-    for (auto &user : ins->users) {
+    for (auto &user : ins->getUsers()) {
         if (!user->valid)
             irError("instruction users contain invalid value in function " + ins->block->function->name
                     + " block " + to_string(ins->block->id) + ".");
@@ -144,11 +144,11 @@ void instructionCheck(const shared_ptr<Instruction> &ins) {
             shared_ptr<BinaryInstruction> inst = s_p_c<BinaryInstruction>(ins);
             if (!inst->lhs->valid)
                 irError("binary Instruction uses an invalid lhs.");
-            else if (inst->lhs->users.count(inst) == 0)
+            else if (!inst->lhs->isUsedBy(inst.get()))
                 irError("binary Instruction's lhs users does not has itself.");
             if (!inst->rhs->valid)
                 irError("binary Instruction uses an invalid lhs.");
-            else if (inst->rhs->users.count(inst) == 0)
+            else if (!inst->rhs->isUsedBy(inst.get()))
                 irError("binary Instruction's rhs users does not has itself.");
             if (inst->type == CMP && inst->resultType != R_VAL_RESULT) {
                 irError("cmp Instruction's result must be r-value.");
@@ -159,7 +159,7 @@ void instructionCheck(const shared_ptr<Instruction> &ins) {
             shared_ptr<UnaryInstruction> inst = s_p_c<UnaryInstruction>(ins);
             if (!inst->value->valid)
                 irError("unary Instruction uses an invalid value.");
-            else if (inst->value->users.count(inst) == 0)
+            else if (!inst->value->isUsedBy(inst.get()))
                 irError("unary Instruction's value users does not has itself.");
             break;
         }
@@ -167,11 +167,11 @@ void instructionCheck(const shared_ptr<Instruction> &ins) {
             shared_ptr<LoadInstruction> inst = s_p_c<LoadInstruction>(ins);
             if (!inst->address->valid)
                 irError("load Instruction uses an invalid value.");
-            else if (inst->address->users.count(inst) == 0)
+            else if (!inst->address->isUsedBy(inst.get()))
                 irError("load Instruction's address users does not has itself.");
             if (!inst->offset->valid)
                 irError("load Instruction uses an invalid value.");
-            else if (inst->offset->users.count(inst) == 0)
+            else if (!inst->offset->isUsedBy(inst.get()))
                 irError("load Instruction's address users does not has itself.");
             break;
         }
@@ -180,7 +180,7 @@ void instructionCheck(const shared_ptr<Instruction> &ins) {
             if (inst->funcType == FuncType::FUNC_INT) {
                 if (!inst->value->valid)
                     irError("return Instruction uses an invalid value.");
-                else if (inst->value->users.count(inst) == 0)
+                else if (!inst->value->isUsedBy(inst.get()))
                     irError("return Instruction's value users does not has itself.");
             }
             if (!inst->block->successors.empty())
@@ -191,23 +191,57 @@ void instructionCheck(const shared_ptr<Instruction> &ins) {
             shared_ptr<StoreInstruction> inst = s_p_c<StoreInstruction>(ins);
             if (!inst->value->valid)
                 irError("store Instruction uses an invalid value.");
-            else if (inst->value->users.count(inst) == 0)
+            else if (!inst->value->isUsedBy(inst.get()))
                 irError("store Instruction's value users does not has itself.");
             if (!inst->address->valid)
                 irError("store Instruction uses an invalid address.");
-            else if (inst->address->users.count(inst) == 0)
+            else if (!inst->address->isUsedBy(inst.get()))
                 irError("store Instruction's address users does not has itself.");
             if (!inst->offset->valid)
                 irError("store Instruction uses an invalid offset.");
-            else if (inst->offset->users.count(inst) == 0)
+            else if (!inst->offset->isUsedBy(inst.get()))
                 irError("store Instruction's offset users does not has itself.");
             break;
         }
+        case InstructionType::MEMSET: {
+            shared_ptr<MemsetInstruction> inst = s_p_c<MemsetInstruction>(ins);
+            if (!inst->value->valid)
+                irError("memset Instruction uses an invalid value.");
+            else if (!inst->value->isUsedBy(inst.get()))
+                irError("memset Instruction's value users does not has itself.");
+            if (!inst->address->valid)
+                irError("memset Instruction uses an invalid address.");
+            else if (!inst->address->isUsedBy(inst.get()))
+                irError("memset Instruction's address users does not has itself.");
+            break;
+        }
+        case InstructionType::MEMCPY: {
+            shared_ptr<MemcpyInstruction> inst = s_p_c<MemcpyInstruction>(ins);
+            if (inst->source->valueType != ValueType::CONSTANT)
+                irError("memcpy Instruction copies from a non-constant source.");
+            else if (!inst->source->isUsedBy(inst.get()))
+                irError("memcpy Instruction's source users does not has itself.");
+            if (!inst->address->valid)
+                irError("memcpy Instruction uses an invalid address.");
+            else if (!inst->address->isUsedBy(inst.get()))
+                irError("memcpy Instruction's address users does not has itself.");
+            break;
+        }
+        case InstructionType::VECTOR: {
+            shared_ptr<VectorInstruction> inst = s_p_c<VectorInstruction>(ins);
+            for (auto &operand : inst->operands) {
+                if (!operand->valid)
+                    irError("vector Instruction uses an invalid operand.");
+                else if (!operand->isUsedBy(inst.get()))
+                    irError("vector Instruction's operand users does not has itself.");
+            }
+            break;
+        }
         case InstructionType::BR: {
             shared_ptr<BranchInstruction> inst = s_p_c<BranchInstruction>(ins);
             if (!inst->condition->valid)
                 irError("branch Instruction uses an invalid condition.");
-            else if (inst->condition->users.count(inst) == 0)
+            else if (!inst->condition->isUsedBy(inst.get()))
                 irError("branch Instruction's condition users does not has itself.");
             if (inst->block->successors.size() != 2)
                 irError("branch Instruction's successors size is not 2.");
@@ -243,7 +277,7 @@ void instructionCheck(const shared_ptr<Instruction> &ins) {
             for (auto &arg : inst->params) {
                 if (!arg->valid)
                     irError("invoke Instruction's parameter is invalid.");
-                else if (arg->users.count(inst) == 0)
+                else if (!arg->isUsedBy(inst.get()))
                     irError("invoke Instruction's parameter users does not has itself.");
             }
             break;
@@ -258,11 +292,11 @@ void instructionCheck(const shared_ptr<Instruction> &ins) {
 }
 
 void phiCheck(const shared_ptr<PhiInstruction> &phi) {
-    if (irUserCheck && phi->users.empty())
+    if (irUserCheck && phi->hasNoUser())
         irError("phi has no user.");
-    if (phi->users.size() > 1 && phi->resultType == R_VAL_RESULT)
+    if (!phi->hasNoUser() && !phi->hasOneUser() && phi->resultType == R_VAL_RESULT)
         irError("phi has more than 1 users but is r-val.");
-    for (auto &user : phi->users) {
+    for (auto &user : phi->getUsers()) {
         if (user->valueType == ValueType::BASIC_BLOCK) {
             irError("phi have block user.");
         }
@@ -274,7 +308,7 @@ void phiCheck(const shared_ptr<PhiInstruction> &phi) {
     if (phi->operands.size() != phi->block->predecessors.size()) {
         irError("phi's operands is not equal to block's predecessors.");
     }
-    for (auto &user : phi->users) {
+    for (auto &user : phi->getUsers()) {
         if (!user->valid && user->valueType != ValueType::BASIC_BLOCK)
             irError("phi has invalid user in function " + phi->block->function->name
                     + " block " + to_string(phi->block->id) + ".");
@@ -288,7 +322,7 @@ void phiCheck(const shared_ptr<PhiInstruction> &phi) {
             irWarning("phi has an undefined value.");
         if (!it.second->valid)
             irError("phi's operand is invalid.");
-        else if (it.second->users.count(phi) == 0)
+        else if (!it.second->isUsedBy(phi.get()))
             irError("phi's operand users does not have itself.");
         else if (it.second->valueType == ValueType::INSTRUCTION
                  && s_p_c<Instruction>(it.second)->resultType != L_VAL_RESULT) {
@@ -257,7 +257,7 @@ string InvokeInstruction::toString() {
 
 string UnaryInstruction::toString() {
     shared_ptr<Value> v = shared_from_this();
-    string s = getSsaName(v) + " = " + op + " " + getSsaName(value);
+    string s = getSsaName(v) + " = " + irOpName(op) + " " + getSsaName(value);
     if (resultType == L_VAL_RESULT) return s + " (" + caughtVarName + ") (id " + to_string(id) + ")\n";
     return s + " (id " + to_string(id) + ")\n";
 }
@@ -266,7 +266,7 @@ string BinaryInstruction::toString() {
     shared_ptr<Value> v = shared_from_this();
     string s = getSsaName(v) + " = ";
     if (type == InstructionType::CMP) s += "[cmp] ";
-    s += getSsaName(lhs) + " " + op + " " + getSsaName(rhs);
+    s += getSsaName(lhs) + " " + irOpName(op) + " " + getSsaName(rhs);
     if (resultType == L_VAL_RESULT) s += " (" + caughtVarName + ")";
     return s + " (id " + to_string(id) + ")\n";
 }
@@ -282,6 +282,49 @@ string StoreInstruction::toString() {
            + "] (id " + to_string(id) + ")\n";
 }
 
+string MemsetInstruction::toString() {
+    return "memset " + getSsaName(value) + " to " + getSsaName(address) + " [units " + to_string(units)
+           + "] (id " + to_string(id) + ")\n";
+}
+
+string MemcpyInstruction::toString() {
+    return "memcpy " + getSsaName(source) + " to " + getSsaName(address) + " [units " + to_string(units)
+           + "] (id " + to_string(id) + ")\n";
+}
+
+string VectorInstruction::toString() {
+    shared_ptr<Value> v = shared_from_this();
+    string s = hasReduction() ? getSsaName(v) + " = " : "";
+    s += "vector loop " + getSsaName(operands[0]) + " times {";
+    for (int i = 0; i < ops.size(); ++i) {
+        VectorOp &op = ops[i];
+        string name = "v" + to_string(i);
+        string lhs = "v" + to_string(op.lhs);
+        switch (op.type) {
+            case V_LOAD:
+                s += " " + name + " = load " + getSsaName(operands[op.operand])
+                     + " [offset " + getSsaName(operands[op.operand + 1]) + "];";
+                break;
+            case V_SPLAT:
+                s += " " + name + " = splat " + getSsaName(operands[op.operand]) + ";";
+                break;
+            case V_BINARY:
+                s += " " + name + " = " + lhs + " " + irOpName(op.op) + " v" + to_string(op.rhs) + ";";
+                break;
+            case V_STORE:
+                s += " store " + lhs + " to " + getSsaName(operands[op.operand])
+                     + " [offset " + getSsaName(operands[op.operand + 1]) + "];";
+                break;
+            case V_REDUCE:
+                s += " reduce " + lhs + " to " + getSsaName(operands[1]) + ";";
+                break;
+        }
+    }
+    s += " }";
+    if (resultType == L_VAL_RESULT) s += " (" + caughtVarName + ")";
+    return s + " (id " + to_string(id) + ")\n";
+}
+
 string LoadInstruction::toString() {
     shared_ptr<Value> v = shared_from_this();
     string s = getSsaName(v) + " = load " + getSsaName(address) + " [offset " + getSsaName(offset) + "]";
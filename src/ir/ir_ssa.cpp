@@ -2,49 +2,45 @@
 
 #include <iostream>
 
-shared_ptr<Value> readLocalVariableRecursively(shared_ptr<BasicBlock> &bb, string &varName);
+shared_ptr<Value> readLocalVariableRecursively(shared_ptr<BasicBlock> &bb, int varId, const string &varName);
 
-shared_ptr<Value> readLocalVariable(shared_ptr<BasicBlock> &bb, string &varName) {
-    if (bb->localVarSsaMap.count(varName) != 0) return bb->localVarSsaMap.at(varName);
-    return readLocalVariableRecursively(bb, varName);
+shared_ptr<Value> readLocalVariable(shared_ptr<BasicBlock> &bb, int varId, const string &varName) {
+    auto it = bb->localVarSsaMap.find(varId);
+    if (it != bb->localVarSsaMap.end()) return it->second;
+    return readLocalVariableRecursively(bb, varId, varName);
 }
 
-void writeLocalVariable(shared_ptr<BasicBlock> &bb, const string &varName, const shared_ptr<Value> &value) {
-    bb->localVarSsaMap[varName] = value;
-    if (dynamic_cast<PhiInstruction *>(value.get())) {
-        value->users.insert(bb);
-    }
+void writeLocalVariable(shared_ptr<BasicBlock> &bb, int varId, const shared_ptr<Value> &value) {
+    bb->writeLocalVariable(varId, value);
 }
 
-shared_ptr<Value> readLocalVariableRecursively(shared_ptr<BasicBlock> &bb, string &varName) {
+shared_ptr<Value> readLocalVariableRecursively(shared_ptr<BasicBlock> &bb, int varId, const string &varName) {
     if (!bb->sealed) {
-        shared_ptr<PhiInstruction> emptyPhi = make_shared<PhiInstruction>(varName, bb);
-        bb->incompletePhis[varName] = emptyPhi;
-        writeLocalVariable(bb, varName, emptyPhi);
+        shared_ptr<PhiInstruction> emptyPhi = newIr<PhiInstruction>(varName, bb);
+        bb->incompletePhis[varId] = emptyPhi;
+        writeLocalVariable(bb, varId, emptyPhi);
         return emptyPhi;
     } else if (bb->predecessors.size() == 1) {
         shared_ptr<BasicBlock> predecessor = *(bb->predecessors.begin());
-        shared_ptr<Value> val = readLocalVariable(predecessor, varName);
-        writeLocalVariable(bb, varName, val);
+        shared_ptr<Value> val = readLocalVariable(predecessor, varId, varName);
+        writeLocalVariable(bb, varId, val);
         return val;
     } else {
-        shared_ptr<Value> val = make_shared<PhiInstruction>(varName, bb);
-        writeLocalVariable(bb, varName, val);
+        shared_ptr<Value> val = newIr<PhiInstruction>(varName, bb);
+        writeLocalVariable(bb, varId, val);
         shared_ptr<PhiInstruction> phi = s_p_c<PhiInstruction>(val);
         bb->phis.insert(phi);
-        val = addPhiOperands(bb, varName, phi);
-        writeLocalVariable(bb, varName, val);
+        val = addPhiOperands(bb, varId, phi);
+        writeLocalVariable(bb, varId, val);
         return val;
     }
 }
 
-shared_ptr<Value> addPhiOperands(shared_ptr<BasicBlock> &bb, string &varName, shared_ptr<PhiInstruction> &phi) {
+shared_ptr<Value> addPhiOperands(shared_ptr<BasicBlock> &bb, int varId, shared_ptr<PhiInstruction> &phi) {
     for (auto &it : bb->predecessors) {
         shared_ptr<BasicBlock> pred = it;
-        shared_ptr<Value> v = readLocalVariable(pred, varName);
-        shared_ptr<BasicBlock> block;
-        phi->operands.insert({it, v});
-        v->users.insert(phi);
+        shared_ptr<Value> v = readLocalVariable(pred, varId, phi->localVarName);
+        if (phi->operands.count(it) == 0) phi->setOperand(it, v);
     }
     return removeTrivialPhi(phi);
 }
@@ -57,17 +53,16 @@ shared_ptr<Value> removeTrivialPhi(shared_ptr<PhiInstruction> &phi) {
         if (same != nullptr) return phi;
         same = it.second;
     }
-    if (same == nullptr) same = make_shared<UndefinedValue>(phi->localVarName);
-    phi->users.erase(phi);
-    unordered_set<shared_ptr<Value>> users = phi->users;
-    shared_ptr<Value> toBeReplaced = phi;
-    phi->block->phis.erase(phi);
-    for (auto &it : users) {
-        it->replaceUse(toBeReplaced, same);
+    if (same == nullptr) same = newIr<UndefinedValue>(phi->localVarName);
+    for (auto &it : phi->operands) {
+        if (it.second == self) phi->operandUses[it.first.get()].unlink();
     }
+    vector<shared_ptr<Value>> users = phi->getUsers();
+    phi->block->phis.erase(phi);
+    phi->replaceAllUsesWith(same);
     if (_isBuildingIr) {
-        for (auto &it : phi->operands) {
-            it.second->users.erase(phi);
+        for (auto &it : phi->operandUses) {
+            it.second.unlink();
         }
         phi->valid = false;
     } else {
@@ -88,10 +83,9 @@ shared_ptr<Value> removeTrivialPhi(shared_ptr<PhiInstruction> &phi) {
 void sealBasicBlock(shared_ptr<BasicBlock> &bb) {
     if (!bb->sealed) {
         for (auto &it : bb->incompletePhis) {
-            string varName = it.first;
             shared_ptr<PhiInstruction> phi = it.second;
             bb->phis.insert(phi);
-            addPhiOperands(bb, varName, phi);
+            addPhiOperands(bb, it.first, phi);
         }
         bb->incompletePhis.clear();
         bb->sealed = true;
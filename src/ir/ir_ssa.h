@@ -3,13 +3,14 @@
 
 #include "ir.h"
 
-extern shared_ptr<Value> readLocalVariable(shared_ptr<BasicBlock> &bb, string &varName);
+// local variables are keyed by SymbolTableItem::varId, the name is only used for the phis created.
+extern shared_ptr<Value> readLocalVariable(shared_ptr<BasicBlock> &bb, int varId, const string &varName);
 
-extern void writeLocalVariable(shared_ptr<BasicBlock> &bb, const string &varName, const shared_ptr<Value> &value);
+extern void writeLocalVariable(shared_ptr<BasicBlock> &bb, int varId, const shared_ptr<Value> &value);
 
 extern void sealBasicBlock(shared_ptr<BasicBlock> &bb);
 
-extern shared_ptr<Value> addPhiOperands(shared_ptr<BasicBlock> &bb, string &varName, shared_ptr<PhiInstruction> &phi);
+extern shared_ptr<Value> addPhiOperands(shared_ptr<BasicBlock> &bb, int varId, shared_ptr<PhiInstruction> &phi);
 
 extern shared_ptr<Value> removeTrivialPhi(shared_ptr<PhiInstruction> &phi);
 
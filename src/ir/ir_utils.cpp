@@ -8,26 +8,29 @@ const unordered_set<InstructionType> noResultTypes{ // NOLINT
         InstructionType::JMP,
         InstructionType::RET,
         InstructionType::INVOKE,
-        InstructionType::STORE
+        InstructionType::STORE,
+        InstructionType::MEMSET,
+        InstructionType::MEMCPY,
+        InstructionType::VECTOR
 };
 
-unordered_set<shared_ptr<BasicBlock>> blockRelationTree;
-
-void buildBlockRelationTree(const shared_ptr<BasicBlock> &bb);
-
-void removeUnusedInstructions(shared_ptr<BasicBlock> &bb) {
+bool removeUnusedInstructions(shared_ptr<BasicBlock> &bb) {
+    bool changed = false;
     auto it = bb->instructions.begin();
     while (it != bb->instructions.end()) {
-        if (noResultTypes.count((*it)->type) == 0 && (*it)->users.empty()) {
+        if (noResultTypes.count((*it)->type) == 0 && (*it)->hasNoUser()) {
             (*it)->abandonUse();
             it = bb->instructions.erase(it);
+            changed = true;
         } else if (noResultTypes.count((*it)->type) != 0 && !(*it)->valid) {
             it = bb->instructions.erase(it);
-        } else if ((*it)->type == INVOKE && (*it)->users.empty()) {
+            changed = true;
+        } else if ((*it)->type == INVOKE && (*it)->hasNoUser()) {
             shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(*it);
             if (invoke->invokeType == COMMON && !invoke->targetFunction->hasSideEffect) {
                 (*it)->abandonUse();
                 it = bb->instructions.erase(it);
+                changed = true;
             } else ++it;
         } else ++it;
     }
@@ -37,34 +40,36 @@ void removeUnusedInstructions(shared_ptr<BasicBlock> &bb) {
         if (phi->onlyHasBlockUserOrUserEmpty()) {
             phi->abandonUse();
             bb->phis.erase(phi);
+            changed = true;
             continue;
         }
         unordered_map<shared_ptr<BasicBlock>, shared_ptr<Value>> operands = phi->operands;
         bool op = false;
         for (auto &entry : operands) {
             if (bb->predecessors.count(entry.first) == 0) {
-                if (phi->getOperandValueCount(entry.second) == 1)
-                    entry.second->users.erase(phi);
-                phi->operands.erase(entry.first);
+                phi->removeOperand(entry.first);
                 op = true;
             }
         }
         if (op) {
             removeTrivialPhi(phi);
+            changed = true;
             goto VISIT_ALL_PHIS;
         }
     }
+    return changed;
 }
 
-void removeUnusedBasicBlocks(shared_ptr<Function> &func) {
-    blockRelationTree.clear();
-    buildBlockRelationTree(func->entryBlock);
+bool removeUnusedBasicBlocks(shared_ptr<Function> &func) {
+    bool changed = false;
+    // removing unreachable blocks keeps the analyses of reachable blocks valid.
+    FunctionAnalysis &analysis = getFunctionAnalysis(func);
     auto it = func->blocks.begin();
     while (it != func->blocks.end()) {
-        if (blockRelationTree.count(*it) == 0) {
-            for (int i = (*it)->instructions.size() - 1; i >= 0; --i) {
-                shared_ptr<Value> selfIns = (*it)->instructions.at(i);
-                unordered_set<shared_ptr<Value>> users = selfIns->users;
+        if (!analysis.isReachable(*it)) {
+            for (auto ins = (*it)->instructions.rbegin(); ins != (*it)->instructions.rend(); ++ins) {
+                shared_ptr<Value> selfIns = *ins;
+                vector<shared_ptr<Value>> users = selfIns->getUsers();
                 for (auto &user : users) {
                     if (user->valueType == ValueType::INSTRUCTION) {
                         shared_ptr<Instruction> userIns = s_p_c<Instruction>(user);
@@ -74,13 +79,13 @@ void removeUnusedBasicBlocks(shared_ptr<Function> &func) {
                                 unordered_map<shared_ptr<BasicBlock>, shared_ptr<Value>> operands = phi->operands;
                                 for (auto &op : operands) {
                                     if (op.first == *it || op.second == selfIns) {
-                                        phi->operands.erase(op.first);
+                                        phi->removeOperand(op.first);
                                     }
                                 }
                                 removeTrivialPhi(phi);
                             } else {
                                 string undefinedName = "unused block's instruction " + to_string(selfIns->id);
-                                shared_ptr<Value> newVal = make_shared<UndefinedValue>(undefinedName);
+                                shared_ptr<Value> newVal = newIr<UndefinedValue>(undefinedName);
                                 user->replaceUse(selfIns, newVal);
                             }
                         }
@@ -90,18 +95,23 @@ void removeUnusedBasicBlocks(shared_ptr<Function> &func) {
             }
             (*it)->abandonUse();
             it = func->blocks.erase(it);
+            changed = true;
         } else ++it;
     }
+    return changed;
 }
 
-void removeUnusedFunctions(shared_ptr<Module> &module) {
+bool removeUnusedFunctions(shared_ptr<Module> &module) {
+    bool changed = false;
     auto func = module->functions.begin();
     while (func != module->functions.end()) {
         if ((*func)->callers.empty() && (*func)->name != "main") {
             (*func)->abandonUse();
             func = module->functions.erase(func);
+            changed = true;
         } else ++func;
     }
+    return changed;
 }
 
 void removeBlockPredecessor(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &pre) {
@@ -116,15 +126,6 @@ void removeBlockPredecessor(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &
     }
 }
 
-void buildBlockRelationTree(const shared_ptr<BasicBlock> &bb) {
-    blockRelationTree.insert(bb);
-    for (const shared_ptr<BasicBlock> &b : bb->successors) {
-        if (blockRelationTree.count(b) == 0) {
-            buildBlockRelationTree(b);
-        }
-    }
-}
-
 void countFunctionSideEffect(shared_ptr<Module> &module) {
     for (auto &func : module->functions) {
         func->hasSideEffect = false;
@@ -141,6 +142,16 @@ void countFunctionSideEffect(shared_ptr<Module> &module) {
                         func->hasSideEffect = true;
                         goto FUNC_SIDE_EFFECT_CONTINUE;
                     }
+                } else if (ins->type == InstructionType::MEMSET) {
+                    if (s_p_c<MemsetInstruction>(ins)->address->valueType != INSTRUCTION) {
+                        func->hasSideEffect = true;
+                        goto FUNC_SIDE_EFFECT_CONTINUE;
+                    }
+                } else if (ins->type == InstructionType::MEMCPY) {
+                    if (s_p_c<MemcpyInstruction>(ins)->address->valueType != INSTRUCTION) {
+                        func->hasSideEffect = true;
+                        goto FUNC_SIDE_EFFECT_CONTINUE;
+                    }
                 } else if (ins->type == InstructionType::LOAD) {
                     if (s_p_c<LoadInstruction>(ins)->address->valueType != INSTRUCTION) {
                         func->hasSideEffect = true;
@@ -176,34 +187,38 @@ void countFunctionSideEffect(shared_ptr<Module> &module) {
     }
 }
 
-void addUser(const shared_ptr<Value> &user, initializer_list<shared_ptr<Value>> used) {
-    for (const auto &u : used) {
-        u->users.insert(user);
+long long countInstructions(const shared_ptr<Function> &func) {
+    long long cnt = 0;
+    for (auto &bb : func->blocks) {
+        cnt += (long long) (bb->instructions.size() + bb->phis.size());
     }
+    return cnt;
 }
 
-void addUser(const shared_ptr<Value> &user, const vector<shared_ptr<Value>> &used) {
-    for (const auto &u : used) {
-        u->users.insert(user);
+long long countInstructions(const shared_ptr<Module> &module) {
+    long long cnt = 0;
+    for (auto &func : module->functions) {
+        cnt += countInstructions(func);
     }
+    return cnt;
 }
 
 void removePhiUserBlocksAndMultiCmp(shared_ptr<Module> &module) {
     for (auto &func : module->functions) {
         for (auto &bb : func->blocks) {
             for (auto ins = bb->instructions.begin(); ins != bb->instructions.end(); ++ins) {
-                if ((*ins)->type == InstructionType::CMP && ins + 1 != bb->instructions.end()) {
-                    if ((*(ins + 1))->type != InstructionType::BR) {
+                if ((*ins)->type == InstructionType::CMP && next(ins) != bb->instructions.end()) {
+                    if ((*next(ins))->type != InstructionType::BR) {
                         (*ins)->type = InstructionType::BINARY;
                     }
                 }
             }
             for (auto &phi : bb->phis) {
-                unordered_set<shared_ptr<Value>> users = phi->users;
-                for (auto &user : users) {
-                    if (user->valueType == ValueType::BASIC_BLOCK) {
-                        phi->users.erase(user);
-                    }
+                Use *use = phi->useHead;
+                while (use != nullptr) {
+                    Use *next = use->next;
+                    if (use->user->valueType == ValueType::BASIC_BLOCK) use->unlink();
+                    use = next;
                 }
             }
         }
@@ -211,33 +226,45 @@ void removePhiUserBlocksAndMultiCmp(shared_ptr<Module> &module) {
 }
 
 void fixRightValue(shared_ptr<Module> &module) {
-    // pre-deal with the alloc and non-users function call.
     for (auto &func : module->functions) {
-        for (auto &bb : func->blocks) {
-            for (auto &ins : bb->instructions) {
-                if (ins->type == ALLOC) {
-                    ins->resultType = OTHER_RESULT;
-                } else if (ins->type == INVOKE && s_p_c<InvokeInstruction>(ins)->users.empty()) {
-                    s_p_c<InvokeInstruction>(ins)->resultType = OTHER_RESULT;
-                }
+        fixRightValue(func);
+    }
+}
+
+void fixRightValue(shared_ptr<Function> &func) {
+    // pre-deal with the alloc and non-users function call.
+    for (auto &bb : func->blocks) {
+        for (auto &ins : bb->instructions) {
+            if (ins->type == ALLOC) {
+                ins->resultType = OTHER_RESULT;
+            } else if (ins->type == INVOKE && ins->hasNoUser()) {
+                s_p_c<InvokeInstruction>(ins)->resultType = OTHER_RESULT;
             }
         }
     }
-    for (auto &func : module->functions) {
-        for (auto &bb : func->blocks) {
-            for (auto &ins : bb->instructions) {
-                if (ins->users.size() == 1 && ins->resultType == R_VAL_RESULT) {
-                    if (ins->users.begin()->get()->valueType == ValueType::INSTRUCTION
-                        && ins->block != s_p_c<Instruction>(*ins->users.begin())->block) {
-                        ins->resultType = L_VAL_RESULT;
-                        ins->caughtVarName = generateTempLeftValueName();
-                    }
+    for (auto &bb : func->blocks) {
+        for (auto &ins : bb->instructions) {
+            if (ins->hasOneUser() && ins->resultType == R_VAL_RESULT) {
+                Value *user = ins->useHead->user;
+                if (user->valueType == ValueType::INSTRUCTION
+                    && ins->block != dynamic_cast<Instruction *>(user)->block) {
+                    ins->resultType = L_VAL_RESULT;
+                    ins->caughtVarName = generateTempLeftValueName();
                 }
             }
         }
     }
 }
 
+void markLeftValue(const shared_ptr<Value> &value) {
+    if (value->valueType != INSTRUCTION) return;
+    shared_ptr<Instruction> ins = s_p_c<Instruction>(value);
+    if (ins->resultType == R_VAL_RESULT) {
+        ins->resultType = L_VAL_RESULT;
+        ins->caughtVarName = generateTempLeftValueName();
+    }
+}
+
 void getFunctionRequiredStackSize(shared_ptr<Function> &func) {
     unsigned int size = 4 * _W_LEN;
     unordered_set<shared_ptr<Value>> phiMovSet;
@@ -259,16 +286,16 @@ void getFunctionRequiredStackSize(shared_ptr<Function> &func) {
 void phiElimination(shared_ptr<Function> &func) {
     for (auto &bb : func->blocks) {
         for (auto phi : bb->phis) {
-            shared_ptr<Instruction> phiMov = make_shared<PhiMoveInstruction>(phi);
+            shared_ptr<Instruction> phiMov = newIr<PhiMoveInstruction>(phi);
             for (auto &operand : phi->operands) {
                 shared_ptr<BasicBlock> pred = operand.first;
                 if (!pred->instructions.empty()) {
-                    auto it = pred->instructions.end() - 1;
+                    auto it = prev(pred->instructions.end());
                     if ((*it)->type == JMP) {
                         pred->instructions.insert(it, phiMov);
                     } else if ((*it)->type == BR) {
-                        if (it != pred->instructions.begin() && (*(it - 1))->type == CMP) {
-                            pred->instructions.insert(it - 1, phiMov);
+                        if (it != pred->instructions.begin() && (*prev(it))->type == CMP) {
+                            pred->instructions.insert(prev(it), phiMov);
                         } else {
                             pred->instructions.insert(it, phiMov);
                         }
@@ -3,23 +3,26 @@
 
 #include "ir.h"
 #include "ir_ssa.h"
+#include "ir_analysis.h"
 
 // used at any time when optimizing ir.
 extern const unordered_set<InstructionType> noResultTypes;
 
-extern void removeUnusedInstructions(shared_ptr<BasicBlock> &bb);
+// the remove functions return true if anything is removed.
+extern bool removeUnusedInstructions(shared_ptr<BasicBlock> &bb);
 
-extern void removeUnusedBasicBlocks(shared_ptr<Function> &func);
+extern bool removeUnusedBasicBlocks(shared_ptr<Function> &func);
 
-extern void removeUnusedFunctions(shared_ptr<Module> &module);
+extern bool removeUnusedFunctions(shared_ptr<Module> &module);
 
 extern void removeBlockPredecessor(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &pre);
 
 extern void countFunctionSideEffect(shared_ptr<Module> &module);
 
-extern void addUser(const shared_ptr<Value> &user, initializer_list<shared_ptr<Value>> used);
+// count instructions and phis, used in pass report.
+extern long long countInstructions(const shared_ptr<Function> &func);
 
-extern void addUser(const shared_ptr<Value> &user, const vector<shared_ptr<Value>> &used);
+extern long long countInstructions(const shared_ptr<Module> &module);
 
 // used in ir built finished.
 extern void removePhiUserBlocksAndMultiCmp(shared_ptr<Module> &module);
@@ -27,6 +30,11 @@ extern void removePhiUserBlocksAndMultiCmp(shared_ptr<Module> &module);
 // used in ir or optimize finished.
 extern void fixRightValue(shared_ptr<Module> &module);
 
+extern void fixRightValue(shared_ptr<Function> &func);
+
+// used when a pass makes a value alive across blocks.
+extern void markLeftValue(const shared_ptr<Value> &value);
+
 extern void getFunctionRequiredStackSize(shared_ptr<Function> &func);
 
 extern void phiElimination(shared_ptr<Function> &func);
@@ -0,0 +1,28 @@
+#include "asm_buffer.h"
+
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+
+AsmBuffer &AsmBuffer::operator<<(int number) {
+    char digits[16];
+    buffer.append(digits, to_chars(digits, digits + sizeof(digits), number).ptr);
+    return *this;
+}
+
+bool AsmBuffer::writeTo(const string &file) const {
+    int fd = file == "-" ? STDOUT_FILENO : open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    const char *data = buffer.data();
+    size_t left = buffer.size();
+    while (left > 0) {
+        ssize_t written = write(fd, data, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) break;
+        data += written;
+        left -= written;
+    }
+    if (fd != STDOUT_FILENO) close(fd);
+    return left == 0;
+}
@@ -0,0 +1,48 @@
+#ifndef COMPILER_ASM_BUFFER_H
+#define COMPILER_ASM_BUFFER_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * Growing in-memory buffer that the assembly is formatted into.
+ * Pieces are appended in place without temporary strings and nothing is flushed per line,
+ * the whole text is written out at once by writeTo after the module is emitted.
+ */
+class AsmBuffer {
+private:
+    string buffer;
+
+public:
+    AsmBuffer &operator<<(const string &s) {
+        buffer.append(s);
+        return *this;
+    }
+
+    AsmBuffer &operator<<(const char *s) {
+        buffer.append(s);
+        return *this;
+    }
+
+    AsmBuffer &operator<<(char c) {
+        buffer.push_back(c);
+        return *this;
+    }
+
+    AsmBuffer &operator<<(int number);
+
+    void reserve(size_t size) { buffer.reserve(size); }
+
+    const string &str() const { return buffer; }
+
+    void clear() { buffer.clear(); }
+
+    /**
+     * Write the whole buffer to a file, or to stdout if the file name is "-".
+     * @return false if the file cannot be opened or written.
+     */
+    bool writeTo(const string &file) const;
+};
+
+#endif
@@ -5,8 +5,10 @@
 
 using namespace std;
 
-ofstream machineIrStream; // NOLINT
+AsmBuffer machineIrStream; // NOLINT
 string longConstantDnf;
+vector<string> machineLabelNames;
+unordered_map<string, int> machineLabelIds;
 extern int const_pool_id;
 extern int ins_count;
 extern int pre_ins_count;
@@ -18,57 +20,90 @@ extern unordered_map<mit::InsType, string> instype2string;
 extern unordered_map<SType, string> stype2string;
 extern unordered_map<Cond, string> cond2string;
 
+long long countMachineInstructions(const shared_ptr<MachineModule> &machineModule) {
+    long long cnt = 0;
+    for (auto &func : machineModule->machineFunctions) {
+        for (auto &bb : func->machineBlocks) {
+            cnt += (long long) bb->MachineInstructions.size();
+        }
+    }
+    return cnt;
+}
+
+int internMachineLabel(const string &name) {
+    auto it = machineLabelIds.find(name);
+    if (it != machineLabelIds.end()) return it->second;
+    int id = (int) machineLabelNames.size();
+    machineLabelIds.emplace(name, id);
+    machineLabelNames.push_back(name);
+    return id;
+}
+
 string convertImm(int imm, const string &reg);
 
 string convertImm(int imm, const string &reg, bool mov);
 
+bool MachineModule::usesNeon() {
+    for (const auto &func:machineFunctions) {
+        for (const auto &machinebb:func->machineBlocks) {
+            for (const auto &ins:machinebb->MachineInstructions) {
+                if (ins->type >= mit::VLOAD && ins->type <= mit::VGET) return true;
+            }
+        }
+    }
+    return false;
+}
+
 void MachineModule::toARM() {
-    machineIrStream << ".arch armv7ve" << endl;
-    machineIrStream << ".data" << endl;
+    // about 32 bytes for each instruction or comment line, so the buffer rarely grows.
+    size_t lines = 0;
+    for (const auto &func:machineFunctions) {
+        for (const auto &machinebb:func->machineBlocks) lines += machinebb->MachineInstructions.size();
+    }
+    machineIrStream.reserve(32 * lines + 4096);
+    machineIrStream << ".arch armv7ve\n";
+    if (usesNeon()) machineIrStream << ".fpu neon-vfpv4\n";
+    machineIrStream << ".data\n";
     for (const auto &variable:globalVariables) {
-        if (s_p_c<GlobalValue>(variable)->variableType == INT) {
-            machineIrStream << s_p_c<GlobalValue>(variable)->name + ": .word " +
-                               to_string(s_p_c<GlobalValue>(variable)->initValues.at(0)) << endl;
-        } else if (s_p_c<GlobalValue>(variable)->variableType == POINTER) {
-            machineIrStream << s_p_c<GlobalValue>(variable)->name + ":" << endl;
+        shared_ptr<GlobalValue> global = s_p_c<GlobalValue>(variable);
+        if (global->variableType == INT) {
+            machineIrStream << global->name << ": .word " << global->initValues.at(0) << '\n';
+        } else if (global->variableType == POINTER) {
+            machineIrStream << global->name << ":\n";
             int start = 0, space;
-            for (auto iter : s_p_c<GlobalValue>(variable)->initValues) {
+            for (auto iter : global->initValues) {
                 space = iter.first * 4 - start;
                 if (space != 0) {
-                    machineIrStream << "    .zero " + to_string(space) << endl;
+                    machineIrStream << "    .zero " << space << '\n';
                 }
-                machineIrStream << "    .word " + to_string(iter.second) << endl;
+                machineIrStream << "    .word " << iter.second << '\n';
                 start = iter.first * 4 + 4;
             }
-            if (start < s_p_c<GlobalValue>(variable)->size * 4) {
-                machineIrStream
-                        << "    .zero " + to_string(s_p_c<GlobalValue>(variable)->size * 4 - start)
-                        << endl;
+            if (start < global->size * 4) {
+                machineIrStream << "    .zero " << global->size * 4 - start << '\n';
             }
         }
     }
     for (const auto &const_array:globalConstants) {
-        machineIrStream << s_p_c<ConstantValue>(const_array)->name + ":" << endl;
+        shared_ptr<ConstantValue> constant = s_p_c<ConstantValue>(const_array);
+        machineIrStream << constant->name << ":\n";
         int start = 0;
         int space;
         map<int, int>::iterator iter;
-        for (iter = s_p_c<ConstantValue>(const_array)->values.begin();
-             iter != s_p_c<ConstantValue>(const_array)->values.end(); iter++) {
+        for (iter = constant->values.begin(); iter != constant->values.end(); iter++) {
             space = iter->first * 4 - start;
             if (space != 0) {
-                machineIrStream << "    .zero " + to_string(space) << endl;
+                machineIrStream << "    .zero " << space << '\n';
             }
-            machineIrStream << "    .word " + to_string(iter->second) << endl;
+            machineIrStream << "    .word " << iter->second << '\n';
             start = iter->first * 4 + 4;
         }
-        if (start < s_p_c<ConstantValue>(const_array)->size * 4) {
-            machineIrStream
-                    << "    .zero " + to_string(s_p_c<ConstantValue>(const_array)->size * 4 - start)
-                    << endl;
+        if (start < constant->size * 4) {
+            machineIrStream << "    .zero " << constant->size * 4 - start << '\n';
         }
     }
-    machineIrStream << ".text" << endl;
-    machineIrStream << ".global main" << endl;
+    machineIrStream << ".text\n";
+    machineIrStream << ".global main\n";
     for (const auto &func:machineFunctions) {
         func->toARM(this->globalVariables, this->globalConstants);
 
@@ -78,7 +113,7 @@ void MachineModule::toARM() {
 }
 
 void MachineFunc::toARM(vector<shared_ptr<Value>> &global_vars, vector<shared_ptr<Value>> &global_consts) {
-    machineIrStream << name + ":" << endl;
+    machineIrStream << name << ":\n";
     for (const auto &machinebb:machineBlocks) {
         machinebb->toARM(global_vars, global_consts);
     }
@@ -113,18 +148,16 @@ bool judgeImmValid(unsigned int imm, bool mov) {
 string convertImm(int imm, const string &reg, bool mov) {
     bool valid = judgeImmValid(imm, mov);
     if (valid && mov) {
-        machineIrStream << "        MOV " + reg + ", #" + to_string((int) imm) << endl;
+        machineIrStream << "        MOV " << reg << ", #" << imm << '\n';
         ++ins_count;
         return reg;
     }
     if (valid) return "#" + to_string(imm);
     invalid_imm.insert(imm);
     if (imm < 0) {
-        machineIrStream << "        LDR " + reg + ", invalid_imm_" + to_string(const_pool_id) + "__" +
-                           to_string(abs((int) imm)) << endl;
+        machineIrStream << "        LDR " << reg << ", invalid_imm_" << const_pool_id << "__" << abs(imm) << '\n';
     } else {
-        machineIrStream << "        LDR " + reg + ", invalid_imm_"
-                           + to_string(const_pool_id) + "_" + to_string((int) imm) << endl;
+        machineIrStream << "        LDR " << reg << ", invalid_imm_" << const_pool_id << '_' << imm << '\n';
     }
     ++ins_count;
     return reg;
@@ -136,37 +169,64 @@ string convertImm(int imm, const string &reg) {
 
 void insert_reference(vector<shared_ptr<Value>> &global_vars, vector<shared_ptr<Value>> &global_consts) {
     //generate jump to skip constant pool
-    machineIrStream << "        B next" + to_string(const_pool_id) << endl;
+    machineIrStream << "        B next" << const_pool_id << '\n';
     //generate constant pool reference
     for (const auto &glob_var:global_vars) {
-        machineIrStream << s_p_c<GlobalValue>(glob_var)->name + to_string(const_pool_id) + "_whitee_" +
-                           to_string(const_pool_id) + ":"
-                        << endl;
-        machineIrStream << "    .long " + s_p_c<GlobalValue>(glob_var)->name << endl;
+        const string &name = s_p_c<GlobalValue>(glob_var)->name;
+        machineIrStream << name << const_pool_id << "_whitee_" << const_pool_id << ":\n";
+        machineIrStream << "    .long " << name << '\n';
     }
     for (const auto &glob_const:global_consts) {
-        machineIrStream << s_p_c<ConstantValue>(glob_const)->name + to_string(const_pool_id) + "_whitee_" +
-                           to_string(const_pool_id) + ":"
-                        << endl;
-        machineIrStream << "    .long " + s_p_c<ConstantValue>(glob_const)->name << endl;
+        const string &name = s_p_c<ConstantValue>(glob_const)->name;
+        machineIrStream << name << const_pool_id << "_whitee_" << const_pool_id << ":\n";
+        machineIrStream << "    .long " << name << '\n';
     }
     for (int invalid_int:invalid_imm) {
         if (invalid_int < 0) {
-            machineIrStream << "invalid_imm_" + to_string(const_pool_id) + "__" + to_string(abs(invalid_int)) + ":"
-                            << endl;
+            machineIrStream << "invalid_imm_" << const_pool_id << "__" << abs(invalid_int) << ":\n";
         } else {
-            machineIrStream << "invalid_imm_" + to_string(const_pool_id) + "_" + to_string(invalid_int) + ":" << endl;
+            machineIrStream << "invalid_imm_" << const_pool_id << '_' << invalid_int << ":\n";
         }
-        machineIrStream << "    .long " + to_string(invalid_int) << endl;
+        machineIrStream << "    .long " << invalid_int << '\n';
     }
     invalid_imm.clear();
     //generate branch label
-    machineIrStream << "    next" + to_string(const_pool_id) + ":" << endl;
+    machineIrStream << "    next" << const_pool_id << ":\n";
     const_pool_id++;
 }
 
+/**
+ * Emit the indented mnemonic with its condition suffix and the separating space.
+ */
+static void emitMnemonic(mit::InsType type, Cond cond) {
+    machineIrStream << "        " << instype2string.at(type) << cond2string.at(cond) << ' ';
+}
+
+/**
+ * Emit a register operand, or an immediate one if it is allowed at this place.
+ */
+static void emitOperand(const shared_ptr<Operand> &op) {
+    machineIrStream << (op->state == IMM ? '#' : 'R') << op->value;
+}
+
+/**
+ * Emit a register operand, or the fallback register if the operand is not in a register.
+ */
+static void emitRegister(const shared_ptr<Operand> &op, const char *fallback) {
+    if (op->state == REG) machineIrStream << 'R' << op->value;
+    else machineIrStream << fallback;
+}
+
+/**
+ * Emit the shift applied to the last operand, if any.
+ */
+static void emitShift(const shared_ptr<Shift> &shift) {
+    if (shift->type != NONE) {
+        machineIrStream << ", " << stype2string.at(shift->type) << " #" << shift->shift;
+    }
+}
+
 void BinaryIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    string t_op1;
     //op1
     if (op1->state == GLOB_INT || op1->state == GLOB_POINTER) {
         cerr << "GG in virtual op1 bin." << endl;
@@ -177,48 +237,30 @@ void BinaryIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     } else if (op1->state == IMM) {
         cerr << "GG!!!In BinaryIns::toARM op1->state == IMM" << endl;
         exit(_MACH_IR_ERR);
-    } else {
-        t_op1 = "R" + op1->value;
     }
     //op2
-    string t_op2;
     if (op2->state == GLOB_INT || op2->state == GLOB_POINTER) {
         cerr << "GG in bin op2 global." << endl;
         exit(_MACH_IR_ERR);
     } else if (op2->state == VIRTUAL) {
         cerr << "GG in bin op2 virtual." << endl;
         exit(_MACH_IR_ERR);
-    } else if (op2->state == IMM) {
-        if (this->type == mit::MUL || this->type == mit::DIV) {
-            cerr << "GG!!!In BinaryIns::toARM, MUL and DIV: op2->state == IMM" << endl;
-            exit(_MACH_IR_ERR);
-        } else {
-            t_op2 = "#" + op2->value;
-        }
-    } else {
-        t_op2 = "R" + op2->value;
-    }
-    //rd
-    string des;
-    if (rd->state == REG) {
-        des = "R" + rd->value;
-    } else {
-        des = "R1";
+    } else if (op2->state == IMM && (this->type == mit::MUL || this->type == mit::DIV)) {
+        cerr << "GG!!!In BinaryIns::toARM, MUL and DIV: op2->state == IMM" << endl;
+        exit(_MACH_IR_ERR);
     }
     //compute
+    emitMnemonic(this->type, this->cond);
+    emitRegister(rd, "R1");
+    machineIrStream << ", R" << op1->value;
     if (this->type == mit::ASR || this->type == mit::LSR || this->type == mit::LSL) {
-        machineIrStream
-                << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + des + ", " + t_op1 +
-                   ", #" + to_string(shift->shift) << endl;
+        machineIrStream << ", #" << shift->shift << '\n';
     } else {
-        machineIrStream
-                << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + des + ", " + t_op1 +
-                   ", " + t_op2;
+        machineIrStream << ", ";
+        emitOperand(op2);
         ins_count++;
-        if (this->shift->type != NONE) {
-            machineIrStream << ", " + stype2string.at(this->shift->type) + " #" + to_string(this->shift->shift);
-        }
-        machineIrStream << endl;
+        emitShift(this->shift);
+        machineIrStream << '\n';
     }
 
     ins_count++;
@@ -233,7 +275,6 @@ void BinaryIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
 }
 
 void TriIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    string t_op1;
     //op1
     if (op1->state == GLOB_INT || op1->state == GLOB_POINTER) {
         cerr << "GG in tri op1 global." << endl;
@@ -244,11 +285,8 @@ void TriIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     } else if (op1->state == IMM) {
         cerr << "GG!!!In TriIns::toARM op1->state == IMM" << endl;
         exit(_MACH_IR_ERR);
-    } else {
-        t_op1 = "R" + op1->value;
     }
     //op2
-    string t_op2;
     if (op2->state == GLOB_INT || op2->state == GLOB_POINTER) {
         cerr << "GG in tri op2 vir." << endl;
         exit(_MACH_IR_ERR);
@@ -258,11 +296,8 @@ void TriIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     } else if (op2->state == IMM) {
         cerr << "GG!!!In TriIns::toARM op2->state == IMM" << endl;
         exit(_MACH_IR_ERR);
-    } else {
-        t_op2 = "R" + op2->value;
     }
     //op3
-    string t_op3;
     if (op3->state == GLOB_INT || op3->state == GLOB_POINTER) {
         cerr << "gg in tri op3 global." << endl;
         exit(_MACH_IR_ERR);
@@ -272,20 +307,11 @@ void TriIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     } else if (op3->state == IMM) {
         cerr << "GG!!!In TriIns::toARM op3->state == IMM" << endl;
         exit(_MACH_IR_ERR);
-    } else {
-        t_op3 = "R" + op3->value;
-    }
-    //rd
-    string des;
-    if (rd->state == REG) {
-        des = "R" + rd->value;
-    } else {
-        des = "R4";
     }
     //compute
-    machineIrStream
-            << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + des + ", " + t_op1 +
-               ", " + t_op2 + ", " + t_op3 << endl;
+    emitMnemonic(this->type, this->cond);
+    emitRegister(rd, "R4");
+    machineIrStream << ", R" << op1->value << ", R" << op2->value << ", R" << op3->value << '\n';
     ins_count++;
     //store rd
     if (rd->state == GLOB_INT) {
@@ -299,34 +325,22 @@ void TriIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
 
 void MemoryIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     //base
-    string add = "R1";
     if (base->state == GLOB_INT || base->state == GLOB_POINTER) {
         cerr << "GG in global memory base." << endl;
         exit(_MACH_IR_ERR);
     } else if (base->state == VIRTUAL) {
         cerr << "GG in virtual memory base." << endl;
         exit(_MACH_IR_ERR);
-    } else if (base->state == REG) {
-        add = "R" + base->value;
     }
     //offset
-    string off;
     if (offset->state == GLOB_INT) {
         cerr << "GG in global offset." << endl;
         exit(_MACH_IR_ERR);
     } else if (offset->state == VIRTUAL) {
         cerr << "GG in virtual offset." << endl;
         exit(_MACH_IR_ERR);
-    } else if (offset->state == IMM) {
-        off = "#" + this->offset->value;
-    } else {
-        off = "R" + offset->value;
     }
     //rd
-    string des = "R2";
-    if (rd->state == REG) {
-        des = "R" + rd->value;
-    }
     if (this->type == mit::STORE) {
         if (rd->state == GLOB_INT) {
             cerr << "GG memory global rd." << endl;
@@ -338,23 +352,17 @@ void MemoryIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
             cerr << "GG!!!In MemoryIns::toARM, rd->state == IMM" << endl;
             exit(_MACH_IR_ERR);
         }
-        machineIrStream
-                << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + des + ", [" + add +
-                   ", " + off;
-        if (this->shift->type != NONE) {
-            machineIrStream << ", " + stype2string.at(this->shift->type) + " #" + to_string(this->shift->shift);
-        }
-        machineIrStream << "]" << endl;
-        ins_count++;
-    } else {
-        machineIrStream
-                << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + des + ", [" + add +
-                   ", " + off;
-        if (this->shift->type != NONE) {
-            machineIrStream << ", " + stype2string.at(this->shift->type) + " #" + to_string(this->shift->shift);
-        }
-        machineIrStream << "]" << endl;
-        ins_count++;
+    }
+    emitMnemonic(this->type, this->cond);
+    emitRegister(rd, "R2");
+    machineIrStream << ", [";
+    emitRegister(base, "R1");
+    machineIrStream << ", ";
+    emitOperand(offset);
+    emitShift(this->shift);
+    machineIrStream << "]\n";
+    ins_count++;
+    if (this->type != mit::STORE) {
         if (rd->state == VIRTUAL) {
             cerr << "gg in virtual memory rd." << endl;
             exit(_MACH_IR_ERR);
@@ -366,24 +374,28 @@ void MemoryIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
 }
 
 void PseudoLoad::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    string des = "R" + rd->value;
-    machineIrStream
-            << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + des + ", " + label->value
-            << endl;
+    emitMnemonic(this->type, this->cond);
+    machineIrStream << 'R' << rd->value << ", ";
+    if (isGlob) {
+        machineIrStream << machineLabelNames.at(label->value) << poolId << "_whitee_" << poolId << '\n';
+    } else if (label->value < 0) {
+        machineIrStream << "invalid_imm_" << poolId << "__" << -label->value << '\n';
+    } else {
+        machineIrStream << "invalid_imm_" << poolId << '_' << label->value << '\n';
+    }
 }
 
 void StackIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    machineIrStream << "        " + instype2string.at(this->type) + " {";
+    machineIrStream << "        " << instype2string.at(this->type) << " {";
     for (int i = 0; i < this->regs.size() - 1; i++) {
-        machineIrStream << "R" + regs[i]->value + ", ";
+        machineIrStream << 'R' << regs[i]->value << ", ";
     }
-    machineIrStream << "R" + regs[regs.size() - 1]->value + "}" << endl;
+    machineIrStream << 'R' << regs[regs.size() - 1]->value << "}\n";
     ins_count++;
 }
 
 void CmpIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     //op1
-    string f_op;
     if (op1->state == GLOB_INT || op1->state == GLOB_POINTER) {
         cerr << "gg in op1 state global cmp." << endl;
         exit(_MACH_IR_ERR);
@@ -393,56 +405,39 @@ void CmpIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     } else if (op1->state == IMM) {
         cerr << "GG!!!In CmpIns::toARM op1->state == IMM" << endl;
         exit(_MACH_IR_ERR);
-    } else {
-        f_op = "R" + op1->value;
     }
     //op2
-    string s_op;
     if (op2->state == GLOB_INT || op2->state == GLOB_POINTER) {
         cerr << "GG in cmp op2 global." << endl;
         exit(_MACH_IR_ERR);
     } else if (op2->state == VIRTUAL) {
         cerr << "GG in cmp op2 vir." << endl;
         exit(_MACH_IR_ERR);
-    } else if (op2->state == IMM) {
-        s_op = "#" + op2->value;
-    } else {
-        s_op = "R" + op2->value;
     }
 
-    machineIrStream
-            << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + f_op + ", " + s_op;
-    if (this->shift->type != NONE) {
-        machineIrStream << ", " + stype2string.at(this->shift->type) + " #" + to_string(this->shift->shift);
-    }
-    machineIrStream << endl;
+    emitMnemonic(this->type, this->cond);
+    machineIrStream << 'R' << op1->value << ", ";
+    emitOperand(op2);
+    emitShift(this->shift);
+    machineIrStream << '\n';
     ins_count++;
 }
 
 void MovIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
     //op2
-    string v_op;
     if (op2->state == GLOB_INT || op2->state == GLOB_POINTER) {
         cerr << "gg in op2 global move." << endl;
         exit(_MACH_IR_ERR);
     } else if (op2->state == VIRTUAL) {
         cerr << "gg in op2 virtual move." << endl;
         exit(_MACH_IR_ERR);
-    } else if (op2->state == IMM) {
-        v_op = "#" + op2->value;
-    } else {
-        v_op = "R" + op2->value;
     }
     //op1
-    string t_op;
-    if (op1->state == REG) {
-        t_op = "R" + op1->value;
-    } else {
-        t_op = "R2";
-    }
-    machineIrStream
-            << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + t_op + ", " + v_op
-            << endl;
+    emitMnemonic(this->type, this->cond);
+    emitRegister(op1, "R2");
+    machineIrStream << ", ";
+    emitOperand(op2);
+    machineIrStream << '\n';
     ins_count++;
     if (op1->state == GLOB_INT) {
         cerr << "gg in mov op1 global." << endl;
@@ -454,27 +449,35 @@ void MovIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
 }
 
 void BIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    machineIrStream << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + label << endl;
+    emitMnemonic(this->type, this->cond);
+    machineIrStream << label << '\n';
     ins_count++;
 }
 
 void BLIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    machineIrStream << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " " + label << endl;
+    emitMnemonic(this->type, this->cond);
+    machineIrStream << label << '\n';
     ins_count++;
 }
 
 void BXIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    machineIrStream << "        " + instype2string.at(this->type) + cond2string.at(this->cond) + " LR" << endl;
+    emitMnemonic(this->type, this->cond);
+    machineIrStream << "LR\n";
     ins_count++;
 }
 
 void GlobalIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    machineIrStream << this->name + ":" << endl;
+    machineIrStream << this->name << ":\n";
     if (!this->value.empty()) {
-        machineIrStream << "    .long " + this->value << endl;
+        machineIrStream << "    .long " << this->value << '\n';
     }
 }
 
+void VectorIns::toARM(shared_ptr<MachineFunc> &machineFunc) {
+    machineIrStream << "        " << toString() << '\n';
+    ins_count++;
+}
+
 void Comment::toARM(shared_ptr<MachineFunc> &machineFunc) {
-    machineIrStream << "    @" + content << endl;
+    machineIrStream << "    @" << content << '\n';
 }
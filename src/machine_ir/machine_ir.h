@@ -2,12 +2,13 @@
 #define COMPILER_MACHINE_IR_H
 
 #include "../ir/ir.h"
+#include "asm_buffer.h"
 
 #include <fstream>
 
 using namespace std;
 
-extern ofstream machineIrStream;
+extern AsmBuffer machineIrStream;
 
 class MachineModule;
 
@@ -39,6 +40,8 @@ class BXIns;
 
 class GlobalIns;
 
+class VectorIns;
+
 class PhiTmp;
 
 extern bool readRegister(shared_ptr<Value> &val, shared_ptr<Operand> &op, shared_ptr<MachineFunc> &machineFunc,
@@ -47,9 +50,18 @@ extern bool readRegister(shared_ptr<Value> &val, shared_ptr<Operand> &op, shared
 extern bool writeRegister(shared_ptr<Value> &val, shared_ptr<Operand> &op, shared_ptr<MachineFunc> &machineFunc,
                           vector<shared_ptr<MachineIns>> &res);
 
-extern void releaseTempRegister(const string &reg);
+extern void releaseTempRegister(int reg);
+
+extern int allocTempRegister();
+
+// names of the globals that PseudoLoad loads, the operands only keep the index.
+extern vector<string> machineLabelNames;
 
-extern string allocTempRegister();
+// the globals are interned before the functions are built in parallel, which then only look them up.
+extern int internMachineLabel(const string &name);
+
+// used in pass report.
+extern long long countMachineInstructions(const shared_ptr<MachineModule> &machineModule);
 
 extern void store2Memory(shared_ptr<Operand> &des, int val_id, shared_ptr<MachineFunc> &machineFunc,
                          vector<shared_ptr<MachineIns>> &res);
@@ -86,7 +98,17 @@ namespace mit {
         BLINK,
         BRETURN,
         GLOBAL,
-        COMMENT
+        COMMENT,
+        VLOAD,
+        VSTORE,
+        VDUP,
+        VMOV,
+        VADD,
+        VSUB,
+        VMUL,
+        VMLA,
+        VPADD,
+        VGET
     };
 }
 
@@ -114,6 +136,28 @@ enum Cond {
     GT              // >
 };
 
+/**
+ * Physical registers, a REG operand keeps one of them.
+ */
+enum PhyReg {
+    R0,
+    R1,
+    R2,
+    R3,
+    R4,
+    R5,
+    R6,
+    R7,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    SP,
+    LR,
+    PC
+};
+
 /**
  * For represent an op type
  */
@@ -141,6 +185,8 @@ public:
     vector<shared_ptr<Value>> globalVariables;
     vector<shared_ptr<Value>> globalConstants;
 
+    bool usesNeon();
+
     void toARM();
 };
 
@@ -150,7 +196,7 @@ public:
     FuncType funcType;
     vector<shared_ptr<Value>> params;
     vector<shared_ptr<MachineBB>> machineBlocks;
-    unordered_map<string, int> var2offset;
+    unordered_map<unsigned int, int> var2offset; // value id <--> offset to the sp.
     // stack size
     int stackSize;
     int stackPointer;
@@ -162,7 +208,7 @@ class MachineBB {
 public:
     int index;
     shared_ptr<MachineFunc> function;
-    vector<shared_ptr<MachineIns>> MachineInstructions;
+    list<shared_ptr<MachineIns>> MachineInstructions;
 
     explicit MachineBB(int index, shared_ptr<MachineFunc> &function) : index(index), function(function) {};
 
@@ -200,9 +246,15 @@ public:
 class Operand {
 public:
     State state;
-    string value;  // op value
-
-    Operand(State state, string value) : state(state), value(value) {};
+    /*
+     * REG: the PhyReg number.
+     * IMM: the immediate.
+     * LABEL: the number loaded from the constant pool.
+     * GLOB_INT, GLOB_POINTER: the index of the global in machineLabelNames.
+     */
+    int value;
+
+    Operand(State state, int value) : state(state), value(value) {};
 };
 
 class BinaryIns : public MachineIns {
@@ -287,6 +339,7 @@ public:
     shared_ptr<Operand> rd;
     shared_ptr<Operand> label;
     bool isGlob;
+    int poolId = -1;  // the constant pool holding the label.
 
     PseudoLoad(Cond condition, SType stype, int shift, shared_ptr<Operand> &label, shared_ptr<Operand> &rd, bool isGlob)
             : MachineIns(mit::PSEUDO_LOAD, condition, stype, shift), label(label), rd(rd), isGlob(isGlob) {};
@@ -404,6 +457,34 @@ public:
     void toARM(shared_ptr<MachineFunc> &machineFunc) override;
 };
 
+/**
+ * For NEON, vd, vn and vm are numbers of q registers, or of d registers if not quad.
+ * VLOAD and VSTORE move vd from and to the words at rn, VDUP fills vd with rn, VMOV fills vd with imm,
+ * VGET moves the first lane of vn to rn, the others compute vd from vn and vm.
+ */
+class VectorIns : public MachineIns {
+public:
+    int vd = 0;
+    int vn = 0;
+    int vm = 0;
+    bool quad = true;
+    shared_ptr<Operand> rn;
+    bool writeBack = false; // VLOAD and VSTORE step rn to the words after.
+    int imm = 0;
+
+    VectorIns(mit::InsType type, int vd, int vn, int vm, bool quad)
+            : MachineIns(type, NON, NONE, 0), vd(vd), vn(vn), vm(vm), quad(quad) {};
+
+    VectorIns(mit::InsType type, int vd, shared_ptr<Operand> &rn, bool writeBack)
+            : MachineIns(type, NON, NONE, 0), vd(vd), vn(vd), rn(rn), writeBack(writeBack) {};
+
+    VectorIns(int vd, int imm) : MachineIns(mit::VMOV, NON, NONE, 0), vd(vd), imm(imm) {};
+
+    string toString() override;
+
+    void toARM(shared_ptr<MachineFunc> &machineFunc) override;
+};
+
 class Comment : public MachineIns {
 public:
     string content;
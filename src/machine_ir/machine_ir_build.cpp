@@ -6,19 +6,31 @@
 
 #include "machine_ir_build.h"
 #include "../basic/std/compile_std.h"
+#include "../basic/report/pass_report.h"
+#include "../basic/parallel/parallel_for.h"
 #include "../optimize/machine/machine_optimize.h"
 
 extern bool judgeImmValid(unsigned int imm, bool mov);
 
-unordered_map<shared_ptr<BasicBlock>, shared_ptr<MachineBB>> IRB2MachB;
+// per-function build state, thread local as functions may be built in parallel.
+thread_local unordered_map<shared_ptr<BasicBlock>, shared_ptr<MachineBB>> IRB2MachB;
 
 int const_pool_id = 0;
 int ins_count = 0;
 int pre_ins_count = 0;
 set<int> invalid_imm;
 
-Cond cmp_op = NON;
-bool true_cmp = false;
+thread_local Cond cmp_op = NON;
+thread_local bool true_cmp = false;
+
+// ir text of each instruction, printed serially before the parallel build as the ssa names are numbered globally.
+unordered_map<Instruction *, string> irInsText;
+
+// function name <--> bit mask of the global registers the function may change, its callees included.
+unordered_map<string, unsigned int> clobberedRegs;
+
+// the runtime library keeps the registers saved by the AAPCS, but a call veneer may change R12.
+const unsigned int LIBRARY_CLOBBERED_REGS = 1u << R12;
 
 unordered_map<mit::InsType, string> instype2string = { // NOLINT
         {mit::ADD,         "ADD"},
@@ -47,7 +59,17 @@ unordered_map<mit::InsType, string> instype2string = { // NOLINT
         {mit::MLS,         "MLS"},
         {mit::MLA,         "MLA"},
         {mit::GLOBAL,      "GLOBAL"},
-        {mit::COMMENT,     "COMMENT"}
+        {mit::COMMENT,     "COMMENT"},
+        {mit::VLOAD,       "VLD1.32"},
+        {mit::VSTORE,      "VST1.32"},
+        {mit::VDUP,        "VDUP.32"},
+        {mit::VMOV,        "VMOV.I32"},
+        {mit::VADD,        "VADD.I32"},
+        {mit::VSUB,        "VSUB.I32"},
+        {mit::VMUL,        "VMUL.I32"},
+        {mit::VMLA,        "VMLA.I32"},
+        {mit::VPADD,       "VPADD.I32"},
+        {mit::VGET,        "VMOV.32"}
 };
 
 unordered_map<SType, string> stype2string{ // NOLINT
@@ -79,14 +101,19 @@ unordered_map<State, string> state2string{ // NOLINT
 void loadImm2Reg(int num, shared_ptr<Operand> des, vector<shared_ptr<MachineIns>> &res, bool mov);
 
 void loadVal2Reg(shared_ptr<Value> &val, shared_ptr<Operand> &des, shared_ptr<MachineFunc> &machineFunc,
-                 vector<shared_ptr<MachineIns>> &res, bool mov, int compensate = 0, string reg = "3");
+                 vector<shared_ptr<MachineIns>> &res, bool mov, int compensate = 0, int reg = R3);
 
 vector<shared_ptr<MachineIns>> genRetIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc);
 
+void genFrameRelease(shared_ptr<MachineFunc> &machineFunc, int reg, int tempReg, vector<shared_ptr<MachineIns>> &res);
+
 vector<shared_ptr<MachineIns>> genJmpIns(shared_ptr<Instruction> &ins);
 
+bool isSiblingCall(shared_ptr<Instruction> &ins);
+
 vector<shared_ptr<MachineIns>>
-genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc, shared_ptr<Module> &module);
+genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc, shared_ptr<Module> &module,
+              bool sibling);
 
 vector<shared_ptr<MachineIns>> genUnaryIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc);
 
@@ -96,10 +123,29 @@ vector<shared_ptr<MachineIns>> genStoreIns(shared_ptr<Instruction> &ins, shared_
 
 vector<shared_ptr<MachineIns>> genLoadIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc);
 
+vector<shared_ptr<MachineIns>> genBulkInitIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc);
+
+vector<shared_ptr<MachineIns>> genVectorIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc);
+
 void genAlloc(shared_ptr<MachineFunc> &machineFunc, shared_ptr<Instruction> &ins);
 
 vector<shared_ptr<MachineIns>> genBIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc);
 
+/**
+ * Condition code under which a comparison holds.
+ */
+Cond irOpCond(IrOp op) {
+    switch (op) {
+        case OP_EQ: return EQ;
+        case OP_NE: return NE;
+        case OP_LT: return LS;
+        case OP_GT: return GT;
+        case OP_LE: return LE;
+        case OP_GE: return GE;
+        default: return NON;
+    }
+}
+
 vector<shared_ptr<MachineIns>> genCmpIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc);
 
 vector<shared_ptr<MachineIns>>
@@ -109,102 +155,281 @@ vector<shared_ptr<MachineIns>> genPhi(shared_ptr<Instruction> &ins, shared_ptr<M
 
 vector<shared_ptr<MachineIns>> genGlobIns(shared_ptr<MachineModule> &machineModule);
 
-set<string> tempRegPool; // NOLINT
-unordered_map<shared_ptr<Value>, string> lValRegMap;
-unordered_map<shared_ptr<Value>, string> rValRegMap;
-unordered_set<string> regInUse;
+/**
+ * Temp registers are handed out in the order R0, R1, LR, R2, R3, the same order as the former
+ * pool of register names, which sorted "14" before "2".
+ */
+struct TempRegisterOrder {
+    static int rank(int reg) { return reg == LR ? 2 : reg < R2 ? reg : reg + 1; }
+
+    bool operator()(int a, int b) const { return rank(a) < rank(b); }
+};
+
+thread_local set<int, TempRegisterOrder> tempRegPool; // NOLINT
+thread_local unordered_map<shared_ptr<Value>, int> lValRegMap;
+thread_local unordered_map<shared_ptr<Value>, int> rValRegMap;
+thread_local unordered_set<int> regInUse;
+thread_local unordered_set<BasicBlock *> framelessBlocks; // LR keeps the return address in these blocks.
+thread_local bool tempRegShortage;
 
 // we need to record vars' addr in this step
 // for local vars, we need to record the offset to the sp
 // for global vars, we need to record the label
 
-shared_ptr<MachineModule> buildMachineModule(shared_ptr<Module> &module) {
-    shared_ptr<MachineModule> machineModule = make_shared<MachineModule>(); // NOLINT
-    machineModule->globalConstants = module->globalConstants;
-    machineModule->globalVariables = module->globalVariables;
-
-    for (auto &func : module->functions) {
-        // if (_debugMachineIr) cout << func->name + ":" << endl;
-        shared_ptr<MachineFunc> machineFunction = make_shared<MachineFunc>();
-        //machineModule->machineFunctions.push_back(machineFunction);
-        machineFunction->name = func->name;
-        machineFunction->funcType = func->funcType;
-        machineFunction->params = func->params;
-        machineFunction->stackSize = func->requiredStackSize + _W_LEN;
-        machineFunction->stackPointer = 0;
-
-        /// begin: clear all register pools.
-        while (!tempRegPool.empty()) tempRegPool.clear();
-        regInUse.clear();
-        rValRegMap.clear();
-        lValRegMap = func->variableRegs;
-        for (int i = _TMP_REG_CNT - 2; i >= 0; --i) {
-            tempRegPool.insert(to_string(_TMP_REG_START + i));
-        }
-        tempRegPool.insert("14");
-        for (auto &it : lValRegMap) regInUse.insert(it.second);
-        /// end: clear all register pools.
-
-        shared_ptr<MachineBB> func_epilogue = make_shared<MachineBB>(func->blocks[0]->getValueId(), machineFunction);
-        /// manage parameters
-        int para_size = 0;
-        for (int i = 4; i < machineFunction->params.size(); ++i) {
-            if (lValRegMap.count(machineFunction->params[i]) != 0) {
-                shared_ptr<Operand> des = make_shared<Operand>(REG, lValRegMap.at(machineFunction->params[i]));
-                shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
-                shared_ptr<Operand> offset = make_shared<Operand>(IMM, to_string((i - 4) * 4));
-                shared_ptr<MemoryIns> load_para = make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, NONE, 0, des, stack,
-                                                                         offset);
-                func_epilogue->MachineInstructions.push_back(load_para);
-            } else {
-                machineFunction->var2offset.insert(pair<string, int>(to_string(machineFunction->params[i]->id),
-                                                                     (i - 4) * 4 + machineFunction->stackSize));
+/**
+ * Shrink-wrap the frame of a function, which is the LR save and the stack adjustment.
+ * A block needs the frame if it calls a function, or reads or writes a value kept on the stack.
+ * The frame is set up in the nearest common dominator of these blocks, and the blocks it does not dominate
+ * return by BX LR without a frame.
+ * The frame stays in the entry block if that block is in a loop, or a return after it is reachable without it.
+ * Returns the block to set up the frame in, or nullptr if the function needs no frame.
+ */
+shared_ptr<BasicBlock> shrinkWrapFrame(shared_ptr<Function> &func) {
+    framelessBlocks.clear();
+    unordered_set<shared_ptr<BasicBlock>> frameBlocks;
+    vector<shared_ptr<Value>> stackValues;
+    for (int i = 0; i < func->params.size(); ++i) {
+        if (func->variableRegs.count(func->params[i]) != 0) continue;
+        if (i < 4) return func->entryBlock; // stored into the frame by the prologue.
+        stackValues.push_back(func->params[i]);
+    }
+    for (auto &bb : func->blocks) {
+        for (auto &ins : bb->instructions) {
+            if (ins->type == ALLOC) return func->entryBlock;
+            if (ins->type == INVOKE) frameBlocks.insert(bb);
+            if (ins->type == PHI) {
+                shared_ptr<Value> phiMove = s_p_c<PhiInstruction>(ins)->phiMove;
+                if (phiMove != nullptr && func->variableRegs.count(phiMove) == 0) frameBlocks.insert(bb);
+            }
+            if ((ins->resultType == L_VAL_RESULT || ins->type == PHI_MOV) && func->variableRegs.count(ins) == 0) {
+                frameBlocks.insert(bb);
+                stackValues.push_back(ins);
             }
         }
-        for (int i = 0; i < machineFunction->params.size() && i < 4; ++i) {
-            if (lValRegMap.count(machineFunction->params[i]) == 0) //no reg
-            {
-                shared_ptr<Operand> para_reg = make_shared<Operand>(REG, to_string(i));
-                shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
-                shared_ptr<Operand> offset = make_shared<Operand>(IMM, to_string(-16 + i * 4));
-                shared_ptr<MemoryIns> storeParam = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, para_reg,
-                                                                          stack, offset);
-                func_epilogue->MachineInstructions.push_back(storeParam);
-                machineFunction->var2offset.insert(pair<string, int>(to_string(machineFunction->params[i]->id),
-                                                                     -16 + i * 4 + machineFunction->stackSize));
-            } else {
-                shared_ptr<Operand> para_reg = make_shared<Operand>(REG, to_string(i));
-                shared_ptr<Operand> des_reg = make_shared<Operand>(REG, lValRegMap.at(machineFunction->params[i]));
-                shared_ptr<MovIns> mov2Des = make_shared<MovIns>(NON, NONE, 0, des_reg, para_reg);
-                func_epilogue->MachineInstructions.push_back(mov2Des);
+    }
+    for (auto &value : stackValues) {
+        for (auto &user : value->getUsers()) {
+            if (user->valueType != INSTRUCTION) continue;
+            shared_ptr<Instruction> userIns = s_p_c<Instruction>(user);
+            if (userIns->type != PHI) {
+                frameBlocks.insert(userIns->block);
+                continue;
+            }
+            for (auto &it : s_p_c<PhiInstruction>(userIns)->operands) {
+                if (it.second == value) frameBlocks.insert(it.first); // read by the phi move of the predecessor.
             }
         }
-        ///lr: temp reg
-        shared_ptr<Operand> lr = make_shared<Operand>(REG, "14");
-        shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
-        shared_ptr<Operand> lrSpace = make_shared<Operand>(IMM, "-20");
-        shared_ptr<MemoryIns> storeLR = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, lr, stack, lrSpace);
-        func_epilogue->MachineInstructions.push_back(storeLR);
-        ///move stack
-        shared_ptr<Operand> stack_size;
-        if (judgeImmValid(machineFunction->stackSize, false)) {
-            stack_size = make_shared<Operand>(IMM, to_string(machineFunction->stackSize));
+    }
+
+    invalidateFunctionAnalysis(func);
+    FunctionAnalysis &analysis = getFunctionAnalysis(func);
+    shared_ptr<BasicBlock> frameBlock;
+    for (auto &bb : frameBlocks) {
+        if (!analysis.isReachable(bb)) continue;
+        if (frameBlock == nullptr) frameBlock = bb;
+        while (!analysis.dominates(frameBlock, bb)) frameBlock = analysis.getImmediateDominator(frameBlock);
+    }
+    if (frameBlock == func->entryBlock) return frameBlock;
+    if (frameBlock != nullptr) {
+        if (analysis.getLoopFor(frameBlock) != nullptr) return func->entryBlock;
+        unordered_set<shared_ptr<BasicBlock>> visited = {frameBlock};
+        vector<shared_ptr<BasicBlock>> worklist = {frameBlock};
+        while (!worklist.empty()) {
+            shared_ptr<BasicBlock> bb = worklist.back();
+            worklist.pop_back();
+            if (!bb->instructions.empty() && bb->instructions.back()->type == RET
+                && !analysis.dominates(frameBlock, bb)) {
+                return func->entryBlock;
+            }
+            for (auto &succ : bb->successors) {
+                if (visited.insert(succ).second) worklist.push_back(succ);
+            }
+        }
+    }
+    for (auto &bb : func->blocks) {
+        if (frameBlock == nullptr || !analysis.dominates(frameBlock, bb)) framelessBlocks.insert(bb.get());
+    }
+    return frameBlock;
+}
+
+/**
+ * Set up the frame: save LR below the stack pointer and move the stack pointer down by the stack size.
+ */
+void genFrameSetup(shared_ptr<MachineFunc> &machineFunction, vector<shared_ptr<MachineIns>> &res) {
+    shared_ptr<Operand> lr = make_shared<Operand>(REG, LR);
+    shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
+    shared_ptr<Operand> lrSpace = make_shared<Operand>(IMM, -20);
+    shared_ptr<MemoryIns> storeLR = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, lr, stack, lrSpace);
+    res.push_back(storeLR);
+    shared_ptr<Operand> stack_size;
+    if (judgeImmValid(machineFunction->stackSize, false)) {
+        stack_size = make_shared<Operand>(IMM, machineFunction->stackSize);
+    } else {
+        stack_size = make_shared<Operand>(REG, R0);
+        loadImm2Reg(machineFunction->stackSize, stack_size, res, true);
+    }
+    shared_ptr<BinaryIns> moveStack = make_shared<BinaryIns>(mit::SUB, NON, NONE, 0, stack, stack_size, stack);
+    res.push_back(moveStack);
+}
+
+shared_ptr<MachineFunc>
+buildMachineFunction(shared_ptr<Function> &func, unsigned int prologueId, shared_ptr<Module> &module,
+                     bool shrinkWrap = true) {
+    // if (_debugMachineIr) cout << func->name + ":" << endl;
+    shared_ptr<MachineFunc> machineFunction = make_shared<MachineFunc>();
+    machineFunction->name = func->name;
+    machineFunction->funcType = func->funcType;
+    machineFunction->params = func->params;
+    machineFunction->stackSize = func->requiredStackSize + _W_LEN;
+    machineFunction->stackPointer = 0;
+
+    /// begin: clear all register pools.
+    while (!tempRegPool.empty()) tempRegPool.clear();
+    regInUse.clear();
+    rValRegMap.clear();
+    lValRegMap = func->variableRegs;
+    for (int i = _TMP_REG_CNT - 2; i >= 0; --i) {
+        tempRegPool.insert(_TMP_REG_START + i);
+    }
+    tempRegPool.insert(LR);
+    for (auto &it : lValRegMap) regInUse.insert(it.second);
+    /// end: clear all register pools.
+
+    shared_ptr<MachineBB> func_epilogue = make_shared<MachineBB>(prologueId, machineFunction);
+    /// manage parameters
+    int para_size = 0;
+    for (int i = 4; i < machineFunction->params.size(); ++i) {
+        if (lValRegMap.count(machineFunction->params[i]) != 0) {
+            shared_ptr<Operand> des = make_shared<Operand>(REG, lValRegMap.at(machineFunction->params[i]));
+            shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
+            shared_ptr<Operand> offset = make_shared<Operand>(IMM, (i - 4) * 4);
+            shared_ptr<MemoryIns> load_para = make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, NONE, 0, des, stack,
+                                                                     offset);
+            func_epilogue->MachineInstructions.push_back(load_para);
+        } else {
+            machineFunction->var2offset.insert(pair<unsigned int, int>(machineFunction->params[i]->id,
+                                                                 (i - 4) * 4 + machineFunction->stackSize));
+        }
+    }
+    for (int i = 0; i < machineFunction->params.size() && i < 4; ++i) {
+        if (lValRegMap.count(machineFunction->params[i]) == 0) //no reg
+        {
+            shared_ptr<Operand> para_reg = make_shared<Operand>(REG, i);
+            shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
+            shared_ptr<Operand> offset = make_shared<Operand>(IMM, -16 + i * 4);
+            shared_ptr<MemoryIns> storeParam = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, para_reg,
+                                                                      stack, offset);
+            func_epilogue->MachineInstructions.push_back(storeParam);
+            machineFunction->var2offset.insert(pair<unsigned int, int>(machineFunction->params[i]->id,
+                                                                 -16 + i * 4 + machineFunction->stackSize));
         } else {
-            stack_size = make_shared<Operand>(REG, "0");
-            loadImm2Reg(machineFunction->stackSize, stack_size, func_epilogue->MachineInstructions, true);
+            shared_ptr<Operand> para_reg = make_shared<Operand>(REG, i);
+            shared_ptr<Operand> des_reg = make_shared<Operand>(REG, lValRegMap.at(machineFunction->params[i]));
+            shared_ptr<MovIns> mov2Des = make_shared<MovIns>(NON, NONE, 0, des_reg, para_reg);
+            func_epilogue->MachineInstructions.push_back(mov2Des);
         }
-        shared_ptr<BinaryIns> moveStack = make_shared<BinaryIns>(mit::SUB, NON, NONE, 0, stack, stack_size, stack);
-        func_epilogue->MachineInstructions.push_back(moveStack);
-        machineFunction->machineBlocks.push_back(func_epilogue);
+    }
+    ///lr: temp reg, unless the block runs without the frame.
+    tempRegShortage = false;
+    shared_ptr<BasicBlock> frameBlock = func->entryBlock;
+    if (shrinkWrap) {
+        frameBlock = shrinkWrapFrame(func);
+    } else {
+        framelessBlocks.clear();
+    }
+    if (frameBlock == func->entryBlock) {
+        vector<shared_ptr<MachineIns>> res;
+        genFrameSetup(machineFunction, res);
+        func_epilogue->MachineInstructions.insert(func_epilogue->MachineInstructions.end(), res.begin(), res.end());
+    }
+    machineFunction->machineBlocks.push_back(func_epilogue);
+
+    ///for each block in func, mapping it into machineFunc.
+    for (auto &bb:func->blocks) {
+        // if (_debugMachineIr) cout << "block" + to_string(bb->id) + ":" << endl;
+        if (framelessBlocks.count(bb.get()) == 0) {
+            if (regInUse.count(LR) == 0) tempRegPool.insert(LR);
+        } else if (regInUse.count(LR) != 0) {
+            tempRegShortage = true;
+        } else {
+            tempRegPool.erase(LR);
+        }
+        shared_ptr<MachineBB> machineBB = bbToMachineBB(bb, machineFunction, module);
+        if (bb == frameBlock && bb != func->entryBlock) {
+            vector<shared_ptr<MachineIns>> res;
+            genFrameSetup(machineFunction, res);
+            machineBB->MachineInstructions.insert(machineBB->MachineInstructions.begin(), res.begin(), res.end());
+        }
+        machineFunction->machineBlocks.push_back(machineBB);
+    }
+    /// four temp registers were not enough without LR, build it again with the frame in the entry block.
+    if (tempRegShortage && !framelessBlocks.empty()) {
+        return buildMachineFunction(func, prologueId, module, false);
+    }
 
-        ///for each block in func, mapping it into machineFunc.
-        for (auto &bb:func->blocks) {
-            // if (_debugMachineIr) cout << "block" + to_string(bb->id) + ":" << endl;
-            machineFunction->machineBlocks.push_back(bbToMachineBB(bb, machineFunction, module));
+    return machineFunction;
+}
+
+/**
+ * Publish the registers each function may change before the functions are built, so that a call only saves
+ * the registers alive across it and changed by the callee.
+ * A function changes the global registers of its values and everything its callees change.
+ */
+void publishClobberedRegs(shared_ptr<Module> &module) {
+    clobberedRegs.clear();
+    unordered_map<string, unordered_set<string>> callees;
+    for (auto &func : module->functions) {
+        unsigned int regs = 0;
+        for (auto &it : func->variableRegs) regs |= 1u << it.second;
+        for (auto &bb : func->blocks) {
+            for (auto &ins : bb->instructions) {
+                if (ins->type != INVOKE) continue;
+                shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(ins);
+                if (invoke->targetFunction != nullptr) callees[func->name].insert(invoke->targetFunction->name);
+                else regs |= LIBRARY_CLOBBERED_REGS;
+            }
         }
+        clobberedRegs[func->name] = regs;
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &func : module->functions) {
+            unsigned int regs = clobberedRegs.at(func->name);
+            for (auto &callee : callees[func->name]) {
+                regs |= clobberedRegs.count(callee) != 0 ? clobberedRegs.at(callee) : ~0u;
+            }
+            if (regs != clobberedRegs.at(func->name)) {
+                clobberedRegs[func->name] = regs;
+                changed = true;
+            }
+        }
+    }
+}
+
+shared_ptr<MachineModule> buildMachineModule(shared_ptr<Module> &module) {
+    shared_ptr<MachineModule> machineModule = make_shared<MachineModule>(); // NOLINT
+    machineModule->globalConstants = module->globalConstants;
+    machineModule->globalVariables = module->globalVariables;
+
+    for (auto &glob_var:module->globalVariables) internMachineLabel(s_p_c<GlobalValue>(glob_var)->name);
+    for (auto &glob_const:module->globalConstants) internMachineLabel(s_p_c<ConstantValue>(glob_const)->name);
 
-        machineModule->machineFunctions.push_back(machineFunction);
+    // the prologue blocks take value ids in function order, so the labels do not depend on the threads.
+    vector<unsigned int> prologueIds;
+    for (unsigned int i = 0; i < module->functions.size(); ++i) prologueIds.push_back(Value::getValueId());
+    irInsText.clear();
+    for (auto &func : module->functions) {
+        for (auto &bb : func->blocks) {
+            for (auto &ins : bb->instructions) irInsText[ins.get()] = ins->toString();
+        }
     }
+    publishClobberedRegs(module);
+    machineModule->machineFunctions.resize(module->functions.size());
+    parallelFor(module->functions.size(), [&](size_t i) {
+        machineModule->machineFunctions.at(i) = buildMachineFunction(module->functions.at(i), prologueIds.at(i),
+                                                                     module);
+    });
 
     for (auto &machineFunc:machineModule->machineFunctions) {
         for (auto &machineBB:machineFunc->machineBlocks) {
@@ -224,23 +449,14 @@ shared_ptr<MachineModule> buildMachineModule(shared_ptr<Module> &module) {
                 ins_count++;
                 if (ins->type == mit::PSEUDO_LOAD) {
                     shared_ptr<PseudoLoad> ldr = s_p_c<PseudoLoad>(ins);
-                    if (ldr->isGlob) {
-                        ldr->label->value =
-                                ldr->label->value + to_string(const_pool_id) + "_whitee_" + to_string(const_pool_id);
-                    } else {
-                        if (ldr->label->value.at(0) == '_') {
-                            invalid_imm.insert(-stoi(ldr->label->value.substr(1)));
-                        } else {
-                            invalid_imm.insert(stoi(ldr->label->value));
-                        }
-
-                        ldr->label->value = "invalid_imm_" + to_string(const_pool_id) + "_" + ldr->label->value;
-                    }
+                    if (!ldr->isGlob) invalid_imm.insert(ldr->label->value);
+                    ldr->poolId = const_pool_id;
                 }
                 if (ins_count - pre_ins_count >= 800) {
                     vector<shared_ptr<MachineIns>> res;
                     res = genGlobIns(machineModule);
-                    it = machineBB->MachineInstructions.insert(it + 1, res.begin(), res.end()) + res.size();
+                    it = next(it);
+                    machineBB->MachineInstructions.insert(it, res.begin(), res.end());
                     pre_ins_count = ins_count;
                     ins_count += res.size();
                 } else {
@@ -271,11 +487,19 @@ shared_ptr<MachineModule> buildMachineModule(shared_ptr<Module> &module) {
     pre_ins_count = ins_count;
 
     if (_optimizeMachineIr) {
-        delete_imm_jump(machineModule);
-        delete_useless_compute(machineModule);
-        reduce_redundant_move(machineModule);
-        merge_mla_and_mls(machineModule);
-        exchange_branch_ins(machineModule);
+        auto counter = [&]() { return countMachineInstructions(machineModule); };
+        const vector<pair<string, void (*)(shared_ptr<MachineModule> &)>> machinePasses{
+                {"Delete Immediate Jump",       delete_imm_jump},
+                {"Delete Useless Compute",      delete_useless_compute},
+                {"Reduce Redundant Move",       reduce_redundant_move},
+                {"Merge MLA and MLS",           merge_mla_and_mls},
+                {"Exchange Branch Instruction", exchange_branch_ins},
+                {"Instruction Scheduling",      schedule_instructions}
+        };
+        for (auto &pass : machinePasses) {
+            PassRecorder recorder(PASS_RECORD, pass.first, counter);
+            pass.second(machineModule);
+        }
     }
 
     return machineModule;
@@ -285,6 +509,7 @@ shared_ptr<MachineBB>
 bbToMachineBB(shared_ptr<BasicBlock> &bb, shared_ptr<MachineFunc> &machineFunction, shared_ptr<Module> &module) {
     shared_ptr<MachineBB> machineBB = make_shared<MachineBB>(bb->id, machineFunction);
     IRB2MachB.insert(pair<shared_ptr<BasicBlock>, shared_ptr<MachineBB>>(bb, machineBB));
+    bool siblingCalled = false; // the return after a sibling call is done by the callee.
     for (auto &ins : bb->instructions) {
         /*
          * for each ins, we need to mapping it into machineIns.
@@ -292,11 +517,11 @@ bbToMachineBB(shared_ptr<BasicBlock> &bb, shared_ptr<MachineFunc> &machineFuncti
          * we propose it as a local var, we need to record its offset and increase stackSize.
          */
         vector<shared_ptr<MachineIns>> res;
-        string content = ins->toString();
+        string content = irInsText.at(ins.get());
         shared_ptr<Comment> ir = make_shared<Comment>(content);
         switch (ins->type) {
             case RET:
-                res = genRetIns(ins, machineFunction);
+                if (!siblingCalled) res = genRetIns(ins, machineFunction);
                 break;
             case BR:
                 res = genBIns(ins, machineFunction);
@@ -306,7 +531,8 @@ bbToMachineBB(shared_ptr<BasicBlock> &bb, shared_ptr<MachineFunc> &machineFuncti
                 res = genJmpIns(ins);
                 break;
             case INVOKE:
-                res = genInvokeIns2(ins, machineFunction, module);
+                siblingCalled = isSiblingCall(ins);
+                res = genInvokeIns2(ins, machineFunction, module, siblingCalled);
                 break;
             case UNARY:
                 res = genUnaryIns(ins, machineFunction);
@@ -327,6 +553,13 @@ bbToMachineBB(shared_ptr<BasicBlock> &bb, shared_ptr<MachineFunc> &machineFuncti
             case STORE:
                 res = genStoreIns(ins, machineFunction);
                 break;
+            case MEMSET:
+            case MEMCPY:
+                res = genBulkInitIns(ins, machineFunction);
+                break;
+            case VECTOR:
+                res = genVectorIns(ins, machineFunction);
+                break;
             case PHI_MOV:
                 res = genPhiMov(ins, bb, machineFunction);
                 break;
@@ -338,7 +571,7 @@ bbToMachineBB(shared_ptr<BasicBlock> &bb, shared_ptr<MachineFunc> &machineFuncti
         }
         machineBB->MachineInstructions.insert(machineBB->MachineInstructions.end(), ir);
         machineBB->MachineInstructions.insert(machineBB->MachineInstructions.end(), res.begin(), res.end());
-        if (tempRegPool.size() + rValRegMap.size() != _TMP_REG_CNT) {
+        if (tempRegPool.size() + rValRegMap.size() + framelessBlocks.count(bb.get()) != _TMP_REG_CNT) {
             cerr << "machine_ir_build: temp reg error!" << endl;
         }
     }
@@ -346,9 +579,9 @@ bbToMachineBB(shared_ptr<BasicBlock> &bb, shared_ptr<MachineFunc> &machineFuncti
     return machineBB;
 }
 
-string allocTempRegister() {
+int allocTempRegister() {
     if (!tempRegPool.empty()) {
-        string reg = *tempRegPool.begin();
+        int reg = *tempRegPool.begin();
         tempRegPool.erase(reg);
         if (regInUse.count(reg) != 0) {
             cerr << "Alloc a register in use." << endl;
@@ -356,22 +589,20 @@ string allocTempRegister() {
         regInUse.insert(reg);
         return reg;
     } else {
-        cerr << "Temp registers are not enough." << endl;
-        return "error";
+        tempRegShortage = true;
+        if (framelessBlocks.empty()) cerr << "Temp registers are not enough." << endl;
+        return -1;
     }
 }
 
-void releaseTempRegister(const string &reg) {
-    set<string> copy = tempRegPool;
-    while (!copy.empty()) {
-        if (*copy.begin() == reg) {
-            cerr << "Try to release a register in pool." << endl;
-            return;
-        }
-        copy.erase(copy.begin());
+void releaseTempRegister(int reg) {
+    if (reg < 0) return; // the temp registers ran out.
+    if (tempRegPool.count(reg) != 0) {
+        cerr << "Try to release a register in pool." << endl;
+        return;
     }
     if (regInUse.count(reg) == 0) {
-        cerr << "Register " + reg + " is not in the use list but trying to release it." << endl;
+        cerr << "Register " << reg << " is not in the use list but trying to release it." << endl;
     }
     regInUse.erase(reg);
     tempRegPool.insert(reg);
@@ -380,34 +611,30 @@ void releaseTempRegister(const string &reg) {
 void loadImm2Reg(int num, shared_ptr<Operand> des, vector<shared_ptr<MachineIns>> &res, bool mov) {
     shared_ptr<Operand> imm;
     if (judgeImmValid(num, mov)) { //can move to reg
-        imm = make_shared<Operand>(IMM, to_string(num));
+        imm = make_shared<Operand>(IMM, num);
         shared_ptr<MovIns> mov2Reg = make_shared<MovIns>(NON, NONE, 0, des, imm);
         res.push_back(mov2Reg);
     } else { //load to reg
         if (_optimizeMachineIr) {
             unsigned short low16 = (unsigned int) num & 0x0000FFFFU;
             unsigned short high16 = ((unsigned int) num & 0xFFFF0000U) >> 16U;
-            shared_ptr<Operand> low = make_shared<Operand>(IMM, to_string(low16));
-            shared_ptr<Operand> high = make_shared<Operand>(IMM, to_string(high16));
+            shared_ptr<Operand> low = make_shared<Operand>(IMM, low16);
+            shared_ptr<Operand> high = make_shared<Operand>(IMM, high16);
             shared_ptr<MovIns> movw = make_shared<MovIns>(mit::MOVW, NON, NONE, 0, des, low);
             shared_ptr<MovIns> movt = make_shared<MovIns>(mit::MOVT, NON, NONE, 0, des, high);
             res.push_back(movw);
             if (high16 != 0) res.push_back(movt);
         } else {
-            if (num < 0) {
-                imm = make_shared<Operand>(LABEL, "_" + to_string(abs(num)));
-            } else {
-                imm = make_shared<Operand>(LABEL, to_string(num));
-            }
+            imm = make_shared<Operand>(LABEL, num);
             shared_ptr<PseudoLoad> load2Reg = make_shared<PseudoLoad>(NON, NONE, 0, imm, des, false);
             res.push_back(load2Reg);
         }
     }
 }
 
-void loadOffset(int offset, shared_ptr<Operand> &off, string reg, vector<shared_ptr<MachineIns>> &res) {
+void loadOffset(int offset, shared_ptr<Operand> &off, int reg, vector<shared_ptr<MachineIns>> &res) {
     if (offset < 4096 && offset > -4096) {
-        off = make_shared<Operand>(IMM, to_string(offset));
+        off = make_shared<Operand>(IMM, offset);
         return;
     }
     off = make_shared<Operand>(REG, reg);
@@ -417,23 +644,23 @@ void loadOffset(int offset, shared_ptr<Operand> &off, string reg, vector<shared_
 void loadGlobVar2Reg(shared_ptr<GlobalValue> &glob, shared_ptr<Operand> &des, vector<shared_ptr<MachineIns>> &res) {
     shared_ptr<Operand> op;
     if (glob->variableType == POINTER) {
-        op = make_shared<Operand>(GLOB_POINTER, glob->name);
+        op = make_shared<Operand>(GLOB_POINTER, internMachineLabel(glob->name));
     } else {
-        op = make_shared<Operand>(GLOB_INT, glob->name);
+        op = make_shared<Operand>(GLOB_INT, internMachineLabel(glob->name));
     }
     shared_ptr<PseudoLoad> loadAddr = make_shared<PseudoLoad>(NON, NONE, 0, op, des, true);
     res.push_back(loadAddr);
 }
 
 void loadConst2Reg(shared_ptr<ConstantValue> &cons, shared_ptr<Operand> &des, vector<shared_ptr<MachineIns>> &res) {
-    shared_ptr<Operand> op = make_shared<Operand>(GLOB_POINTER, cons->name);
+    shared_ptr<Operand> op = make_shared<Operand>(GLOB_POINTER, internMachineLabel(cons->name));
     shared_ptr<PseudoLoad> loadAddr = make_shared<PseudoLoad>(NON, NONE, 0, op, des, true);
     res.push_back(loadAddr);
 }
 
 void loadMemory2Reg(shared_ptr<Value> &var, shared_ptr<Operand> &des, shared_ptr<Operand> &offset,
                     vector<shared_ptr<MachineIns>> &res) {
-    shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
+    shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
     if (var->valueType == INSTRUCTION && s_p_c<Instruction>(var)->type == ALLOC) {
         shared_ptr<BinaryIns> addrToReg = make_shared<BinaryIns>(mit::ADD, NON, NONE, 0, stack, offset, des);
         res.push_back(addrToReg);
@@ -444,7 +671,7 @@ void loadMemory2Reg(shared_ptr<Value> &var, shared_ptr<Operand> &des, shared_ptr
 }
 
 void loadVal2Reg(shared_ptr<Value> &val, shared_ptr<Operand> &des, shared_ptr<MachineFunc> &machineFunc,
-                 vector<shared_ptr<MachineIns>> &res, bool mov, int compensate, string reg) {
+                 vector<shared_ptr<MachineIns>> &res, bool mov, int compensate, int reg) {
     if (val->valueType == NUMBER) {
         int imm = s_p_c<NumberValue>(val)->number;
         loadImm2Reg(imm, des, res, mov);
@@ -456,9 +683,9 @@ void loadVal2Reg(shared_ptr<Value> &val, shared_ptr<Operand> &des, shared_ptr<Ma
         loadConst2Reg(const_var, des, res);
     } else { //VIRTUAL
         shared_ptr<Operand> off;
-        if (machineFunc->var2offset.count(to_string(val->id)) == 0) {
+        if (machineFunc->var2offset.count(val->id) == 0) {
             if (rValRegMap.count(val) != 0 || lValRegMap.count(val) != 0) {
-                string exist_reg;
+                int exist_reg;
                 if (rValRegMap.count(val) != 0) exist_reg = rValRegMap.at(val);
                 else exist_reg = lValRegMap.at(val);
                 if (exist_reg == des->value) { //same reg
@@ -474,10 +701,10 @@ void loadVal2Reg(shared_ptr<Value> &val, shared_ptr<Operand> &des, shared_ptr<Ma
             cerr << "machine_ir_build: unalloc memory" << endl;
             return;
         }
-        int offset = machineFunc->var2offset.at(to_string(val->id)) + compensate;
+        int offset = machineFunc->var2offset.at(val->id) + compensate;
         if (val->valueType == INSTRUCTION && s_p_c<Instruction>(val)->type == ALLOC) { //use ADD instead of LDR+OFFSET
             if (judgeImmValid(offset, false)) {
-                off = make_shared<Operand>(IMM, to_string(offset));
+                off = make_shared<Operand>(IMM, offset);
             } else {
                 off = make_shared<Operand>(REG, reg);
                 loadImm2Reg(offset, off, res, true);
@@ -490,29 +717,29 @@ void loadVal2Reg(shared_ptr<Value> &val, shared_ptr<Operand> &des, shared_ptr<Ma
 }
 
 void storeNewValue(shared_ptr<Operand> &des, int val_id, shared_ptr<MachineFunc> &machineFunc,
-                   vector<shared_ptr<MachineIns>> &res, string reg = "3") {
-    shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
+                   vector<shared_ptr<MachineIns>> &res, int reg = R3) {
+    shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
     shared_ptr<Operand> offset;
     loadOffset(machineFunc->stackPointer, offset, reg, res);
     shared_ptr<MemoryIns> strValue = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, des, stack, offset);
     res.push_back(strValue);
     machineFunc->var2offset.insert(
-            pair<string, int>(to_string(val_id), machineFunc->stackPointer));
+            pair<unsigned int, int>(val_id, machineFunc->stackPointer));
     machineFunc->stackPointer += 4;
 }
 
 void store2Memory(shared_ptr<Operand> &des, int val_id, shared_ptr<MachineFunc> &machineFunc,
                   vector<shared_ptr<MachineIns>> &res) {
-    if (machineFunc->var2offset.count(to_string(val_id)) == 0) { // new value
-        string reg = allocTempRegister();
+    if (machineFunc->var2offset.count(val_id) == 0) { // new value
+        int reg = allocTempRegister();
         storeNewValue(des, val_id, machineFunc, res, reg);
         releaseTempRegister(reg);
         releaseTempRegister(des->value);
     } else { // existing value
-        shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
+        shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
         shared_ptr<Operand> offset;
-        string reg = allocTempRegister();
-        loadOffset(machineFunc->var2offset.at(to_string(val_id)), offset, reg, res);
+        int reg = allocTempRegister();
+        loadOffset(machineFunc->var2offset.at(val_id), offset, reg, res);
         shared_ptr<MemoryIns> storeExistVal = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, des, stack,
                                                                      offset);
         res.push_back(storeExistVal);
@@ -522,7 +749,7 @@ void store2Memory(shared_ptr<Operand> &des, int val_id, shared_ptr<MachineFunc>
 }
 
 void loadOperand(shared_ptr<Value> &val, shared_ptr<Operand> &des, shared_ptr<MachineFunc> &machineFunc,
-                 vector<shared_ptr<MachineIns>> &res, bool mov, string reg = "3", bool regRequired = true) {
+                 vector<shared_ptr<MachineIns>> &res, bool mov, int reg = R3, bool regRequired = true) {
     if (regRequired) {
         loadVal2Reg(val, des, machineFunc, res, true, 0, reg);
     } else {
@@ -530,7 +757,7 @@ void loadOperand(shared_ptr<Value> &val, shared_ptr<Operand> &des, shared_ptr<Ma
             int imm = s_p_c<NumberValue>(val)->number;
             if (judgeImmValid(imm, mov)) {
                 des->state = IMM;
-                des->value = to_string(imm);
+                des->value = imm;
             } else {
                 loadVal2Reg(val, des, machineFunc, res, true, 0, reg);
             }
@@ -575,7 +802,7 @@ bool readRegister(shared_ptr<Value> &val, shared_ptr<Operand> &op, shared_ptr<Ma
                 return true;
             } else {
                 if (judgeImmValid(num, mov)) {
-                    op->value = to_string(num);
+                    op->value = num;
                     op->state = IMM;
                     return false;
                 } else {
@@ -587,7 +814,7 @@ bool readRegister(shared_ptr<Value> &val, shared_ptr<Operand> &op, shared_ptr<Ma
             }
         }
         if (val->valueType == GLOBAL) {
-            string reg = allocTempRegister();
+            int reg = allocTempRegister();
             op->value = reg;
             op->state = REG;
             shared_ptr<GlobalValue> glob_val = static_pointer_cast<GlobalValue>(val);
@@ -595,7 +822,7 @@ bool readRegister(shared_ptr<Value> &val, shared_ptr<Operand> &op, shared_ptr<Ma
             return true;
         }
         if (val->valueType == CONSTANT) {
-            string reg = allocTempRegister();
+            int reg = allocTempRegister();
             op->value = reg;
             op->state = REG;
             shared_ptr<ConstantValue> const_val = static_pointer_cast<ConstantValue>(val);
@@ -603,14 +830,14 @@ bool readRegister(shared_ptr<Value> &val, shared_ptr<Operand> &op, shared_ptr<Ma
             return true;
         }
         if (val->valueType == PARAMETER) {
-            string reg = allocTempRegister();
+            int reg = allocTempRegister();
             op->value = reg;
             op->state = REG;
             loadOperand(val, op, machineFunc, res, mov, reg, regRequired);
             return true;
         }
         if (val->valueType == INSTRUCTION && static_pointer_cast<Instruction>(val)->type == ALLOC) {
-            string reg = allocTempRegister();
+            int reg = allocTempRegister();
             op->value = reg;
             op->state = REG;
             loadOperand(val, op, machineFunc, res, mov, reg, regRequired);
@@ -655,10 +882,10 @@ vector<shared_ptr<MachineIns>> genRetIns(shared_ptr<Instruction> &ins, shared_pt
     shared_ptr<BXIns> bx = make_shared<BXIns>(NON, NONE, 0);   // bx lr
 
     if (s_p_c<ReturnInstruction>(ins)->funcType == FUNC_INT) {
-        shared_ptr<Operand> op1 = make_shared<Operand>(REG, "0");
+        shared_ptr<Operand> op1 = make_shared<Operand>(REG, R0);
         shared_ptr<Value> ret_val = s_p_c<ReturnInstruction>(ins)->value;
         if (rValRegMap.count(ret_val) != 0 || lValRegMap.count(ret_val) != 0) {
-            string ret_reg;
+            int ret_reg;
             if (rValRegMap.count(ret_val) != 0) {
                 ret_reg = rValRegMap.at(ret_val);
                 releaseTempRegister(ret_reg);
@@ -666,7 +893,7 @@ vector<shared_ptr<MachineIns>> genRetIns(shared_ptr<Instruction> &ins, shared_pt
             } else {
                 ret_reg = lValRegMap.at(ret_val);
             }
-            if (ret_reg != "0") {
+            if (ret_reg != R0) {
                 shared_ptr<Operand> ori_reg = make_shared<Operand>(REG, ret_reg);
                 shared_ptr<MovIns> move2R0 = make_shared<MovIns>(NON, NONE, 0, op1, ori_reg);
                 res.push_back(move2R0);
@@ -676,7 +903,7 @@ vector<shared_ptr<MachineIns>> genRetIns(shared_ptr<Instruction> &ins, shared_pt
         }
     }
     //end of function
-    shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
+    shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
     int para_size;
     int para_num = machineFunc->params.size();
     if ((para_num - 4) < 0) {
@@ -684,23 +911,41 @@ vector<shared_ptr<MachineIns>> genRetIns(shared_ptr<Instruction> &ins, shared_pt
     } else {
         para_size = para_num - 4;
     }
+    if (framelessBlocks.count(ins->block.get()) != 0) {
+        if (para_size > 0) {
+            shared_ptr<Operand> para_stack = make_shared<Operand>(IMM, para_size * 4);
+            res.push_back(make_shared<BinaryIns>(mit::ADD, NON, NONE, 0, stack, para_stack, stack));
+        }
+        res.push_back(bx);
+        return res;
+    }
+    ///restore lr to pc
+    genFrameRelease(machineFunc, PC, R1, res);
+
+    return res;
+}
+
+/**
+ * Release the frame with the stack arguments of the function, and load the saved LR into reg.
+ * tempReg holds the size to release if it is not a valid immediate.
+ */
+void genFrameRelease(shared_ptr<MachineFunc> &machineFunc, int reg, int tempReg, vector<shared_ptr<MachineIns>> &res) {
+    shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
+    int para_size = max((int) machineFunc->params.size() - 4, 0);
     int restore_size = machineFunc->stackSize + para_size * 4;
     shared_ptr<Operand> restore_stack;
     if (judgeImmValid(restore_size, false)) {
-        restore_stack = make_shared<Operand>(IMM, to_string(restore_size));
+        restore_stack = make_shared<Operand>(IMM, restore_size);
     } else {
-        restore_stack = make_shared<Operand>(REG, "1");
+        restore_stack = make_shared<Operand>(REG, tempReg);
         loadImm2Reg(restore_size, restore_stack, res, true);
     }
     shared_ptr<BinaryIns> restore_func = make_shared<BinaryIns>(mit::ADD, NON, NONE, 0, stack, restore_stack, stack);
     res.push_back(restore_func);
-    ///restore lr to pc
-    shared_ptr<Operand> pc = make_shared<Operand>(REG, "15");
-    shared_ptr<Operand> lrOff = make_shared<Operand>(IMM, to_string(-20 - para_size * 4));
-    shared_ptr<MemoryIns> restoreLR = make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, NONE, 0, pc, stack, lrOff);
+    shared_ptr<Operand> des = make_shared<Operand>(REG, reg);
+    shared_ptr<Operand> lrOff = make_shared<Operand>(IMM, -20 - para_size * 4);
+    shared_ptr<MemoryIns> restoreLR = make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, NONE, 0, des, stack, lrOff);
     res.push_back(restoreLR);
-
-    return res;
 }
 
 vector<shared_ptr<MachineIns>> genJmpIns(shared_ptr<Instruction> &ins) {
@@ -713,18 +958,43 @@ vector<shared_ptr<MachineIns>> genJmpIns(shared_ptr<Instruction> &ins) {
     return res;
 }
 
+/**
+ * A call is a sibling call if it takes its arguments in registers and its result is returned right after it.
+ * The frame is released before the call, so the callee returns to the caller of this function.
+ * A function with local arrays is never a sibling caller, since the callee may get their addresses.
+ */
+bool isSiblingCall(shared_ptr<Instruction> &ins) {
+    shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(ins);
+    list<shared_ptr<Instruction>> &instructions = ins->block->instructions;
+    if (invoke->targetFunction == nullptr || invoke->params.size() > 4) return false;
+    if (instructions.size() < 2 || instructions.back()->type != RET || *prev(instructions.end(), 2) != ins) {
+        return false;
+    }
+    for (auto &bb : ins->block->function->blocks) {
+        for (auto &other : bb->instructions) {
+            if (other->type == ALLOC) return false;
+        }
+    }
+    shared_ptr<ReturnInstruction> ret = s_p_c<ReturnInstruction>(instructions.back());
+    return ret->funcType == FUNC_VOID || ret->value == ins;
+}
+
 vector<shared_ptr<MachineIns>>
-genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc, shared_ptr<Module> &module) {
+genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc, shared_ptr<Module> &module,
+              bool sibling) {
     vector<shared_ptr<MachineIns>> res;
     shared_ptr<InvokeInstruction> invoke = static_pointer_cast<InvokeInstruction>(ins);
-    //save context
+    //save context, nothing is alive after a sibling call.
     bool useR0 = false;
     shared_ptr<StackIns> push = make_shared<StackIns>(NON, NONE, 0, true);
     set<int> reg_index;
     int context_size = 0;
     for (auto &r_val:rValRegMap) {
-        if (r_val.second == "0") useR0 = true;
-        reg_index.insert(stoi(r_val.second));
+        if (sibling) break;
+        // an r-value is used once, so the one passed to this call is not alive after it.
+        if (find(invoke->params.begin(), invoke->params.end(), r_val.first) != invoke->params.end()) continue;
+        if (r_val.second == R0) useR0 = true;
+        reg_index.insert(r_val.second);
     }
     shared_ptr<Function> current_func;
     for (const auto &func:module->functions) {
@@ -733,18 +1003,25 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
             break;
         }
     }
+    // only the registers alive across the call and changed by the callee are saved.
+    unsigned int clobbered = LIBRARY_CLOBBERED_REGS;
+    if (invoke->targetFunction != nullptr) {
+        auto callee = clobberedRegs.find(invoke->targetFunction->name);
+        clobbered = callee != clobberedRegs.end() ? callee->second : ~0u;
+    }
     set<int> current_reg_index;
-    if (current_func != nullptr) {
+    if (current_func != nullptr && !sibling) {
         for (auto &alive_val:ins->aliveValues) {
-            if (current_func->variableRegs.count(alive_val) != 0) {
-                current_reg_index.insert(stoi(current_func->variableRegs.at(alive_val)));
+            if (current_func->variableRegs.count(alive_val) != 0
+                && (clobbered >> current_func->variableRegs.at(alive_val) & 1u) != 0) {
+                current_reg_index.insert(current_func->variableRegs.at(alive_val));
             }
         }
     }
     reg_index.insert(current_reg_index.begin(), current_reg_index.end());
     for (auto index:reg_index) {
         context_size += 4;
-        shared_ptr<Operand> reg = make_shared<Operand>(REG, to_string(index));
+        shared_ptr<Operand> reg = make_shared<Operand>(REG, index);
         push->regs.push_back(reg);
     }
 
@@ -762,14 +1039,14 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
         shared_ptr<StackIns> push_param = make_shared<StackIns>(NON, NONE, 0, true);
         set<int> regs;
         while (i >= 4 && j < 4) {
-            shared_ptr<Operand> tmp_param = make_shared<Operand>(REG, to_string(3 - j));
+            shared_ptr<Operand> tmp_param = make_shared<Operand>(REG, 3 - j);
             loadVal2Reg(invoke->params[i], tmp_param, machineFunc, res, true, compensate, tmp_param->value);
             regs.insert(3 - j);
             j++;
             i--;
         }
         for (auto reg:regs) {
-            shared_ptr<Operand> param = make_shared<Operand>(REG, to_string(reg));
+            shared_ptr<Operand> param = make_shared<Operand>(REG, reg);
             push_param->regs.push_back(param);
         }
         res.push_back(push_param);
@@ -777,11 +1054,11 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
     }
     //save first 4 params
     while (i >= 0) {
-        shared_ptr<Operand> init_param = make_shared<Operand>(REG, to_string(i));
+        shared_ptr<Operand> init_param = make_shared<Operand>(REG, i);
         if (lValRegMap.count(invoke->params[i]) == 0 && rValRegMap.count(invoke->params[i]) == 0) {
-            loadVal2Reg(invoke->params[i], init_param, machineFunc, res, true, compensate, to_string(i));
+            loadVal2Reg(invoke->params[i], init_param, machineFunc, res, true, compensate, i);
         } else {
-            string init_reg;
+            int init_reg;
             if (lValRegMap.count(invoke->params[i]) != 0) {
                 init_reg = lValRegMap.at(invoke->params[i]);
             } else {
@@ -791,8 +1068,8 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
             }
             init_param->value = init_reg;
         }
-        if (init_param->value != to_string(i)) {
-            shared_ptr<Operand> des = make_shared<Operand>(REG, to_string(i));
+        if (init_param->value != i) {
+            shared_ptr<Operand> des = make_shared<Operand>(REG, i);
             shared_ptr<MovIns> mov2R = make_shared<MovIns>(NON, NONE, 0, des, init_param);
             res.push_back(mov2R);
         }
@@ -800,9 +1077,9 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
     }
     if (invoke->targetFunction == nullptr &&
         (invoke->targetName == "_sysy_starttime" || invoke->targetName == "_sysy_stoptime")) {
-        shared_ptr<Operand> R0 = make_shared<Operand>(REG, "0");
-        shared_ptr<Operand> one = make_shared<Operand>(IMM, "1");
-        shared_ptr<MovIns> mov1 = make_shared<MovIns>(NON, NONE, 0, R0, one);
+        shared_ptr<Operand> r0 = make_shared<Operand>(REG, R0);
+        shared_ptr<Operand> one = make_shared<Operand>(IMM, 1);
+        shared_ptr<MovIns> mov1 = make_shared<MovIns>(NON, NONE, 0, r0, one);
         res.push_back(mov1);
     }
     //bl
@@ -815,6 +1092,11 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
             targetName = "_sysy_" + targetName;
         }
     }
+    if (sibling) {
+        genFrameRelease(machineFunc, LR, LR, res);
+        res.push_back(make_shared<BIns>(NON, NONE, 0, targetName));
+        return res;
+    }
     shared_ptr<BLIns> blink = make_shared<BLIns>(NON, NONE, 0, targetName);
     res.push_back(blink);
     //save return value in R0
@@ -827,9 +1109,9 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
           s_p_c<InvokeInstruction>(ins)->targetFunction->funcType == FUNC_INT))) {
         if (useR0) {
             needFetch = true;
-            shared_ptr<Operand> ret = make_shared<Operand>(REG, "0");
-            shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
-            shared_ptr<Operand> offset = make_shared<Operand>(IMM, "-4");
+            shared_ptr<Operand> ret = make_shared<Operand>(REG, R0);
+            shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
+            shared_ptr<Operand> offset = make_shared<Operand>(IMM, -4);
             shared_ptr<MemoryIns> storeR0 = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, ret, stack,
                                                                    offset);
             res.push_back(storeR0);
@@ -847,8 +1129,8 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
     }
     //fetch return value R0
     if (needMove) {
-        shared_ptr<Operand> ret = make_shared<Operand>(REG, "0");
-        shared_ptr<Operand> final_des = make_shared<Operand>(REG, "1");
+        shared_ptr<Operand> ret = make_shared<Operand>(REG, R0);
+        shared_ptr<Operand> final_des = make_shared<Operand>(REG, R1);
         shared_ptr<Value> i_ins = ins;
         bool release_des = writeRegister(i_ins, final_des, machineFunc, res);
         shared_ptr<MovIns> move2Des = make_shared<MovIns>(NON, NONE, 0, final_des, ret);
@@ -858,11 +1140,11 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
         }
     }
     if (needFetch) {
-        shared_ptr<Operand> final_des = make_shared<Operand>(REG, "1");
-        shared_ptr<Operand> stack = make_shared<Operand>(REG, "13");
+        shared_ptr<Operand> final_des = make_shared<Operand>(REG, R1);
+        shared_ptr<Operand> stack = make_shared<Operand>(REG, SP);
         shared_ptr<Value> i_ins = ins;
         bool release_des = writeRegister(i_ins, final_des, machineFunc, res);
-        shared_ptr<Operand> offset = make_shared<Operand>(IMM, to_string(-context_size - 4));
+        shared_ptr<Operand> offset = make_shared<Operand>(IMM, -context_size - 4);
         shared_ptr<MemoryIns> fetchR0 = make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, NONE, 0, final_des, stack,
                                                                offset);
         res.push_back(fetchR0);
@@ -876,14 +1158,14 @@ genInvokeIns2(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc
 vector<shared_ptr<MachineIns>> genUnaryIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc) {
     shared_ptr<UnaryInstruction> ui = s_p_c<UnaryInstruction>(ins);
     vector<shared_ptr<MachineIns>> res;
-    if (ui->op == "-") {
-        shared_ptr<Operand> op1 = make_shared<Operand>(IMM, "0");
-        shared_ptr<Operand> op2 = make_shared<Operand>(REG, "3");
+    if (ui->op == OP_SUB) {
+        shared_ptr<Operand> op1 = make_shared<Operand>(IMM, 0);
+        shared_ptr<Operand> op2 = make_shared<Operand>(REG, R3);
         bool release2 = readRegister(ui->value, op2, machineFunc, res, true, true);
         if (release2) {
             releaseTempRegister(op2->value);
         }
-        shared_ptr<Operand> rd = make_shared<Operand>(REG, "1");
+        shared_ptr<Operand> rd = make_shared<Operand>(REG, R1);
         shared_ptr<Value> u_ins = ins;
         bool release_rd = writeRegister(u_ins, rd, machineFunc, res);
 
@@ -892,20 +1174,33 @@ vector<shared_ptr<MachineIns>> genUnaryIns(shared_ptr<Instruction> &ins, shared_
         if (release_rd) {
             store2Memory(rd, ui->id, machineFunc, res);
         }
+    } else if (ui->op == OP_ADD) { // the copy of a split live range.
+        shared_ptr<Operand> op = make_shared<Operand>(REG, R3);
+        bool release = readRegister(ui->value, op, machineFunc, res, true, true);
+        if (release) {
+            releaseTempRegister(op->value);
+        }
+        shared_ptr<Operand> rd = make_shared<Operand>(REG, R1);
+        shared_ptr<Value> u_ins = ins;
+        bool release_rd = writeRegister(u_ins, rd, machineFunc, res);
+        res.push_back(make_shared<MovIns>(NON, NONE, 0, rd, op));
+        if (release_rd) {
+            store2Memory(rd, ui->id, machineFunc, res);
+        }
     } else {
-        shared_ptr<Operand> op2 = make_shared<Operand>(IMM, "0");
-        shared_ptr<Operand> op1 = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> op2 = make_shared<Operand>(IMM, 0);
+        shared_ptr<Operand> op1 = make_shared<Operand>(REG, R2);
         bool release1 = readRegister(ui->value, op1, machineFunc, res, true, true);
         if (release1) {
             releaseTempRegister(op1->value);
         }
         shared_ptr<CmpIns> cmp = make_shared<CmpIns>(NON, NONE, 0, op1, op2);
         res.push_back(cmp);
-        shared_ptr<Operand> rd = make_shared<Operand>(REG, "1");
+        shared_ptr<Operand> rd = make_shared<Operand>(REG, R1);
         shared_ptr<Value> u_ins = ins;
         bool release_rd = writeRegister(u_ins, rd, machineFunc, res);
-        shared_ptr<Operand> ans0 = make_shared<Operand>(IMM, "0");
-        shared_ptr<Operand> ans1 = make_shared<Operand>(IMM, "1");
+        shared_ptr<Operand> ans0 = make_shared<Operand>(IMM, 0);
+        shared_ptr<Operand> ans1 = make_shared<Operand>(IMM, 1);
         shared_ptr<MovIns> mv1 = make_shared<MovIns>(EQ, NONE, 0, rd, ans1);
         shared_ptr<MovIns> mv2 = make_shared<MovIns>(NE, NONE, 0, rd, ans0);
         res.push_back(mv1);
@@ -920,15 +1215,16 @@ vector<shared_ptr<MachineIns>> genUnaryIns(shared_ptr<Instruction> &ins, shared_
 vector<shared_ptr<MachineIns>> genBinaryIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc) {
     vector<shared_ptr<MachineIns>> res;
     shared_ptr<Operand> rd;
-    if (s_p_c<BinaryInstruction>(ins)->op == "%") {
-        shared_ptr<Operand> d_op1 = make_shared<Operand>(REG, "2");
+    IrOp irOp = s_p_c<BinaryInstruction>(ins)->op;
+    if (irOp == OP_MOD) {
+        shared_ptr<Operand> d_op1 = make_shared<Operand>(REG, R2);
         shared_ptr<Value> lhs = s_p_c<BinaryInstruction>(ins)->lhs;
         bool release1 = readRegister(lhs, d_op1, machineFunc, res, true, true);
-        shared_ptr<Operand> d_op2 = make_shared<Operand>(REG, "3");
+        shared_ptr<Operand> d_op2 = make_shared<Operand>(REG, R3);
         shared_ptr<Value> rhs = s_p_c<BinaryInstruction>(ins)->rhs;
         bool release2 = readRegister(rhs, d_op2, machineFunc, res, true, true);
 
-        shared_ptr<Operand> d_rd = make_shared<Operand>(REG, "1");
+        shared_ptr<Operand> d_rd = make_shared<Operand>(REG, R1);
 
         d_rd->value = allocTempRegister();
         shared_ptr<BinaryIns> sdiv = make_shared<BinaryIns>(mit::DIV, NON, NONE, 0, d_op1, d_op2, d_rd);
@@ -936,7 +1232,7 @@ vector<shared_ptr<MachineIns>> genBinaryIns(shared_ptr<Instruction> &ins, shared
         releaseTempRegister(d_rd->value);
         if (release2) releaseTempRegister(d_op2->value);
         if (release1) releaseTempRegister(d_op1->value);
-        rd = make_shared<Operand>(REG, "0");
+        rd = make_shared<Operand>(REG, R0);
         shared_ptr<Value> ans = ins;
         bool release_ans = writeRegister(ans, rd, machineFunc, res);
         shared_ptr<TriIns> mls = make_shared<TriIns>(mit::MLS, NON, NONE, 0, d_rd, d_op2, d_op1, rd);
@@ -945,41 +1241,38 @@ vector<shared_ptr<MachineIns>> genBinaryIns(shared_ptr<Instruction> &ins, shared
             store2Memory(rd, ins->id, machineFunc, res);
         }
     } else { //+ - * / && ||
-        if (s_p_c<BinaryInstruction>(ins)->op == ">" || s_p_c<BinaryInstruction>(ins)->op == "<" ||
-            s_p_c<BinaryInstruction>(ins)->op == "<=" || s_p_c<BinaryInstruction>(ins)->op == ">=" ||
-            s_p_c<BinaryInstruction>(ins)->op == "==" || s_p_c<BinaryInstruction>(ins)->op == "!=") {
+        if (isComparisonOp(irOp)) {
             return genCmpIns(ins, machineFunc);
         }
         if (_optimizeDivAndMul && s_p_c<BinaryInstruction>(ins)->rhs->valueType == NUMBER) {
             shared_ptr<BinaryInstruction> binaryIns = s_p_c<BinaryInstruction>(ins);
-            if (s_p_c<BinaryInstruction>(ins)->op == "*") {
+            if (irOp == OP_MUL) {
                 return mulOptimization(binaryIns, machineFunc);
-            } else if (s_p_c<BinaryInstruction>(ins)->op == "/") {
+            } else if (irOp == OP_DIV) {
                 return divOptimization(binaryIns, machineFunc);
             }
         }
-        shared_ptr<Operand> op1 = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> op1 = make_shared<Operand>(REG, R2);
         shared_ptr<Value> lhs = s_p_c<BinaryInstruction>(ins)->lhs;
         bool release1 = readRegister(lhs, op1, machineFunc, res, true, true);
-        shared_ptr<Operand> op2 = make_shared<Operand>(REG, "3");
+        shared_ptr<Operand> op2 = make_shared<Operand>(REG, R3);
         shared_ptr<Value> rhs = s_p_c<BinaryInstruction>(ins)->rhs;
         bool release2;
-        if (s_p_c<BinaryInstruction>(ins)->op == "*" ||
-            s_p_c<BinaryInstruction>(ins)->op == "/") {
+        if (irOp == OP_MUL || irOp == OP_DIV) {
             release2 = readRegister(rhs, op2, machineFunc, res, true, true);
         } else {
             release2 = readRegister(rhs, op2, machineFunc, res, false, false);
         }
         if (release2) releaseTempRegister(op2->value);
         if (release1) releaseTempRegister(op1->value);
-        rd = make_shared<Operand>(REG, "1");
+        rd = make_shared<Operand>(REG, R1);
         shared_ptr<Value> b_ins = ins;
         bool release_rd = writeRegister(b_ins, rd, machineFunc, res);
-        mit::InsType type = s_p_c<BinaryInstruction>(ins)->op == "+" ? mit::ADD :
-                            s_p_c<BinaryInstruction>(ins)->op == "-" ? mit::SUB :
-                            s_p_c<BinaryInstruction>(ins)->op == "*" ? mit::MUL :
-                            s_p_c<BinaryInstruction>(ins)->op == "/" ? mit::DIV :
-                            s_p_c<BinaryInstruction>(ins)->op == "&&" ? mit::AND : mit::ORR;
+        mit::InsType type = irOp == OP_ADD ? mit::ADD :
+                            irOp == OP_SUB ? mit::SUB :
+                            irOp == OP_MUL ? mit::MUL :
+                            irOp == OP_DIV ? mit::DIV :
+                            irOp == OP_AND ? mit::AND : mit::ORR;
         shared_ptr<BinaryIns> binary = make_shared<BinaryIns>(type, NON, NONE, 0, op1, op2, rd);
         res.push_back(binary);
         if (release_rd) {
@@ -993,48 +1286,26 @@ vector<shared_ptr<MachineIns>> genBinaryIns(shared_ptr<Instruction> &ins, shared
 vector<shared_ptr<MachineIns>> genCmpIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc) {
     vector<shared_ptr<MachineIns>> res;
     shared_ptr<BinaryInstruction> bi = s_p_c<BinaryInstruction>(ins);
-    shared_ptr<Operand> op1 = make_shared<Operand>(REG, "2");
+    shared_ptr<Operand> op1 = make_shared<Operand>(REG, R2);
     shared_ptr<Value> lhs = bi->lhs;
     bool release1 = readRegister(lhs, op1, machineFunc, res, true, true);
-    shared_ptr<Operand> op2 = make_shared<Operand>(REG, "3");
+    shared_ptr<Operand> op2 = make_shared<Operand>(REG, R3);
     shared_ptr<Value> rhs = bi->rhs;
     bool release2 = readRegister(rhs, op2, machineFunc, res, false, false);
     shared_ptr<CmpIns> cmp = make_shared<CmpIns>(NON, NONE, 0, op1, op2);
     res.push_back(cmp);
     if (release2) releaseTempRegister(op2->value);
     if (release1) releaseTempRegister(op1->value);
-    shared_ptr<Operand> ans = make_shared<Operand>(REG, "1");
+    shared_ptr<Operand> ans = make_shared<Operand>(REG, R1);
     shared_ptr<Value> cmp_ins = ins;
     bool release_rd = writeRegister(cmp_ins, ans, machineFunc, res);
-    shared_ptr<Operand> one = make_shared<Operand>(IMM, "1");
-    shared_ptr<Operand> zero = make_shared<Operand>(IMM, "0");
+    shared_ptr<Operand> one = make_shared<Operand>(IMM, 1);
+    shared_ptr<Operand> zero = make_shared<Operand>(IMM, 0);
     shared_ptr<MovIns> assign_t = make_shared<MovIns>(NON, NONE, 0, ans, one);
     shared_ptr<MovIns> assign_f = make_shared<MovIns>(NON, NONE, 0, ans, zero);
-    if (bi->op == "==") {
-        assign_t->cond = EQ;
-        assign_f->cond = NE;
-        cmp_op = NE;
-    } else if (bi->op == "!=") {
-        assign_t->cond = NE;
-        assign_f->cond = EQ;
-        cmp_op = EQ;
-    } else if (bi->op == "<") {
-        assign_t->cond = LS;
-        assign_f->cond = GE;
-        cmp_op = GE;
-    } else if (bi->op == ">") {
-        assign_t->cond = GT;
-        assign_f->cond = LE;
-        cmp_op = LE;
-    } else if (bi->op == "<=") {
-        assign_t->cond = LE;
-        assign_f->cond = GT;
-        cmp_op = GT;
-    } else {
-        assign_t->cond = GE;
-        assign_f->cond = LS;
-        cmp_op = LS;
-    }
+    assign_t->cond = irOpCond(bi->op);
+    assign_f->cond = irOpCond(inverseOp(bi->op));
+    cmp_op = assign_f->cond;
     if (!true_cmp) {
         res.push_back(assign_t);
         res.push_back(assign_f);
@@ -1051,9 +1322,9 @@ vector<shared_ptr<MachineIns>> genCmpIns(shared_ptr<Instruction> &ins, shared_pt
 vector<shared_ptr<MachineIns>> genBIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc) {
     vector<shared_ptr<MachineIns>> res;
     shared_ptr<BranchInstruction> br = s_p_c<BranchInstruction>(ins);
-    shared_ptr<Operand> op1 = make_shared<Operand>(REG, "2");
+    shared_ptr<Operand> op1 = make_shared<Operand>(REG, R2);
     bool release1 = readRegister(br->condition, op1, machineFunc, res, true, true);
-    shared_ptr<Operand> op2 = make_shared<Operand>(IMM, "0");
+    shared_ptr<Operand> op2 = make_shared<Operand>(IMM, 0);
     shared_ptr<CmpIns> cmpIns = make_shared<CmpIns>(NON, NONE, 0, op1, op2);
     if (release1) releaseTempRegister(op1->value);
     //false case
@@ -1076,7 +1347,7 @@ vector<shared_ptr<MachineIns>> genBIns(shared_ptr<Instruction> &ins, shared_ptr<
 
 void genAlloc(shared_ptr<MachineFunc> &machineFunc, shared_ptr<Instruction> &ins) {
     shared_ptr<AllocInstruction> al = s_p_c<AllocInstruction>(ins);
-    machineFunc->var2offset.insert(pair<string, int>(to_string(al->id), machineFunc->stackPointer));
+    machineFunc->var2offset.insert(pair<unsigned int, int>(al->id, machineFunc->stackPointer));
     machineFunc->stackPointer += al->bytes;
 }
 
@@ -1087,14 +1358,14 @@ vector<shared_ptr<MachineIns>> genLoadIns(shared_ptr<Instruction> &ins, shared_p
         li->address->valueType == CONSTANT || (li->address->valueType == INSTRUCTION &&
                                                s_p_c<Instruction>(li->address)->type ==
                                                BINARY)) {
-        shared_ptr<Operand> t_base = make_shared<Operand>(REG, "1");
+        shared_ptr<Operand> t_base = make_shared<Operand>(REG, R1);
         bool release_base = readRegister(li->address, t_base, machineFunc, res, true, true);
-        shared_ptr<Operand> t_offset = make_shared<Operand>(REG, "3");
+        shared_ptr<Operand> t_offset = make_shared<Operand>(REG, R3);
         shared_ptr<Shift> t_s = make_shared<Shift>();
         bool release_offset;
         if (li->offset->valueType == NUMBER) {
             int off = s_p_c<NumberValue>(li->offset)->number * 4;
-            string reg = allocTempRegister();
+            int reg = allocTempRegister();
             t_offset->value = reg;
             loadOffset(off, t_offset, reg, res);
             release_offset = true;
@@ -1111,7 +1382,7 @@ vector<shared_ptr<MachineIns>> genLoadIns(shared_ptr<Instruction> &ins, shared_p
         }
         if (release_offset) releaseTempRegister(t_offset->value);
         if (release_base) releaseTempRegister(t_base->value);
-        shared_ptr<Operand> t_rd = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> t_rd = make_shared<Operand>(REG, R2);
         shared_ptr<Value> l_ins = ins;
         bool release_rd = writeRegister(l_ins, t_rd, machineFunc, res);
         shared_ptr<MemoryIns> t_load = make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, t_s, t_rd, t_base, t_offset);
@@ -1121,18 +1392,18 @@ vector<shared_ptr<MachineIns>> genLoadIns(shared_ptr<Instruction> &ins, shared_p
         }
     } else { //use sp
         //compute offset
-        shared_ptr<Operand> f_pre = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> f_pre = make_shared<Operand>(REG, R2);
         f_pre->value = allocTempRegister();
         f_pre->state = REG;
-        loadImm2Reg(machineFunc->var2offset.at(to_string(li->address->id)), f_pre, res, true);
-        shared_ptr<Operand> t_off = make_shared<Operand>(REG, "3");
+        loadImm2Reg(machineFunc->var2offset.at(li->address->id), f_pre, res, true);
+        shared_ptr<Operand> t_off = make_shared<Operand>(REG, R3);
         bool release_off;
         shared_ptr<Shift> t_s = make_shared<Shift>();
         if (li->offset->valueType == NUMBER) {
             int off = s_p_c<NumberValue>(li->offset)->number * 4;
             if (judgeImmValid(off, false)) {
                 t_off->state = IMM;
-                t_off->value = to_string(off);
+                t_off->value = off;
                 release_off = false;
             } else {
                 t_off->value = allocTempRegister();
@@ -1149,17 +1420,17 @@ vector<shared_ptr<MachineIns>> genLoadIns(shared_ptr<Instruction> &ins, shared_p
         }
         if (release_off) releaseTempRegister(t_off->value);
         releaseTempRegister(f_pre->value);
-        shared_ptr<Operand> f_aft = make_shared<Operand>(REG, "3");
+        shared_ptr<Operand> f_aft = make_shared<Operand>(REG, R3);
         f_aft->value = allocTempRegister();
         f_aft->state = REG;
         shared_ptr<BinaryIns> add = make_shared<BinaryIns>(mit::ADD, NON, t_s, f_pre, t_off, f_aft);
         res.push_back(add);
         releaseTempRegister(f_aft->value);
         //load
-        shared_ptr<Operand> des = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> des = make_shared<Operand>(REG, R2);
         shared_ptr<Value> l_ins = ins;
         bool release_des = writeRegister(l_ins, des, machineFunc, res);
-        shared_ptr<Operand> base = make_shared<Operand>(REG, "13");
+        shared_ptr<Operand> base = make_shared<Operand>(REG, SP);
         shared_ptr<MemoryIns> load = make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, NONE, 0, des, base, f_aft);
         res.push_back(load);
         if (release_des) {
@@ -1176,16 +1447,16 @@ vector<shared_ptr<MachineIns>> genStoreIns(shared_ptr<Instruction> &ins, shared_
     if (si->address->valueType == PARAMETER || si->address->valueType == GLOBAL ||
         (si->address->valueType == INSTRUCTION &&
          s_p_c<Instruction>(si->address)->type == BINARY)) { //pointer
-        shared_ptr<Operand> t_base = make_shared<Operand>(REG, "1");
+        shared_ptr<Operand> t_base = make_shared<Operand>(REG, R1);
         bool release_base = readRegister(si->address, t_base, machineFunc, res, true, true);
-        shared_ptr<Operand> t_rd = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> t_rd = make_shared<Operand>(REG, R2);
         bool release_rd = readRegister(si->value, t_rd, machineFunc, res, true, true);
-        shared_ptr<Operand> t_offset = make_shared<Operand>(REG, "3");
+        shared_ptr<Operand> t_offset = make_shared<Operand>(REG, R3);
         bool release_offset;
         shared_ptr<Shift> t_s = make_shared<Shift>();
         if (si->offset->valueType == NUMBER) {
             int off = s_p_c<NumberValue>(si->offset)->number * 4;
-            string reg = allocTempRegister();
+            int reg = allocTempRegister();
             t_offset->value = reg;
             loadOffset(off, t_offset, t_offset->value, res);
             release_offset = true;
@@ -1207,17 +1478,17 @@ vector<shared_ptr<MachineIns>> genStoreIns(shared_ptr<Instruction> &ins, shared_
         if (release_base) releaseTempRegister(t_base->value);
     } else { //use sp
         //compute offset
-        shared_ptr<Operand> f_pre = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> f_pre = make_shared<Operand>(REG, R2);
         f_pre->value = allocTempRegister();
         f_pre->state = REG;
-        loadImm2Reg(machineFunc->var2offset.at(to_string(si->address->id)), f_pre, res, true);
-        shared_ptr<Operand> t_off = make_shared<Operand>(REG, "3");
+        loadImm2Reg(machineFunc->var2offset.at(si->address->id), f_pre, res, true);
+        shared_ptr<Operand> t_off = make_shared<Operand>(REG, R3);
         bool release_offset;
         shared_ptr<Shift> t_s = make_shared<Shift>();
         if (si->offset->valueType == NUMBER) {
             int off = s_p_c<NumberValue>(si->offset)->number * 4;
             if (judgeImmValid(off, false)) {
-                t_off->value = to_string(off);
+                t_off->value = off;
                 t_off->state = IMM;
                 release_offset = false;
             } else {
@@ -1235,15 +1506,15 @@ vector<shared_ptr<MachineIns>> genStoreIns(shared_ptr<Instruction> &ins, shared_
         }
         releaseTempRegister(f_pre->value);
         if (release_offset) releaseTempRegister(t_off->value);
-        shared_ptr<Operand> f_aft = make_shared<Operand>(REG, "3");
+        shared_ptr<Operand> f_aft = make_shared<Operand>(REG, R3);
         f_aft->value = allocTempRegister();
         f_aft->state = REG;
         shared_ptr<BinaryIns> add = make_shared<BinaryIns>(mit::ADD, NON, t_s, f_pre, t_off, f_aft);
         res.push_back(add);
         //store
-        shared_ptr<Operand> obj = make_shared<Operand>(REG, "2");
+        shared_ptr<Operand> obj = make_shared<Operand>(REG, R2);
         bool release_obj = readRegister(si->value, obj, machineFunc, res, true, true);
-        shared_ptr<Operand> base = make_shared<Operand>(REG, "13");
+        shared_ptr<Operand> base = make_shared<Operand>(REG, SP);
         shared_ptr<MemoryIns> store = make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, obj, base, f_aft);
         res.push_back(store);
         if (release_obj) releaseTempRegister(obj->value);
@@ -1252,15 +1523,225 @@ vector<shared_ptr<MachineIns>> genStoreIns(shared_ptr<Instruction> &ins, shared_
     return res;
 }
 
+/**
+ * Lower memset and memcpy on a local array to a loop storing one word each time, from the last word to the first:
+ *     label: SUB index, index, #4; [LDR word, [source, index]]; STR word, [base, index]; CMP index, #0; BGT label
+ */
+vector<shared_ptr<MachineIns>> genBulkInitIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc) {
+    vector<shared_ptr<MachineIns>> res;
+    bool isMemset = ins->type == MEMSET;
+    shared_ptr<Value> address = isMemset ? s_p_c<MemsetInstruction>(ins)->address
+                                         : s_p_c<MemcpyInstruction>(ins)->address;
+    int units = isMemset ? s_p_c<MemsetInstruction>(ins)->units : s_p_c<MemcpyInstruction>(ins)->units;
+    if (machineFunc->var2offset.count(address->id) == 0) {
+        cerr << "Error occurs in process bulk init: the address is not a local array." << endl;
+        return res;
+    }
+    shared_ptr<Operand> sp = make_shared<Operand>(REG, SP);
+    shared_ptr<Operand> base = make_shared<Operand>(REG, allocTempRegister());
+    loadImm2Reg(machineFunc->var2offset.at(address->id), base, res, true);
+    res.push_back(make_shared<BinaryIns>(mit::ADD, NON, NONE, 0, sp, base, base));
+    shared_ptr<Operand> index = make_shared<Operand>(REG, allocTempRegister());
+    loadImm2Reg(units * _W_LEN, index, res, true);
+    shared_ptr<Operand> word = make_shared<Operand>(REG, R2);
+    shared_ptr<Operand> source = make_shared<Operand>(REG, R3);
+    bool release_word = true;
+    if (isMemset) {
+        release_word = readRegister(s_p_c<MemsetInstruction>(ins)->value, word, machineFunc, res, true, true);
+    } else {
+        word->value = allocTempRegister();
+        source->value = allocTempRegister();
+        shared_ptr<ConstantValue> constant = s_p_c<ConstantValue>(s_p_c<MemcpyInstruction>(ins)->source);
+        loadConst2Reg(constant, source, res);
+    }
+    string label = "bulk_init" + to_string(ins->id);
+    res.push_back(make_shared<GlobalIns>(label, ""));
+    shared_ptr<Operand> four = make_shared<Operand>(IMM, _W_LEN);
+    res.push_back(make_shared<BinaryIns>(mit::SUB, NON, NONE, 0, index, four, index));
+    if (!isMemset) {
+        res.push_back(make_shared<MemoryIns>(mit::LOAD, OFFSET, NON, NONE, 0, word, source, index));
+    }
+    res.push_back(make_shared<MemoryIns>(mit::STORE, OFFSET, NON, NONE, 0, word, base, index));
+    shared_ptr<Operand> zero = make_shared<Operand>(IMM, 0);
+    res.push_back(make_shared<CmpIns>(NON, NONE, 0, index, zero));
+    res.push_back(make_shared<BIns>(GT, NONE, 0, label));
+    if (!isMemset) releaseTempRegister(source->value);
+    if (release_word) releaseTempRegister(word->value);
+    releaseTempRegister(index->value);
+    releaseTempRegister(base->value);
+    return res;
+}
+
+// the vector loop keeps its values in q8 to q15, d16 to d31, which need no saving across calls.
+const int FIRST_VECTOR_REG = 8;
+
+/**
+ * Whether two operands of a vector loop are the same start offset, so the accesses share a pointer.
+ */
+bool sameVectorStart(const shared_ptr<Value> &a, const shared_ptr<Value> &b) {
+    if (a->valueType == NUMBER && b->valueType == NUMBER) {
+        return s_p_c<NumberValue>(a)->number == s_p_c<NumberValue>(b)->number;
+    }
+    return a == b;
+}
+
+/**
+ * Set up a pointer to the first word accessed in array, which is array + start * 4.
+ */
+shared_ptr<Operand> genVectorPointer(shared_ptr<Value> &array, shared_ptr<Value> &start,
+                                     shared_ptr<MachineFunc> &machineFunc, vector<shared_ptr<MachineIns>> &res) {
+    shared_ptr<Operand> base = make_shared<Operand>(REG, R1);
+    bool release_base = true;
+    if (array->valueType == INSTRUCTION && s_p_c<Instruction>(array)->type == ALLOC) {
+        base->value = allocTempRegister();
+        loadImm2Reg(machineFunc->var2offset.at(array->id), base, res, true);
+        shared_ptr<Operand> sp = make_shared<Operand>(REG, SP);
+        res.push_back(make_shared<BinaryIns>(mit::ADD, NON, NONE, 0, sp, base, base));
+    } else {
+        release_base = readRegister(array, base, machineFunc, res, true, true);
+    }
+    shared_ptr<Operand> index = make_shared<Operand>(REG, R3);
+    shared_ptr<Shift> shift = make_shared<Shift>();
+    shift->type = NONE;
+    shift->shift = 0;
+    bool release_index = false;
+    if (start->valueType == NUMBER) {
+        int off = s_p_c<NumberValue>(start)->number * _W_LEN;
+        if (judgeImmValid(off, false)) {
+            index->state = IMM;
+            index->value = off;
+        } else {
+            index->value = allocTempRegister();
+            loadImm2Reg(off, index, res, true);
+            release_index = true;
+        }
+    } else {
+        release_index = readRegister(start, index, machineFunc, res, true, true);
+        shift->type = LSL;
+        shift->shift = 2;
+    }
+    if (release_index) releaseTempRegister(index->value);
+    if (release_base) releaseTempRegister(base->value);
+    shared_ptr<Operand> pointer = make_shared<Operand>(REG, allocTempRegister());
+    res.push_back(make_shared<BinaryIns>(mit::ADD, NON, shift, base, index, pointer));
+    return pointer;
+}
+
+/**
+ * Lower the vector loop IR to a NEON loop, walking each array by a pointer register and counting down the times:
+ *     label: VLD1.32 {..}, [pointer]!; V<op>.I32 ..; VST1.32 {..}, [pointer]!; SUB count, count, #1; CMP count, #0; BGT label
+ * The splats are set up before the loop, and the sum is kept in a q register, then added up to the result after it.
+ * A product only summed up is folded into VMLA.
+ */
+vector<shared_ptr<MachineIns>> genVectorIns(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc) {
+    vector<shared_ptr<MachineIns>> res;
+    shared_ptr<VectorInstruction> vi = s_p_c<VectorInstruction>(ins);
+    vector<VectorOp> &ops = vi->ops;
+    int folded = -1;
+    for (auto &op : ops) {
+        if (op.type != V_REDUCE) continue;
+        const VectorOp &value = ops.at(op.lhs);
+        int uses = 0;
+        for (auto &other : ops) uses += (other.lhs == op.lhs) + (other.rhs == op.lhs);
+        if (value.type == V_BINARY && value.op == OP_MUL && uses == 1) folded = op.lhs;
+    }
+    vector<int> vectorRegs(ops.size(), -1);
+    int nextReg = FIRST_VECTOR_REG;
+    for (int i = 0; i < ops.size(); ++i) {
+        if (ops[i].type == V_STORE || ops[i].type == V_REDUCE || i == folded) continue;
+        vectorRegs[i] = nextReg++;
+        if (ops[i].type != V_SPLAT) continue;
+        shared_ptr<Operand> value = make_shared<Operand>(REG, R2);
+        bool release_value = readRegister(vi->operands.at(ops[i].operand), value, machineFunc, res, true, true);
+        res.push_back(make_shared<VectorIns>(mit::VDUP, vectorRegs[i], value, false));
+        if (release_value) releaseTempRegister(value->value);
+    }
+    int sum = nextReg;
+    if (vi->hasReduction()) res.push_back(make_shared<VectorIns>(sum, 0));
+    // the accesses of the same start share the pointer, the last one of them steps it.
+    vector<shared_ptr<Operand>> pointers;
+    vector<int> pointerOfOp(ops.size(), -1);
+    vector<int> lastUse;
+    vector<int> firstOperand;
+    for (int i = 0; i < ops.size(); ++i) {
+        if (ops[i].type != V_LOAD && ops[i].type != V_STORE) continue;
+        int operand = ops[i].operand;
+        for (int p = 0; p < pointers.size(); ++p) {
+            if (vi->operands.at(firstOperand[p]) == vi->operands.at(operand)
+                && sameVectorStart(vi->operands.at(firstOperand[p] + 1), vi->operands.at(operand + 1))) {
+                pointerOfOp[i] = p;
+            }
+        }
+        if (pointerOfOp[i] < 0) {
+            pointerOfOp[i] = (int) pointers.size();
+            pointers.push_back(genVectorPointer(vi->operands.at(operand), vi->operands.at(operand + 1),
+                                                machineFunc, res));
+            lastUse.push_back(i);
+            firstOperand.push_back(operand);
+        }
+        lastUse[pointerOfOp[i]] = i;
+    }
+    shared_ptr<Operand> count = make_shared<Operand>(REG, R2);
+    if (!readRegister(vi->operands.at(0), count, machineFunc, res, true, true)) {
+        shared_ptr<Operand> times = count;
+        count = make_shared<Operand>(REG, allocTempRegister());
+        res.push_back(make_shared<MovIns>(NON, NONE, 0, count, times));
+    }
+    string label = "vector_loop" + to_string(ins->id);
+    res.push_back(make_shared<GlobalIns>(label, ""));
+    for (int i = 0; i < ops.size(); ++i) {
+        VectorOp &op = ops[i];
+        if (op.type == V_LOAD || op.type == V_STORE) {
+            int reg = op.type == V_LOAD ? vectorRegs[i] : vectorRegs[op.lhs];
+            res.push_back(make_shared<VectorIns>(op.type == V_LOAD ? mit::VLOAD : mit::VSTORE, reg,
+                                                 pointers[pointerOfOp[i]], lastUse[pointerOfOp[i]] == i));
+        } else if (op.type == V_BINARY && i != folded) {
+            mit::InsType type = op.op == OP_ADD ? mit::VADD : op.op == OP_SUB ? mit::VSUB : mit::VMUL;
+            res.push_back(make_shared<VectorIns>(type, vectorRegs[i], vectorRegs[op.lhs], vectorRegs[op.rhs], true));
+        } else if (op.type == V_REDUCE && op.lhs == folded) {
+            VectorOp &mul = ops.at(folded);
+            res.push_back(make_shared<VectorIns>(mit::VMLA, sum, vectorRegs[mul.lhs], vectorRegs[mul.rhs], true));
+        } else if (op.type == V_REDUCE) {
+            res.push_back(make_shared<VectorIns>(mit::VADD, sum, sum, vectorRegs[op.lhs], true));
+        }
+    }
+    shared_ptr<Operand> one = make_shared<Operand>(IMM, 1);
+    res.push_back(make_shared<BinaryIns>(mit::SUB, NON, NONE, 0, count, one, count));
+    shared_ptr<Operand> zero = make_shared<Operand>(IMM, 0);
+    res.push_back(make_shared<CmpIns>(NON, NONE, 0, count, zero));
+    res.push_back(make_shared<BIns>(GT, NONE, 0, label));
+    releaseTempRegister(count->value);
+    for (auto &pointer : pointers) releaseTempRegister(pointer->value);
+    if (!vi->hasReduction()) return res;
+    // add the lanes up in the low d register of the sum.
+    res.push_back(make_shared<VectorIns>(mit::VADD, sum * 2, sum * 2, sum * 2 + 1, false));
+    res.push_back(make_shared<VectorIns>(mit::VPADD, sum * 2, sum * 2, sum * 2, false));
+    shared_ptr<Operand> init = make_shared<Operand>(REG, R3);
+    bool release_init = readRegister(vi->operands.at(1), init, machineFunc, res, false, false);
+    shared_ptr<Operand> rd = make_shared<Operand>(REG, R2);
+    shared_ptr<Value> result = ins;
+    bool release_rd = writeRegister(result, rd, machineFunc, res);
+    shared_ptr<Operand> lane = rd;
+    res.push_back(make_shared<VectorIns>(mit::VGET, sum * 2, lane, false));
+    if (init->state != IMM || init->value != 0) {
+        res.push_back(make_shared<BinaryIns>(mit::ADD, NON, NONE, 0, rd, init, rd));
+    }
+    if (release_init) releaseTempRegister(init->value);
+    if (release_rd) {
+        store2Memory(rd, ins->id, machineFunc, res);
+    }
+    return res;
+}
+
 vector<shared_ptr<MachineIns>> genPhiMov(shared_ptr<Instruction> &ins, shared_ptr<BasicBlock> &basicBlock,
                                          shared_ptr<MachineFunc> &machineFunc) //PhiMoveIns
 {
     vector<shared_ptr<MachineIns>> res;
     shared_ptr<PhiMoveInstruction> p_move = static_pointer_cast<PhiMoveInstruction>(ins);
     shared_ptr<Value> target = p_move->phi->operands.at(basicBlock);
-    shared_ptr<Operand> op = make_shared<Operand>(REG, "3");
+    shared_ptr<Operand> op = make_shared<Operand>(REG, R3);
     bool release_target = readRegister(target, op, machineFunc, res, true, true);
-    shared_ptr<Operand> des = make_shared<Operand>(REG, "2");
+    shared_ptr<Operand> des = make_shared<Operand>(REG, R2);
     shared_ptr<Value> p_ins = ins;
     if (release_target) releaseTempRegister(op->value);
     bool release_des = writeRegister(p_ins, des, machineFunc, res);
@@ -1275,10 +1756,10 @@ vector<shared_ptr<MachineIns>> genPhiMov(shared_ptr<Instruction> &ins, shared_pt
 vector<shared_ptr<MachineIns>> genPhi(shared_ptr<Instruction> &ins, shared_ptr<MachineFunc> &machineFunc) {
     vector<shared_ptr<MachineIns>> res;
     shared_ptr<PhiInstruction> phi = static_pointer_cast<PhiInstruction>(ins);
-    shared_ptr<Operand> phi_mov = make_shared<Operand>(REG, "3");
+    shared_ptr<Operand> phi_mov = make_shared<Operand>(REG, R3);
     shared_ptr<Value> p_mov = phi->phiMove;
     bool release_mov = readRegister(p_mov, phi_mov, machineFunc, res, true, true);
-    shared_ptr<Operand> target = make_shared<Operand>(REG, "2");
+    shared_ptr<Operand> target = make_shared<Operand>(REG, R2);
     shared_ptr<Value> p_ins = ins;
     bool release_target = writeRegister(p_ins, target, machineFunc, res);
     shared_ptr<MovIns> move2Target = make_shared<MovIns>(NON, NONE, 0, target, phi_mov);
@@ -1338,9 +1819,9 @@ vector<shared_ptr<MachineIns>> genGlobIns(shared_ptr<MachineModule> &machineModu
 
 string BinaryIns::toString() {
     string type = instype2string.at(this->type);
-    string op1_ = state2string.at(op1->state) + op1->value;
-    string op2_ = state2string.at(op2->state) + op2->value;
-    string rd_ = state2string.at(rd->state) + rd->value;
+    string op1_ = state2string.at(op1->state) + to_string(op1->value);
+    string op2_ = state2string.at(op2->state) + to_string(op2->value);
+    string rd_ = state2string.at(rd->state) + to_string(rd->value);
     string cond = cond2string.at(this->cond);
     string stype = stype2string.at(this->shift->type);
     string out = type + cond + " " + rd_ + ", " + op1_ + ", " + op2_ + stype;
@@ -1349,10 +1830,10 @@ string BinaryIns::toString() {
 
 string TriIns::toString() {
     string type = instype2string.at(this->type);
-    string op1_ = state2string.at(op1->state) + op1->value;
-    string op2_ = state2string.at(op2->state) + op2->value;
-    string op3_ = state2string.at(op3->state) + op3->value;
-    string rd_ = state2string.at(rd->state) + rd->value;
+    string op1_ = state2string.at(op1->state) + to_string(op1->value);
+    string op2_ = state2string.at(op2->state) + to_string(op2->value);
+    string op3_ = state2string.at(op3->state) + to_string(op3->value);
+    string rd_ = state2string.at(rd->state) + to_string(rd->value);
     string cond = cond2string.at(this->cond);
     string stype = stype2string.at(this->shift->type);
     string out = type + cond + " " + rd_ + ", " + op1_ + ", " + op2_ + ", " + op3_ + stype;
@@ -1361,9 +1842,9 @@ string TriIns::toString() {
 
 string MemoryIns::toString() {
     string type = instype2string.at(this->type);
-    string op1 = state2string.at(rd->state) + rd->value;
-    string op2 = state2string.at(base->state) + base->value;
-    string op3 = state2string.at(offset->state) + offset->value;
+    string op1 = state2string.at(rd->state) + to_string(rd->value);
+    string op2 = state2string.at(base->state) + to_string(base->value);
+    string op3 = state2string.at(offset->state) + to_string(offset->value);
     string cond = cond2string.at(this->cond);
     string stype = stype2string.at(this->shift->type);
     string out = type + cond + " " + op1 + ", [" + op2 + ", " + op3 + "]" + stype;
@@ -1372,8 +1853,8 @@ string MemoryIns::toString() {
 
 string PseudoLoad::toString() {
     string type = instype2string.at(this->type);
-    string op1 = state2string.at(rd->state) + rd->value;
-    string op2 = state2string.at(label->state) + label->value;
+    string op1 = state2string.at(rd->state) + to_string(rd->value);
+    string op2 = state2string.at(label->state) + to_string(label->value);
     string cond = cond2string.at(this->cond);
     string stype = stype2string.at(this->shift->type);
     string out = type + cond + " ," + op1 + ", " + op2 + stype;
@@ -1386,7 +1867,7 @@ string StackIns::toString() {
     string stype = stype2string.at(this->shift->type);
     string out = type + cond + "{";
     for (auto &operand:regs) {
-        out.append(state2string.at(operand->state) + operand->value + ", ");
+        out.append(state2string.at(operand->state) + to_string(operand->value) + ", ");
     }
     out.append("}");
     return out;
@@ -1396,8 +1877,8 @@ string CmpIns::toString() {
     string type = instype2string.at(this->type);
     string cond = cond2string.at(this->cond);
     string stype = stype2string.at(this->shift->type);
-    string op1_ = state2string.at(op1->state) + op1->value;
-    string op2_ = state2string.at(op2->state) + op2->value;
+    string op1_ = state2string.at(op1->state) + to_string(op1->value);
+    string op2_ = state2string.at(op2->state) + to_string(op2->value);
     string out = type + cond + " " + op1_ + ", " + op2_ + " " + stype;
     return out;
 }
@@ -1406,8 +1887,8 @@ string MovIns::toString() {
     string type = instype2string.at(this->type);
     string cond = cond2string.at(this->cond);
     string stype = stype2string.at(this->shift->type);
-    string op1_ = state2string.at(op1->state) + op1->value;
-    string op2_ = state2string.at(op2->state) + op2->value;
+    string op1_ = state2string.at(op1->state) + to_string(op1->value);
+    string op2_ = state2string.at(op2->state) + to_string(op2->value);
     string out = type + cond + " " + op1_ + ", " + op2_ + " " + stype;
     return out;
 }
@@ -1442,3 +1923,22 @@ string GlobalIns::toString() {
 string Comment::toString() {
     return content;
 }
+
+string VectorIns::toString() {
+    string type = instype2string.at(this->type);
+    string prefix = quad ? "Q" : "D";
+    switch (this->type) {
+        case mit::VLOAD:
+        case mit::VSTORE:
+            return type + " {D" + to_string(vd * 2) + ", D" + to_string(vd * 2 + 1) + "}, [R"
+                   + to_string(rn->value) + "]" + (writeBack ? "!" : "");
+        case mit::VDUP:
+            return type + " Q" + to_string(vd) + ", R" + to_string(rn->value);
+        case mit::VMOV:
+            return type + " Q" + to_string(vd) + ", #" + to_string(imm);
+        case mit::VGET:
+            return type + " R" + to_string(rn->value) + ", D" + to_string(vn) + "[0]";
+        default:
+            return type + " " + prefix + to_string(vd) + ", " + prefix + to_string(vn) + ", " + prefix + to_string(vm);
+    }
+}
@@ -9,6 +9,7 @@
 #include "ir/ir_check.h"
 #include "optimize/ir/ir_optimize.h"
 #include "machine_ir/machine_ir_build.h"
+#include "basic/report/pass_report.h"
 
 using namespace std;
 
@@ -39,13 +40,23 @@ int main(int argc, char **argv) {
 
     if ((r = initConfig()) != 0) return r;
 
-    if (!lexicalAnalyze(sourceCodeFile)) {
-        cout << "Error: Cannot parse source code file." << endl;
-        return _LEX_ERR;
+    // the assembly goes to stdout, so the progress messages are moved to stderr.
+    if (targetCodeFile == "-") cout.rdbuf(cerr.rdbuf());
+
+    {
+        PassRecorder recorder(PHASE_RECORD, "Lexical Analyze");
+        if (!lexicalAnalyze(sourceCodeFile)) {
+            cout << "Error: Cannot parse source code file." << endl;
+            return _LEX_ERR;
+        }
     }
 
     cout << "[AST]" << endl << "Start building AST..." << endl;
-    auto root = syntaxAnalyze();
+    shared_ptr<CompUnitNode> root;
+    {
+        PassRecorder recorder(PHASE_RECORD, "Syntax Analyze");
+        root = syntaxAnalyze();
+    }
     cout << "AST built successfully." << endl;
     if (_debugAst) {
         ofstream astStream;
@@ -57,9 +68,14 @@ int main(int argc, char **argv) {
     cout << endl;
 
     cout << "[IR]" << endl << "Start building IR in SSA form..." << endl;
-    auto module = buildIrModule(root);
+    shared_ptr<Module> module;
+    auto irCounter = [&]() { return module == nullptr ? -1 : countInstructions(module); };
+    {
+        PassRecorder recorder(PHASE_RECORD, "IR Build", irCounter);
+        module = buildIrModule(root);
+        removePhiUserBlocksAndMultiCmp(module);
+    }
     cout << "IR built successfully." << endl;
-    removePhiUserBlocksAndMultiCmp(module);
     if (_debugIr) {
         ofstream irStream;
         irStream.open(debugMessageDirectory + "ir.txt", ios::out | ios::trunc);
@@ -78,13 +94,17 @@ int main(int argc, char **argv) {
 
     if (optimizeLevel != OptimizeLevel::O0) {
         cout << "[Optimize]" << endl << "Start IR optimizing..." << endl;
-        optimizeIr(module, optimizeLevel);
+        {
+            PassRecorder recorder(PHASE_RECORD, "IR Optimize", irCounter);
+            optimizeIr(module, optimizeLevel);
+        }
         cout << "IR Optimized successfully." << endl;
         if (_debugIr) {
             cout << "Optimized IR written to ir_optimize.txt." << endl;
         }
         cout << endl;
     } else {
+        PassRecorder recorder(PHASE_RECORD, "IR Finalize", irCounter);
         fixRightValue(module);
         for (auto &func : module->functions) {
             phiElimination(func);
@@ -99,17 +119,31 @@ int main(int argc, char **argv) {
     }
 
     cout << "[Machine IR]" << endl << "Start building Machine IR..." << endl;
-    auto machineModule = buildMachineModule(module);
+    shared_ptr<MachineModule> machineModule;
+    auto machineCounter = [&]() {
+        return machineModule == nullptr ? -1 : countMachineInstructions(machineModule);
+    };
+    {
+        PassRecorder recorder(PHASE_RECORD, "Machine IR Build", machineCounter);
+        machineModule = buildMachineModule(module);
+    }
     cout << "Machine IR built successfully." << endl;
     cout << endl;
 
     cout << "[ARM]" << endl << "Start building ARM..." << endl;
-    machineIrStream.open(targetCodeFile, ios::out | ios::trunc);
-    machineModule->toARM();
-    machineIrStream.close();
+    {
+        PassRecorder recorder(PHASE_RECORD, "ARM Output", machineCounter);
+        machineModule->toARM();
+        if (!machineIrStream.writeTo(targetCodeFile)) {
+            cerr << "Error: Cannot write target code file." << endl;
+            return _ARM_OUT_ERR;
+        }
+    }
     cout << "ARM built successfully!" << endl;
     cout << endl;
 
+    outputPassReport(targetCodeFile == "-" ? "whitee.passes.json" : targetCodeFile + ".passes.json");
+
     return 0;
 }
 
@@ -120,6 +154,8 @@ int setCompileOptions(int argc, char **argv) {
     bool argDebugFlag = false;
     bool argCheckFlag = false;
     bool argDebugDirectoryFlag = false;
+    bool argJobsFlag = false;
+    bool argUnrollFlag = false;
 
     if (argc < 1) {
         printHelp(argv[0]);
@@ -206,6 +242,48 @@ int setCompileOptions(int argc, char **argv) {
             if (debugLevel > 1) {
                 needIrPassCheck = true;
             }
+        } else if (!argJobsFlag && string(argv[i]).find("-j") == 0) {
+            argJobsFlag = true;
+            argv[i] += 2;
+            if (*argv[i] == '\0') {
+                if (i + 1 == argc) {
+                    printHelp(argv[0]);
+                    return _SCO_JOBS_ERR;
+                }
+                ++i;
+            }
+            int jobs = strtol(argv[i], argv + i, 10);
+            if (jobs <= 0 || *argv[i] != '\0') {
+                cout << "Error: The number of jobs should be a positive integer." << endl;
+                printHelp(argv[0]);
+                return _SCO_JOBS_ERR;
+            }
+            _jobs = jobs;
+        } else if (!argUnrollFlag && string(argv[i]).find("--unroll-factor") == 0) {
+            argUnrollFlag = true;
+            argv[i] += 15;
+            if (*argv[i] == '=') {
+                ++argv[i];
+            } else if (*argv[i] == '\0') {
+                if (i + 1 == argc) {
+                    printHelp(argv[0]);
+                    return _SCO_UNROLL_ERR;
+                }
+                ++i;
+            }
+            int factor = strtol(argv[i], argv + i, 10);
+            if (factor <= 0 || *argv[i] != '\0') {
+                cout << "Error: The unroll factor should be a positive integer." << endl;
+                printHelp(argv[0]);
+                return _SCO_UNROLL_ERR;
+            }
+            _unrollFactor = factor;
+        } else if (argv[i] == "--no-vectorize"s) {
+            _vectorize = false;
+        } else if (argv[i] == "--time-passes"s) {
+            _timePasses = true;
+        } else if (argv[i] == "--mem-report"s) {
+            _memReport = true;
         } else if (!argDebugDirectoryFlag && string(argv[i]).find("--set-debug-path=") == 0) {
             argDebugDirectoryFlag = true;
             argv[i] += 17;
@@ -223,6 +301,8 @@ int setCompileOptions(int argc, char **argv) {
             }
         }
     }
+    // the conflict graphs of all the functions are appended to one dump file.
+    if (_debugIrOptimize) _jobs = 1;
     return _SCO_SUCCESS;
 }
 
@@ -233,9 +313,12 @@ void printHelp(const char *exec) {
         cout << endl << string(8 + strlen(exec), ' ')
              << "[-c | --check <level>] [--set-debug-path=<path>]"
              << endl << string(8 + strlen(exec), ' ')
+             << "[--time-passes] [--mem-report] [-j <jobs>] [--unroll-factor <n>] [--no-vectorize]"
+             << endl << string(8 + strlen(exec), ' ')
              << "<target-file> <source-file> [-O <level>]" << endl;
     } else {
         cout << " [-c | --check <level>] [--set-debug-path=<path>]"
+                " [--time-passes] [--mem-report] [-j <jobs>] [--unroll-factor <n>] [--no-vectorize]"
                 " <target-file> <source-file> [-O <level>]" << endl;
     }
     cout << endl;
@@ -253,7 +336,17 @@ void printHelp(const char *exec) {
     cout << "    --set-debug-path=<path>" << endl;
     cout << "                        " << "set debug messages output path,"
                                           " default the same path with target assembly file" << endl;
-    cout << "    <target-file>       " << "target assembly file in ARM-v7a" << endl;
+    cout << "    --time-passes       " << "report time and instruction counts of each phase and pass" << endl;
+    cout << "    --mem-report        " << "report peak RSS growth of each phase and pass" << endl;
+    cout << "                        " << "both print a table to stderr and write <target-file>.passes.json" << endl;
+    cout << "    -j <jobs>           " << "run the per-function register alloc and machine IR build on <jobs> threads,"
+                                          " default 1" << endl;
+    cout << "                        " << "the output is the same as the serial one" << endl;
+    cout << "    --unroll-factor <n> " << "unroll the counted loops <n> times at -O2 and -O3,"
+                                          " default chosen from the loop body size" << endl;
+    cout << "                        " << "1 disables loop unrolling" << endl;
+    cout << "    --no-vectorize      " << "do not vectorize the loops by NEON at -O2 and -O3" << endl;
+    cout << "    <target-file>       " << "target assembly file in ARM-v7a, - for stdout" << endl;
     cout << "    <source-file>       " << "source code file matching SysY grammar" << endl;
     cout << "    -O <level>          " << "set optimization level, default non-optimization -O0" << endl;
     cout << endl;
@@ -1,13 +1,35 @@
 #include "ir_optimize.h"
 
-void arrayExternalLift(shared_ptr<Module> &module) {
+/**
+ * A bulk-initialized array can only be lifted if the initialization and every store stay in the block of the alloc,
+ * the initialization comes first and no load in that block runs before the last store.
+ */
+bool bulkInitBeforeStoresAndLoads(shared_ptr<Instruction> &alloc, shared_ptr<Value> &bulk, int storeCnt) {
+    bool bulkVisited = false;
+    for (auto &ins : alloc->block->instructions) {
+        if (ins == bulk) {
+            bulkVisited = true;
+        } else if (ins->type == InstructionType::STORE && s_p_c<StoreInstruction>(ins)->address == alloc) {
+            if (!bulkVisited) return false;
+            --storeCnt;
+        } else if (ins->type == InstructionType::LOAD && s_p_c<LoadInstruction>(ins)->address == alloc) {
+            if (!bulkVisited || storeCnt != 0) return false;
+        }
+    }
+    return bulkVisited && storeCnt == 0;
+}
+
+bool arrayExternalLift(shared_ptr<Module> &module) {
+    bool changed = false;
     for (auto &func : module->functions) {
         for (auto &bb : func->blocks) {
             for (auto &ins : bb->instructions) {
-                if (ins->type == InstructionType::ALLOC) {
+                if (ins->type == InstructionType::ALLOC && ins->valid) {
                     bool canExternalLift = true;
                     map<int, int> constValues;
-                    unordered_set<shared_ptr<Value>> insUsers = ins->users;
+                    shared_ptr<Value> bulk;
+                    int storeCnt = 0;
+                    vector<shared_ptr<Value>> insUsers = ins->getUsers();
                     for (auto &user : insUsers) {
                         if (dynamic_cast<StoreInstruction *>(user.get())) {
                             shared_ptr<StoreInstruction> store = s_p_c<StoreInstruction>(user);
@@ -18,38 +40,62 @@ void arrayExternalLift(shared_ptr<Module> &module) {
                                     break;
                                 } else {
                                     constValues[number] = s_p_c<NumberValue>(store->value)->number;
+                                    ++storeCnt;
                                 }
                             } else {
                                 canExternalLift = false;
                                 break;
                             }
+                        } else if (dynamic_cast<MemsetInstruction *>(user.get())
+                                   || dynamic_cast<MemcpyInstruction *>(user.get())) {
+                            if (bulk != nullptr || (dynamic_cast<MemsetInstruction *>(user.get())
+                                                    && s_p_c<MemsetInstruction>(user)->value->valueType != NUMBER)) {
+                                canExternalLift = false;
+                                break;
+                            }
+                            bulk = user;
                         } else if (!dynamic_cast<LoadInstruction *>(user.get())) {
                             canExternalLift = false;
                             break;
                         }
                     }
+                    if (canExternalLift && bulk != nullptr && !bulkInitBeforeStoresAndLoads(ins, bulk, storeCnt)) {
+                        canExternalLift = false;
+                    }
                     if (canExternalLift) {
                         shared_ptr<AllocInstruction> alloc = s_p_c<AllocInstruction>(ins);
                         shared_ptr<Value> allocVal = alloc;
-                        shared_ptr<ConstantValue> constant = make_shared<ConstantValue>();
+                        shared_ptr<ConstantValue> constant = newIr<ConstantValue>();
                         shared_ptr<Value> constVal = constant;
                         constant->size = alloc->units;
                         constant->dimensions = vector({alloc->units});
-                        constant->values = constValues;
+                        if (bulk != nullptr && s_p_c<Instruction>(bulk)->type == InstructionType::MEMSET) {
+                            int fill = s_p_c<NumberValue>(s_p_c<MemsetInstruction>(bulk)->value)->number;
+                            if (fill != 0) {
+                                for (int i = 0; i < alloc->units; ++i) constant->values[i] = fill;
+                            }
+                        } else if (bulk != nullptr) {
+                            constant->values = s_p_c<ConstantValue>(s_p_c<MemcpyInstruction>(bulk)->source)->values;
+                        }
+                        for (auto &item : constValues) constant->values[item.first] = item.second;
                         constant->name = alloc->name;
                         module->globalConstants.push_back(constant);
-                        unordered_set<shared_ptr<Value>> users = alloc->users;
+                        vector<shared_ptr<Value>> users = alloc->getUsers();
                         for (auto &user : users) {
-                            if (dynamic_cast<StoreInstruction *> (user.get())) {
+                            if (dynamic_cast<StoreInstruction *> (user.get())
+                                || dynamic_cast<MemsetInstruction *> (user.get())
+                                || dynamic_cast<MemcpyInstruction *> (user.get())) {
                                 user->abandonUse();
                             } else {
                                 user->replaceUse(allocVal, constVal);
                             }
                         }
                         alloc->abandonUse();
+                        changed = true;
                     }
                 }
             }
         }
     }
+    return changed;
 }
@@ -6,7 +6,7 @@ void calculateVariableWeight(shared_ptr<Function> &func) {
         if (func->variableWeight.count(arg) != 0) {
             tempWeight = func->variableWeight.at(arg);
         }
-        for (auto &user : arg->users) {
+        for (auto &user : arg->getUsers()) {
             if (user->valueType == INSTRUCTION && s_p_c<Instruction>(user)->type != PHI) {
                 tempWeight = countWeight(s_p_c<Instruction>(user)->block->loopDepth, tempWeight);
             } else if (user->valueType != INSTRUCTION) {
@@ -24,7 +24,7 @@ void calculateVariableWeight(shared_ptr<Function> &func) {
                     tempWeight = func->variableWeight.at(ins);
                 }
                 tempWeight = countWeight(bb->loopDepth, tempWeight);
-                for (auto &user : ins->users) {
+                for (auto &user : ins->getUsers()) {
                     if (user->valueType == INSTRUCTION && s_p_c<Instruction>(user)->type != PHI) {
                         tempWeight = countWeight(s_p_c<Instruction>(user)->block->loopDepth, tempWeight);
                     } else if (user->valueType != INSTRUCTION) {
@@ -48,7 +48,7 @@ void calculateVariableWeight(shared_ptr<Function> &func) {
                 tempWeight = func->variableWeight.at(phi);
             }
             tempWeight = countWeight(bb->loopDepth, tempWeight);
-            for (auto &user : phi->users) {
+            for (auto &user : phi->getUsers()) {
                 if (user->valueType == INSTRUCTION && s_p_c<Instruction>(user)->type != PHI) {
                     tempWeight = countWeight(s_p_c<Instruction>(user)->block->loopDepth, tempWeight);
                 } else if (user->valueType != INSTRUCTION) {
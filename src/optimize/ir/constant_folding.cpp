@@ -1,8 +1,5 @@
 #include "ir_optimize.h"
 
-string negOp = "-"; // NOLINT
-string notOp = "!"; // NOLINT
-
 void maintainLeftValue(shared_ptr<Value> &newVal, shared_ptr<Value> &oldVal) {
     if (oldVal->valueType == ValueType::INSTRUCTION
         && s_p_c<Instruction>(oldVal)->resultType == L_VAL_RESULT) {
@@ -11,7 +8,34 @@ void maintainLeftValue(shared_ptr<Value> &newVal, shared_ptr<Value> &oldVal) {
     }
 }
 
-void fold(shared_ptr<Instruction> &ins) {
+bool computeBinary(IrOp op, int l, int r, int &result) {
+    if ((op == OP_DIV || op == OP_MOD) && r == 0) {
+        cerr << "Error occurs in process constant folding: divide 0." << endl;
+        return false;
+    }
+    switch (op) {
+        case OP_ADD: result = l + r; break;
+        case OP_SUB: result = l - r; break;
+        case OP_MUL: result = l * r; break;
+        case OP_DIV: result = l / r; break;
+        case OP_MOD: result = l % r; break;
+        case OP_GT: result = l > r; break;
+        case OP_LT: result = l < r; break;
+        case OP_LE: result = l <= r; break;
+        case OP_GE: result = l >= r; break;
+        case OP_EQ: result = l == r; break;
+        case OP_NE: result = l != r; break;
+        case OP_AND: result = (int) ((unsigned) l & (unsigned) r); break;
+        case OP_OR: result = (int) ((unsigned) l | (unsigned) r); break;
+        default:
+            cerr << "Error occurs in process constant folding: undefined operator '"
+                    + string(irOpName(op)) + "'." << endl;
+            return false;
+    }
+    return true;
+}
+
+bool fold(shared_ptr<Instruction> &ins) {
     shared_ptr<Value> newVal;
     shared_ptr<Value> insVal = ins;
     bool insert = false;
@@ -23,85 +47,51 @@ void fold(shared_ptr<Instruction> &ins) {
                 && bIns->rhs->valueType == ValueType::NUMBER) {
                 shared_ptr<NumberValue> lOpVal = s_p_c<NumberValue>(bIns->lhs);
                 shared_ptr<NumberValue> rOpVal = s_p_c<NumberValue>(bIns->rhs);
-                if ((bIns->op == "/" || bIns->op == "%") && rOpVal->number == 0) {
-                    cerr << "Error occurs in process constant folding: divide 0." << endl;
-                    return;
-                }
-                if (bIns->op == "+") newVal = getNumberValue(lOpVal->number + rOpVal->number);
-                else if (bIns->op == "-") newVal = getNumberValue(lOpVal->number - rOpVal->number);
-                else if (bIns->op == "*") newVal = getNumberValue(lOpVal->number * rOpVal->number);
-                else if (bIns->op == "/") newVal = getNumberValue(lOpVal->number / rOpVal->number);
-                else if (bIns->op == "%") newVal = getNumberValue(lOpVal->number % rOpVal->number);
-                else if (bIns->op == ">") newVal = getNumberValue(lOpVal->number > rOpVal->number);
-                else if (bIns->op == "<") newVal = getNumberValue(lOpVal->number < rOpVal->number);
-                else if (bIns->op == "<=") newVal = getNumberValue(lOpVal->number <= rOpVal->number);
-                else if (bIns->op == ">=") newVal = getNumberValue(lOpVal->number >= rOpVal->number);
-                else if (bIns->op == "==") newVal = getNumberValue(lOpVal->number == rOpVal->number);
-                else if (bIns->op == "!=") newVal = getNumberValue(lOpVal->number != rOpVal->number);
-                else if (bIns->op == "&&")
-                    newVal = getNumberValue((int) ((unsigned) lOpVal->number & (unsigned) rOpVal->number));
-                else if (bIns->op == "||")
-                    newVal = getNumberValue((int) ((unsigned) lOpVal->number | (unsigned) rOpVal->number));
-                else {
-                    cerr << "Error occurs in process constant folding: undefined operator '" + bIns->op + "'." << endl;
-                    return;
-                }
+                int result;
+                if (!computeBinary(bIns->op, lOpVal->number, rOpVal->number, result)) return false;
+                newVal = getNumberValue(result);
             } else if (bIns->lhs->valueType == ValueType::NUMBER) {
                 /**
                  * when the lhs is a special number.
                  */
                 shared_ptr<NumberValue> lOpVal = s_p_c<NumberValue>(bIns->lhs);
                 if (lOpVal->number == 0) {
-                    if (bIns->op == "*" || bIns->op == "/" || bIns->op == "%" || bIns->op == "&&")
+                    if (bIns->op == OP_MUL || bIns->op == OP_DIV || bIns->op == OP_MOD || bIns->op == OP_AND)
                         newVal = getNumberValue(0);
-                    else if (bIns->op == "+" || bIns->op == "||")
+                    else if (bIns->op == OP_ADD || bIns->op == OP_OR)
                         newVal = bIns->rhs;
-                    else if (bIns->op == "-") {
-                        newVal = make_shared<UnaryInstruction>(negOp, bIns->rhs, bIns->block);
-                        bIns->rhs->users.insert(newVal);
+                    else if (bIns->op == OP_SUB) {
+                        newVal = newIr<UnaryInstruction>(OP_SUB, bIns->rhs, bIns->block);
                         maintainLeftValue(newVal, bIns->rhs);
                         insert = true;
-                    } else if (ins->type == InstructionType::CMP
-                               && (bIns->op == ">" || bIns->op == "<" || bIns->op == "<=" || bIns->op == ">=")) {
-                        bIns->op = bIns->swapOpConst(bIns->op);
-                        shared_ptr<Value> temp = bIns->lhs;
-                        bIns->lhs = bIns->rhs;
-                        bIns->rhs = temp;
-                        return;
-                    } else return;
+                    } else if (ins->type == InstructionType::CMP && swappedOp(bIns->op) != bIns->op) {
+                        bIns->op = swappedOp(bIns->op);
+                        bIns->swapOperands();
+                        return true;
+                    } else return false;
                 } else if (lOpVal->number == 1) {
-                    if (bIns->op == "*") newVal = bIns->rhs;
-                    else if (ins->type == InstructionType::CMP
-                             && (bIns->op == ">" || bIns->op == "<" || bIns->op == "<=" || bIns->op == ">=")) {
-                        bIns->op = bIns->swapOpConst(bIns->op);
-                        shared_ptr<Value> temp = bIns->lhs;
-                        bIns->lhs = bIns->rhs;
-                        bIns->rhs = temp;
-                        return;
-                    } else return;
+                    if (bIns->op == OP_MUL) newVal = bIns->rhs;
+                    else if (ins->type == InstructionType::CMP && swappedOp(bIns->op) != bIns->op) {
+                        bIns->op = swappedOp(bIns->op);
+                        bIns->swapOperands();
+                        return true;
+                    } else return false;
                 } else if (lOpVal->number == -1) {
-                    if (bIns->op == "*") {
-                        newVal = make_shared<UnaryInstruction>(negOp, bIns->rhs, bIns->block);
-                        bIns->rhs->users.insert(newVal);
+                    if (bIns->op == OP_MUL) {
+                        newVal = newIr<UnaryInstruction>(OP_SUB, bIns->rhs, bIns->block);
                         maintainLeftValue(newVal, bIns->rhs);
                         insert = true;
-                    } else if (ins->type == InstructionType::CMP
-                               && (bIns->op == ">" || bIns->op == "<" || bIns->op == "<=" || bIns->op == ">=")) {
-                        bIns->op = bIns->swapOpConst(bIns->op);
-                        shared_ptr<Value> temp = bIns->lhs;
-                        bIns->lhs = bIns->rhs;
-                        bIns->rhs = temp;
-                        return;
-                    } else return;
+                    } else if (ins->type == InstructionType::CMP && swappedOp(bIns->op) != bIns->op) {
+                        bIns->op = swappedOp(bIns->op);
+                        bIns->swapOperands();
+                        return true;
+                    } else return false;
                 } else {
-                    if (ins->type == InstructionType::CMP
-                        && (bIns->op == ">" || bIns->op == "<" || bIns->op == "<=" || bIns->op == ">=")) {
-                        bIns->op = bIns->swapOpConst(bIns->op);
-                        shared_ptr<Value> temp = bIns->lhs;
-                        bIns->lhs = bIns->rhs;
-                        bIns->rhs = temp;
-                        return;
-                    } else return;
+                    if (ins->type == InstructionType::CMP && swappedOp(bIns->op) != bIns->op) {
+                        bIns->op = swappedOp(bIns->op);
+                        bIns->swapOperands();
+                        return true;
+                    } else return false;
                 }
             } else if (bIns->rhs->valueType == ValueType::NUMBER) {
                 /**
@@ -109,75 +99,73 @@ void fold(shared_ptr<Instruction> &ins) {
                  */
                 shared_ptr<NumberValue> rOpVal = s_p_c<NumberValue>(bIns->rhs);
                 if (rOpVal->number == 0) {
-                    if (bIns->op == "*" || bIns->op == "&&")
+                    if (bIns->op == OP_MUL || bIns->op == OP_AND)
                         newVal = getNumberValue(0);
-                    else if (bIns->op == "+" || bIns->op == "||" || bIns->op == "-")
+                    else if (bIns->op == OP_ADD || bIns->op == OP_OR || bIns->op == OP_SUB)
                         newVal = bIns->lhs;
-                    else return;
+                    else return false;
                 } else if (rOpVal->number == 1) {
-                    if (bIns->op == "*" || bIns->op == "/")
+                    if (bIns->op == OP_MUL || bIns->op == OP_DIV)
                         newVal = bIns->lhs;
-                    else if (bIns->op == "%") newVal = getNumberValue(0);
-                    else return;
+                    else if (bIns->op == OP_MOD) newVal = getNumberValue(0);
+                    else return false;
                 } else if (rOpVal->number == -1) {
-                    if (bIns->op == "*") {
-                        newVal = make_shared<UnaryInstruction>(negOp, bIns->lhs, bIns->block);
-                        bIns->lhs->users.insert(newVal);
+                    if (bIns->op == OP_MUL) {
+                        newVal = newIr<UnaryInstruction>(OP_SUB, bIns->lhs, bIns->block);
                         maintainLeftValue(newVal, bIns->lhs);
                         insert = true;
-                    } else return;
-                } else return;
+                    } else return false;
+                } else return false;
             } else {
-                if ((bIns->op == "-" || bIns->op == "%") && bIns->lhs == bIns->rhs) {
+                if ((bIns->op == OP_SUB || bIns->op == OP_MOD) && bIns->lhs == bIns->rhs) {
                     newVal = getNumberValue(0);
-                } else if (bIns->op == "/" && bIns->lhs == bIns->rhs) {
+                } else if (bIns->op == OP_DIV && bIns->lhs == bIns->rhs) {
                     newVal = getNumberValue(1);
-                } else if (bIns->op == "-" && dynamic_cast<UnaryInstruction *>(bIns->rhs.get())) {
-                    if (s_p_c<UnaryInstruction>(bIns->rhs)->op == "-") {
-                        bIns->op = "+";
+                } else if (bIns->op == OP_SUB && dynamic_cast<UnaryInstruction *>(bIns->rhs.get())) {
+                    if (s_p_c<UnaryInstruction>(bIns->rhs)->op == OP_SUB) {
+                        bIns->op = OP_ADD;
                         shared_ptr<UnaryInstruction> unary = s_p_c<UnaryInstruction>(bIns->rhs);
-                        bIns->rhs = unary->value;
-                        unary->users.erase(bIns);
-                        bIns->rhs->users.insert(bIns);
-                        return;
-                    } else return;
-                } else if (bIns->op == "+" && dynamic_cast<UnaryInstruction *>(bIns->rhs.get())) {
-                    if (s_p_c<UnaryInstruction>(bIns->rhs)->op == "-") {
+                        bIns->rhsUse.set(unary->value);
+                        return true;
+                    } else return false;
+                } else if (bIns->op == OP_ADD && dynamic_cast<UnaryInstruction *>(bIns->rhs.get())) {
+                    if (s_p_c<UnaryInstruction>(bIns->rhs)->op == OP_SUB) {
                         shared_ptr<UnaryInstruction> unary = s_p_c<UnaryInstruction>(bIns->rhs);
                         if (unary->value == bIns->lhs) {
                             newVal = getNumberValue(0);
-                        } else return;
-                    } else return;
-                } else if (bIns->op == "+" && dynamic_cast<UnaryInstruction *>(bIns->lhs.get())) {
-                    if (s_p_c<UnaryInstruction>(bIns->lhs)->op == "-") {
+                        } else return false;
+                    } else return false;
+                } else if (bIns->op == OP_ADD && dynamic_cast<UnaryInstruction *>(bIns->lhs.get())) {
+                    if (s_p_c<UnaryInstruction>(bIns->lhs)->op == OP_SUB) {
                         shared_ptr<UnaryInstruction> unary = s_p_c<UnaryInstruction>(bIns->lhs);
                         if (unary->value == bIns->rhs) {
                             newVal = getNumberValue(0);
-                        } else return;
-                    } else return;
-                } else return;
+                        } else return false;
+                    } else return false;
+                } else return false;
             }
             break;
         }
         case InstructionType::UNARY: {
             shared_ptr<UnaryInstruction> uIns = s_p_c<UnaryInstruction>(ins);
-            if (uIns->op == "+") newVal = uIns->value;
+            if (uIns->op == OP_ADD) newVal = uIns->value;
             else if (uIns->value->valueType == ValueType::NUMBER) {
                 shared_ptr<NumberValue> value = s_p_c<NumberValue>(uIns->value);
-                if (uIns->op == "-") newVal = getNumberValue(-value->number);
-                else if (uIns->op == notOp) newVal = getNumberValue(!value->number);
+                if (uIns->op == OP_SUB) newVal = getNumberValue(-value->number);
+                else if (uIns->op == OP_NOT) newVal = getNumberValue(!value->number);
                 else {
-                    cerr << "Error occurs in process constant folding: undefined operator '" + uIns->op + "'." << endl;
-                    return;
+                    cerr << "Error occurs in process constant folding: undefined operator '"
+                            + string(irOpName(uIns->op)) + "'." << endl;
+                    return false;
                 }
             } else if (dynamic_cast<UnaryInstruction *>(uIns->value.get())) {
                 shared_ptr<UnaryInstruction> value = s_p_c<UnaryInstruction>(uIns->value);
-                if (uIns->op == "-" && value->op == "-") newVal = value->value;
-                else if (uIns->op == "!" && value->op == "!") newVal = value->value;
-                else if (uIns->op == "!") {
-                    newVal = make_shared<UnaryInstruction>(uIns->op, value->value, uIns->block);
-                } else return;
-            } else return;
+                if (uIns->op == OP_SUB && value->op == OP_SUB) newVal = value->value;
+                else if (uIns->op == OP_NOT && value->op == OP_NOT) newVal = value->value;
+                else if (uIns->op == OP_NOT) {
+                    newVal = newIr<UnaryInstruction>(uIns->op, value->value, uIns->block);
+                } else return false;
+            } else return false;
             break;
         }
         case InstructionType::LOAD: {
@@ -189,27 +177,29 @@ void fold(shared_ptr<Instruction> &ins) {
                 if (constArray->values.count(offsetNumber->number) != 0)
                     newVal = getNumberValue(constArray->values.at(offsetNumber->number));
                 else newVal = getNumberValue(0);
-            } else return;
+            } else return false;
             break;
         }
         case InstructionType::PHI: {
             shared_ptr<PhiInstruction> pIns = s_p_c<PhiInstruction>(ins);
             newVal = removeTrivialPhi(pIns);
-            if (newVal == pIns) return;
+            if (newVal == pIns) return false;
             break;
         }
         default:
-            return;
+            return false;
     }
     if (insert) {
         for (auto &it : ins->block->instructions) {
             if (it == ins) it = s_p_c<Instruction>(newVal);
         }
     }
-    unordered_set<shared_ptr<Value>> users = insVal->users;
-    for (auto &it : users) {
-        it->replaceUse(insVal, newVal);
+    // an r-value is read only once, so it becomes a left value when it takes the users of one.
+    if (newVal->valueType == ValueType::INSTRUCTION && s_p_c<Instruction>(newVal)->resultType == R_VAL_RESULT) {
+        maintainLeftValue(newVal, insVal);
     }
+    vector<shared_ptr<Value>> users = insVal->getUsers();
+    insVal->replaceAllUsesWith(newVal);
     insVal->abandonUse();
     for (auto &it : users) {
         if (it->valueType == ValueType::INSTRUCTION) {
@@ -217,16 +207,17 @@ void fold(shared_ptr<Instruction> &ins) {
             fold(itIns);
         }
     }
+    return true;
 }
 
-void constantFolding(shared_ptr<Module> &module) {
-    for (auto &func : module->functions) {
-        for (auto &bb : func->blocks) {
-            for (auto &ins : bb->instructions) {
-                if (!ins->users.empty())
-                    fold(ins);
-            }
-            removeUnusedInstructions(bb);
+bool constantFolding(shared_ptr<Function> &func) {
+    bool changed = false;
+    for (auto &bb : func->blocks) {
+        for (auto &ins : bb->instructions) {
+            if (!ins->hasNoUser() && fold(ins))
+                changed = true;
         }
+        if (removeUnusedInstructions(bb)) changed = true;
     }
+    return changed;
 }
@@ -1,8 +1,9 @@
 #include "ir_optimize.h"
 
-void deadArrayDelete(shared_ptr<Module> &module) {
+bool deadArrayDelete(shared_ptr<Module> &module) {
+    bool changed = false;
     for (auto glb = module->globalVariables.begin(); glb != module->globalVariables.end();) {
-        unordered_set<shared_ptr<Value>> users = (*glb)->users;
+        vector<shared_ptr<Value>> users = (*glb)->getUsers();
         for (auto &user : users) {
             if (!dynamic_cast<StoreInstruction *>(user.get())) {
                 goto GLOBAL_USER_STORE_JUDGE;
@@ -13,6 +14,7 @@ void deadArrayDelete(shared_ptr<Module> &module) {
         }
         (*glb)->abandonUse();
         glb = module->globalVariables.erase(glb);
+        changed = true;
         continue;
         GLOBAL_USER_STORE_JUDGE:
         ++glb;
@@ -20,23 +22,27 @@ void deadArrayDelete(shared_ptr<Module> &module) {
     for (auto &func : module->functions) {
         for (auto &bb : func->blocks) {
             for (auto &ins : bb->instructions) {
-                if (ins->type == InstructionType::ALLOC) {
+                if (ins->type == InstructionType::ALLOC && ins->valid) {
                     bool canDelete = true;
-                    for (auto &user : ins->users) {
-                        if (!dynamic_cast<StoreInstruction *>(user.get())) {
+                    for (auto &user : ins->getUsers()) {
+                        if (!dynamic_cast<StoreInstruction *>(user.get())
+                            && !dynamic_cast<MemsetInstruction *>(user.get())
+                            && !dynamic_cast<MemcpyInstruction *>(user.get())) {
                             canDelete = false;
                             break;
                         }
                     }
                     if (canDelete) {
                         ins->abandonUse();
-                        unordered_set<shared_ptr<Value>> users = ins->users;
+                        vector<shared_ptr<Value>> users = ins->getUsers();
                         for (auto &user : users) {
                             user->abandonUse();
                         }
+                        changed = true;
                     }
                 }
             }
         }
     }
+    return changed;
 }
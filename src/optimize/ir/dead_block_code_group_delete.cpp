@@ -4,10 +4,10 @@
 #include <ctime>
 
 time_t startDeadBlockCodeGroupDeleteTime;
-unsigned long DEAD_BLOCK_CODE_GROUP_DELETE_TIMEOUT = 10;
+unsigned long DEAD_BLOCK_CODE_GROUP_DELETE_TIMEOUT = 1;
 
 inline bool checkDeadBlockCodeGroupDeleteTimeout(time_t startTime, unsigned long timeout) {
-    return time(nullptr) - startTime > timeout / OPTIMIZE_TIMES;
+    return time(nullptr) - startTime > timeout;
 }
 
 bool judgeOnlyHasPhiUsers(const shared_ptr<Instruction> &ins) {
@@ -22,7 +22,7 @@ bool judgeOnlyHasPhiUsers(const shared_ptr<Instruction> &ins) {
             return false;
         shared_ptr<Value> top = visitQueue.front();
         visitQueue.pop();
-        for (auto &user : top->users) {
+        for (auto &user : top->getUsers()) {
             if (user->valueType != INSTRUCTION) {
                 cerr << "Error occurs in process remove unused instructions: user is not an instruction." << endl;
                 return false;
@@ -36,41 +36,41 @@ bool judgeOnlyHasPhiUsers(const shared_ptr<Instruction> &ins) {
             }
         }
     }
+    // every non-phi value in visit lives in the block of ins, so they are dropped in one pass over the block.
+    shared_ptr<BasicBlock> block = ins->block;
     for (auto &val : visit) {
         if (dynamic_cast<PhiInstruction *>(val.get())) {
             shared_ptr<PhiInstruction> phiVal = s_p_c<PhiInstruction>(val);
             phiVal->block->phis.erase(phiVal);
             phiVal->abandonUse();
         } else if (val->valueType == INSTRUCTION) {
-            shared_ptr<Instruction> insVal = s_p_c<Instruction>(val);
-            auto it = insVal->block->instructions.begin();
-            while (it != insVal->block->instructions.end()) {
-                if (*it == insVal) {
-                    insVal->abandonUse();
-                    insVal->block->instructions.erase(it);
-                    break;
-                }
-                ++it;
-            }
+            val->abandonUse();
         } else {
             cerr << "Error occurs in judge only phi users: non-instruction value." << endl;
         }
     }
+    for (auto it = block->instructions.begin(); it != block->instructions.end();) {
+        if (visit.count(*it) != 0) it = block->instructions.erase(it);
+        else ++it;
+    }
     return true;
 }
 
-void deadBlockCodeGroupDelete(shared_ptr<Module> &module) {
+bool deadBlockCodeGroupDelete(shared_ptr<Function> &func) {
     startDeadBlockCodeGroupDeleteTime = time(nullptr);
-    for (auto &func : module->functions) {
-        vector<shared_ptr<BasicBlock>> blocks = func->blocks;
-        JUDGE_PHI_ONLY_VALUE_START:
-        for (auto &bb : blocks) {
-            if (checkDeadBlockCodeGroupDeleteTimeout(startDeadBlockCodeGroupDeleteTime,
-                                                     DEAD_BLOCK_CODE_GROUP_DELETE_TIMEOUT))
-                return;
-            for (auto &ins : bb->instructions) {
-                if (judgeOnlyHasPhiUsers(ins)) goto JUDGE_PHI_ONLY_VALUE_START;
+    bool changed = false;
+    vector<shared_ptr<BasicBlock>> blocks = func->blocks;
+    JUDGE_PHI_ONLY_VALUE_START:
+    for (auto &bb : blocks) {
+        if (checkDeadBlockCodeGroupDeleteTimeout(startDeadBlockCodeGroupDeleteTime,
+                                                 DEAD_BLOCK_CODE_GROUP_DELETE_TIMEOUT))
+            return changed;
+        for (auto &ins : bb->instructions) {
+            if (judgeOnlyHasPhiUsers(ins)) {
+                changed = true;
+                goto JUDGE_PHI_ONLY_VALUE_START;
             }
         }
     }
+    return changed;
 }
@@ -1,60 +1,53 @@
 #include "ir_optimize.h"
 
-void deadCodeElimination(shared_ptr<Module> &module) {
-    removeUnusedFunctions(module);
-    countFunctionSideEffect(module);
-    for (auto var = module->globalStrings.begin(); var != module->globalStrings.end();) {
-        if ((*var)->users.empty()) {
-            var = module->globalConstants.erase(var);
-        } else {
-            auto it = (*var)->users.begin();
-            while (it != (*var)->users.end()) {
-                if ((*it)->valueType == ValueType::INSTRUCTION
-                    && (!s_p_c<Instruction>((*it))->block->valid
-                        || !s_p_c<Instruction>((*it))->block->function->valid)) {
-                    it = (*var)->users.erase(it);
-                } else ++it;
-            }
-            ++var;
-        }
-    }
-    for (auto var = module->globalVariables.begin(); var != module->globalVariables.end();) {
-        if ((*var)->users.empty()) {
-            var = module->globalVariables.erase(var);
-        } else {
-            auto it = (*var)->users.begin();
-            while (it != (*var)->users.end()) {
-                if ((*it)->valueType == ValueType::INSTRUCTION
-                    && (!s_p_c<Instruction>((*it))->block->valid
-                        || !s_p_c<Instruction>((*it))->block->function->valid)) {
-                    it = (*var)->users.erase(it);
-                } else ++it;
-            }
-            ++var;
-        }
-    }
-    for (auto var = module->globalConstants.begin(); var != module->globalConstants.end();) {
-        if ((*var)->users.empty()) {
-            var = module->globalConstants.erase(var);
+bool removeUnusedGlobals(vector<shared_ptr<Value>> &globals) {
+    bool changed = false;
+    for (auto var = globals.begin(); var != globals.end();) {
+        if ((*var)->hasNoUser()) {
+            var = globals.erase(var);
+            changed = true;
         } else {
-            auto it = (*var)->users.begin();
-            while (it != (*var)->users.end()) {
-                if ((*it)->valueType == ValueType::INSTRUCTION
-                    && (!s_p_c<Instruction>((*it))->block->valid
-                        || !s_p_c<Instruction>((*it))->block->function->valid)) {
-                    it = (*var)->users.erase(it);
-                } else ++it;
+            Use *use = (*var)->useHead;
+            while (use != nullptr) {
+                Use *next = use->next;
+                if (use->user->valueType == ValueType::INSTRUCTION
+                    && (!dynamic_cast<Instruction *>(use->user)->block->valid
+                        || !dynamic_cast<Instruction *>(use->user)->block->function->valid)) {
+                    use->unlink();
+                }
+                use = next;
             }
             ++var;
         }
     }
+    return changed;
+}
+
+bool deadCodeElimination(shared_ptr<Module> &module) {
+    bool changed = false;
+    while (removeUnusedFunctions(module)) changed = true;
+    countFunctionSideEffect(module);
+    if (removeUnusedGlobals(module->globalStrings)) changed = true;
+    if (removeUnusedGlobals(module->globalVariables)) changed = true;
+    if (removeUnusedGlobals(module->globalConstants)) changed = true;
     vector<shared_ptr<Function>> functions = module->functions;
     for (auto &func : functions) {
-        removeUnusedBasicBlocks(func);
+        if (deadCodeElimination(func)) changed = true;
+    }
+    return changed;
+}
+
+bool deadCodeElimination(shared_ptr<Function> &func) {
+    bool changed = false;
+    bool removed;
+    do {
+        removed = removeUnusedBasicBlocks(func);
         vector<shared_ptr<BasicBlock>> blocks = func->blocks;
         for (auto &bb : blocks) {
-            removeUnusedInstructions(bb);
+            if (removeUnusedInstructions(bb)) removed = true;
         }
-    }
-    fixRightValue(module);
+        if (removed) changed = true;
+    } while (removed);
+    fixRightValue(func);
+    return changed;
 }
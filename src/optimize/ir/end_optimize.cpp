@@ -1,4 +1,6 @@
 #include "ir_optimize.h"
+#include "../../basic/report/pass_report.h"
+#include "../../basic/parallel/parallel_for.h"
 
 #include <set>
 #include <stack>
@@ -6,9 +8,22 @@
 void outputRegisterAllocResult(const shared_ptr<Module> &module);
 
 void endOptimize(shared_ptr<Module> &module, OptimizeLevel level) {
+    if (level >= O2) {
+        for (auto &func : module->functions) {
+            PassRecorder recorder(PASS_RECORD, "Loop Vectorization", [&]() { return countInstructions(func); });
+            loopVectorization(func);
+        }
+    }
     for (auto &func : module->functions) {
+        PassRecorder recorder(PASS_RECORD, "Phi Elimination", [&]() { return countInstructions(func); });
         phiElimination(func);
     }
+    if (level >= O2) {
+        for (auto &func : module->functions) {
+            PassRecorder recorder(PASS_RECORD, "Split Live Ranges", [&]() { return countInstructions(func); });
+            splitLiveRanges(func);
+        }
+    }
     if (_debugIr) {
         ofstream irStream;
         irStream.open(debugMessageDirectory + "ir_final.txt", ios::out | ios::trunc);
@@ -21,14 +36,20 @@ void endOptimize(shared_ptr<Module> &module, OptimizeLevel level) {
         irStream << "[Conflict Graph]" << endl;
         irStream.close();
     }
-    for (auto &func : module->functions) {
+    // phi elimination and live range splitting create IR and take value ids, so only the rest runs on the thread pool.
+    parallelFor(module->functions.size(), [&](size_t i) {
+        shared_ptr<Function> &func = module->functions.at(i);
         if (level >= O2) {
-            calculateVariableWeight(func);
+            {
+                PassRecorder recorder(PASS_RECORD, "Calculate Variable Weight");
+                calculateVariableWeight(func);
+            }
+            PassRecorder recorder(PASS_RECORD, "Register Alloc", [&]() { return countInstructions(func); });
             registerAlloc(func);
         }
         getFunctionRequiredStackSize(func);
         mergeAliveValuesToInstruction(func);
-    }
+    });
     if (_debugIrOptimize) {
         outputRegisterAllocResult(module);
     }
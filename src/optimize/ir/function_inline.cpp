@@ -22,7 +22,8 @@ shared_ptr<Value> findValueInMap(shared_ptr<Value> &value,
 shared_ptr<BasicBlock> findBlockInMap(shared_ptr<BasicBlock> &bb,
                                       unordered_map<shared_ptr<BasicBlock>, shared_ptr<BasicBlock>> &copyBlockMap);
 
-void functionInline(shared_ptr<Module> &module) {
+bool functionInline(shared_ptr<Module> &module) {
+    bool changed = false;
     START_INLINE:
     auto it = module->functions.end() - 1;
     do {
@@ -30,10 +31,12 @@ void functionInline(shared_ptr<Module> &module) {
             && (*it)->fitInline(MAX_INLINE_INSTRUCTION_CNT, MAX_INLINE_WITH_POINTER_ARGUMENT)) {
             inlineTargetFunction(*it);
             deadCodeElimination(module);
+            changed = true;
             goto START_INLINE;
         }
         --it;
     } while (it != module->functions.begin() - 1);
+    return changed;
 }
 
 void inlineTargetFunction(shared_ptr<Function> &func) {
@@ -42,12 +45,13 @@ void inlineTargetFunction(shared_ptr<Function> &func) {
         QUERY_BLOCK_LABEL:
         vector<shared_ptr<BasicBlock>> blocks = caller->blocks;
         for (auto bb : blocks) {
-            vector<shared_ptr<Instruction>> instructions = bb->instructions;
+            list<shared_ptr<Instruction>> instructions = bb->instructions;
             for (auto &ins : instructions) {
                 if (ins->type == InstructionType::INVOKE) {
                     shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(ins);
                     if (invoke->targetFunction == func) {
                         replaceInvoke(caller, bb, invoke, func);
+                        invalidateFunctionAnalysis(caller);
                         goto QUERY_BLOCK_LABEL;
                     }
                 }
@@ -70,13 +74,13 @@ void replaceInvoke(shared_ptr<Function> &callerFunc, shared_ptr<BasicBlock> &cal
     unordered_map<shared_ptr<Value>, shared_ptr<Value>> funcInlineVarMap; // var in callee <--> var in caller
     unordered_map<shared_ptr<BasicBlock>, shared_ptr<BasicBlock>> funcInlineBlockMap; // bb in callee <--> bb in caller
     vector<shared_ptr<BasicBlock>> inlineBlocks;
-    shared_ptr<BasicBlock> endBlock = make_shared<BasicBlock>(callerFunc, true, callerBlock->loopDepth);
+    shared_ptr<BasicBlock> endBlock = newIr<BasicBlock>(callerFunc, true, callerBlock->loopDepth);
     shared_ptr<PhiInstruction> endPhi;
     if (invoke->resultType == L_VAL_RESULT) {
-        endPhi = make_shared<PhiInstruction>(invoke->caughtVarName, endBlock);
+        endPhi = newIr<PhiInstruction>(invoke->caughtVarName, endBlock);
         endPhi->resultType = L_VAL_RESULT;
     } else {
-        endPhi = make_shared<PhiInstruction>(localVarName, endBlock);
+        endPhi = newIr<PhiInstruction>(localVarName, endBlock);
     }
     for (int i = 0; i < invoke->params.size(); ++i) {
         funcInlineVarMap[toBeInline->params.at(i)] = invoke->params.at(i);
@@ -90,12 +94,12 @@ void replaceInvoke(shared_ptr<Function> &callerFunc, shared_ptr<BasicBlock> &cal
     vector<shared_ptr<BasicBlock>> toBeInlineBlocks = toBeInline->blocks;
     for (auto &it : toBeInlineBlocks) {
         shared_ptr<BasicBlock> tempBlock
-                = make_shared<BasicBlock>(callerFunc, true, it->loopDepth + callerBlock->loopDepth);
+                = newIr<BasicBlock>(callerFunc, true, it->loopDepth + callerBlock->loopDepth);
         inlineBlocks.push_back(tempBlock);
         funcInlineBlockMap[it] = tempBlock;
         unordered_set<shared_ptr<PhiInstruction>> phis = it->phis;
         for (auto &phi : phis) {
-            shared_ptr<PhiInstruction> tempPhi = make_shared<PhiInstruction>(phi->localVarName, tempBlock);
+            shared_ptr<PhiInstruction> tempPhi = newIr<PhiInstruction>(phi->localVarName, tempBlock);
             funcInlineVarMap[phi] = tempPhi;
             tempBlock->phis.insert(tempPhi);
         }
@@ -114,31 +118,25 @@ void replaceInvoke(shared_ptr<Function> &callerFunc, shared_ptr<BasicBlock> &cal
             for (auto &it : ops) {
                 if (it.first == callerBlock) {
                     shared_ptr<Value> val = it.second;
-                    phi->operands.erase(callerBlock);
-                    phi->operands[endBlock] = val;
+                    phi->removeOperand(callerBlock);
+                    phi->setOperand(endBlock, val);
                 }
             }
         }
     }
     // if return int replace all invoke with end phi.
-    unordered_set<shared_ptr<Value>> invokeUsers = invoke->users;
     if (toBeInline->funcType == FuncType::FUNC_INT) {
-        for (auto &user : invokeUsers) {
-            shared_ptr<Value> invokeVal = invoke;
-            shared_ptr<Value> endPhiVal = endPhi;
-            user->replaceUse(invokeVal, endPhiVal);
-        }
+        invoke->replaceAllUsesWith(endPhi);
     }
     // automatically abandon invoke, because marking some IR members invalid is dangerous.
-    vector<shared_ptr<Value>> invokeParams = invoke->params;
-    for (auto &arg : invokeParams) {
-        arg->users.erase(invoke);
+    for (int i = 0; i < invoke->params.size(); ++i) {
+        invoke->paramUses[i].unlink();
     }
     invoke->valid = false;
     // put new instruction into map.
     toBeInlineBlocks = toBeInline->blocks;
     for (auto &it : toBeInlineBlocks) {
-        vector<shared_ptr<Instruction>> instructions = it->instructions;
+        list<shared_ptr<Instruction>> instructions = it->instructions;
         for (auto &ins : instructions) {
             shared_ptr<Instruction> newIns = copyInstruction(ins, endPhi, funcInlineBlockMap.at(it), endBlock,
                                                              funcInlineBlockMap, funcInlineVarMap);
@@ -161,22 +159,9 @@ void replaceInvoke(shared_ptr<Function> &callerFunc, shared_ptr<BasicBlock> &cal
             for (auto &op : operands) {
                 shared_ptr<BasicBlock> opBb = op.first;
                 shared_ptr<Value> opVal = op.second;
-                newPhi->operands[findBlockInMap(opBb, funcInlineBlockMap)]
-                        = findValueInMap(opVal, funcInlineVarMap);
-                addUser(newPhi, {findValueInMap(opVal, funcInlineVarMap)});
-            }
-            unordered_set<shared_ptr<Value>> users = phi->users;
-            for (auto user : users) {
-                if (user->valueType == ValueType::INSTRUCTION) {
-                    if (dynamic_cast<ReturnInstruction *>(user.get())
-                        && s_p_c<ReturnInstruction>(user)->funcType != FuncType::FUNC_INT)
-                        continue;
-                    shared_ptr<Value> newVal = findValueInMap(user, funcInlineVarMap);
-                    newPhi->users.insert(newVal);
-                } else {
-                    cerr << "Error occurs in process copy instrucion: phi's user has other type." << endl;
-                }
+                newPhi->setOperand(findBlockInMap(opBb, funcInlineBlockMap), findValueInMap(opVal, funcInlineVarMap));
             }
+            // the copied users of phi have been linked to new phi when they are created.
         }
     }
     // update predecessors and successors.
@@ -196,8 +181,9 @@ void replaceInvoke(shared_ptr<Function> &callerFunc, shared_ptr<BasicBlock> &cal
     // split basic block.
     for (auto it = callerBlock->instructions.begin(); it != callerBlock->instructions.end(); ++it) {
         if (*it == invoke) {
-            endBlock->instructions = vector(it + 1, callerBlock->instructions.end());
-            callerBlock->instructions.erase(it, callerBlock->instructions.end());
+            endBlock->instructions.splice(endBlock->instructions.end(), callerBlock->instructions, next(it),
+                                          callerBlock->instructions.end());
+            callerBlock->instructions.erase(it);
             for (auto &ins : endBlock->instructions) {
                 ins->block = endBlock;
             }
@@ -217,7 +203,7 @@ void replaceInvoke(shared_ptr<Function> &callerFunc, shared_ptr<BasicBlock> &cal
         removeTrivialPhi(endPhi);
     }
     shared_ptr<BasicBlock> callerBlockTargetBlock = findBlockInMap(toBeInline->entryBlock, funcInlineBlockMap);
-    shared_ptr<Instruction> jumpIns = make_shared<JumpInstruction>(callerBlockTargetBlock, callerBlock);
+    shared_ptr<Instruction> jumpIns = newIr<JumpInstruction>(callerBlockTargetBlock, callerBlock);
     callerBlock->instructions.push_back(jumpIns);
     // remove trivial phis.
     for (auto &it : inlineBlocks) {
@@ -237,7 +223,7 @@ copyInstruction(shared_ptr<Instruction> &toBeCopied, shared_ptr<PhiInstruction>
     switch (toBeCopied->type) {
         case InstructionType::ALLOC: {
             shared_ptr<AllocInstruction> alloc = s_p_c<AllocInstruction>(toBeCopied);
-            ret = make_shared<AllocInstruction>(alloc->name, alloc->bytes, alloc->units, newBlock);
+            ret = newIr<AllocInstruction>(alloc->name, alloc->bytes, alloc->units, newBlock);
             break;
         }
         case InstructionType::INVOKE: {
@@ -247,17 +233,16 @@ copyInstruction(shared_ptr<Instruction> &toBeCopied, shared_ptr<PhiInstruction>
                 newParams.push_back(findValueInMap(it, copyVarMap));
             }
             if (invoke->invokeType == COMMON) {
-                ret = make_shared<InvokeInstruction>(invoke->targetFunction, newParams, newBlock);
+                ret = newIr<InvokeInstruction>(invoke->targetFunction, newParams, newBlock);
             } else {
-                ret = make_shared<InvokeInstruction>(invoke->targetName, newParams, newBlock);
+                ret = newIr<InvokeInstruction>(invoke->targetName, newParams, newBlock);
             }
-            addUser(ret, newParams);
             break;
         }
         case InstructionType::JMP: {
             shared_ptr<JumpInstruction> jump = s_p_c<JumpInstruction>(toBeCopied);
             shared_ptr<BasicBlock> targetBlock = findBlockInMap(jump->targetBlock, copyBlockMap);
-            ret = make_shared<JumpInstruction>(targetBlock, newBlock);
+            ret = newIr<JumpInstruction>(targetBlock, newBlock);
             break;
         }
         case InstructionType::BR: {
@@ -265,8 +250,7 @@ copyInstruction(shared_ptr<Instruction> &toBeCopied, shared_ptr<PhiInstruction>
             shared_ptr<Value> cond = findValueInMap(br->condition, copyVarMap);
             shared_ptr<BasicBlock> trueBlock = findBlockInMap(br->trueBlock, copyBlockMap);
             shared_ptr<BasicBlock> falseBlock = findBlockInMap(br->falseBlock, copyBlockMap);
-            ret = make_shared<BranchInstruction>(cond, trueBlock, falseBlock, newBlock);
-            addUser(ret, {cond});
+            ret = newIr<BranchInstruction>(cond, trueBlock, falseBlock, newBlock);
             break;
         }
         case InstructionType::STORE: {
@@ -274,8 +258,21 @@ copyInstruction(shared_ptr<Instruction> &toBeCopied, shared_ptr<PhiInstruction>
             shared_ptr<Value> val = findValueInMap(store->value, copyVarMap);
             shared_ptr<Value> add = findValueInMap(store->address, copyVarMap);
             shared_ptr<Value> off = findValueInMap(store->offset, copyVarMap);
-            ret = make_shared<StoreInstruction>(val, add, off, newBlock);
-            addUser(ret, {val, add, off});
+            ret = newIr<StoreInstruction>(val, add, off, newBlock);
+            break;
+        }
+        case InstructionType::MEMSET: {
+            shared_ptr<MemsetInstruction> memsetIns = s_p_c<MemsetInstruction>(toBeCopied);
+            shared_ptr<Value> val = findValueInMap(memsetIns->value, copyVarMap);
+            shared_ptr<Value> add = findValueInMap(memsetIns->address, copyVarMap);
+            ret = newIr<MemsetInstruction>(val, add, memsetIns->units, newBlock);
+            break;
+        }
+        case InstructionType::MEMCPY: {
+            shared_ptr<MemcpyInstruction> memcpyIns = s_p_c<MemcpyInstruction>(toBeCopied);
+            shared_ptr<Value> src = findValueInMap(memcpyIns->source, copyVarMap);
+            shared_ptr<Value> add = findValueInMap(memcpyIns->address, copyVarMap);
+            ret = newIr<MemcpyInstruction>(src, add, memcpyIns->units, newBlock);
             break;
         }
         case InstructionType::RET: {
@@ -285,30 +282,27 @@ copyInstruction(shared_ptr<Instruction> &toBeCopied, shared_ptr<PhiInstruction>
             returnBlock->successors.insert(endBlock);
             if (retIns->funcType == FuncType::FUNC_INT) {
                 shared_ptr<Value> retVal = findValueInMap(retIns->value, copyVarMap);
-                endPhi->operands[returnBlock] = retVal;
+                endPhi->setOperand(returnBlock, retVal);
                 if (retVal->valueType == ValueType::INSTRUCTION
                     && s_p_c<Instruction>(retVal)->resultType != L_VAL_RESULT) {
                     s_p_c<Instruction>(retVal)->resultType = L_VAL_RESULT;
                     s_p_c<Instruction>(retVal)->caughtVarName = generatePhiLeftValueName(endPhi->caughtVarName);
                 }
-                addUser(endPhi, {retVal});
             }
-            ret = make_shared<JumpInstruction>(endBlock, newBlock);
+            ret = newIr<JumpInstruction>(endBlock, newBlock);
             break;
         }
         case InstructionType::LOAD: {
             shared_ptr<LoadInstruction> load = s_p_c<LoadInstruction>(toBeCopied);
             shared_ptr<Value> add = findValueInMap(load->address, copyVarMap);
             shared_ptr<Value> off = findValueInMap(load->offset, copyVarMap);
-            ret = make_shared<LoadInstruction>(add, off, newBlock);
-            addUser(ret, {add, off});
+            ret = newIr<LoadInstruction>(add, off, newBlock);
             break;
         }
         case InstructionType::UNARY: {
             shared_ptr<UnaryInstruction> unary = s_p_c<UnaryInstruction>(toBeCopied);
             shared_ptr<Value> val = findValueInMap(unary->value, copyVarMap);
-            ret = make_shared<UnaryInstruction>(unary->op, val, newBlock);
-            addUser(ret, {val});
+            ret = newIr<UnaryInstruction>(unary->op, val, newBlock);
             break;
         }
         case InstructionType::CMP:
@@ -316,8 +310,7 @@ copyInstruction(shared_ptr<Instruction> &toBeCopied, shared_ptr<PhiInstruction>
             shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(toBeCopied);
             shared_ptr<Value> lhs = findValueInMap(binary->lhs, copyVarMap);
             shared_ptr<Value> rhs = findValueInMap(binary->rhs, copyVarMap);
-            ret = make_shared<BinaryInstruction>(binary->op, lhs, rhs, newBlock);
-            addUser(ret, {lhs, rhs});
+            ret = newIr<BinaryInstruction>(binary->op, lhs, rhs, newBlock);
             break;
         }
         default:;
@@ -0,0 +1,222 @@
+#include "ir_optimize.h"
+
+#include <functional>
+#include <algorithm>
+
+// the values numbered so far in the dominator tree, with the keys to pop when leaving a block.
+struct ValueTable {
+    unordered_map<unsigned long long, vector<shared_ptr<Instruction>>> values;
+
+    shared_ptr<Instruction> find(unsigned long long key, const function<bool(shared_ptr<Instruction> &)> &same) {
+        if (values.count(key) == 0) return nullptr;
+        for (auto &value : values.at(key)) {
+            if (same(value)) return value;
+        }
+        return nullptr;
+    }
+
+    void insert(unsigned long long key, shared_ptr<Instruction> &ins, vector<unsigned long long> &scope) {
+        values[key].push_back(ins);
+        scope.push_back(key);
+    }
+
+    void pop(vector<unsigned long long> &scope) {
+        for (auto it = scope.rbegin(); it != scope.rend(); ++it) {
+            values.at(*it).pop_back();
+            if (values.at(*it).empty()) values.erase(*it);
+        }
+    }
+};
+
+bool isAlloc(const shared_ptr<Value> &value) {
+    return value->valueType == INSTRUCTION && s_p_c<Instruction>(value)->type == ALLOC;
+}
+
+/**
+ * The array an address points into, an address computed by adding an offset to an array is followed.
+ * Returns nullptr if it is not known.
+ */
+shared_ptr<Value> arrayBase(const shared_ptr<Value> &address) {
+    if (address->valueType == GLOBAL || address->valueType == CONSTANT || address->valueType == PARAMETER
+        || isAlloc(address)) {
+        return address;
+    }
+    if (address->valueType == INSTRUCTION && s_p_c<Instruction>(address)->type == BINARY) {
+        shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(address);
+        if (binary->op != OP_ADD) return nullptr;
+        shared_ptr<Value> base = arrayBase(binary->lhs);
+        return base != nullptr ? base : arrayBase(binary->rhs);
+    }
+    return nullptr;
+}
+
+/**
+ * The memory writes of a function, to find the arrays which it never writes.
+ * A write through a parameter or a computed address may reach any array but the local ones,
+ * and the local arrays only change by direct writes or by being passed to a call.
+ */
+struct MemoryWrites {
+    unordered_set<shared_ptr<Value>> arrays;
+    bool unknown = false;
+
+    void write(shared_ptr<Value> &address) {
+        shared_ptr<Value> base = arrayBase(address);
+        if (base != nullptr && (base->valueType == GLOBAL || isAlloc(base))) {
+            arrays.insert(base);
+        } else {
+            unknown = true;
+        }
+    }
+
+    bool readOnly(shared_ptr<Value> &address) {
+        shared_ptr<Value> base = arrayBase(address);
+        if (base == nullptr) return false;
+        if (base->valueType == CONSTANT) return true;
+        if (isAlloc(base)) return arrays.count(base) == 0;
+        if (unknown) return false;
+        if (base->valueType == GLOBAL) return arrays.count(base) == 0;
+        for (auto &array : arrays) {
+            if (array->valueType == GLOBAL) return false;
+        }
+        return true;
+    }
+};
+
+MemoryWrites collectMemoryWrites(shared_ptr<Function> &func) {
+    MemoryWrites writes;
+    for (auto &bb : func->blocks) {
+        for (auto &ins : bb->instructions) {
+            if (ins->type == STORE) {
+                writes.write(s_p_c<StoreInstruction>(ins)->address);
+            } else if (ins->type == MEMSET) {
+                writes.write(s_p_c<MemsetInstruction>(ins)->address);
+            } else if (ins->type == MEMCPY) {
+                writes.write(s_p_c<MemcpyInstruction>(ins)->address);
+            } else if (ins->type == INVOKE) {
+                shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(ins);
+                if (invoke->invokeType == GET_ARRAY
+                    || (invoke->targetFunction != nullptr && invoke->targetFunction->hasSideEffect)) {
+                    writes.unknown = true;
+                }
+                for (auto &param : invoke->params) {
+                    shared_ptr<Value> base = arrayBase(param);
+                    if (base != nullptr && isAlloc(base)) writes.arrays.insert(base);
+                }
+            }
+        }
+    }
+    return writes;
+}
+
+bool writesMemory(shared_ptr<Instruction> &ins) {
+    if (ins->type == STORE || ins->type == MEMSET || ins->type == MEMCPY) return true;
+    if (ins->type != INVOKE) return false;
+    shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(ins);
+    if (invoke->invokeType == GET_ARRAY
+        || (invoke->targetFunction != nullptr && invoke->targetFunction->hasSideEffect)) {
+        return true;
+    }
+    return any_of(invoke->params.begin(), invoke->params.end(), [](shared_ptr<Value> &param) {
+        shared_ptr<Value> base = arrayBase(param);
+        return base != nullptr && isAlloc(base);
+    });
+}
+
+unsigned long long loadHashCode(shared_ptr<LoadInstruction> &load) {
+    return ((unsigned long long) load->address->id << 24) ^ load->offset->operandHash();
+}
+
+bool sameLoad(shared_ptr<LoadInstruction> &load, shared_ptr<Instruction> &ins) {
+    shared_ptr<LoadInstruction> other = s_p_c<LoadInstruction>(ins);
+    return other->address == load->address && other->offset->equals(load->offset);
+}
+
+/**
+ * Global value numbering over the dominator tree.
+ * A unary or binary instruction, or a load, is replaced by an equal one in a dominating block,
+ * found by hashCode and equals.
+ * Loads of the arrays which the function never writes are numbered across blocks,
+ * the other loads only inside a block until the next memory write.
+ */
+bool globalValueNumbering(shared_ptr<Function> &func) {
+    bool changed = false;
+    FunctionAnalysis &analysis = getFunctionAnalysis(func);
+    MemoryWrites writes = collectMemoryWrites(func);
+    ValueTable expressions;
+    ValueTable readOnlyLoads;
+
+    auto replace = [&](shared_ptr<Instruction> &ins, shared_ptr<Instruction> &same) {
+        if (same->resultType == R_VAL_RESULT) {
+            same->resultType = L_VAL_RESULT;
+            same->caughtVarName = generateTempLeftValueName();
+        }
+        shared_ptr<Value> sameValue = same;
+        ins->replaceAllUsesWith(sameValue);
+        ins->abandonUse();
+        changed = true;
+    };
+
+    // the blocks in dominator tree preorder, each with its scope which is popped after its children.
+    vector<pair<shared_ptr<BasicBlock>, bool>> worklist = {{func->entryBlock, false}};
+    vector<vector<unsigned long long>> expressionScopes;
+    vector<vector<unsigned long long>> loadScopes;
+    while (!worklist.empty()) {
+        shared_ptr<BasicBlock> bb = worklist.back().first;
+        bool leaving = worklist.back().second;
+        worklist.pop_back();
+        if (leaving) {
+            expressions.pop(expressionScopes.back());
+            readOnlyLoads.pop(loadScopes.back());
+            expressionScopes.pop_back();
+            loadScopes.pop_back();
+            continue;
+        }
+        worklist.emplace_back(bb, true);
+        expressionScopes.emplace_back();
+        loadScopes.emplace_back();
+
+        ValueTable blockLoads;
+        vector<unsigned long long> blockLoadScope;
+        for (auto it = bb->instructions.begin(); it != bb->instructions.end();) {
+            shared_ptr<Instruction> ins = *it;
+            if (ins->type == BINARY || ins->type == UNARY) {
+                unsigned long long hashCode = ins->hashCode();
+                shared_ptr<Instruction> same = expressions.find(hashCode, [&](shared_ptr<Instruction> &value) {
+                    shared_ptr<Value> other = value;
+                    return ins->equals(other);
+                });
+                if (same != nullptr) {
+                    replace(ins, same);
+                    it = bb->instructions.erase(it);
+                    continue;
+                }
+                expressions.insert(hashCode, ins, expressionScopes.back());
+            } else if (ins->type == LOAD) {
+                shared_ptr<LoadInstruction> load = s_p_c<LoadInstruction>(ins);
+                bool readOnly = writes.readOnly(load->address);
+                ValueTable &loads = readOnly ? readOnlyLoads : blockLoads;
+                vector<unsigned long long> &scope = readOnly ? loadScopes.back() : blockLoadScope;
+                unsigned long long hashCode = loadHashCode(load);
+                shared_ptr<Instruction> same = loads.find(hashCode, [&](shared_ptr<Instruction> &value) {
+                    return sameLoad(load, value);
+                });
+                if (same != nullptr) {
+                    replace(ins, same);
+                    it = bb->instructions.erase(it);
+                    continue;
+                }
+                loads.insert(hashCode, ins, scope);
+            } else if (writesMemory(ins)) {
+                blockLoads.values.clear();
+                blockLoadScope.clear();
+            }
+            ++it;
+        }
+
+        const vector<shared_ptr<BasicBlock>> &children = analysis.getDominatorChildren(bb);
+        for (auto child = children.rbegin(); child != children.rend(); ++child) {
+            worklist.emplace_back(*child, false);
+        }
+    }
+    return changed;
+}
@@ -1,104 +1,163 @@
 #include "ir_optimize.h"
 #include "../../basic/std/compile_std.h"
+#include "../../basic/report/pass_report.h"
 
-// lazy to check if the IR changed after a pass.
-const unsigned int OPTIMIZE_TIMES = 10;
+#include <deque>
+
+// stop iterating even if the IR is still changing.
+const unsigned int MAX_OPTIMIZE_ROUNDS = 32;
+// max times a function runs the function passes in one round.
+const unsigned int MAX_FUNCTION_VISIT_TIMES = 8;
 
 extern bool needIrCheck;
 extern bool needIrPassCheck;
 
-void optimizeIr(shared_ptr<Module> &module, OptimizeLevel level) {
-    for (int i = 0; i < OPTIMIZE_TIMES; ++i)
-        deadCodeElimination(module);
-
-    for (int i = 0; i < OPTIMIZE_TIMES; ++i) {
-        globalIrCorrect = true;
-        if (level >= O1) {
-            readOnlyVariableToConstant(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Non-write variable to constant." << endl;
-        }
-
-        if (level >= O1) {
-            constantFolding(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Constant Folding." << endl;
-        }
-
-        if (level >= O3) {
-            localArrayFolding(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Local Array Folding." << endl;
-        }
-
-        if (level >= O3) {
-            deadArrayDelete(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Dead Array Delete." << endl;
-        }
+// preserved is the mask of analyses still valid after the pass changed the IR.
+struct ModulePass {
+    string name;
+    OptimizeLevel level;
+    bool (*run)(shared_ptr<Module> &);
+    unsigned int preserved;
+};
+
+struct FunctionPass {
+    string name;
+    OptimizeLevel level;
+    bool (*run)(shared_ptr<Function> &);
+    unsigned int preserved;
+};
+
+// module passes before and after the function passes in each round.
+const vector<ModulePass> preFunctionPasses{ // NOLINT
+        {"Non-write variable to constant", O1, readOnlyVariableToConstant, ANALYSIS_ALL}
+};
+
+const vector<FunctionPass> functionPasses{ // NOLINT
+        {"Sparse Conditional Constant Propagation", O1, sparseConditionalConstantPropagation, ANALYSIS_NONE},
+        {"Constant Folding",                        O1, constantFolding,                      ANALYSIS_ALL},
+        {"Tail Recursion Elimination",              O2, tailRecursionElimination,             ANALYSIS_NONE},
+        {"Local Array Folding",                     O3, localArrayFolding,                    ANALYSIS_ALL},
+        {"Dead Block Code Group Delete",            O2, deadBlockCodeGroupDelete,             ANALYSIS_ALL},
+        {"Loop Invariant Code Motion",              O1, loopInvariantCodeMotion,              ANALYSIS_NONE},
+        {"Global Value Numbering",                  O1, globalValueNumbering,                 ANALYSIS_ALL},
+        {"Loop Unrolling",                          O2, loopUnrolling,                        ANALYSIS_NONE},
+        {"Loop Strength Reduction",                 O2, loopStrengthReduction,                ANALYSIS_ALL},
+        {"Block Combination",                       O1, blockCombination,                     ANALYSIS_NONE}
+};
+
+const vector<ModulePass> postFunctionPasses{ // NOLINT
+        {"Dead Array Delete",   O3, deadArrayDelete,   ANALYSIS_ALL},
+        {"Array External Lift", O3, arrayExternalLift, ANALYSIS_ALL},
+        {"Function Inline",     O2, functionInline,    ANALYSIS_NONE}
+};
+
+bool recordDeadCodeElimination(shared_ptr<Module> &module) {
+    PassRecorder recorder(PASS_RECORD, "Dead Code Elimination", [&]() { return countInstructions(module); });
+    return deadCodeElimination(module);
+}
 
-        if (level >= O3) {
-            arrayExternalLift(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Array External Lift." << endl;
-        }
+bool recordDeadCodeElimination(shared_ptr<Function> &func) {
+    PassRecorder recorder(PASS_RECORD, "Dead Code Elimination", [&]() { return countInstructions(func); });
+    return deadCodeElimination(func);
+}
 
-        if (level >= O2) {
-            deadBlockCodeGroupDelete(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Dead Block Code Group Delete." << endl;
+bool runModulePasses(shared_ptr<Module> &module, const vector<ModulePass> &passes, OptimizeLevel level) {
+    bool changed = false;
+    for (auto &pass : passes) {
+        if (level < pass.level) continue;
+        bool passChanged;
+        {
+            PassRecorder recorder(PASS_RECORD, pass.name, [&]() { return countInstructions(module); });
+            passChanged = pass.run(module);
         }
+        if (!passChanged) continue;
+        changed = true;
+        invalidateModuleAnalysis(module, pass.preserved);
+        recordDeadCodeElimination(module);
+        if (needIrPassCheck && !irCheck(module)) cerr << "Error: " << pass.name << "." << endl;
+    }
+    return changed;
+}
 
-        if (level >= O1) {
-            loopInvariantCodeMotion(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Loop Invariant Code Motion." << endl;
+bool runFunctionPasses(shared_ptr<Module> &module, shared_ptr<Function> &func, OptimizeLevel level) {
+    bool changed = false;
+    for (auto &pass : functionPasses) {
+        if (level < pass.level) continue;
+        bool passChanged;
+        {
+            PassRecorder recorder(PASS_RECORD, pass.name, [&]() { return countInstructions(func); });
+            passChanged = pass.run(func);
         }
+        if (!passChanged) continue;
+        changed = true;
+        invalidateFunctionAnalysis(func, pass.preserved);
+        recordDeadCodeElimination(func);
+        if (needIrPassCheck && !irCheck(module)) cerr << "Error: " << pass.name << "." << endl;
+    }
+    return changed;
+}
 
-        if (level >= O1) {
-            localCommonSubexpressionElimination(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module))
-                cerr << "Error: Local Common "
-                        "Subexpression Elimination." << endl;
+void optimizeIr(shared_ptr<Module> &module, OptimizeLevel level) {
+    recordDeadCodeElimination(module);
+
+    // functions in the worklist are dirty and need to run the function passes again.
+    deque<shared_ptr<Function>> worklist;
+    unordered_set<shared_ptr<Function>> dirty;
+    auto markAllDirty = [&]() {
+        for (auto &func : module->functions) {
+            if (dirty.insert(func).second) worklist.push_back(func);
         }
+    };
+    markAllDirty();
 
-        if (level >= O1) {
-            constantBranchConversion(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Constant Branch Conversion." << endl;
+    bool changed = true;
+    for (unsigned int round = 1; changed && round <= MAX_OPTIMIZE_ROUNDS; ++round) {
+        changed = false;
+        globalIrCorrect = true;
+        if (runModulePasses(module, preFunctionPasses, level)) {
+            changed = true;
+            markAllDirty();
         }
 
-        if (level >= O1) {
-            blockCombination(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Block Combination." << endl;
+        unordered_map<shared_ptr<Function>, unsigned int> visitTimes;
+        deque<shared_ptr<Function>> nextWorklist;
+        while (!worklist.empty()) {
+            shared_ptr<Function> func = worklist.front();
+            worklist.pop_front();
+            if (!func->valid) {
+                dirty.erase(func);
+                continue;
+            }
+            if (runFunctionPasses(module, func, level)) {
+                changed = true;
+                if (++visitTimes[func] < MAX_FUNCTION_VISIT_TIMES) worklist.push_back(func);
+                else nextWorklist.push_back(func);
+            } else {
+                dirty.erase(func);
+            }
         }
+        worklist = nextWorklist;
 
-        if (level >= O2) {
-            functionInline(module);
-            deadCodeElimination(module);
-            if (needIrPassCheck && !irCheck(module)) cerr << "Error: Function Inline." << endl;
+        if (runModulePasses(module, postFunctionPasses, level) || recordDeadCodeElimination(module)) {
+            changed = true;
+            markAllDirty();
         }
 
         if (_debugIrOptimize) {
             const string fileName = debugMessageDirectory + "optimize"
-                                    + _SLASH_STRING + "ir_op_pass_" + to_string(i + 1) + ".txt";
+                                    + _SLASH_STRING + "ir_op_pass_" + to_string(round) + ".txt";
             ofstream irOptimizeStream(fileName, ios::out | ios::trunc);
             irOptimizeStream << module->toString() << endl;
             irOptimizeStream.close();
         }
 
         if (needIrCheck && !irCheck(module)) {
-            cout << "Error: IR is not correct after optimize pass " << to_string(i + 1) << "." << endl;
-            cerr << "Error: IR is not correct after optimize pass " << to_string(i + 1) << "." << endl;
+            cout << "Error: IR is not correct after optimize pass " << to_string(round) << "." << endl;
+            cerr << "Error: IR is not correct after optimize pass " << to_string(round) << "." << endl;
             exit(_IR_OP_CHK_ERR);
         }
     }
 
-    for (int i = 0; i < OPTIMIZE_TIMES; ++i)
-        deadCodeElimination(module);
-
     if (_debugIr) {
         const string fileName = debugMessageDirectory + "ir_optimize.txt";
         ofstream irOptimizeStream(fileName, ios::out | ios::trunc);
@@ -11,42 +11,71 @@
 
 extern string debugMessageDirectory;
 
-extern const unsigned int OPTIMIZE_TIMES;
+extern const unsigned int MAX_OPTIMIZE_ROUNDS;
 
 extern unsigned long DEAD_BLOCK_CODE_GROUP_DELETE_TIMEOUT;
-extern unsigned long CONFLICT_GRAPH_TIMEOUT;
 
 extern void optimizeIr(shared_ptr<Module> &module, OptimizeLevel level);
 
-void constantFolding(shared_ptr<Module> &module);
+// the optimize passes return true if the IR is changed.
+bool deadCodeElimination(shared_ptr<Module> &module);
 
-void deadCodeElimination(shared_ptr<Module> &module);
+bool deadCodeElimination(shared_ptr<Function> &func);
 
-void functionInline(shared_ptr<Module> &module);
+bool readOnlyVariableToConstant(shared_ptr<Module> &module);
 
-void constantBranchConversion(shared_ptr<Module> &module);
+bool deadArrayDelete(shared_ptr<Module> &module);
 
-void blockCombination(shared_ptr<Module> &module);
+bool arrayExternalLift(shared_ptr<Module> &module);
 
-void readOnlyVariableToConstant(shared_ptr<Module> &module);
+bool functionInline(shared_ptr<Module> &module);
 
-void localArrayFolding(shared_ptr<Module> &module);
+bool computeBinary(IrOp op, int l, int r, int &result);
 
-void deadArrayDelete(shared_ptr<Module> &module);
+bool constantFolding(shared_ptr<Function> &func);
 
-void arrayExternalLift(shared_ptr<Module> &module);
+bool sparseConditionalConstantPropagation(shared_ptr<Function> &func);
 
-void deadBlockCodeGroupDelete(shared_ptr<Module> &module);
+bool localArrayFolding(shared_ptr<Function> &func);
 
-void loopInvariantCodeMotion(shared_ptr<Module> &module);
+bool deadBlockCodeGroupDelete(shared_ptr<Function> &func);
 
-void localCommonSubexpressionElimination(shared_ptr<Module> &module);
+bool loopInvariantCodeMotion(shared_ptr<Function> &func);
+
+bool globalValueNumbering(shared_ptr<Function> &func);
+
+bool loopUnrolling(shared_ptr<Function> &func);
+
+bool loopStrengthReduction(shared_ptr<Function> &func);
+
+shared_ptr<Value> stripOffsets(shared_ptr<Value> value, int &offset);
+
+void linkBlocks(const shared_ptr<BasicBlock> &from, const shared_ptr<BasicBlock> &to);
+
+void replaceSuccessor(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &oldSucc, shared_ptr<BasicBlock> &newSucc);
+
+void jumpTo(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &target);
+
+void branchTo(shared_ptr<BasicBlock> &bb, shared_ptr<Value> &condition,
+              shared_ptr<BasicBlock> &trueBlock, shared_ptr<BasicBlock> &falseBlock);
+
+void insertBlocks(shared_ptr<Function> &func, shared_ptr<BasicBlock> &before, vector<shared_ptr<BasicBlock>> &blocks);
+
+bool isVectorizableLoop(Loop *loop);
+
+bool blockCombination(shared_ptr<Function> &func);
+
+bool tailRecursionElimination(shared_ptr<Function> &func);
 
 // some end optimize functions.
 void endOptimize(shared_ptr<Module> &module, OptimizeLevel level);
 
+void loopVectorization(shared_ptr<Function> &func);
+
 void calculateVariableWeight(shared_ptr<Function> &func);
 
+void splitLiveRanges(shared_ptr<Function> &func);
+
 void registerAlloc(shared_ptr<Function> &func);
 
 #endif
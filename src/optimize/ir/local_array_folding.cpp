@@ -1,11 +1,26 @@
 #include "ir_optimize.h"
 
-void foldLocalArray(shared_ptr<AllocInstruction> &alloc) {
+/**
+ * Get the number a memset or memcpy leaves at offset, or nullptr if it is unknown.
+ */
+shared_ptr<Value> bulkFillValue(shared_ptr<Value> &bulkInit, int offset) {
+    shared_ptr<Instruction> ins = s_p_c<Instruction>(bulkInit);
+    if (ins->type == InstructionType::MEMSET) {
+        shared_ptr<Value> value = s_p_c<MemsetInstruction>(ins)->value;
+        return value->valueType == ValueType::NUMBER ? value : nullptr;
+    }
+    shared_ptr<ConstantValue> source = s_p_c<ConstantValue>(s_p_c<MemcpyInstruction>(ins)->source);
+    return getNumberValue(source->values.count(offset) != 0 ? source->values.at(offset) : 0);
+}
+
+bool foldLocalArray(shared_ptr<AllocInstruction> &alloc) {
     bool visit = false;
+    bool changed = false;
     shared_ptr<BasicBlock> &bb = alloc->block;
     unordered_map<int, shared_ptr<Value>> arrValues;
     unordered_map<int, shared_ptr<StoreInstruction>> arrStores;
     unordered_set<int> canErase;
+    shared_ptr<Value> bulkInit; // the memset or memcpy which fills the array, if any.
     for (auto ins = bb->instructions.begin(); ins != bb->instructions.end();) {
         if (!visit && *ins != alloc) {
             ++ins;
@@ -18,16 +33,17 @@ void foldLocalArray(shared_ptr<AllocInstruction> &alloc) {
         if ((*ins)->type == InstructionType::INVOKE) {
             shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(*ins);
             for (auto &arg : invoke->params) {
-                if (arg == alloc) return;
+                if (arg == alloc) return changed;
             }
         } else if ((*ins)->type == InstructionType::BINARY) {
             shared_ptr<BinaryInstruction> bin = s_p_c<BinaryInstruction>(*ins);
-            if (bin->lhs == alloc || bin->rhs == alloc) return;
+            if (bin->lhs == alloc || bin->rhs == alloc) return changed;
         } else if ((*ins)->type == InstructionType::STORE) {
             shared_ptr<StoreInstruction> store = s_p_c<StoreInstruction>(*ins);
             if (store->address == alloc && store->offset->valueType == ValueType::NUMBER) {
                 shared_ptr<NumberValue> off = s_p_c<NumberValue>(store->offset);
                 if (arrStores.count(off->number) != 0 && canErase.count(off->number) != 0) {
+                    if (arrStores.at(off->number)->valid) changed = true;
                     arrStores.at(off->number)->abandonUse();
                 } else {
                     canErase.insert(off->number);
@@ -36,10 +52,28 @@ void foldLocalArray(shared_ptr<AllocInstruction> &alloc) {
                 arrStores[off->number] = store;
             } else if (store->address == alloc) {
                 for (auto &item : arrStores) {
-                    if (canErase.count(item.first) != 0)
+                    if (canErase.count(item.first) != 0 && item.second->valid) {
                         item.second->abandonUse();
+                        changed = true;
+                    }
                 }
-                return;
+                return changed;
+            }
+        } else if ((*ins)->type == InstructionType::MEMSET || (*ins)->type == InstructionType::MEMCPY) {
+            shared_ptr<Value> address = (*ins)->type == InstructionType::MEMSET
+                                        ? s_p_c<MemsetInstruction>(*ins)->address
+                                        : s_p_c<MemcpyInstruction>(*ins)->address;
+            if (address == alloc) {
+                for (auto &item : arrStores) {
+                    if (canErase.count(item.first) != 0 && item.second->valid) {
+                        item.second->abandonUse();
+                        changed = true;
+                    }
+                }
+                arrValues.clear();
+                arrStores.clear();
+                canErase.clear();
+                bulkInit = *ins;
             }
         } else if ((*ins)->type == InstructionType::LOAD) {
             shared_ptr<LoadInstruction> load = s_p_c<LoadInstruction>(*ins);
@@ -47,11 +81,7 @@ void foldLocalArray(shared_ptr<AllocInstruction> &alloc) {
                 shared_ptr<NumberValue> off = s_p_c<NumberValue>(load->offset);
                 if (arrValues.count(off->number) != 0) {
                     shared_ptr<Value> val = arrValues.at(off->number);
-                    unordered_set<shared_ptr<Value>> users = load->users;
-                    for (auto &u : users) {
-                        shared_ptr<Value> toBeReplace = load;
-                        u->replaceUse(toBeReplace, val);
-                    }
+                    load->replaceAllUsesWith(val);
                     if (val->valueType == INSTRUCTION && s_p_c<Instruction>(val)->resultType == R_VAL_RESULT) {
                         s_p_c<Instruction>(val)->resultType = L_VAL_RESULT;
                         s_p_c<Instruction>(val)->caughtVarName = generateTempLeftValueName();
@@ -60,7 +90,17 @@ void foldLocalArray(shared_ptr<AllocInstruction> &alloc) {
                         canErase.erase(off->number);
                     load->abandonUse();
                     ins = bb->instructions.erase(ins);
+                    changed = true;
                     continue;
+                } else if (bulkInit != nullptr) {
+                    shared_ptr<Value> val = bulkFillValue(bulkInit, off->number);
+                    if (val != nullptr) {
+                        load->replaceAllUsesWith(val);
+                        load->abandonUse();
+                        ins = bb->instructions.erase(ins);
+                        changed = true;
+                        continue;
+                    }
                 }
             } else if (load->address == alloc) {
                 canErase.clear();
@@ -68,18 +108,19 @@ void foldLocalArray(shared_ptr<AllocInstruction> &alloc) {
         }
         ++ins;
     }
+    return changed;
 }
 
-void localArrayFolding(shared_ptr<Module> &module) {
-    for (auto &func : module->functions) {
-        for (auto &bb : func->blocks) {
-            vector<shared_ptr<Instruction>> instructions = bb->instructions;
-            for (auto &ins : instructions) {
-                if (ins->type == InstructionType::ALLOC) {
-                    shared_ptr<AllocInstruction> alloc = s_p_c<AllocInstruction>(ins);
-                    foldLocalArray(alloc);
-                }
+bool localArrayFolding(shared_ptr<Function> &func) {
+    bool changed = false;
+    for (auto &bb : func->blocks) {
+        list<shared_ptr<Instruction>> instructions = bb->instructions;
+        for (auto &ins : instructions) {
+            if (ins->type == InstructionType::ALLOC) {
+                shared_ptr<AllocInstruction> alloc = s_p_c<AllocInstruction>(ins);
+                if (foldLocalArray(alloc)) changed = true;
             }
         }
     }
+    return changed;
 }
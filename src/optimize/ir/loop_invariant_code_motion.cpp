@@ -1,38 +1,23 @@
 #include "ir_optimize.h"
 
 #include <algorithm>
-#include <queue>
 
-unordered_map<shared_ptr<BasicBlock>, unordered_set<shared_ptr<BasicBlock>>> inDominate;
-unordered_map<shared_ptr<BasicBlock>, unordered_set<shared_ptr<BasicBlock>>> outDominate;
 unordered_map<shared_ptr<BasicBlock>, unordered_set<shared_ptr<BasicBlock>>> loopBlocks;
 unordered_map<shared_ptr<BasicBlock>, shared_ptr<BasicBlock>> newForwardBlocks;
 
-void loopInvariantMotion(shared_ptr<Function> &func);
-
-void buildDominateTree(shared_ptr<BasicBlock> &entryBlock, shared_ptr<Function> &func);
-
-void findLoopBlocks(shared_ptr<Function> &func);
-
 void findInvariantCodes(shared_ptr<BasicBlock> &firstBlock);
 
 void fixNewForwardBlock(shared_ptr<Function> &func, shared_ptr<BasicBlock> &firstBlock);
 
 inline bool judgeInLoop(shared_ptr<Value> &value, unordered_set<shared_ptr<BasicBlock>> &blocksInLoop);
 
-void loopInvariantCodeMotion(shared_ptr<Module> &module) {
-    for (auto &func : module->functions) {
-        loopInvariantMotion(func);
-    }
-}
-
-void loopInvariantMotion(shared_ptr<Function> &func) {
-    inDominate.clear();
-    outDominate.clear();
+bool loopInvariantCodeMotion(shared_ptr<Function> &func) {
     loopBlocks.clear();
     newForwardBlocks.clear();
-    buildDominateTree(func->entryBlock, func);
-    findLoopBlocks(func);
+    // copy the loops since moving codes changes the cfg.
+    for (auto &loop : getFunctionAnalysis(func).getLoops()) {
+        loopBlocks[loop->header] = loop->blocks;
+    }
     for (auto &bb : func->blocks) {
         findInvariantCodes(bb);
     }
@@ -40,86 +25,7 @@ void loopInvariantMotion(shared_ptr<Function> &func) {
         shared_ptr<BasicBlock> first = item.first;
         fixNewForwardBlock(func, first);
     }
-}
-
-void buildDominateTree(shared_ptr<BasicBlock> &entryBlock, shared_ptr<Function> &func) {
-    unordered_set<shared_ptr<BasicBlock>> uSet;
-    for (auto &bb : func->blocks) {
-        uSet.insert(bb);
-    }
-    unordered_set<shared_ptr<BasicBlock>> tempSet;
-    tempSet.insert(entryBlock);
-    outDominate[entryBlock] = tempSet;
-    for (auto &bb : func->blocks) {
-        if (bb != entryBlock) {
-            outDominate[bb] = uSet;
-            tempSet.clear();
-            inDominate[bb] = tempSet;
-        }
-    }
-    bool outChanged;
-    do {
-        outChanged = false;
-        for (auto &bb : func->blocks) {
-            if (bb != entryBlock) {
-                unordered_set<shared_ptr<BasicBlock>> inSet = uSet;
-                for (auto &pred : bb->predecessors) {
-                    tempSet = outDominate.at(pred);
-                    for (auto item = inSet.begin(); item != inSet.end();) {
-                        if (tempSet.count(*item) == 0) {
-                            item = inSet.erase(item);
-                        } else ++item;
-                    }
-                }
-                inDominate[bb] = inSet;
-                unordered_set<shared_ptr<BasicBlock>> outSet = inSet;
-                outSet.insert(bb);
-                if (outSet.size() != outDominate.at(bb).size()) outChanged = true;
-                outDominate[bb] = outSet;
-            }
-        }
-    } while (outChanged);
-}
-
-void findLoopBlocks(shared_ptr<Function> &func) {
-    for (auto &bb : func->blocks) {
-        for (auto &suc : bb->successors) {
-            if (outDominate.at(bb).count(suc) != 0) {
-                unordered_set<shared_ptr<BasicBlock>> tempLoopSet;
-                queue<shared_ptr<BasicBlock>> loopQueue;
-                loopQueue.push(bb);
-                tempLoopSet.insert(bb);
-                tempLoopSet.insert(suc);
-                if (bb->loopDepth != suc->loopDepth) {
-                    cerr << "Error occurs in process loop invariant code motion: "
-                            "loop depth does not equal." << endl;
-                }
-                while (!loopQueue.empty()) {
-                    shared_ptr<BasicBlock> top = loopQueue.front();
-                    loopQueue.pop();
-                    if (top != suc) {
-                        for (auto &pred : top->predecessors) {
-                            if (tempLoopSet.count(pred) == 0) {
-                                if (pred->loopDepth < bb->loopDepth) {
-                                    cerr << "Error occurs in process loop invariant code motion: "
-                                            "predecessor's loop depth less than block." << endl;
-                                }
-                                tempLoopSet.insert(pred);
-                                loopQueue.push(pred);
-                            }
-                        }
-                    }
-                }
-                if (loopBlocks.count(suc) != 0) {
-                    unordered_set<shared_ptr<BasicBlock>> newLoopSet = loopBlocks.at(suc);
-                    newLoopSet.merge(tempLoopSet);
-                    loopBlocks[suc] = newLoopSet;
-                } else {
-                    loopBlocks[suc] = tempLoopSet;
-                }
-            }
-        }
-    }
+    return !newForwardBlocks.empty();
 }
 
 void findInvariantCodes(shared_ptr<BasicBlock> &firstBlock) {
@@ -144,8 +50,8 @@ void findInvariantCodes(shared_ptr<BasicBlock> &firstBlock) {
             }
             if (motion) {
                 if (newForwardBlocks.count(firstBlock) == 0) {
-                    shared_ptr<BasicBlock> newBb = make_shared<BasicBlock>(firstBlock->function, true,
-                                                                           firstBlock->loopDepth - 1);
+                    shared_ptr<BasicBlock> newBb = newIr<BasicBlock>(firstBlock->function, true,
+                                                                     firstBlock->loopDepth - 1);
                     newForwardBlocks[firstBlock] = newBb;
                 }
                 shared_ptr<BasicBlock> b = newForwardBlocks.at(firstBlock);
@@ -165,7 +71,7 @@ void fixNewForwardBlock(shared_ptr<Function> &func, shared_ptr<BasicBlock> &firs
     unordered_set<shared_ptr<BasicBlock>> blocksInLoop = loopBlocks.at(firstBlock);
     shared_ptr<BasicBlock> newBlock = newForwardBlocks.at(firstBlock);
     unordered_set<shared_ptr<BasicBlock>> predecessors = firstBlock->predecessors;
-    shared_ptr<JumpInstruction> jumpIns = make_shared<JumpInstruction>(firstBlock, newBlock);
+    shared_ptr<JumpInstruction> jumpIns = newIr<JumpInstruction>(firstBlock, newBlock);
     newBlock->instructions.push_back(jumpIns);
     for (auto &pred : predecessors) {
         if (blocksInLoop.count(pred) == 0) {
@@ -176,7 +82,7 @@ void fixNewForwardBlock(shared_ptr<Function> &func, shared_ptr<BasicBlock> &firs
             if (pred->instructions.empty()) {
                 cerr << "Error occurs in process loop invariant motion: empty instruction vector." << endl;
             } else {
-                auto it = pred->instructions.end() - 1;
+                auto it = prev(pred->instructions.end());
                 if ((*it)->type == JMP) {
                     s_p_c<JumpInstruction>(*it)->targetBlock = newBlock;
                 } else if ((*it)->type == BR) {
@@ -194,19 +100,15 @@ void fixNewForwardBlock(shared_ptr<Function> &func, shared_ptr<BasicBlock> &firs
     firstBlock->predecessors.insert(newBlock);
     for (auto &phi : firstBlock->phis) {
         unordered_map<shared_ptr<BasicBlock>, shared_ptr<Value>> operands = phi->operands;
-        shared_ptr<PhiInstruction> newPhi = make_shared<PhiInstruction>(phi->localVarName, newBlock);
+        shared_ptr<PhiInstruction> newPhi = newIr<PhiInstruction>(phi->localVarName, newBlock);
         for (auto &it : operands) {
             if (blocksInLoop.count(it.first) == 0) {
-                shared_ptr<Value> val = it.second;
-                newPhi->operands[it.first] = val;
-                val->users.erase(phi);
-                val->users.insert(newPhi);
-                phi->operands.erase(it.first);
+                newPhi->setOperand(it.first, it.second);
+                phi->removeOperand(it.first);
             }
         }
         if (!newPhi->operands.empty()) {
-            phi->operands[newBlock] = newPhi;
-            newPhi->users.insert(phi);
+            phi->setOperand(newBlock, newPhi);
             newBlock->phis.insert(newPhi);
         }
     }
@@ -0,0 +1,249 @@
+#include "ir_optimize.h"
+
+#include <map>
+
+/**
+ * A basic induction variable: a header phi which takes init from the preheader,
+ * and adds step to itself before going back from the only latch.
+ */
+struct InductionVariable {
+    shared_ptr<PhiInstruction> phi;
+    shared_ptr<Value> init;
+    int step = 0;
+};
+
+/**
+ * An affine value iv * scale + offset of an induction variable, where scale is loop invariant.
+ */
+struct AffineValue {
+    InductionVariable *iv = nullptr;
+    shared_ptr<Value> scale;
+    int offset = 0;
+};
+
+struct StrengthReductionLoop {
+    Loop *loop;
+    shared_ptr<BasicBlock> preheader;
+    shared_ptr<BasicBlock> latch;
+    vector<InductionVariable> inductionVariables;
+    // the phis of iv * scale made so far, keyed by the phi of the induction variable and the scale.
+    map<pair<Value *, Value *>, shared_ptr<PhiInstruction>> reducedValues;
+};
+
+int wrappingAdd(int a, int b) {
+    return (int) ((unsigned int) a + (unsigned int) b);
+}
+
+int wrappingSubtract(int a, int b) {
+    return (int) ((unsigned int) a - (unsigned int) b);
+}
+
+int wrappingMultiply(int a, int b) {
+    return (int) ((unsigned int) a * (unsigned int) b);
+}
+
+bool isPowerOfTwo(int number) {
+    return number > 0 && (number & (number - 1)) == 0;
+}
+
+/**
+ * The backend multiplies by 0, 2^n and 2^n +- 1 with one instruction, no phi is worth keeping for them.
+ */
+bool cheapMultiplier(const shared_ptr<Value> &value) {
+    if (value->valueType != NUMBER) return false;
+    int number = s_p_c<NumberValue>(value)->number;
+    return number == 0 || isPowerOfTwo(number) || isPowerOfTwo(number - 1) || isPowerOfTwo(number + 1);
+}
+
+bool loopInvariant(const shared_ptr<Value> &value, Loop *loop) {
+    return value->valueType != INSTRUCTION || !loop->contains(s_p_c<Instruction>(value)->block);
+}
+
+/**
+ * Insert ins at the end of bb, before its terminator and the comparison the terminator branches on.
+ */
+void insertBeforeTerminator(shared_ptr<BasicBlock> &bb, const shared_ptr<Instruction> &ins) {
+    auto it = prev(bb->instructions.end());
+    if ((*it)->type == BR && it != bb->instructions.begin()
+        && s_p_c<BranchInstruction>(*it)->condition == *prev(it)) {
+        --it;
+    }
+    bb->instructions.insert(it, ins);
+}
+
+/**
+ * Walk from value through the copies by single operand phis and the additions of numbers, and return the
+ * value it starts from, so j + 1 + 1 in an unrolled loop body is j with offset 2.
+ */
+shared_ptr<Value> stripOffsets(shared_ptr<Value> value, int &offset) {
+    offset = 0;
+    while (value->valueType == INSTRUCTION) {
+        shared_ptr<Instruction> ins = s_p_c<Instruction>(value);
+        if (ins->type == PHI && s_p_c<PhiInstruction>(ins)->operands.size() == 1) {
+            value = s_p_c<PhiInstruction>(ins)->operands.begin()->second;
+            continue;
+        }
+        if (ins->type != BINARY) break;
+        shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(ins);
+        if (binary->op == OP_ADD && binary->rhs->valueType == NUMBER) {
+            offset = wrappingAdd(offset, s_p_c<NumberValue>(binary->rhs)->number);
+            value = binary->lhs;
+        } else if (binary->op == OP_ADD && binary->lhs->valueType == NUMBER) {
+            offset = wrappingAdd(offset, s_p_c<NumberValue>(binary->lhs)->number);
+            value = binary->rhs;
+        } else if (binary->op == OP_SUB && binary->rhs->valueType == NUMBER) {
+            offset = wrappingSubtract(offset, s_p_c<NumberValue>(binary->rhs)->number);
+            value = binary->lhs;
+        } else {
+            break;
+        }
+    }
+    return value;
+}
+
+bool findStrengthReductionLoop(Loop *loop, StrengthReductionLoop &reduction) {
+    if (loop->latches.size() != 1) return false;
+    reduction.loop = loop;
+    reduction.latch = loop->latches.front();
+    for (auto &pred : loop->header->predecessors) {
+        if (loop->contains(pred)) continue;
+        if (reduction.preheader != nullptr) return false;
+        reduction.preheader = pred;
+    }
+    if (reduction.preheader == nullptr || reduction.preheader->instructions.empty()) return false;
+    for (auto &phi : loop->header->phis) {
+        if (phi->operands.size() != 2 || phi->operands.count(reduction.preheader) == 0
+            || phi->operands.count(reduction.latch) == 0) {
+            continue;
+        }
+        InductionVariable iv;
+        iv.phi = phi;
+        iv.init = phi->operands.at(reduction.preheader);
+        if (stripOffsets(phi->operands.at(reduction.latch), iv.step) != phi || iv.step == 0) continue;
+        reduction.inductionVariables.push_back(iv);
+    }
+    return !reduction.inductionVariables.empty();
+}
+
+InductionVariable *findInductionVariable(const shared_ptr<Value> &value, StrengthReductionLoop &reduction) {
+    for (auto &iv : reduction.inductionVariables) {
+        if (iv.phi == value) return &iv;
+    }
+    return nullptr;
+}
+
+/**
+ * Match value as iv + offset, where offset is a number.
+ */
+bool matchInductionOffset(const shared_ptr<Value> &value, StrengthReductionLoop &reduction, AffineValue &affine) {
+    affine.iv = findInductionVariable(stripOffsets(value, affine.offset), reduction);
+    return affine.iv != nullptr;
+}
+
+/**
+ * Match a multiplication as (iv + offset) * scale with a loop invariant scale.
+ */
+bool matchAffineMultiply(shared_ptr<Instruction> &ins, StrengthReductionLoop &reduction, AffineValue &affine) {
+    if (ins->type != BINARY || s_p_c<BinaryInstruction>(ins)->op != OP_MUL) return false;
+    shared_ptr<BinaryInstruction> mul = s_p_c<BinaryInstruction>(ins);
+    if (loopInvariant(mul->rhs, reduction.loop) && matchInductionOffset(mul->lhs, reduction, affine)) {
+        affine.scale = mul->rhs;
+    } else if (loopInvariant(mul->lhs, reduction.loop) && matchInductionOffset(mul->rhs, reduction, affine)) {
+        affine.scale = mul->lhs;
+    } else {
+        return false;
+    }
+    return !cheapMultiplier(affine.scale);
+}
+
+/**
+ * value * scale in the preheader, folded if both are numbers.
+ */
+shared_ptr<Value> multiplyInPreheader(shared_ptr<Value> value, shared_ptr<Value> scale,
+                                      StrengthReductionLoop &reduction) {
+    if (value->valueType == NUMBER && scale->valueType == NUMBER) {
+        return getNumberValue(wrappingMultiply(s_p_c<NumberValue>(value)->number,
+                                               s_p_c<NumberValue>(scale)->number));
+    }
+    if (value->valueType == NUMBER && s_p_c<NumberValue>(value)->number == 1) return scale;
+    // the backend strength reduces a multiplication by a number only if the number is the rhs.
+    if (value->valueType == NUMBER) swap(value, scale);
+    markLeftValue(value);
+    markLeftValue(scale);
+    shared_ptr<Instruction> mul = newIr<BinaryInstruction>(OP_MUL, value, scale, reduction.preheader);
+    markLeftValue(mul);
+    insertBeforeTerminator(reduction.preheader, mul);
+    return mul;
+}
+
+/**
+ * The phi of iv * scale, which starts from init * scale and adds step * scale on each iteration.
+ */
+shared_ptr<PhiInstruction> reducedPhi(AffineValue &affine, StrengthReductionLoop &reduction) {
+    pair<Value *, Value *> key = {affine.iv->phi.get(), affine.scale.get()};
+    auto it = reduction.reducedValues.find(key);
+    if (it != reduction.reducedValues.end()) return it->second;
+
+    shared_ptr<BasicBlock> &header = reduction.loop->header;
+    shared_ptr<PhiInstruction> phi = newIr<PhiInstruction>(generateTempLeftValueName(), header);
+    shared_ptr<Value> init = multiplyInPreheader(affine.iv->init, affine.scale, reduction);
+    shared_ptr<Value> step = multiplyInPreheader(getNumberValue(affine.iv->step), affine.scale, reduction);
+    shared_ptr<Value> phiValue = phi;
+    shared_ptr<Instruction> next = newIr<BinaryInstruction>(OP_ADD, phiValue, step, reduction.latch);
+    markLeftValue(next);
+    reduction.latch->instructions.push_front(next);
+    phi->setOperand(reduction.preheader, init);
+    phi->setOperand(reduction.latch, next);
+    header->phis.insert(phi);
+    reduction.reducedValues[key] = phi;
+    return phi;
+}
+
+/**
+ * Replace the multiplications of an induction variable in the loop by phis carrying the products, which
+ * add a loop invariant step each iteration, so row * columns in the indices of a multi-dimensional array
+ * costs an addition instead of a multiplication.
+ */
+bool reduceLoop(StrengthReductionLoop &reduction) {
+    bool changed = false;
+    for (shared_ptr<BasicBlock> bb : reduction.loop->blocks) {
+        for (auto it = bb->instructions.begin(); it != bb->instructions.end();) {
+            shared_ptr<Instruction> ins = *it;
+            AffineValue affine;
+            if (!matchAffineMultiply(ins, reduction, affine)) {
+                ++it;
+                continue;
+            }
+            shared_ptr<Value> product = reducedPhi(affine, reduction);
+            if (affine.offset != 0) {
+                shared_ptr<Value> offset = multiplyInPreheader(getNumberValue(affine.offset), affine.scale,
+                                                               reduction);
+                shared_ptr<Instruction> add = newIr<BinaryInstruction>(OP_ADD, product, offset, bb);
+                add->resultType = ins->resultType;
+                add->caughtVarName = ins->caughtVarName;
+                *it = add;
+                product = add;
+                ++it;
+            } else {
+                it = bb->instructions.erase(it);
+            }
+            ins->replaceAllUsesWith(product);
+            ins->abandonUse();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Loop strength reduction on the basic induction variables of each loop with a preheader and one latch.
+ */
+bool loopStrengthReduction(shared_ptr<Function> &func) {
+    bool changed = false;
+    for (auto &loop : getFunctionAnalysis(func).getLoops()) {
+        StrengthReductionLoop reduction;
+        if (!findStrengthReductionLoop(loop.get(), reduction)) continue;
+        if (reduceLoop(reduction)) changed = true;
+    }
+    return changed;
+}
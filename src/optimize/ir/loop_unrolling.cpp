@@ -0,0 +1,560 @@
+#include "ir_optimize.h"
+#include "../../basic/std/compile_std.h"
+
+#include <climits>
+#include <functional>
+#include <algorithm>
+
+// a loop is fully unrolled if its copies have at most so many instructions.
+const unsigned int FULL_UNROLL_SIZE = 200;
+const unsigned int MAX_FULL_UNROLL_TRIPS = 64;
+// the body of a partially unrolled loop has at most so many instructions, unless the factor is given.
+const unsigned int PARTIAL_UNROLL_SIZE = 80;
+const unsigned int MAX_UNROLL_FACTOR = 4;
+
+typedef unordered_map<shared_ptr<Value>, shared_ptr<Value>> ValueMap;
+typedef unordered_map<shared_ptr<BasicBlock>, shared_ptr<BasicBlock>> BlockMap;
+
+/**
+ * An innermost loop whose only latch is also its only exit, going on while the induction variable of
+ * the next iteration compares true with a loop invariant bound.
+ * The body runs at least once each time the loop is entered.
+ */
+struct CountedLoop {
+    shared_ptr<BasicBlock> header;
+    vector<shared_ptr<BasicBlock>> blocks; // in reverse post order, the header first.
+    unordered_set<shared_ptr<BasicBlock>> blockSet;
+    shared_ptr<BasicBlock> preheader;
+    shared_ptr<BasicBlock> latch;
+    shared_ptr<BasicBlock> exit;
+    shared_ptr<PhiInstruction> inductionVariable;
+    shared_ptr<Value> update; // the induction variable of the next iteration.
+    int step = 0;
+    IrOp op = OP_LT; // the loop goes on while update op bound.
+    shared_ptr<Value> bound;
+    unsigned int size = 0;
+};
+
+IrOp swapComparison(IrOp op) {
+    switch (op) {
+        case OP_LT: return OP_GT;
+        case OP_GT: return OP_LT;
+        case OP_LE: return OP_GE;
+        case OP_GE: return OP_LE;
+        default: return op;
+    }
+}
+
+IrOp negateComparison(IrOp op) {
+    switch (op) {
+        case OP_LT: return OP_GE;
+        case OP_GE: return OP_LT;
+        case OP_GT: return OP_LE;
+        case OP_LE: return OP_GT;
+        case OP_EQ: return OP_NE;
+        default: return OP_EQ;
+    }
+}
+
+bool definedInLoop(const shared_ptr<Value> &value, CountedLoop &loop) {
+    return value->valueType == INSTRUCTION && loop.blockSet.count(s_p_c<Instruction>(value)->block) != 0;
+}
+
+/**
+ * Find the step of an induction variable from its update, which adds or subtracts a number.
+ */
+bool findStep(shared_ptr<PhiInstruction> &phi, shared_ptr<Value> &update, int &step) {
+    if (update->valueType != INSTRUCTION || s_p_c<Instruction>(update)->type != BINARY) return false;
+    shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(update);
+    if (binary->op == OP_ADD && binary->lhs == phi && binary->rhs->valueType == NUMBER) {
+        step = s_p_c<NumberValue>(binary->rhs)->number;
+    } else if (binary->op == OP_ADD && binary->rhs == phi && binary->lhs->valueType == NUMBER) {
+        step = s_p_c<NumberValue>(binary->lhs)->number;
+    } else if (binary->op == OP_SUB && binary->lhs == phi && binary->rhs->valueType == NUMBER) {
+        step = -s_p_c<NumberValue>(binary->rhs)->number;
+    } else {
+        return false;
+    }
+    return step != 0;
+}
+
+bool findCountedLoop(Loop *loop, const vector<shared_ptr<BasicBlock>> &reversePostOrder, CountedLoop &counted) {
+    if (!loop->children.empty() || loop->latches.size() != 1 || loop->header->unrolled) {
+        return false;
+    }
+    counted.header = loop->header;
+    counted.latch = loop->latches.front();
+    counted.blockSet = loop->blocks;
+    for (auto &bb : reversePostOrder) {
+        if (loop->contains(bb)) counted.blocks.push_back(bb);
+    }
+    for (auto &pred : counted.header->predecessors) {
+        if (loop->contains(pred)) continue;
+        if (counted.preheader != nullptr) return false;
+        counted.preheader = pred;
+    }
+    if (counted.preheader == nullptr) return false;
+    for (auto &bb : counted.blocks) {
+        counted.size += bb->phis.size() + bb->instructions.size();
+        for (auto &succ : bb->successors) {
+            if (bb != counted.latch && !loop->contains(succ)) return false;
+        }
+        for (auto &ins : bb->instructions) {
+            if (ins->type == RET || ins->type == ALLOC) return false;
+            if (ins->type == INVOKE && (s_p_c<InvokeInstruction>(ins)->invokeType == START_TIME
+                                        || s_p_c<InvokeInstruction>(ins)->invokeType == STOP_TIME)) {
+                return false;
+            }
+        }
+    }
+    for (auto &phi : counted.header->phis) {
+        if (phi->operands.size() != 2 || phi->operands.count(counted.preheader) == 0
+            || phi->operands.count(counted.latch) == 0) {
+            return false;
+        }
+    }
+
+    shared_ptr<Instruction> last = counted.latch->instructions.back();
+    if (last->type != BR) return false;
+    shared_ptr<BranchInstruction> br = s_p_c<BranchInstruction>(last);
+    bool goOnIfTrue = br->trueBlock == counted.header;
+    if (goOnIfTrue == (br->falseBlock == counted.header)) return false;
+    counted.exit = goOnIfTrue ? br->falseBlock : br->trueBlock;
+    if (loop->contains(counted.exit)) return false;
+    if (br->condition->valueType != INSTRUCTION || s_p_c<Instruction>(br->condition)->type != CMP) return false;
+    shared_ptr<BinaryInstruction> cmp = s_p_c<BinaryInstruction>(br->condition);
+
+    for (auto &phi : counted.header->phis) {
+        shared_ptr<Value> update = phi->operands.at(counted.latch);
+        if (update != cmp->lhs && update != cmp->rhs) continue;
+        shared_ptr<PhiInstruction> inductionVariable = phi;
+        if (!findStep(inductionVariable, update, counted.step)) continue;
+        counted.bound = update == cmp->lhs ? cmp->rhs : cmp->lhs;
+        if (definedInLoop(counted.bound, counted)) return false;
+        counted.inductionVariable = phi;
+        counted.update = update;
+        counted.op = update == cmp->lhs ? cmp->op : swapComparison(cmp->op);
+        if (!goOnIfTrue) counted.op = negateComparison(counted.op);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * The times the body runs, or 0 if the bounds are not numbers or it runs too many times.
+ */
+unsigned int constantTripCount(CountedLoop &loop) {
+    shared_ptr<Value> init = loop.inductionVariable->operands.at(loop.preheader);
+    if (init->valueType != NUMBER || loop.bound->valueType != NUMBER) return 0;
+    long long value = s_p_c<NumberValue>(init)->number;
+    int bound = s_p_c<NumberValue>(loop.bound)->number;
+    for (unsigned int trips = 1; trips <= MAX_FULL_UNROLL_TRIPS; ++trips) {
+        value += loop.step;
+        if (value < INT_MIN || value > INT_MAX) return 0;
+        int goOn;
+        if (!computeBinary(loop.op, (int) value, bound, goOn)) return 0;
+        if (!goOn) return trips;
+    }
+    return 0;
+}
+
+shared_ptr<Value> mapValue(const shared_ptr<Value> &value, ValueMap &valueMap) {
+    auto it = valueMap.find(value);
+    return it == valueMap.end() ? value : it->second;
+}
+
+void linkBlocks(const shared_ptr<BasicBlock> &from, const shared_ptr<BasicBlock> &to) {
+    from->successors.insert(to);
+    to->predecessors.insert(from);
+}
+
+void replaceSuccessor(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &oldSucc, shared_ptr<BasicBlock> &newSucc) {
+    shared_ptr<Instruction> &last = bb->instructions.back();
+    if (last->type == JMP) {
+        s_p_c<JumpInstruction>(last)->targetBlock = newSucc;
+    } else if (last->type == BR) {
+        shared_ptr<BranchInstruction> br = s_p_c<BranchInstruction>(last);
+        if (br->trueBlock == oldSucc) br->trueBlock = newSucc;
+        if (br->falseBlock == oldSucc) br->falseBlock = newSucc;
+    }
+    bb->successors.erase(oldSucc);
+    oldSucc->predecessors.erase(bb);
+    linkBlocks(bb, newSucc);
+}
+
+void jumpTo(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &target) {
+    bb->instructions.push_back(newIr<JumpInstruction>(target, bb));
+    linkBlocks(bb, target);
+}
+
+void branchTo(shared_ptr<BasicBlock> &bb, shared_ptr<Value> &condition,
+              shared_ptr<BasicBlock> &trueBlock, shared_ptr<BasicBlock> &falseBlock) {
+    bb->instructions.push_back(newIr<BranchInstruction>(condition, trueBlock, falseBlock, bb));
+    linkBlocks(bb, trueBlock);
+    linkBlocks(bb, falseBlock);
+}
+
+/**
+ * Compare value with the limit by the loop condition, at the end of bb.
+ */
+shared_ptr<Value> compareWithLimit(shared_ptr<BasicBlock> &bb, shared_ptr<Value> value, shared_ptr<Value> limit,
+                                   CountedLoop &loop) {
+    markLeftValue(value);
+    markLeftValue(limit);
+    shared_ptr<Instruction> cmp = newIr<BinaryInstruction>(loop.op, value, limit, bb);
+    bb->instructions.push_back(cmp);
+    return cmp;
+}
+
+shared_ptr<Instruction> cloneInstruction(shared_ptr<Instruction> &ins, shared_ptr<BasicBlock> &bb,
+                                         ValueMap &valueMap) {
+    shared_ptr<Instruction> copy;
+    switch (ins->type) {
+        case INVOKE: {
+            shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(ins);
+            vector<shared_ptr<Value>> params;
+            for (auto &param : invoke->params) params.push_back(mapValue(param, valueMap));
+            if (invoke->invokeType == COMMON) {
+                copy = newIr<InvokeInstruction>(invoke->targetFunction, params, bb);
+            } else {
+                copy = newIr<InvokeInstruction>(invoke->targetName, params, bb);
+            }
+            break;
+        }
+        case UNARY: {
+            shared_ptr<UnaryInstruction> unary = s_p_c<UnaryInstruction>(ins);
+            shared_ptr<Value> value = mapValue(unary->value, valueMap);
+            copy = newIr<UnaryInstruction>(unary->op, value, bb);
+            break;
+        }
+        case BINARY:
+        case CMP: {
+            shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(ins);
+            shared_ptr<Value> lhs = mapValue(binary->lhs, valueMap);
+            shared_ptr<Value> rhs = mapValue(binary->rhs, valueMap);
+            copy = newIr<BinaryInstruction>(binary->op, lhs, rhs, bb);
+            break;
+        }
+        case LOAD: {
+            shared_ptr<LoadInstruction> load = s_p_c<LoadInstruction>(ins);
+            shared_ptr<Value> address = mapValue(load->address, valueMap);
+            shared_ptr<Value> offset = mapValue(load->offset, valueMap);
+            copy = newIr<LoadInstruction>(address, offset, bb);
+            break;
+        }
+        case STORE: {
+            shared_ptr<StoreInstruction> store = s_p_c<StoreInstruction>(ins);
+            shared_ptr<Value> value = mapValue(store->value, valueMap);
+            shared_ptr<Value> address = mapValue(store->address, valueMap);
+            shared_ptr<Value> offset = mapValue(store->offset, valueMap);
+            copy = newIr<StoreInstruction>(value, address, offset, bb);
+            break;
+        }
+        case MEMSET: {
+            shared_ptr<MemsetInstruction> memsetIns = s_p_c<MemsetInstruction>(ins);
+            shared_ptr<Value> value = mapValue(memsetIns->value, valueMap);
+            shared_ptr<Value> address = mapValue(memsetIns->address, valueMap);
+            copy = newIr<MemsetInstruction>(value, address, memsetIns->units, bb);
+            break;
+        }
+        case MEMCPY: {
+            shared_ptr<MemcpyInstruction> memcpyIns = s_p_c<MemcpyInstruction>(ins);
+            shared_ptr<Value> source = mapValue(memcpyIns->source, valueMap);
+            shared_ptr<Value> address = mapValue(memcpyIns->address, valueMap);
+            copy = newIr<MemcpyInstruction>(source, address, memcpyIns->units, bb);
+            break;
+        }
+        default:
+            cerr << "Error occurs in process loop unrolling: unexpected instruction." << endl;
+            return nullptr;
+    }
+    copy->resultType = ins->resultType;
+    copy->caughtVarName = ins->caughtVarName;
+    bb->instructions.push_back(copy);
+    valueMap[ins] = copy;
+    return copy;
+}
+
+/**
+ * Copy the blocks of the loop once, the header phis are taken from valueMap and the copy of the header
+ * may be given in blockMap. The latch of the copy is left without a terminator.
+ */
+void copyLoopBody(CountedLoop &loop, ValueMap &valueMap, BlockMap &blockMap,
+                  vector<shared_ptr<BasicBlock>> &newBlocks) {
+    shared_ptr<Function> func = loop.header->function;
+    for (auto &bb : loop.blocks) {
+        if (blockMap.count(bb) == 0) blockMap[bb] = newIr<BasicBlock>(func, true, bb->loopDepth);
+        shared_ptr<BasicBlock> copy = blockMap.at(bb);
+        newBlocks.push_back(copy);
+        if (bb == loop.header) continue;
+        for (auto &phi : bb->phis) {
+            shared_ptr<PhiInstruction> newPhi = newIr<PhiInstruction>(phi->localVarName, copy);
+            copy->phis.insert(newPhi);
+            valueMap[phi] = newPhi;
+        }
+    }
+    for (auto &bb : loop.blocks) {
+        shared_ptr<BasicBlock> copy = blockMap.at(bb);
+        for (auto &ins : bb->instructions) {
+            if (ins->type != JMP && ins->type != BR) cloneInstruction(ins, copy, valueMap);
+        }
+    }
+    for (auto &bb : loop.blocks) {
+        shared_ptr<BasicBlock> copy = blockMap.at(bb);
+        if (bb != loop.header) {
+            for (auto &phi : bb->phis) {
+                shared_ptr<PhiInstruction> newPhi = s_p_c<PhiInstruction>(valueMap.at(phi));
+                for (auto &op : phi->operands) newPhi->setOperand(blockMap.at(op.first), mapValue(op.second, valueMap));
+            }
+        }
+        if (bb == loop.latch) continue;
+        shared_ptr<Instruction> last = bb->instructions.back();
+        if (last->type == JMP) {
+            jumpTo(copy, blockMap.at(s_p_c<JumpInstruction>(last)->targetBlock));
+        } else {
+            shared_ptr<BranchInstruction> br = s_p_c<BranchInstruction>(last);
+            shared_ptr<Value> condition = mapValue(br->condition, valueMap);
+            branchTo(copy, condition, blockMap.at(br->trueBlock), blockMap.at(br->falseBlock));
+        }
+    }
+}
+
+/**
+ * The header phis of the next copy of the body take the values of the latch in this copy.
+ */
+void advanceHeaderPhis(CountedLoop &loop, ValueMap &valueMap) {
+    vector<pair<shared_ptr<Value>, shared_ptr<Value>>> nextValues;
+    for (auto &phi : loop.header->phis) {
+        shared_ptr<Value> next = mapValue(phi->operands.at(loop.latch), valueMap);
+        markLeftValue(next);
+        nextValues.emplace_back(phi, next);
+    }
+    for (auto &it : nextValues) valueMap[it.first] = it.second;
+}
+
+/**
+ * Replace the uses of the loop values out of the loop and the new blocks, by the values given by replace.
+ */
+void replaceUsesAfterLoop(CountedLoop &loop, vector<shared_ptr<BasicBlock>> &newBlocks,
+                          const function<shared_ptr<Value>(shared_ptr<Value> &)> &replace) {
+    unordered_set<shared_ptr<BasicBlock>> newBlockSet(newBlocks.begin(), newBlocks.end());
+    vector<shared_ptr<Value>> values;
+    for (auto &bb : loop.blocks) {
+        values.insert(values.end(), bb->phis.begin(), bb->phis.end());
+        values.insert(values.end(), bb->instructions.begin(), bb->instructions.end());
+    }
+    for (auto &value : values) {
+        shared_ptr<Value> replacement;
+        for (auto &user : value->getUsers()) {
+            if (user->valueType != INSTRUCTION) continue;
+            shared_ptr<BasicBlock> &userBlock = s_p_c<Instruction>(user)->block;
+            if (loop.blockSet.count(userBlock) != 0 || newBlockSet.count(userBlock) != 0) continue;
+            if (replacement == nullptr) {
+                replacement = replace(value);
+                markLeftValue(replacement);
+            }
+            user->replaceUse(value, replacement);
+        }
+    }
+}
+
+void insertBlocks(shared_ptr<Function> &func, shared_ptr<BasicBlock> &before, vector<shared_ptr<BasicBlock>> &blocks) {
+    auto it = find(func->blocks.begin(), func->blocks.end(), before);
+    func->blocks.insert(it, blocks.begin(), blocks.end());
+}
+
+/**
+ * Replace the loop by trips copies of its body, the original blocks are left unreachable.
+ */
+void fullyUnroll(CountedLoop &loop, unsigned int trips) {
+    shared_ptr<Function> func = loop.header->function;
+    vector<shared_ptr<BasicBlock>> newBlocks;
+    ValueMap valueMap;
+    for (auto &phi : loop.header->phis) {
+        shared_ptr<Value> init = phi->operands.at(loop.preheader);
+        markLeftValue(init);
+        valueMap[phi] = init;
+    }
+    shared_ptr<BasicBlock> firstHeader;
+    shared_ptr<BasicBlock> lastLatch;
+    for (unsigned int i = 0; i < trips; ++i) {
+        BlockMap blockMap;
+        copyLoopBody(loop, valueMap, blockMap, newBlocks);
+        if (i == 0) firstHeader = blockMap.at(loop.header);
+        else jumpTo(lastLatch, blockMap.at(loop.header));
+        lastLatch = blockMap.at(loop.latch);
+        if (i + 1 < trips) advanceHeaderPhis(loop, valueMap);
+    }
+    jumpTo(lastLatch, loop.exit);
+
+    replaceSuccessor(loop.preheader, loop.header, firstHeader);
+    for (auto &phi : loop.exit->phis) phi->replaceUse(loop.latch, lastLatch);
+    loop.latch->successors.erase(loop.exit);
+    loop.exit->predecessors.erase(loop.latch);
+    replaceUsesAfterLoop(loop, newBlocks, [&](shared_ptr<Value> &value) { return mapValue(value, valueMap); });
+    insertBlocks(func, loop.header, newBlocks);
+}
+
+/**
+ * Find whether the induction variable runs ahead more iterations by value op limit, for limit = bound - ahead,
+ * instead of value + ahead op bound, which wraps around when the bound is close to the end of int.
+ * A constant limit is given at once, and is nullptr if it wraps around. Otherwise the limit is computed at the end
+ * of bb, and safe tells whether it does not wrap around.
+ */
+shared_ptr<Value> aheadLimit(shared_ptr<BasicBlock> &bb, int ahead, CountedLoop &loop, shared_ptr<Value> &safe) {
+    if (loop.bound->valueType == NUMBER) {
+        long long limit = (long long) s_p_c<NumberValue>(loop.bound)->number - ahead;
+        return limit < INT_MIN || limit > INT_MAX ? nullptr : getNumberValue((int) limit);
+    }
+    markLeftValue(loop.bound);
+    shared_ptr<Value> aheadValue = getNumberValue(ahead);
+    shared_ptr<Instruction> limit = newIr<BinaryInstruction>(OP_SUB, loop.bound, aheadValue, bb);
+    bb->instructions.push_back(limit);
+    shared_ptr<Value> end = getNumberValue(ahead > 0 ? INT_MIN + ahead : INT_MAX + ahead);
+    shared_ptr<Instruction> cmp = newIr<BinaryInstruction>(ahead > 0 ? OP_GE : OP_LE, loop.bound, end, bb);
+    bb->instructions.push_back(cmp);
+    safe = cmp;
+    return limit;
+}
+
+/**
+ * Unroll the loop by factor with the original loop kept for the remainder iterations:
+ *
+ *   preheader -> limit check:  bound - (factor - 1) * step does not wrap around ? guard : header
+ *   guard:                     the first factor iterations all run ? unrolled header : header
+ *   unrolled latch:            the next factor iterations all run ? unrolled header : remainder check
+ *   remainder check:           one more iteration runs ? header : join
+ *   latch -> join -> exit:     the values used after the loop are joined by phis.
+ *
+ * The limit check is left out for a constant bound, and the loop is not unrolled if the limit wraps around.
+ */
+bool partiallyUnroll(CountedLoop &loop, unsigned int factor) {
+    shared_ptr<Function> func = loop.header->function;
+    unsigned int outerDepth = loop.header->loopDepth > 0 ? loop.header->loopDepth - 1 : 0;
+    int ahead = (int) (factor - 1) * loop.step;
+    shared_ptr<BasicBlock> limitCheck = newIr<BasicBlock>(func, true, outerDepth);
+    shared_ptr<Value> safe;
+    shared_ptr<Value> limit = aheadLimit(limitCheck, ahead, loop, safe);
+    if (limit == nullptr) return false;
+    shared_ptr<BasicBlock> guard = newIr<BasicBlock>(func, true, outerDepth);
+    shared_ptr<BasicBlock> remainderCheck = newIr<BasicBlock>(func, true, outerDepth);
+    shared_ptr<BasicBlock> join = newIr<BasicBlock>(func, true, outerDepth);
+    vector<shared_ptr<BasicBlock>> newBlocks = {guard};
+    if (safe != nullptr) newBlocks.insert(newBlocks.begin(), limitCheck);
+
+    ValueMap valueMap;
+    vector<pair<shared_ptr<PhiInstruction>, shared_ptr<PhiInstruction>>> unrolledPhis;
+    shared_ptr<BasicBlock> unrolledHeader = newIr<BasicBlock>(func, true, loop.header->loopDepth);
+    for (auto &phi : loop.header->phis) {
+        shared_ptr<PhiInstruction> newPhi = newIr<PhiInstruction>(phi->localVarName, unrolledHeader);
+        unrolledHeader->phis.insert(newPhi);
+        unrolledPhis.emplace_back(phi, newPhi);
+        valueMap[phi] = newPhi;
+    }
+    shared_ptr<BasicBlock> lastLatch;
+    for (unsigned int i = 0; i < factor; ++i) {
+        BlockMap blockMap;
+        if (i == 0) blockMap[loop.header] = unrolledHeader;
+        copyLoopBody(loop, valueMap, blockMap, newBlocks);
+        if (i != 0) jumpTo(lastLatch, blockMap.at(loop.header));
+        lastLatch = blockMap.at(loop.latch);
+        if (i + 1 < factor) advanceHeaderPhis(loop, valueMap);
+    }
+    newBlocks.push_back(remainderCheck);
+
+    shared_ptr<Value> update = mapValue(loop.update, valueMap);
+    shared_ptr<Value> goOn = compareWithLimit(lastLatch, update, limit, loop);
+    branchTo(lastLatch, goOn, unrolledHeader, remainderCheck);
+    shared_ptr<Value> remainder = compareWithLimit(remainderCheck, update, loop.bound, loop);
+    branchTo(remainderCheck, remainder, loop.header, join);
+    shared_ptr<Value> init = loop.inductionVariable->operands.at(loop.preheader);
+    shared_ptr<Value> enter = compareWithLimit(guard, init, limit, loop);
+    branchTo(guard, enter, unrolledHeader, loop.header);
+    if (safe != nullptr) {
+        branchTo(limitCheck, safe, guard, loop.header);
+        replaceSuccessor(loop.preheader, loop.header, limitCheck);
+    } else {
+        replaceSuccessor(loop.preheader, loop.header, guard);
+    }
+
+    for (auto &it : unrolledPhis) {
+        shared_ptr<Value> next = mapValue(it.first->operands.at(loop.latch), valueMap);
+        shared_ptr<Value> entry = it.first->operands.at(loop.preheader);
+        markLeftValue(next);
+        markLeftValue(entry);
+        it.second->setOperand(guard, entry);
+        it.second->setOperand(lastLatch, next);
+        it.first->replaceUse(loop.preheader, guard);
+        if (safe != nullptr) it.first->setOperand(limitCheck, entry);
+        it.first->setOperand(remainderCheck, next);
+    }
+
+    replaceSuccessor(loop.latch, loop.exit, join);
+    jumpTo(join, loop.exit);
+    for (auto &phi : loop.exit->phis) phi->replaceUse(loop.latch, join);
+    newBlocks.push_back(join);
+    replaceUsesAfterLoop(loop, newBlocks, [&](shared_ptr<Value> &value) {
+        string name = value->valueType == INSTRUCTION && s_p_c<Instruction>(value)->resultType == L_VAL_RESULT
+                      ? s_p_c<Instruction>(value)->caughtVarName : generateTempLeftValueName();
+        shared_ptr<PhiInstruction> phi = newIr<PhiInstruction>(name, join);
+        shared_ptr<Value> unrolledValue = mapValue(value, valueMap);
+        markLeftValue(value);
+        markLeftValue(unrolledValue);
+        phi->setOperand(loop.latch, value);
+        phi->setOperand(remainderCheck, unrolledValue);
+        join->phis.insert(phi);
+        return phi;
+    });
+
+    newBlocks.pop_back();
+    insertBlocks(func, loop.header, newBlocks);
+    auto lastLoopBlock = find_if(func->blocks.rbegin(), func->blocks.rend(), [&](shared_ptr<BasicBlock> &bb) {
+        return loop.blockSet.count(bb) != 0;
+    });
+    func->blocks.insert(lastLoopBlock.base(), join);
+    loop.header->unrolled = true;
+    unrolledHeader->unrolled = true;
+    return true;
+}
+
+unsigned int partialUnrollFactor(CountedLoop &loop) {
+    if (_unrollFactor != 0) return _unrollFactor;
+    unsigned int factor = MAX_UNROLL_FACTOR;
+    while (factor >= 2 && factor * loop.size > PARTIAL_UNROLL_SIZE) factor /= 2;
+    return factor;
+}
+
+/**
+ * Unroll the innermost counted loops.
+ * A loop with a small constant trip count is fully unrolled, and the other counted loops which step towards
+ * their bound are unrolled by a factor chosen from the body size, or by the --unroll-factor option.
+ */
+bool loopUnrolling(shared_ptr<Function> &func) {
+    if (_unrollFactor == 1) return false;
+    FunctionAnalysis &analysis = getFunctionAnalysis(func);
+    // the analysis is not updated while unrolling, each loop is checked again just before it is unrolled.
+    vector<Loop *> innermostLoops;
+    for (auto &loop : analysis.getLoops()) {
+        if (loop->children.empty()) innermostLoops.push_back(loop.get());
+    }
+    const vector<shared_ptr<BasicBlock>> reversePostOrder = analysis.getReversePostOrder();
+    bool changed = false;
+    for (auto &loop : innermostLoops) {
+        CountedLoop counted;
+        if (!findCountedLoop(loop, reversePostOrder, counted)) continue;
+        unsigned int trips = constantTripCount(counted);
+        if (trips != 0 && trips * counted.size <= FULL_UNROLL_SIZE) {
+            fullyUnroll(counted, trips);
+            changed = true;
+            continue;
+        }
+        // the vector loop covers the iterations of a partially unrolled one.
+        if (isVectorizableLoop(loop)) continue;
+        bool towardsBound = ((counted.op == OP_LT || counted.op == OP_LE) && counted.step > 0)
+                            || ((counted.op == OP_GT || counted.op == OP_GE) && counted.step < 0);
+        unsigned int factor = partialUnrollFactor(counted);
+        if (!towardsBound || factor < 2 || (trips != 0 && trips < factor)) continue;
+        if (partiallyUnroll(counted, factor)) changed = true;
+    }
+    return changed;
+}
@@ -0,0 +1,421 @@
+#include "ir_optimize.h"
+#include "../../basic/std/compile_std.h"
+
+// the vector loop keeps its values in q8 to q15, which the scalar code never uses.
+const unsigned int MAX_VECTOR_REGS = 8;
+// the vector loop keeps its counter and a pointer to each array in the temp registers, leaving one for the rest.
+const unsigned int MAX_VECTOR_ARRAYS = 3;
+// a loop running fewer times than this is not worth setting up the vector loop.
+const int MIN_VECTOR_TRIPS = 2 * VECTOR_LANES;
+
+/**
+ * The words at array[base + iv + offset], base is loop invariant, or null for 0.
+ */
+struct ArrayAccess {
+    shared_ptr<Value> array;
+    shared_ptr<Value> base;
+    int offset = 0;
+
+    bool sameWords(const ArrayAccess &access) const {
+        return array == access.array && base == access.base && offset == access.offset;
+    }
+};
+
+/**
+ * An innermost loop of blocks jumping one to the next, going on while its induction variable plus 1 is less than,
+ * or not greater than a loop invariant bound. The body only loads and stores the words at the induction variable
+ * of the arrays, computes them by +, - and *, and adds one value to a sum.
+ * The body runs at least once each time the loop is entered.
+ */
+struct VectorLoop {
+    shared_ptr<BasicBlock> header;
+    shared_ptr<BasicBlock> latch;
+    vector<shared_ptr<BasicBlock>> blocks; // from the header to the latch.
+    unordered_set<shared_ptr<BasicBlock>> blockSet;
+    shared_ptr<BasicBlock> preheader;
+    shared_ptr<PhiInstruction> inductionVariable;
+    shared_ptr<Value> bound;
+    bool inclusive = false;
+    shared_ptr<PhiInstruction> reduction; // the sum, null if nothing is summed up.
+    shared_ptr<BinaryInstruction> reductionUpdate;
+
+    // the vector form, operands[0] and operands[1] are left for the count and the initial sum,
+    // and each load and store takes two operands, its array and its first offset, filled when vectorized.
+    vector<VectorOp> ops;
+    vector<shared_ptr<Value>> operands;
+    unordered_map<int, ArrayAccess> accesses; // operand index of the array <--> access.
+    unordered_map<Value *, int> opOfValue;
+};
+
+bool inBody(const shared_ptr<Value> &value, VectorLoop &loop) {
+    return value->valueType == INSTRUCTION && loop.blockSet.count(s_p_c<Instruction>(value)->block) != 0;
+}
+
+/**
+ * Match value as base + iv + offset.
+ */
+bool matchIndex(const shared_ptr<Value> &value, VectorLoop &loop, shared_ptr<Value> &base, int &offset) {
+    shared_ptr<Value> root = stripOffsets(value, offset);
+    base = nullptr;
+    if (root == loop.inductionVariable) return true;
+    if (root->valueType != INSTRUCTION || s_p_c<Instruction>(root)->type != BINARY) return false;
+    shared_ptr<BinaryInstruction> add = s_p_c<BinaryInstruction>(root);
+    if (add->op != OP_ADD) return false;
+    int indexOffset;
+    if (!inBody(add->lhs, loop) && stripOffsets(add->rhs, indexOffset) == loop.inductionVariable) {
+        base = add->lhs;
+    } else if (!inBody(add->rhs, loop) && stripOffsets(add->lhs, indexOffset) == loop.inductionVariable) {
+        base = add->rhs;
+    } else {
+        return false;
+    }
+    offset += indexOffset;
+    return true;
+}
+
+bool isArray(const shared_ptr<Value> &value) {
+    switch (value->valueType) {
+        case GLOBAL:
+            return s_p_c<GlobalValue>(value)->variableType == POINTER;
+        case CONSTANT:
+            return true;
+        case PARAMETER:
+            return s_p_c<ParameterValue>(value)->variableType == POINTER;
+        case INSTRUCTION:
+            return s_p_c<Instruction>(value)->type == ALLOC || s_p_c<Instruction>(value)->type == BINARY;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Whether two different arrays may share words: a pointer parameter may point into any global array or
+ * any array of the callers, and a pointer computed by a binary IR may point into anything.
+ */
+bool mayAlias(const shared_ptr<Value> &a, const shared_ptr<Value> &b) {
+    if (a == b) return true;
+    if (a->valueType == INSTRUCTION && s_p_c<Instruction>(a)->type == BINARY) return true;
+    if (b->valueType == INSTRUCTION && s_p_c<Instruction>(b)->type == BINARY) return true;
+    if (a->valueType == PARAMETER) return b->valueType == PARAMETER || b->valueType == GLOBAL;
+    if (b->valueType == PARAMETER) return a->valueType == GLOBAL;
+    return false;
+}
+
+int addAccess(const shared_ptr<Value> &array, const shared_ptr<Value> &offset, VectorLoop &loop) {
+    ArrayAccess access;
+    if (inBody(array, loop) || !isArray(array) || !matchIndex(offset, loop, access.base, access.offset)) return -1;
+    access.array = array;
+    int operand = (int) loop.operands.size();
+    loop.operands.push_back(array);
+    loop.operands.push_back(nullptr);
+    loop.accesses[operand] = access;
+    return operand;
+}
+
+/**
+ * The op computing the value in each lane, a loop invariant number or variable is splat.
+ */
+int vectorOperand(const shared_ptr<Value> &value, VectorLoop &loop) {
+    auto it = loop.opOfValue.find(value.get());
+    if (it != loop.opOfValue.end()) return it->second;
+    if (inBody(value, loop)) return -1;
+    if (value->valueType == INSTRUCTION && s_p_c<Instruction>(value)->type == ALLOC) return -1;
+    if (value->valueType != NUMBER && value->valueType != INSTRUCTION
+        && (value->valueType != PARAMETER || s_p_c<ParameterValue>(value)->variableType != INT)) {
+        return -1;
+    }
+    loop.ops.push_back({V_SPLAT, OP_ADD, -1, -1, (int) loop.operands.size()});
+    loop.operands.push_back(value);
+    loop.opOfValue[value.get()] = (int) loop.ops.size() - 1;
+    return (int) loop.ops.size() - 1;
+}
+
+/**
+ * Find the induction variable and the bound from the branch at the end of the latch.
+ */
+bool findVectorLoopBound(VectorLoop &loop) {
+    shared_ptr<Instruction> last = loop.latch->instructions.back();
+    if (last->type != BR) return false;
+    shared_ptr<BranchInstruction> br = s_p_c<BranchInstruction>(last);
+    bool goOnIfTrue = br->trueBlock == loop.header;
+    if (goOnIfTrue == (br->falseBlock == loop.header)) return false;
+    if (br->condition->valueType != INSTRUCTION || s_p_c<Instruction>(br->condition)->type != CMP) return false;
+    shared_ptr<BinaryInstruction> cmp = s_p_c<BinaryInstruction>(br->condition);
+    if (!cmp->hasOneUser()) return false;
+    for (auto &phi : loop.header->phis) {
+        shared_ptr<Value> update = phi->operands.at(loop.latch);
+        if (update != cmp->lhs && update != cmp->rhs) continue;
+        int step;
+        if (stripOffsets(update, step) != phi || step != 1) continue;
+        loop.inductionVariable = phi;
+        loop.bound = update == cmp->lhs ? cmp->rhs : cmp->lhs;
+        IrOp op = update == cmp->lhs ? cmp->op : swappedOp(cmp->op);
+        if (!goOnIfTrue) op = inverseOp(op);
+        loop.inclusive = op == OP_LE;
+        return !inBody(loop.bound, loop) && (op == OP_LT || op == OP_LE);
+    }
+    return false;
+}
+
+/**
+ * A phi summing up a value, which has no other use in the body.
+ */
+bool findReduction(shared_ptr<PhiInstruction> &phi, VectorLoop &loop) {
+    shared_ptr<Value> update = phi->operands.at(loop.latch);
+    if (!inBody(update, loop) || s_p_c<Instruction>(update)->type != BINARY) return false;
+    shared_ptr<BinaryInstruction> add = s_p_c<BinaryInstruction>(update);
+    if (add->op != OP_ADD || (add->lhs != phi && add->rhs != phi) || add->lhs == add->rhs) return false;
+    for (auto &user : phi->getUsers()) {
+        if (user.get() != add.get() && inBody(user, loop)) {
+            return false;
+        }
+    }
+    for (auto &user : add->getUsers()) {
+        if (user.get() != phi.get() && inBody(user, loop)) {
+            return false;
+        }
+    }
+    loop.reduction = phi;
+    loop.reductionUpdate = add;
+    return true;
+}
+
+/**
+ * Add the vector form of an instruction of the body, the loop control is left out, and so are the instructions
+ * computing the indexes, which are only used by the loads and stores.
+ */
+bool buildVectorOp(const shared_ptr<Instruction> &ins, VectorLoop &loop, bool control) {
+    if (control || ins->type == JMP) return true;
+    if (ins->type == LOAD) {
+        shared_ptr<LoadInstruction> load = s_p_c<LoadInstruction>(ins);
+        int operand = addAccess(load->address, load->offset, loop);
+        if (operand < 0) return false;
+        loop.ops.push_back({V_LOAD, OP_ADD, -1, -1, operand});
+        loop.opOfValue[ins.get()] = (int) loop.ops.size() - 1;
+    } else if (ins->type == STORE) {
+        shared_ptr<StoreInstruction> store = s_p_c<StoreInstruction>(ins);
+        int value = vectorOperand(store->value, loop);
+        int operand = addAccess(store->address, store->offset, loop);
+        if (value < 0 || operand < 0) return false;
+        loop.ops.push_back({V_STORE, OP_ADD, value, -1, operand});
+    } else if (ins->type == BINARY) {
+        shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(ins);
+        shared_ptr<Value> base;
+        int offset;
+        if (matchIndex(ins, loop, base, offset)) return true;
+        if (binary->op != OP_ADD && binary->op != OP_SUB && binary->op != OP_MUL) return false;
+        int lhs = vectorOperand(binary->lhs, loop);
+        int rhs = vectorOperand(binary->rhs, loop);
+        if (lhs < 0 || rhs < 0) return false;
+        loop.ops.push_back({V_BINARY, binary->op, lhs, rhs, -1});
+        loop.opOfValue[ins.get()] = (int) loop.ops.size() - 1;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Build the vector form of the body, following the instructions in order.
+ */
+bool buildVectorOps(VectorLoop &loop) {
+    shared_ptr<Instruction> last = loop.latch->instructions.back();
+    shared_ptr<Value> cmp = s_p_c<BranchInstruction>(last)->condition;
+    for (auto &bb : loop.blocks) {
+        for (auto &ins : bb->instructions) {
+            if (!buildVectorOp(ins, loop, ins == cmp || ins == last || ins == loop.reductionUpdate)) return false;
+        }
+    }
+    if (loop.reduction != nullptr) {
+        shared_ptr<Value> &add = loop.reductionUpdate->lhs == loop.reduction ? loop.reductionUpdate->rhs
+                                                                              : loop.reductionUpdate->lhs;
+        int value = vectorOperand(add, loop);
+        if (value < 0) return false;
+        loop.ops.push_back({V_REDUCE, OP_ADD, value, -1, -1});
+    }
+    return true;
+}
+
+/**
+ * The arrays stored to must not share words with the other arrays, except for the same words of the same array.
+ * The registers holding the vectors and the array pointers must be enough.
+ */
+bool checkVectorOps(VectorLoop &loop) {
+    unsigned int regs = loop.reduction == nullptr ? 0 : 1;
+    bool stores = loop.reduction != nullptr;
+    vector<ArrayAccess> arrays;
+    for (auto &op : loop.ops) {
+        if (op.type == V_STORE) stores = true;
+        if (op.type != V_STORE && op.type != V_REDUCE) ++regs;
+        if (op.type != V_LOAD && op.type != V_STORE) continue;
+        const ArrayAccess &access = loop.accesses.at(op.operand);
+        bool found = false;
+        for (auto &array : arrays) found = found || array.sameWords(access);
+        if (!found) arrays.push_back(access);
+        if (op.type == V_LOAD) continue;
+        for (auto &other : loop.ops) {
+            if (&other == &op || (other.type != V_LOAD && other.type != V_STORE)) continue;
+            const ArrayAccess &otherAccess = loop.accesses.at(other.operand);
+            if (mayAlias(access.array, otherAccess.array) && !access.sameWords(otherAccess)) return false;
+        }
+    }
+    return stores && regs <= MAX_VECTOR_REGS && arrays.size() <= MAX_VECTOR_ARRAYS;
+}
+
+/**
+ * The blocks of the loop from the header to the latch, each of them jumps to the next.
+ */
+bool findVectorLoopBlocks(Loop *loop, VectorLoop &vectorLoop) {
+    vectorLoop.header = loop->header;
+    vectorLoop.latch = loop->latches.front();
+    vectorLoop.blockSet = loop->blocks;
+    shared_ptr<BasicBlock> bb = loop->header;
+    while (true) {
+        if (bb != loop->header && (!bb->phis.empty() || bb->predecessors.size() != 1)) return false;
+        vectorLoop.blocks.push_back(bb);
+        if (bb == vectorLoop.latch) break;
+        shared_ptr<Instruction> &last = bb->instructions.back();
+        if (last->type != JMP) return false;
+        bb = s_p_c<JumpInstruction>(last)->targetBlock;
+        if (!loop->contains(bb) || bb == loop->header) return false;
+    }
+    return vectorLoop.blocks.size() == loop->blocks.size();
+}
+
+bool findVectorLoop(Loop *loop, VectorLoop &vectorLoop) {
+    if (!loop->children.empty() || loop->latches.size() != 1 || !findVectorLoopBlocks(loop, vectorLoop)) return false;
+    for (auto &pred : loop->header->predecessors) {
+        if (loop->contains(pred)) continue;
+        if (vectorLoop.preheader != nullptr) return false;
+        vectorLoop.preheader = pred;
+    }
+    if (vectorLoop.preheader == nullptr || !findVectorLoopBound(vectorLoop)) return false;
+    for (auto &phi : vectorLoop.header->phis) {
+        if (phi->operands.size() != 2 || phi->operands.count(vectorLoop.preheader) == 0) return false;
+        if (phi == vectorLoop.inductionVariable) continue;
+        if (vectorLoop.reduction != nullptr) return false;
+        shared_ptr<PhiInstruction> reduction = phi;
+        if (!findReduction(reduction, vectorLoop)) return false;
+    }
+    shared_ptr<Value> init = vectorLoop.inductionVariable->operands.at(vectorLoop.preheader);
+    if (init->valueType == NUMBER && vectorLoop.bound->valueType == NUMBER) {
+        long long trips = (long long) s_p_c<NumberValue>(vectorLoop.bound)->number
+                          - s_p_c<NumberValue>(init)->number + (vectorLoop.inclusive ? 1 : 0);
+        if (trips < MIN_VECTOR_TRIPS) return false;
+    }
+    vectorLoop.operands.resize(2);
+    return buildVectorOps(vectorLoop) && checkVectorOps(vectorLoop);
+}
+
+bool isVectorizableLoop(Loop *loop) {
+    VectorLoop vectorLoop;
+    return _vectorize && findVectorLoop(loop, vectorLoop);
+}
+
+/**
+ * lhs op rhs at the end of bb, folded if both are numbers.
+ */
+shared_ptr<Value> computeAtEnd(IrOp op, shared_ptr<Value> lhs, shared_ptr<Value> rhs, shared_ptr<BasicBlock> &bb) {
+    int result;
+    if (lhs->valueType == NUMBER && rhs->valueType == NUMBER
+        && computeBinary(op, s_p_c<NumberValue>(lhs)->number, s_p_c<NumberValue>(rhs)->number, result)) {
+        return getNumberValue(result);
+    }
+    if (rhs->valueType == NUMBER && s_p_c<NumberValue>(rhs)->number == 0 && (op == OP_ADD || op == OP_SUB)) {
+        return lhs;
+    }
+    if (lhs->valueType == NUMBER && s_p_c<NumberValue>(lhs)->number == 0 && op == OP_ADD) return rhs;
+    markLeftValue(lhs);
+    markLeftValue(rhs);
+    shared_ptr<Instruction> ins = newIr<BinaryInstruction>(op, lhs, rhs, bb);
+    bb->instructions.push_back(ins);
+    return ins;
+}
+
+/**
+ * Run the first groups of VECTOR_LANES iterations by a vector loop, and the rest by the loop itself:
+ *
+ *   preheader -> check:    more than VECTOR_LANES iterations run ? vector : body
+ *   vector -> body:        the vector loop runs (trips - 1) / VECTOR_LANES times, then the body runs the rest,
+ *                          starting from the induction variable and the sum the vector loop stops at.
+ *
+ * The body still runs at least once, so the values used after the loop are kept.
+ */
+void vectorizeLoop(VectorLoop &loop) {
+    shared_ptr<Function> func = loop.header->function;
+    unsigned int outerDepth = loop.header->loopDepth > 0 ? loop.header->loopDepth - 1 : 0;
+    shared_ptr<BasicBlock> check = newIr<BasicBlock>(func, true, outerDepth);
+    shared_ptr<BasicBlock> vectorBlock = newIr<BasicBlock>(func, true, outerDepth);
+
+    shared_ptr<Value> init = loop.inductionVariable->operands.at(loop.preheader);
+    shared_ptr<Value> trips = computeAtEnd(OP_SUB, loop.bound, init, check);
+    if (loop.inclusive) trips = computeAtEnd(OP_ADD, trips, getNumberValue(1), check);
+    markLeftValue(trips);
+    shared_ptr<Value> lanes = getNumberValue(VECTOR_LANES);
+    // a constant trip count is known to be enough for the vector loop.
+    bool alwaysEnter = trips->valueType == NUMBER;
+    if (alwaysEnter) {
+        jumpTo(check, vectorBlock);
+    } else {
+        shared_ptr<Value> enter = newIr<BinaryInstruction>(OP_GT, trips, lanes, check);
+        check->instructions.push_back(s_p_c<Instruction>(enter));
+        branchTo(check, enter, vectorBlock, loop.header);
+    }
+    replaceSuccessor(loop.preheader, loop.header, check);
+
+    shared_ptr<Value> count = computeAtEnd(OP_SUB, trips, getNumberValue(1), vectorBlock);
+    count = computeAtEnd(OP_DIV, count, lanes, vectorBlock);
+    loop.operands[0] = count;
+    loop.operands[1] = loop.reduction != nullptr ? loop.reduction->operands.at(loop.preheader) : getNumberValue(0);
+    // the accesses to the same words share their first offset, so that they share a pointer in the vector loop.
+    vector<pair<ArrayAccess, shared_ptr<Value>>> starts;
+    for (auto &it : loop.accesses) {
+        ArrayAccess &access = it.second;
+        shared_ptr<Value> start;
+        for (auto &known : starts) {
+            if (known.first.sameWords(access)) start = known.second;
+        }
+        if (start == nullptr) {
+            start = computeAtEnd(OP_ADD, init, getNumberValue(access.offset), vectorBlock);
+            if (access.base != nullptr) start = computeAtEnd(OP_ADD, access.base, start, vectorBlock);
+            starts.emplace_back(access, start);
+        }
+        loop.operands[it.first + 1] = start;
+    }
+    for (auto &operand : loop.operands) markLeftValue(operand);
+    shared_ptr<Instruction> vectorIns = newIr<VectorInstruction>(loop.operands, loop.ops, vectorBlock);
+    vectorBlock->instructions.push_back(vectorIns);
+    shared_ptr<Value> vectorEnd = computeAtEnd(OP_MUL, count, lanes, vectorBlock);
+    vectorEnd = computeAtEnd(OP_ADD, init, vectorEnd, vectorBlock);
+    markLeftValue(vectorEnd);
+    jumpTo(vectorBlock, loop.header);
+
+    shared_ptr<BasicBlock> &enterBody = alwaysEnter ? vectorBlock : check;
+    for (auto &phi : loop.header->phis) phi->replaceUse(loop.preheader, enterBody);
+    loop.inductionVariable->setOperand(vectorBlock, vectorEnd);
+    if (loop.reduction != nullptr) {
+        vectorIns->resultType = L_VAL_RESULT;
+        vectorIns->caughtVarName = generateTempLeftValueName();
+        loop.reduction->setOperand(vectorBlock, vectorIns);
+    }
+    vector<shared_ptr<BasicBlock>> newBlocks = {check, vectorBlock};
+    insertBlocks(func, loop.header, newBlocks);
+}
+
+/**
+ * Vectorize the innermost counted loops of int arrays by NEON, after the IR is optimized,
+ * so that the other passes never see the vector IR.
+ */
+void loopVectorization(shared_ptr<Function> &func) {
+    if (!_vectorize) return;
+    vector<Loop *> loops;
+    for (auto &loop : getFunctionAnalysis(func).getLoops()) loops.push_back(loop.get());
+    bool changed = false;
+    for (auto &loop : loops) {
+        VectorLoop vectorLoop;
+        if (!findVectorLoop(loop, vectorLoop)) continue;
+        vectorizeLoop(vectorLoop);
+        changed = true;
+    }
+    if (changed) invalidateFunctionAnalysis(func);
+}
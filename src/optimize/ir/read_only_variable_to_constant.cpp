@@ -1,7 +1,7 @@
 #include "ir_optimize.h"
 
 bool globalVarHasWriteUser(const shared_ptr<Value> &globalVar) {
-    for (auto &user : globalVar->users) {
+    for (auto &user : globalVar->getUsers()) {
         if (dynamic_cast<StoreInstruction *>(user.get())) return true;
         if (dynamic_cast<InvokeInstruction *>(user.get())) return true;
         if (dynamic_cast<BinaryInstruction *>(user.get()))
@@ -20,36 +20,33 @@ void globalVariableToConstant(shared_ptr<Value> &globalVar, shared_ptr<Module> &
     shared_ptr<GlobalValue> global = s_p_c<GlobalValue>(globalVar);
     if (global->variableType == VariableType::INT) {
         shared_ptr<Value> constantNumber = getNumberValue(global->initValues.at(0));
-        unordered_set<shared_ptr<Value>> users = global->users;
+        vector<shared_ptr<Value>> users = global->getUsers();
         for (auto user : users) {
             if (!dynamic_cast<LoadInstruction *>(user.get())) {
                 cerr << "Error occurs in process global variable to constant:"
                         " global has other type users except load." << endl;
             } else {
-                unordered_set<shared_ptr<Value>> userUsers = user->users;
-                for (auto &loadUser : userUsers) {
-                    loadUser->replaceUse(user, constantNumber);
-                }
+                user->replaceAllUsesWith(constantNumber);
                 user->abandonUse();
             }
         }
         global->abandonUse();
     } else {
-        shared_ptr<Value> constantArray = make_shared<ConstantValue>(global);
-        unordered_set<shared_ptr<Value>> users = global->users;
-        for (auto &user : users) {
-            user->replaceUse(globalVar, constantArray);
-        }
+        shared_ptr<Value> constantArray = newIr<ConstantValue>(global);
+        global->replaceAllUsesWith(constantArray);
         global->abandonUse();
         module->globalConstants.push_back(constantArray);
     }
 }
 
-void readOnlyVariableToConstant(shared_ptr<Module> &module) {
+bool readOnlyVariableToConstant(shared_ptr<Module> &module) {
+    bool changed = false;
     vector<shared_ptr<Value>> globalVariables = module->globalVariables;
     for (auto &globalVar : globalVariables) {
         if (!globalVarHasWriteUser(globalVar)) {
             globalVariableToConstant(globalVar, module);
+            changed = true;
         }
     }
+    return changed;
 }
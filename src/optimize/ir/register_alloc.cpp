@@ -1,467 +1,516 @@
 #include "ir_optimize.h"
 
-#include <stack>
-#include <queue>
-#include <ctime>
+#include <algorithm>
 #include <set>
+#include <tuple>
 
-time_t startAllocTime;
-bool conflictGraphBuildSuccess;
-unsigned long CONFLICT_GRAPH_TIMEOUT = 10;
+typedef vector<unsigned long long> LiveSet; // bitset over the dense ids of liveValues.
 
-unordered_map<shared_ptr<Value>, shared_ptr<unordered_set<shared_ptr<Value>>>> conflictGraph;
-unordered_map<shared_ptr<BasicBlock>, shared_ptr<unordered_map<shared_ptr<BasicBlock>,
-        unordered_set<shared_ptr<BasicBlock>>>>> blockPath;
+/**
+ * Register alloc state of one function, the functions may be allocated in parallel.
+ * The containers are fresh for each function, so the allocation does not depend on the functions before.
+ */
+struct RegisterAllocContext {
+    // the values which may own a global register: parameters and l-values, indexed by dense id.
+    vector<shared_ptr<Value>> liveValues;
+    unordered_map<Value *, unsigned int> liveValueIds;
 
-inline bool checkRegAllocTimeout(time_t startTime, unsigned long timeout) {
-    if (time(nullptr) - startTime > timeout) {
-        conflictGraphBuildSuccess = false;
-        return true;
-    }
-    return false;
-}
+    vector<unordered_set<unsigned int>> conflictGraph; // dense id <--> conflicting dense ids.
+    vector<tuple<unsigned long long, unsigned int, unsigned int>> moves; // weight, dense ids of the copy.
+};
+
+void initConflictGraph(RegisterAllocContext &ctx, shared_ptr<Function> &func);
+
+void buildConflictGraph(RegisterAllocContext &ctx, shared_ptr<Function> &func);
 
-void initConflictGraph(shared_ptr<Function> &func);
+void collectMoves(RegisterAllocContext &ctx, shared_ptr<Function> &func);
 
-void buildConflictGraph(shared_ptr<Function> &func);
+vector<unsigned int> coalesceMoves(RegisterAllocContext &ctx, vector<unsigned long long> &weights);
 
-void allocRegister(shared_ptr<Function> &func);
+void allocRegister(RegisterAllocContext &ctx, shared_ptr<Function> &func);
 
-void addAliveValue(shared_ptr<Instruction> &value, shared_ptr<Instruction> &owner,
-                   shared_ptr<BasicBlock> &ownerBlock);
+void getInstructionOperands(const shared_ptr<Instruction> &ins, const shared_ptr<BasicBlock> &bb,
+                            vector<Value *> &operands);
 
-void addAliveValue(shared_ptr<Value> &value, shared_ptr<Instruction> &owner,
-                   shared_ptr<BasicBlock> &ownerBlock);
+void computeBlockLiveness(RegisterAllocContext &ctx, shared_ptr<Function> &func,
+                          unordered_map<BasicBlock *, LiveSet> &liveIn, unordered_map<BasicBlock *, LiveSet> &liveOut,
+                          unordered_map<BasicBlock *, LiveSet> &kill);
 
-unordered_set<shared_ptr<BasicBlock>>
-getBlockPathPoints(shared_ptr<BasicBlock> &from, shared_ptr<BasicBlock> &to);
+unordered_set<shared_ptr<Value>> liveSetToValues(RegisterAllocContext &ctx, const LiveSet &live);
 
-void getBlockReachableBlocks(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &cannotArrive,
-                             unordered_set<shared_ptr<BasicBlock>> &ans);
+void addConflict(RegisterAllocContext &ctx, unsigned int a, unsigned int b);
 
-void outputConflictGraph(const string &funcName);
+void outputConflictGraph(RegisterAllocContext &ctx, const string &funcName);
+
+unsigned int loopPressure(RegisterAllocContext &ctx, Loop *loop, unordered_map<BasicBlock *, LiveSet> &liveOut,
+                          const vector<bool> &spilled);
+
+shared_ptr<Instruction> insertCopy(shared_ptr<Value> &value, shared_ptr<BasicBlock> &bb,
+                                   list<shared_ptr<Instruction>>::iterator pos);
+
+inline bool liveSetTest(const LiveSet &live, unsigned int id) { return (live[id >> 6] >> (id & 63)) & 1; }
+
+inline void liveSetInsert(LiveSet &live, unsigned int id) { live[id >> 6] |= 1ULL << (id & 63); }
+
+inline void liveSetErase(LiveSet &live, unsigned int id) { live[id >> 6] &= ~(1ULL << (id & 63)); }
 
 void registerAlloc(shared_ptr<Function> &func) {
-    conflictGraph.clear();
-    blockPath.clear();
-    initConflictGraph(func);
-    conflictGraphBuildSuccess = true;
-    startAllocTime = time(nullptr);
-    buildConflictGraph(func);
-    if (_debugIrOptimize) outputConflictGraph(func->name);
-    if (conflictGraphBuildSuccess) allocRegister(func);
-    else {
-        cerr << "Time out when building conflict graph of function " << func->name << "." << endl;
-    }
+    RegisterAllocContext ctx;
+    initConflictGraph(ctx, func);
+    buildConflictGraph(ctx, func);
+    if (_debugIrOptimize) outputConflictGraph(ctx, func->name);
+    collectMoves(ctx, func);
+    allocRegister(ctx, func);
 }
 
-void initConflictGraph(shared_ptr<Function> &func) {
+void initConflictGraph(RegisterAllocContext &ctx, shared_ptr<Function> &func) {
     for (auto &arg : func->params) {
-        shared_ptr<unordered_set<shared_ptr<Value>>> tempSet
-                = make_shared<unordered_set<shared_ptr<Value>>>();
-        conflictGraph[arg] = tempSet;
+        ctx.liveValueIds[arg.get()] = ctx.liveValues.size();
+        ctx.liveValues.push_back(arg);
     }
     for (auto &bb : func->blocks) {
         for (auto &ins : bb->instructions) {
-            if (ins->resultType == L_VAL_RESULT && conflictGraph.count(ins) == 0) {
-                shared_ptr<unordered_set<shared_ptr<Value>>> tempSet
-                        = make_shared<unordered_set<shared_ptr<Value>>>();
-                conflictGraph[ins] = tempSet;
+            if (ins->resultType == L_VAL_RESULT && ctx.liveValueIds.count(ins.get()) == 0) {
+                ctx.liveValueIds[ins.get()] = ctx.liveValues.size();
+                ctx.liveValues.push_back(ins);
             }
         }
     }
+    ctx.conflictGraph.resize(ctx.liveValues.size());
 }
 
 /**
- * These codes maybe redundant.
- * @param func
+ * Backward liveness over per-block bitsets, then every l-value conflicts with the values alive just after its
+ * definition, and the parameters alive at the entry conflict with each other.
+ * The values alive at an instruction include its operands but not its result, but the values alive at an invoke
+ * are only the ones alive across the call, which the caller has to keep.
  */
-void buildConflictGraph(shared_ptr<Function> &func) {
-    /// judge parameters.
-    for (auto &ins : func->params) {
-        if (checkRegAllocTimeout(startAllocTime, CONFLICT_GRAPH_TIMEOUT)) return;
-        for (auto &user : ins->users) {
-            if (checkRegAllocTimeout(startAllocTime, CONFLICT_GRAPH_TIMEOUT)) return;
-            if (user->valueType != INSTRUCTION) {
-                cerr << "Error occurs in register alloc: got a non-instruction user." << endl;
-            }
-            shared_ptr<Instruction> userIns = s_p_c<Instruction>(user);
-            if (userIns->type == PHI) {
-                shared_ptr<PhiMoveInstruction> phiMov = s_p_c<PhiInstruction>(userIns)->phiMove;
-                for (auto &op : phiMov->phi->operands) {
-                    if (op.second == ins) {
-                        shared_ptr<BasicBlock> phiMovLocation = op.first;
-                        if (phiMovLocation->aliveValues.count(ins) != 0) continue;
-                        else if (phiMov->blockALiveValues.at(phiMovLocation).count(ins) != 0) continue;
-                        auto it = func->entryBlock->instructions.begin();
-                        bool searchOtherBlocks = true;
-                        while (it != func->entryBlock->instructions.end()) {
-                            addAliveValue(ins, *it, func->entryBlock);
-                            if (*it == phiMov && phiMovLocation == func->entryBlock) {
-                                searchOtherBlocks = false;
-                                break;
-                            }
-                            ++it;
-                        }
-                        if (searchOtherBlocks) {
-                            unordered_set<shared_ptr<BasicBlock>> pathNodes;
-                            if (blockPath.count(func->entryBlock) != 0) {
-                                if (blockPath.at(func->entryBlock)->count(phiMovLocation) != 0) {
-                                    pathNodes = blockPath.at(func->entryBlock)->at(phiMovLocation);
-                                } else {
-                                    pathNodes = getBlockPathPoints(func->entryBlock, phiMovLocation);
-                                }
-                            } else pathNodes = getBlockPathPoints(func->entryBlock, phiMovLocation);
-                            for (auto &b : pathNodes) {
-                                b->aliveValues.insert(ins);
-                            }
-                            it = phiMovLocation->instructions.begin();
-                            while (it != phiMovLocation->instructions.end()) {
-                                addAliveValue(ins, *it, phiMovLocation);
-                                if (*it == phiMov) break;
-                                ++it;
-                            }
-                        }
-                    }
-                }
-            } else {
-                if (userIns->block->aliveValues.count(ins) != 0 || userIns->aliveValues.count(ins) != 0) {
-                    continue;
-                } else { // mark this instruction alive all along the path to userIns.
-                    auto it = func->entryBlock->instructions.begin();
-                    bool searchOtherBlocks = true;
-                    while (it != func->entryBlock->instructions.end()) {
-                        addAliveValue(ins, *it, func->entryBlock);
-                        if (*it == userIns) {
-                            searchOtherBlocks = false;
-                            break;
-                        }
-                        ++it;
-                    }
-                    // the user is not just after the insVal, search for block paths.
-                    if (searchOtherBlocks) {
-                        // maintain the passing block and add them to alive nodes.
-                        unordered_set<shared_ptr<BasicBlock>> pathNodes;
-                        if (blockPath.count(func->entryBlock) != 0) {
-                            if (blockPath.at(func->entryBlock)->count(userIns->block) != 0) {
-                                pathNodes = blockPath.at(func->entryBlock)->at(userIns->block);
-                            } else {
-                                pathNodes = getBlockPathPoints(func->entryBlock, userIns->block);
-                            }
-                        } else {
-                            pathNodes = getBlockPathPoints(func->entryBlock, userIns->block);
-                        }
-                        for (auto &b : pathNodes) {
-                            b->aliveValues.insert(ins);
-                        }
-                        // search the user block and mark alive.
-                        it = userIns->block->instructions.begin();
-                        while (it != userIns->block->instructions.end()) {
-                            addAliveValue(ins, *it, userIns->block);
-                            if (*it == userIns) {
-                                break;
-                            }
-                            ++it;
-                        }
+void buildConflictGraph(RegisterAllocContext &ctx, shared_ptr<Function> &func) {
+    unordered_map<BasicBlock *, LiveSet> liveIn, liveOut, kill;
+    computeBlockLiveness(ctx, func, liveIn, liveOut, kill);
+    vector<Value *> operands;
+    for (auto &bb : func->blocks) {
+        LiveSet live = liveOut.at(bb.get());
+        for (auto ins = bb->instructions.rbegin(); ins != bb->instructions.rend(); ++ins) {
+            if (ctx.liveValueIds.count(ins->get()) != 0) {
+                unsigned int def = ctx.liveValueIds.at(ins->get());
+                for (unsigned int i = 0; i < live.size(); ++i) {
+                    for (unsigned long long word = live[i]; word != 0; word &= word - 1) {
+                        unsigned int id = (i << 6) + __builtin_ctzll(word);
+                        if (id != def) addConflict(ctx, def, id);
                     }
                 }
+                liveSetErase(live, def);
             }
+            if ((*ins)->type == INVOKE) (*ins)->aliveValues = liveSetToValues(ctx, live);
+            operands.clear();
+            getInstructionOperands(*ins, bb, operands);
+            for (auto op : operands) {
+                if (ctx.liveValueIds.count(op) != 0) liveSetInsert(live, ctx.liveValueIds.at(op));
+            }
+            if ((*ins)->type == PHI_MOV) {
+                s_p_c<PhiMoveInstruction>(*ins)->blockALiveValues[bb] = liveSetToValues(ctx, live);
+            } else if ((*ins)->type != INVOKE) {
+                (*ins)->aliveValues = liveSetToValues(ctx, live);
+            }
+        }
+        LiveSet through = liveIn.at(bb.get());
+        const LiveSet &out = liveOut.at(bb.get());
+        const LiveSet &blockKill = kill.at(bb.get());
+        for (unsigned int i = 0; i < through.size(); ++i) {
+            through[i] &= out[i] & ~blockKill[i];
         }
+        bb->aliveValues = liveSetToValues(ctx, through);
     }
-    /// judge instructions.
-    for (auto &bb : func->blocks) {
-        if (checkRegAllocTimeout(startAllocTime, CONFLICT_GRAPH_TIMEOUT)) return;
-        for (auto ins = bb->instructions.begin(); ins != bb->instructions.end(); ++ins) {
-            if (checkRegAllocTimeout(startAllocTime, CONFLICT_GRAPH_TIMEOUT)) return;
-            shared_ptr<Instruction> insVal = *ins;
-            if (insVal->type != PHI_MOV && insVal->resultType == L_VAL_RESULT) {
-                for (auto &user : insVal->users) {
-                    if (checkRegAllocTimeout(startAllocTime, CONFLICT_GRAPH_TIMEOUT)) return;
-                    if (user->valueType != INSTRUCTION) {
-                        cerr << "Error occurs in register alloc: got a non-instruction user." << endl;
-                    }
-                    shared_ptr<Instruction> userIns = s_p_c<Instruction>(user);
-                    if (userIns->type == PHI) { // deal with phi user.
-                        // find the phi move location(can be many).
-                        shared_ptr<PhiMoveInstruction> phiMov = s_p_c<PhiInstruction>(userIns)->phiMove;
-                        for (auto &op : phiMov->phi->operands) {
-                            if (op.second == insVal) {
-                                shared_ptr<BasicBlock> phiMovLocation = op.first;
-                                if (phiMovLocation->aliveValues.count(insVal) != 0) {
-                                    continue;
-                                } else if (phiMov->blockALiveValues.at(phiMovLocation).count(insVal) != 0) {
-                                    continue;
-                                }
-                                auto it = ins + 1;
-                                bool searchOtherBlocks = true;
-                                while (it != bb->instructions.end()) {
-                                    addAliveValue(insVal, *it, bb);
-                                    if (*it == phiMov && phiMovLocation == bb) {
-                                        searchOtherBlocks = false;
-                                        break;
-                                    }
-                                    ++it;
-                                }
-                                if (searchOtherBlocks) {
-                                    unordered_set<shared_ptr<BasicBlock>> pathNodes;
-                                    if (blockPath.count(bb) != 0) {
-                                        if (blockPath.at(bb)->count(phiMovLocation) != 0) {
-                                            pathNodes = blockPath.at(bb)->at(phiMovLocation);
-                                        } else {
-                                            pathNodes = getBlockPathPoints(bb, phiMovLocation);
-                                        }
-                                    } else pathNodes = getBlockPathPoints(bb, phiMovLocation);
-                                    for (auto &b : pathNodes) {
-                                        b->aliveValues.insert(insVal);
-                                    }
-                                    it = phiMovLocation->instructions.begin();
-                                    while (it != phiMovLocation->instructions.end()) {
-                                        addAliveValue(insVal, *it, phiMovLocation);
-                                        if (*it == phiMov) break;
-                                        ++it;
-                                    }
-                                }
-                            }
-                        }
-                    } else {
-                        // if the user block or the instruction has mark this instruction alive, continue.
-                        if (userIns->block->aliveValues.count(insVal) != 0 || userIns->aliveValues.count(insVal) != 0) {
-                            continue;
-                        } else { // mark this instruction alive all along the path to userIns.
-                            auto it = ins + 1;
-                            bool searchOtherBlocks = true;
-                            while (it != bb->instructions.end()) {
-                                addAliveValue(insVal, *it, bb);
-                                if (*it == userIns) {
-                                    searchOtherBlocks = false;
-                                    break;
-                                }
-                                ++it;
-                            }
-                            // the user is not just after the insVal, search for block paths.
-                            if (searchOtherBlocks) {
-                                // maintain the passing block and add them to alive nodes.
-                                unordered_set<shared_ptr<BasicBlock>> pathNodes;
-                                if (blockPath.count(bb) != 0) {
-                                    if (blockPath.at(bb)->count(userIns->block) != 0) {
-                                        pathNodes = blockPath.at(bb)->at(userIns->block);
-                                    } else {
-                                        pathNodes = getBlockPathPoints(bb, userIns->block);
-                                    }
-                                } else {
-                                    pathNodes = getBlockPathPoints(bb, userIns->block);
-                                }
-                                for (auto &b : pathNodes) {
-                                    b->aliveValues.insert(insVal);
-                                }
-                                // search the user block and mark alive.
-                                it = userIns->block->instructions.begin();
-                                while (it != userIns->block->instructions.end()) {
-                                    addAliveValue(insVal, *it, userIns->block);
-                                    if (*it == userIns) {
-                                        break;
-                                    }
-                                    ++it;
-                                }
-                            }
-                        }
-                    }
-                }
-            } else if (insVal->type == PHI_MOV) { // deal with phi move.
-                shared_ptr<PhiMoveInstruction> phiMove = s_p_c<PhiMoveInstruction>(insVal);
-                shared_ptr<BasicBlock> targetPhiBlock = phiMove->phi->block;
-                auto it = ins + 1;
-                while (it != bb->instructions.end()) {
-                    addAliveValue(insVal, *it, bb);
-                    ++it;
-                }
-                if (targetPhiBlock->aliveValues.count(insVal) != 0
-                    || phiMove->phi->aliveValues.count(insVal) != 0)
-                    continue;
-                it = targetPhiBlock->instructions.begin();
-                while (it != targetPhiBlock->instructions.end()) {
-                    addAliveValue(insVal, *it, targetPhiBlock);
-                    if (*it == phiMove->phi) break;
-                    ++it;
-                }
-            }
+    const LiveSet &entryLive = liveIn.at(func->entryBlock.get());
+    vector<unsigned int> entryValues;
+    for (unsigned int i = 0; i < entryLive.size(); ++i) {
+        for (unsigned long long word = entryLive[i]; word != 0; word &= word - 1) {
+            entryValues.push_back((i << 6) + __builtin_ctzll(word));
+        }
+    }
+    for (unsigned int i = 0; i < entryValues.size(); ++i) {
+        for (unsigned int j = i + 1; j < entryValues.size(); ++j) {
+            addConflict(ctx, entryValues.at(i), entryValues.at(j));
+        }
+    }
+}
+
+/**
+ * A phi reads its phi move at the head of its block, and a phi move reads the phi operand of the block it lies in.
+ */
+void getInstructionOperands(const shared_ptr<Instruction> &ins, const shared_ptr<BasicBlock> &bb,
+                            vector<Value *> &operands) {
+    switch (ins->type) {
+        case RET:
+            if (s_p_c<ReturnInstruction>(ins)->value != nullptr)
+                operands.push_back(s_p_c<ReturnInstruction>(ins)->value.get());
+            break;
+        case BR:
+            operands.push_back(s_p_c<BranchInstruction>(ins)->condition.get());
+            break;
+        case INVOKE:
+            for (auto &arg : s_p_c<InvokeInstruction>(ins)->params) operands.push_back(arg.get());
+            break;
+        case UNARY:
+            operands.push_back(s_p_c<UnaryInstruction>(ins)->value.get());
+            break;
+        case BINARY:
+        case CMP:
+            operands.push_back(s_p_c<BinaryInstruction>(ins)->lhs.get());
+            operands.push_back(s_p_c<BinaryInstruction>(ins)->rhs.get());
+            break;
+        case LOAD:
+            operands.push_back(s_p_c<LoadInstruction>(ins)->address.get());
+            operands.push_back(s_p_c<LoadInstruction>(ins)->offset.get());
+            break;
+        case STORE:
+            operands.push_back(s_p_c<StoreInstruction>(ins)->value.get());
+            operands.push_back(s_p_c<StoreInstruction>(ins)->address.get());
+            operands.push_back(s_p_c<StoreInstruction>(ins)->offset.get());
+            break;
+        case MEMSET:
+            operands.push_back(s_p_c<MemsetInstruction>(ins)->value.get());
+            operands.push_back(s_p_c<MemsetInstruction>(ins)->address.get());
+            break;
+        case MEMCPY:
+            operands.push_back(s_p_c<MemcpyInstruction>(ins)->source.get());
+            operands.push_back(s_p_c<MemcpyInstruction>(ins)->address.get());
+            break;
+        case VECTOR:
+            for (auto &operand : s_p_c<VectorInstruction>(ins)->operands) operands.push_back(operand.get());
+            break;
+        case PHI:
+            if (s_p_c<PhiInstruction>(ins)->phiMove != nullptr)
+                operands.push_back(s_p_c<PhiInstruction>(ins)->phiMove.get());
+            break;
+        case PHI_MOV: {
+            shared_ptr<PhiInstruction> phi = s_p_c<PhiMoveInstruction>(ins)->phi;
+            if (phi->operands.count(bb) != 0) operands.push_back(phi->operands.at(bb).get());
+            else cerr << "Error occurs in process register alloc: phi move in a non-predecessor block." << endl;
+            break;
         }
+        default:
+            break;
     }
+}
+
+void computeBlockLiveness(RegisterAllocContext &ctx, shared_ptr<Function> &func,
+                          unordered_map<BasicBlock *, LiveSet> &liveIn, unordered_map<BasicBlock *, LiveSet> &liveOut,
+                          unordered_map<BasicBlock *, LiveSet> &kill) {
+    unsigned int words = (ctx.liveValues.size() + 63) >> 6;
+    unordered_map<BasicBlock *, LiveSet> gen;
+    vector<Value *> operands;
     for (auto &bb : func->blocks) {
-        for (auto &aliveVal : bb->aliveValues) {
-            for (auto &aliveValInside : bb->aliveValues) {
-                if (aliveVal != aliveValInside) {
-                    if (conflictGraph.count(aliveVal) == 0) {
-                        cerr << "Error occurs in process register alloc: "
-                                "conflict graph does not have a l-value." << endl;
-                    } else {
-                        conflictGraph.at(aliveVal)->insert(aliveValInside);
-                    }
-                }
-            }
-            for (auto &ins : bb->instructions) {
-                if (ins->resultType == L_VAL_RESULT) {
-                    conflictGraph.at(aliveVal)->insert(ins);
-                    conflictGraph.at(ins)->insert(aliveVal);
-                }
+        LiveSet blockGen(words, 0), blockKill(words, 0);
+        for (auto &ins : bb->instructions) {
+            operands.clear();
+            getInstructionOperands(ins, bb, operands);
+            for (auto op : operands) {
+                if (ctx.liveValueIds.count(op) != 0 && !liveSetTest(blockKill, ctx.liveValueIds.at(op)))
+                    liveSetInsert(blockGen, ctx.liveValueIds.at(op));
             }
+            if (ctx.liveValueIds.count(ins.get()) != 0) liveSetInsert(blockKill, ctx.liveValueIds.at(ins.get()));
         }
-        for (auto &ins : bb->instructions) {
-            unordered_set<shared_ptr<Value>> aliveValues;
-            if (ins->type != PHI_MOV) {
-                aliveValues = ins->aliveValues;
-            } else {
-                aliveValues = s_p_c<PhiMoveInstruction>(ins)->blockALiveValues.at(bb);
+        liveIn[bb.get()] = blockGen;
+        liveOut[bb.get()] = LiveSet(words, 0);
+        gen[bb.get()] = move(blockGen);
+        kill[bb.get()] = move(blockKill);
+    }
+    // visit the blocks backward, it is close to post order and takes few rounds to be stable.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto bb = func->blocks.rbegin(); bb != func->blocks.rend(); ++bb) {
+            LiveSet &out = liveOut.at(bb->get());
+            for (auto &suc : (*bb)->successors) {
+                auto sucIn = liveIn.find(suc.get());
+                if (sucIn == liveIn.end()) continue;
+                for (unsigned int i = 0; i < words; ++i) out[i] |= sucIn->second[i];
             }
-            for (auto &aliveVal : aliveValues) {
-                for (auto &aliveValInside : aliveValues) {
-                    if (aliveVal != aliveValInside) {
-                        if (conflictGraph.count(aliveVal) == 0) {
-                            cerr << "Error occurs in process register alloc: "
-                                    "conflict graph does not have a l-value." << endl;
-                        } else {
-                            conflictGraph.at(aliveVal)->insert(aliveValInside);
-                        }
-                    }
+            LiveSet &in = liveIn.at(bb->get());
+            const LiveSet &blockGen = gen.at(bb->get());
+            const LiveSet &blockKill = kill.at(bb->get());
+            for (unsigned int i = 0; i < words; ++i) {
+                unsigned long long word = blockGen[i] | (out[i] & ~blockKill[i]);
+                if (word != in[i]) {
+                    in[i] = word;
+                    changed = true;
                 }
             }
         }
     }
 }
 
-void allocRegister(shared_ptr<Function> &func) {
-    stack<shared_ptr<Value>> variableWithRegs;
-    unordered_map<shared_ptr<Value>, shared_ptr<unordered_set<shared_ptr<Value>>>> tempGraph = conflictGraph;
-    ALLOC_REGISTER_START:
-    for (auto &it : tempGraph) {
-        shared_ptr<Value> var = it.first;
-        if (it.second->size() < _GLB_REG_CNT) {
-            for (auto &val : *it.second) {
-                tempGraph.at(val)->erase(var);
-            }
-            tempGraph.erase(var);
-            variableWithRegs.push(var);
-            goto ALLOC_REGISTER_START;
+unordered_set<shared_ptr<Value>> liveSetToValues(RegisterAllocContext &ctx, const LiveSet &live) {
+    unordered_set<shared_ptr<Value>> values;
+    for (unsigned int i = 0; i < live.size(); ++i) {
+        for (unsigned long long word = live[i]; word != 0; word &= word - 1) {
+            values.insert(ctx.liveValues.at((i << 6) + __builtin_ctzll(word)));
         }
     }
-    if (!tempGraph.empty()) {
-        shared_ptr<Value> abandon = tempGraph.begin()->first;
-        for (auto &it : tempGraph) {
-            shared_ptr<Value> ins = it.first;
-            if (func->variableWeight.at(ins) < func->variableWeight.at(abandon)
-                || (func->variableWeight.at(ins) == func->variableWeight.at(abandon) && ins->id < abandon->id)) {
-                abandon = ins;
+    return values;
+}
+
+void addConflict(RegisterAllocContext &ctx, unsigned int a, unsigned int b) {
+    ctx.conflictGraph.at(a).insert(b);
+    ctx.conflictGraph.at(b).insert(a);
+}
+
+/**
+ * A phi copies its phi move, a phi move copies its phi operand and a split copies its value,
+ * the copies are weighted by the loop depth.
+ */
+void collectMoves(RegisterAllocContext &ctx, shared_ptr<Function> &func) {
+    for (auto &bb : func->blocks) {
+        unsigned long long weight = countWeight(bb->loopDepth, 0);
+        for (auto &ins : bb->instructions) {
+            Value *source = nullptr;
+            if (ins->type == PHI) {
+                source = s_p_c<PhiInstruction>(ins)->phiMove.get();
+            } else if (ins->type == PHI_MOV) {
+                shared_ptr<PhiInstruction> phi = s_p_c<PhiMoveInstruction>(ins)->phi;
+                if (phi->operands.count(bb) != 0) source = phi->operands.at(bb).get();
+            } else if (ins->type == UNARY && s_p_c<UnaryInstruction>(ins)->op == OP_ADD) {
+                source = s_p_c<UnaryInstruction>(ins)->value.get();
             }
+            if (source == nullptr || ctx.liveValueIds.count(source) == 0
+                || ctx.liveValueIds.count(ins.get()) == 0)
+                continue;
+            ctx.moves.emplace_back(weight, ctx.liveValueIds.at(ins.get()), ctx.liveValueIds.at(source));
         }
-        for (auto &it : *tempGraph.at(abandon)) {
-            tempGraph.at(it)->erase(abandon);
+    }
+}
+
+/**
+ * Conservative coalescing (Briggs): two copy-related values are merged if they do not conflict and the merged value
+ * has less than _GLB_REG_CNT neighbors of significant degree, so the graph stays as colorable as before.
+ * Returns the representative of each value, the conflict graph and the weights are merged into the representatives.
+ */
+vector<unsigned int> coalesceMoves(RegisterAllocContext &ctx, vector<unsigned long long> &weights) {
+    vector<unsigned int> alias(ctx.liveValues.size());
+    for (unsigned int i = 0; i < alias.size(); ++i) alias[i] = i;
+    auto findAlias = [&alias](unsigned int v) {
+        while (alias[v] != v) v = alias[v] = alias[alias[v]];
+        return v;
+    };
+    // heavy copies first, ties are broken by the dense ids to keep the result stable.
+    stable_sort(ctx.moves.begin(), ctx.moves.end(), [](auto &a, auto &b) { return get<0>(a) > get<0>(b); });
+    vector<unordered_set<unsigned int>> &graph = ctx.conflictGraph;
+    for (auto &move : ctx.moves) {
+        unsigned int a = findAlias(get<1>(move)), b = findAlias(get<2>(move));
+        if (a == b || graph[a].count(b) != 0) continue;
+        unsigned int significant = 0;
+        for (auto n : graph[a]) {
+            unsigned int degree = graph[n].size() - (graph[b].count(n) != 0 ? 1 : 0);
+            if (degree >= _GLB_REG_CNT) ++significant;
         }
-        tempGraph.erase(abandon);
-        for (auto &it : *conflictGraph.at(abandon)) {
-            conflictGraph.at(it)->erase(abandon);
+        for (auto n : graph[b]) {
+            if (graph[a].count(n) == 0 && graph[n].size() >= _GLB_REG_CNT) ++significant;
         }
-        conflictGraph.erase(abandon);
-        func->variableWithoutReg.insert(abandon);
-        goto ALLOC_REGISTER_START;
-    }
-    unordered_set<string> validRegs;
-    for (int i = 0; i < _GLB_REG_CNT; ++i) validRegs.insert(to_string(i + _GLB_REG_START));
-    while (!variableWithRegs.empty()) {
-        unordered_set<string> regs = validRegs;
-        shared_ptr<Value> ins = variableWithRegs.top();
-        variableWithRegs.pop();
-        for (auto &it : *conflictGraph.at(ins)) {
-            if (func->variableRegs.count(it) != 0) regs.erase(func->variableRegs.at(it));
+        if (significant >= _GLB_REG_CNT) continue;
+        for (auto n : graph[b]) {
+            graph[n].erase(b);
+            graph[n].insert(a);
+            graph[a].insert(n);
         }
-        func->variableRegs[ins] = *regs.begin();
+        graph[b].clear();
+        alias[b] = a;
+        weights[a] += weights[b];
     }
+    for (unsigned int i = 0; i < alias.size(); ++i) findAlias(i);
+    return alias;
 }
 
-unordered_set<shared_ptr<BasicBlock>>
-getBlockPathPoints(shared_ptr<BasicBlock> &from, shared_ptr<BasicBlock> &to) {
-    unordered_set<shared_ptr<BasicBlock>> fromReachable;
-    unordered_set<shared_ptr<BasicBlock>> ans;
-    unordered_set<shared_ptr<BasicBlock>> tempReachable;
-    getBlockReachableBlocks(from, from, fromReachable);
-    for (auto bb : fromReachable) {
-        tempReachable.clear();
-        getBlockReachableBlocks(bb, from, tempReachable);
-        if (tempReachable.count(to) != 0) {
-            ans.insert(bb);
-        }
+/**
+ * Coalesce the copies, then simplify the values of low degree by a work list. When all the left values have
+ * significant degree, the one with the least spill cost (weight by degree) is removed optimistically, and gets
+ * a register only if its neighbors leave one free.
+ */
+void allocRegister(RegisterAllocContext &ctx, shared_ptr<Function> &func) {
+    unsigned int valueCnt = ctx.liveValues.size();
+    vector<unsigned long long> weights(valueCnt);
+    for (unsigned int i = 0; i < valueCnt; ++i) weights[i] = func->variableWeight.at(ctx.liveValues.at(i));
+    vector<unsigned int> alias = coalesceMoves(ctx, weights);
+    const vector<unordered_set<unsigned int>> &graph = ctx.conflictGraph;
+
+    vector<unsigned int> degrees(valueCnt);
+    vector<unsigned int> lowDegree;
+    set<tuple<unsigned long long, unsigned int, unsigned int>> spillQueue; // weight, value id, dense id.
+    for (unsigned int i = 0; i < valueCnt; ++i) {
+        if (alias[i] != i) continue;
+        degrees[i] = graph[i].size();
+        if (degrees[i] < _GLB_REG_CNT) lowDegree.push_back(i);
+        else spillQueue.emplace(weights[i], ctx.liveValues[i]->id, i);
     }
-    ans.erase(from);
-    if (blockPath.count(from) != 0) {
-        shared_ptr<unordered_map<shared_ptr<BasicBlock>,
-                unordered_set<shared_ptr<BasicBlock>>>> tempMap = blockPath.at(from);
-        if (tempMap->count(to) != 0) {
-            cerr << "Error occurs in process register alloc: search path twice." << endl;
+    vector<bool> removed(valueCnt, false);
+    vector<unsigned int> selectStack;
+    while (!lowDegree.empty() || !spillQueue.empty()) {
+        unsigned int v;
+        if (!lowDegree.empty()) {
+            v = lowDegree.back();
+            lowDegree.pop_back();
         } else {
-            tempMap->insert({to, ans});
-            blockPath[from] = tempMap;
+            // the cheapest value to spill: the least weight for each conflict it takes away.
+            auto cheapest = spillQueue.begin();
+            for (auto it = next(spillQueue.begin()); it != spillQueue.end(); ++it) {
+                unsigned int a = get<2>(*it), b = get<2>(*cheapest);
+                if ((long double) weights[a] * degrees[b] < (long double) weights[b] * degrees[a]) cheapest = it;
+            }
+            v = get<2>(*cheapest);
+            spillQueue.erase(cheapest);
         }
-    } else {
-        shared_ptr<unordered_map<shared_ptr<BasicBlock>, unordered_set<shared_ptr<BasicBlock>>>> tempMap
-                = make_shared<unordered_map<shared_ptr<BasicBlock>, unordered_set<shared_ptr<BasicBlock>>>>();
-        tempMap->insert({to, ans});
-        blockPath[from] = tempMap;
+        removed[v] = true;
+        selectStack.push_back(v);
+        for (auto n : graph[v]) {
+            if (removed[n]) continue;
+            if (degrees[n]-- == _GLB_REG_CNT) {
+                spillQueue.erase({weights[n], ctx.liveValues[n]->id, n});
+                lowDegree.push_back(n);
+            }
+        }
+    }
+    // the free register with the largest number is taken.
+    vector<int> colors(valueCnt, -1);
+    while (!selectStack.empty()) {
+        unsigned int v = selectStack.back();
+        selectStack.pop_back();
+        set<int> regs;
+        for (int i = 0; i < _GLB_REG_CNT; ++i) regs.insert(i + _GLB_REG_START);
+        for (auto n : graph[v]) {
+            if (colors[n] != -1) regs.erase(colors[n]);
+        }
+        if (!regs.empty()) colors[v] = *regs.rbegin();
+    }
+    for (unsigned int i = 0; i < valueCnt; ++i) {
+        if (colors[alias[i]] != -1) func->variableRegs[ctx.liveValues[i]] = colors[alias[i]];
+        else func->variableWithoutReg.insert(ctx.liveValues[i]);
     }
-    return ans;
 }
 
-void getBlockReachableBlocks(shared_ptr<BasicBlock> &bb, shared_ptr<BasicBlock> &cannotArrive,
-                             unordered_set<shared_ptr<BasicBlock>> &ans) {
-    queue<shared_ptr<BasicBlock>> blockQueue;
-    blockQueue.push(bb);
-    while (!blockQueue.empty()) {
-        shared_ptr<BasicBlock> top = blockQueue.front();
-        blockQueue.pop();
-        for (auto &suc : top->successors) {
-            if (ans.count(suc) == 0 && suc != cannotArrive) {
-                ans.insert(suc);
-                blockQueue.push(suc);
+/**
+ * Split the live ranges of the values spilled everywhere at the innermost loops which use them and still have
+ * free registers: such a value gets a copy in the preheader for its uses in the loop. The value is loaded once
+ * before the loop, and the copy may own a register in the loop.
+ * A trial allocation tells the spilled values. Runs before the function is allocated, as it creates IR.
+ */
+void splitLiveRanges(shared_ptr<Function> &func) {
+    invalidateFunctionAnalysis(func);
+    vector<pair<Loop *, shared_ptr<BasicBlock>>> loops; // innermost loop, preheader.
+    for (auto &loop : getFunctionAnalysis(func).getLoops()) {
+        if (!loop->children.empty()) continue;
+        shared_ptr<BasicBlock> preheader;
+        for (auto &pred : loop->header->predecessors) {
+            if (loop->contains(pred)) continue;
+            preheader = preheader == nullptr && pred->successors.size() == 1 ? pred : nullptr;
+            if (preheader == nullptr) break;
+        }
+        if (preheader != nullptr) loops.emplace_back(loop.get(), preheader);
+    }
+    if (loops.empty()) return;
+    RegisterAllocContext ctx;
+    calculateVariableWeight(func);
+    initConflictGraph(ctx, func);
+    buildConflictGraph(ctx, func);
+    collectMoves(ctx, func);
+    allocRegister(ctx, func);
+    vector<bool> spilled(ctx.liveValues.size(), false);
+    for (unsigned int i = 0; i < ctx.liveValues.size(); ++i) {
+        spilled[i] = func->variableWithoutReg.count(ctx.liveValues[i]) != 0;
+    }
+    func->variableWeight.clear();
+    func->variableRegs.clear();
+    func->variableWithoutReg.clear();
+    if (find(spilled.begin(), spilled.end(), true) == spilled.end()) return;
+    unordered_map<BasicBlock *, LiveSet> liveIn, liveOut, kill;
+    computeBlockLiveness(ctx, func, liveIn, liveOut, kill);
+    for (auto &[loop, preheader] : loops) {
+        unsigned int pressure = loopPressure(ctx, loop, liveOut, spilled);
+        if (pressure >= _GLB_REG_CNT) continue;
+        vector<pair<unsigned int, vector<shared_ptr<Value>>>> candidates; // dense id, uses in the loop.
+        const LiveSet &headerIn = liveIn.at(loop->header.get());
+        for (unsigned int i = 0; i < headerIn.size(); ++i) {
+            for (unsigned long long word = headerIn[i]; word != 0; word &= word - 1) {
+                unsigned int id = (i << 6) + __builtin_ctzll(word);
+                shared_ptr<Value> value = ctx.liveValues.at(id);
+                if (!spilled[id] || (value->valueType == INSTRUCTION && s_p_c<Instruction>(value)->type == PHI_MOV))
+                    continue;
+                vector<shared_ptr<Value>> inLoop;
+                for (auto &user : value->getUsers()) {
+                    if (user->valueType == INSTRUCTION && loop->contains(s_p_c<Instruction>(user)->block))
+                        inLoop.push_back(user);
+                }
+                if (!inLoop.empty()) candidates.emplace_back(id, move(inLoop));
             }
         }
+        // the values used most in the loop take the free registers.
+        stable_sort(candidates.begin(), candidates.end(),
+                    [](auto &a, auto &b) { return a.second.size() > b.second.size(); });
+        if (candidates.size() > _GLB_REG_CNT - pressure) candidates.resize(_GLB_REG_CNT - pressure);
+        for (auto &[id, inLoop] : candidates) {
+            shared_ptr<Value> value = ctx.liveValues.at(id);
+            auto pos = preheader->instructions.begin();
+            while (pos != preheader->instructions.end() && (*pos)->type != PHI_MOV && (*pos)->type != JMP) ++pos;
+            shared_ptr<Value> copy = insertCopy(value, preheader, pos);
+            for (auto &user : inLoop) user->replaceUse(value, copy);
+        }
     }
 }
 
-void addAliveValue(shared_ptr<Instruction> &value, shared_ptr<Instruction> &owner,
-                   shared_ptr<BasicBlock> &ownerBlock) {
-    if (value->resultType == L_VAL_RESULT) {
-        if (owner->type == PHI_MOV) {
-            s_p_c<PhiMoveInstruction>(owner)->blockALiveValues.at(ownerBlock).insert(value);
-        } else owner->aliveValues.insert(value);
+/**
+ * The most values with registers alive at the same time in the blocks of a loop.
+ */
+unsigned int loopPressure(RegisterAllocContext &ctx, Loop *loop, unordered_map<BasicBlock *, LiveSet> &liveOut,
+                          const vector<bool> &spilled) {
+    unsigned int pressure = 0;
+    vector<Value *> operands;
+    for (auto &bb : loop->blocks) {
+        LiveSet live = liveOut.at(bb.get());
+        for (auto ins = bb->instructions.rbegin(); ins != bb->instructions.rend(); ++ins) {
+            if (ctx.liveValueIds.count(ins->get()) != 0) liveSetErase(live, ctx.liveValueIds.at(ins->get()));
+            operands.clear();
+            getInstructionOperands(*ins, bb, operands);
+            for (auto op : operands) {
+                if (ctx.liveValueIds.count(op) != 0) liveSetInsert(live, ctx.liveValueIds.at(op));
+            }
+            unsigned int alive = 0;
+            for (unsigned int i = 0; i < live.size(); ++i) {
+                for (unsigned long long word = live[i]; word != 0; word &= word - 1) {
+                    if (!spilled[(i << 6) + __builtin_ctzll(word)]) ++alive;
+                }
+            }
+            pressure = max(pressure, alive);
+        }
     }
+    return pressure;
 }
 
-void addAliveValue(shared_ptr<Value> &value, shared_ptr<Instruction> &owner,
-                   shared_ptr<BasicBlock> &ownerBlock) {
-    if (value->valueType == INSTRUCTION) {
-        shared_ptr<Instruction> insVal = s_p_c<Instruction>(value);
-        addAliveValue(insVal, owner, ownerBlock);
-    } else if (value->valueType == PARAMETER) {
-        if (owner->type == PHI_MOV) {
-            s_p_c<PhiMoveInstruction>(owner)->blockALiveValues.at(ownerBlock).insert(value);
-        } else owner->aliveValues.insert(value);
-    } else {
-        cerr << "Error occurs in process add alive value: add a non-instruction and non-parameter value." << endl;
-    }
+/**
+ * The copy of a split live range is an l-value unary add, which is never built from the source.
+ */
+shared_ptr<Instruction> insertCopy(shared_ptr<Value> &value, shared_ptr<BasicBlock> &bb,
+                                   list<shared_ptr<Instruction>>::iterator pos) {
+    shared_ptr<Instruction> copy = newIr<UnaryInstruction>(OP_ADD, value, bb);
+    copy->resultType = L_VAL_RESULT;
+    copy->caughtVarName = generateTempLeftValueName();
+    bb->instructions.insert(pos, copy);
+    return copy;
 }
 
-void outputConflictGraph(const string &funcName) {
+void outputConflictGraph(RegisterAllocContext &ctx, const string &funcName) {
     if (_debugIrOptimize) {
         const string fileName = debugMessageDirectory + "ir_conflict_graph.txt";
         ofstream irOptimizeStream(fileName, ios::app);
         irOptimizeStream << "Function <" << funcName << ">:" << endl;
-        map<unsigned int, shared_ptr<unordered_set<shared_ptr<Value>>>> tempMap;
-        for (auto &val : conflictGraph) {
-            tempMap[val.first->id] = val.second;
+        map<unsigned int, unsigned int> tempMap; // value id <--> dense id.
+        for (unsigned int i = 0; i < ctx.liveValues.size(); ++i) {
+            tempMap[ctx.liveValues[i]->id] = i;
         }
         for (auto &value : tempMap) {
             irOptimizeStream << "<" << value.first << ">:";
             set<unsigned int> tempValSet;
-            for (auto &edge : *value.second) {
-                tempValSet.insert(edge->id);
+            for (auto &edge : ctx.conflictGraph.at(value.second)) {
+                tempValSet.insert(ctx.liveValues.at(edge)->id);
             }
             for (auto &edge : tempValSet) {
                 irOptimizeStream << " <" << edge << ">";
@@ -0,0 +1,215 @@
+#include "ir_optimize.h"
+
+#include <set>
+
+// a value is unknown until proved constant, and overdefined once it may take two values.
+enum LatticeState {
+    LATTICE_UNKNOWN,
+    LATTICE_CONSTANT,
+    LATTICE_OVERDEFINED
+};
+
+struct LatticeValue {
+    LatticeState state = LATTICE_UNKNOWN;
+    int number = 0;
+
+    bool operator==(const LatticeValue &other) const {
+        return state == other.state && (state != LATTICE_CONSTANT || number == other.number);
+    }
+
+    bool operator!=(const LatticeValue &other) const { return !(*this == other); }
+};
+
+const LatticeValue OVERDEFINED = {LATTICE_OVERDEFINED, 0}; // NOLINT
+
+LatticeValue latticeConstant(int number) { return {LATTICE_CONSTANT, number}; }
+
+LatticeValue meet(const LatticeValue &a, const LatticeValue &b) {
+    if (a.state == LATTICE_UNKNOWN) return b;
+    if (b.state == LATTICE_UNKNOWN) return a;
+    if (a == b) return a;
+    return OVERDEFINED;
+}
+
+/**
+ * Wegman-Zadeck sparse conditional constant propagation.
+ * Blocks become executable only through executable edges, a branch on a constant makes one edge executable,
+ * and a phi meets only the operands of its executable edges, so constants reach through phis behind
+ * branches that fold in the same run.
+ */
+struct ConstantPropagationContext {
+    shared_ptr<Function> func;
+    unordered_map<Value *, LatticeValue> lattice;
+    unordered_set<BasicBlock *> executableBlocks;
+    set<pair<BasicBlock *, BasicBlock *>> executableEdges;
+    vector<pair<shared_ptr<BasicBlock>, shared_ptr<BasicBlock>>> edgeWorklist;
+    vector<shared_ptr<Instruction>> instructionWorklist;
+
+    explicit ConstantPropagationContext(shared_ptr<Function> &func) : func(func) {};
+
+    LatticeValue get(const shared_ptr<Value> &value) {
+        if (value->valueType == NUMBER) return latticeConstant(s_p_c<NumberValue>(value)->number);
+        if (value->valueType != INSTRUCTION) return OVERDEFINED;
+        auto it = lattice.find(value.get());
+        return it == lattice.end() ? LatticeValue() : it->second;
+    }
+
+    void markEdge(const shared_ptr<BasicBlock> &from, const shared_ptr<BasicBlock> &to) {
+        if (executableEdges.insert({from.get(), to.get()}).second) edgeWorklist.emplace_back(from, to);
+    }
+
+    void update(const shared_ptr<Instruction> &ins, const LatticeValue &value) {
+        LatticeValue &old = lattice[ins.get()];
+        if (old == value || old.state == LATTICE_OVERDEFINED) return;
+        old = old.state == LATTICE_UNKNOWN ? value : OVERDEFINED;
+        for (auto &user : ins->getUsers()) {
+            if (user->valueType == INSTRUCTION) instructionWorklist.push_back(s_p_c<Instruction>(user));
+        }
+    }
+
+    LatticeValue evaluate(shared_ptr<Instruction> &ins);
+
+    void visit(shared_ptr<Instruction> &ins);
+
+    void run();
+
+    bool rewrite();
+};
+
+LatticeValue ConstantPropagationContext::evaluate(shared_ptr<Instruction> &ins) {
+    switch (ins->type) {
+        case PHI: {
+            shared_ptr<PhiInstruction> phi = s_p_c<PhiInstruction>(ins);
+            LatticeValue value;
+            for (auto &it : phi->operands) {
+                if (executableEdges.count({it.first.get(), phi->block.get()}) == 0) continue;
+                value = meet(value, get(it.second));
+            }
+            return value;
+        }
+        case BINARY:
+        case CMP: {
+            shared_ptr<BinaryInstruction> binary = s_p_c<BinaryInstruction>(ins);
+            LatticeValue lhs = get(binary->lhs), rhs = get(binary->rhs);
+            if ((binary->op == OP_MUL || binary->op == OP_AND)
+                && ((lhs.state == LATTICE_CONSTANT && lhs.number == 0)
+                    || (rhs.state == LATTICE_CONSTANT && rhs.number == 0))) {
+                return latticeConstant(0);
+            }
+            if (lhs.state == LATTICE_OVERDEFINED || rhs.state == LATTICE_OVERDEFINED) return OVERDEFINED;
+            if (lhs.state == LATTICE_UNKNOWN || rhs.state == LATTICE_UNKNOWN) return {};
+            if ((binary->op == OP_DIV || binary->op == OP_MOD) && rhs.number == 0) return OVERDEFINED;
+            int result;
+            if (!computeBinary(binary->op, lhs.number, rhs.number, result)) return OVERDEFINED;
+            return latticeConstant(result);
+        }
+        case UNARY: {
+            shared_ptr<UnaryInstruction> unary = s_p_c<UnaryInstruction>(ins);
+            LatticeValue value = get(unary->value);
+            if (value.state != LATTICE_CONSTANT) return value;
+            if (unary->op == OP_ADD) return value;
+            if (unary->op == OP_SUB) return latticeConstant(-value.number);
+            if (unary->op == OP_NOT) return latticeConstant(!value.number);
+            return OVERDEFINED;
+        }
+        case LOAD: {
+            shared_ptr<LoadInstruction> load = s_p_c<LoadInstruction>(ins);
+            if (load->address->valueType != CONSTANT) return OVERDEFINED;
+            LatticeValue offset = get(load->offset);
+            if (offset.state != LATTICE_CONSTANT) return offset;
+            map<int, int> &values = s_p_c<ConstantValue>(load->address)->values;
+            return latticeConstant(values.count(offset.number) != 0 ? values.at(offset.number) : 0);
+        }
+        default:
+            return OVERDEFINED;
+    }
+}
+
+void ConstantPropagationContext::visit(shared_ptr<Instruction> &ins) {
+    if (executableBlocks.count(ins->block.get()) == 0) return;
+    if (ins->type == JMP) {
+        markEdge(ins->block, s_p_c<JumpInstruction>(ins)->targetBlock);
+    } else if (ins->type == BR) {
+        shared_ptr<BranchInstruction> br = s_p_c<BranchInstruction>(ins);
+        LatticeValue condition = get(br->condition);
+        if (condition.state == LATTICE_UNKNOWN) return;
+        if (condition.state == LATTICE_OVERDEFINED || condition.number != 0) markEdge(ins->block, br->trueBlock);
+        if (condition.state == LATTICE_OVERDEFINED || condition.number == 0) markEdge(ins->block, br->falseBlock);
+    } else if (ins->type == INVOKE || noResultTypes.count(ins->type) == 0) {
+        update(ins, evaluate(ins));
+    }
+}
+
+void ConstantPropagationContext::run() {
+    executableBlocks.insert(func->entryBlock.get());
+    for (auto &ins : func->entryBlock->instructions) visit(ins);
+    while (!edgeWorklist.empty() || !instructionWorklist.empty()) {
+        while (!instructionWorklist.empty()) {
+            shared_ptr<Instruction> ins = instructionWorklist.back();
+            instructionWorklist.pop_back();
+            visit(ins);
+        }
+        if (edgeWorklist.empty()) break;
+        shared_ptr<BasicBlock> bb = edgeWorklist.back().second;
+        edgeWorklist.pop_back();
+        bool reached = executableBlocks.insert(bb.get()).second;
+        for (auto &phi : bb->phis) {
+            shared_ptr<Instruction> phiIns = phi;
+            visit(phiIns);
+        }
+        if (reached) {
+            for (auto &ins : bb->instructions) visit(ins);
+        }
+    }
+}
+
+/**
+ * Replace the constant values by numbers, and the branches with one executable edge by jumps.
+ * The phi operands of the dropped edges are removed with the unused instructions,
+ * and the blocks left unreachable by dead code elimination.
+ */
+bool ConstantPropagationContext::rewrite() {
+    bool changed = false;
+    for (auto &bb : func->blocks) {
+        if (executableBlocks.count(bb.get()) == 0) continue;
+        unordered_set<shared_ptr<PhiInstruction>> phis = bb->phis;
+        for (auto &phi : phis) {
+            LatticeValue value = get(phi);
+            if (value.state != LATTICE_CONSTANT) continue;
+            phi->replaceAllUsesWith(getNumberValue(value.number));
+            bb->phis.erase(phi);
+            phi->abandonUse();
+            changed = true;
+        }
+        for (auto &ins : bb->instructions) {
+            if (noResultTypes.count(ins->type) != 0) continue;
+            LatticeValue value = get(ins);
+            if (value.state != LATTICE_CONSTANT || ins->hasNoUser()) continue;
+            ins->replaceAllUsesWith(getNumberValue(value.number));
+            changed = true;
+        }
+        shared_ptr<Instruction> &last = bb->instructions.back();
+        if (last->type != BR) continue;
+        shared_ptr<BranchInstruction> br = s_p_c<BranchInstruction>(last);
+        bool trueEdge = executableEdges.count({bb.get(), br->trueBlock.get()}) != 0;
+        bool falseEdge = executableEdges.count({bb.get(), br->falseBlock.get()}) != 0;
+        if (br->trueBlock == br->falseBlock || trueEdge == falseEdge) continue;
+        shared_ptr<BasicBlock> target = trueEdge ? br->trueBlock : br->falseBlock;
+        shared_ptr<BasicBlock> removed = trueEdge ? br->falseBlock : br->trueBlock;
+        removeBlockPredecessor(removed, bb);
+        last = newIr<JumpInstruction>(target, bb);
+        br->abandonUse();
+        changed = true;
+    }
+    return changed;
+}
+
+bool sparseConditionalConstantPropagation(shared_ptr<Function> &func) {
+    ConstantPropagationContext context(func);
+    context.run();
+    bool changed = context.rewrite();
+    for (auto &bb : func->blocks) {
+        if (removeUnusedInstructions(bb)) changed = true;
+    }
+    return changed;
+}
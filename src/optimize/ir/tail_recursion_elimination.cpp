@@ -0,0 +1,118 @@
+#include "ir_optimize.h"
+
+/**
+ * Find the self calls in tail position: the call is followed by the return of its result, or by a void return.
+ */
+vector<shared_ptr<InvokeInstruction>> findTailRecursions(shared_ptr<Function> &func) {
+    vector<shared_ptr<InvokeInstruction>> tailCalls;
+    for (auto &bb : func->blocks) {
+        if (bb->instructions.size() < 2) continue;
+        shared_ptr<Instruction> last = bb->instructions.back();
+        shared_ptr<Instruction> beforeLast = *prev(bb->instructions.end(), 2);
+        if (last->type != RET || beforeLast->type != INVOKE) continue;
+        shared_ptr<InvokeInstruction> invoke = s_p_c<InvokeInstruction>(beforeLast);
+        if (invoke->targetFunction != func) continue;
+        shared_ptr<ReturnInstruction> ret = s_p_c<ReturnInstruction>(last);
+        if (func->funcType == FUNC_INT && (ret->value != invoke || !invoke->hasOneUser())) continue;
+        tailCalls.push_back(invoke);
+    }
+    return tailCalls;
+}
+
+/**
+ * Turn the self tail recursions into a loop.
+ * A new entry block jumps to the old one, where the phis of the parameters join the entry values and the
+ * arguments of the tail calls, and each tail call with its return is replaced by a jump back.
+ * The functions with local arrays are skipped since each call needs its own copy of them, and so are the ones
+ * passing a different array to a tail call, because array addresses are not kept in phis.
+ */
+bool tailRecursionElimination(shared_ptr<Function> &func) {
+    shared_ptr<BasicBlock> oldEntry = func->entryBlock;
+    if (func->callers.count(func) == 0 || !oldEntry->predecessors.empty()) return false;
+    vector<shared_ptr<InvokeInstruction>> tailCalls = findTailRecursions(func);
+    if (tailCalls.empty()) return false;
+    for (auto &bb : func->blocks) {
+        for (auto &ins : bb->instructions) {
+            if (ins->type == ALLOC) return false;
+        }
+    }
+    for (auto &invoke : tailCalls) {
+        for (int i = 0; i < func->params.size(); ++i) {
+            if (s_p_c<ParameterValue>(func->params[i])->variableType == POINTER
+                && invoke->params[i] != func->params[i]) {
+                return false;
+            }
+        }
+    }
+
+    // the blocks on the new cycle run once more per tail call.
+    unordered_set<shared_ptr<BasicBlock>> reachTail;
+    vector<shared_ptr<BasicBlock>> worklist;
+    for (auto &invoke : tailCalls) {
+        if (reachTail.insert(invoke->block).second) worklist.push_back(invoke->block);
+    }
+    while (!worklist.empty()) {
+        shared_ptr<BasicBlock> bb = worklist.back();
+        worklist.pop_back();
+        for (auto &pred : bb->predecessors) {
+            if (reachTail.insert(pred).second) worklist.push_back(pred);
+        }
+    }
+    for (auto &bb : reachTail) ++bb->loopDepth;
+
+    shared_ptr<BasicBlock> newEntry = newIr<BasicBlock>(func, true, oldEntry->loopDepth - 1);
+    newEntry->instructions.push_back(newIr<JumpInstruction>(oldEntry, newEntry));
+    newEntry->successors.insert(oldEntry);
+    oldEntry->predecessors.insert(newEntry);
+    func->blocks.insert(func->blocks.begin(), newEntry);
+    func->entryBlock = newEntry;
+
+    vector<shared_ptr<PhiInstruction>> paramPhis;
+    for (int i = 0; i < func->params.size(); ++i) {
+        shared_ptr<Value> param = func->params[i];
+        if (s_p_c<ParameterValue>(param)->variableType == POINTER) continue;
+        shared_ptr<PhiInstruction> phi = newIr<PhiInstruction>(s_p_c<ParameterValue>(param)->name, oldEntry);
+        shared_ptr<Value> phiValue = phi;
+        param->replaceAllUsesWith(phiValue);
+        phi->setOperand(newEntry, param);
+        for (auto &invoke : tailCalls) {
+            shared_ptr<Value> arg = invoke->params[i];
+            if (arg->valueType == INSTRUCTION && s_p_c<Instruction>(arg)->resultType != L_VAL_RESULT) {
+                s_p_c<Instruction>(arg)->resultType = L_VAL_RESULT;
+                s_p_c<Instruction>(arg)->caughtVarName = generateArgumentLeftValueName(func->name);
+            }
+            phi->setOperand(invoke->block, arg);
+        }
+        oldEntry->phis.insert(phi);
+        paramPhis.push_back(phi);
+    }
+
+    for (auto &invoke : tailCalls) {
+        shared_ptr<BasicBlock> bb = invoke->block;
+        shared_ptr<Instruction> ret = bb->instructions.back();
+        bb->instructions.pop_back();
+        bb->instructions.pop_back();
+        if (func->funcType == FUNC_INT) {
+            ret->abandonUse();
+        } else {
+            ret->valid = false;
+        }
+        invoke->abandonUse();
+        bb->instructions.push_back(newIr<JumpInstruction>(oldEntry, bb));
+        bb->successors.insert(oldEntry);
+        oldEntry->predecessors.insert(bb);
+    }
+    for (auto &phi : paramPhis) removeTrivialPhi(phi);
+
+    bool selfCalled = false;
+    for (auto &bb : func->blocks) {
+        for (auto &ins : bb->instructions) {
+            if (ins->type == INVOKE && s_p_c<InvokeInstruction>(ins)->targetFunction == func) selfCalled = true;
+        }
+    }
+    if (!selfCalled) {
+        func->callers.erase(func);
+        func->callees.erase(func);
+    }
+    return true;
+}
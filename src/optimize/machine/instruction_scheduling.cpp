@@ -0,0 +1,367 @@
+#include "machine_optimize.h"
+
+#include <algorithm>
+
+// the dependence resources are R0 to PC, the flags, then q0 to q15.
+#define FLAGS_RESOURCE (PC + 1)
+#define Q_RESOURCE(q) (FLAGS_RESOURCE + 1 + (q))
+#define RESOURCE_CNT Q_RESOURCE(16)
+
+// Cortex-A72 decodes and issues up to three instructions each cycle.
+#define ISSUE_WIDTH 3
+
+/**
+ * An instruction of a scheduling region, with the registers, flags and memory it reads and writes.
+ */
+struct ScheduleNode {
+    shared_ptr<MachineIns> ins;
+    vector<shared_ptr<MachineIns>> comments; // the IR comments printed before it.
+    vector<int> uses;
+    vector<int> defs;
+    bool loadsMemory = false;
+    bool storesMemory = false;
+    int memoryBase = -1; // base register of a word access at an immediate offset, -1 if the words are unknown.
+    int memoryOffset = 0;
+    int baseVersion = 0; // writes to the base register in the region before this node.
+    int latency = 1;
+    vector<pair<int, int>> successors; // node index <--> latency.
+    int predecessors = 0;
+    int height = 0; // the critical path from this node to the end of the region.
+    int earliest = 0; // the earliest cycle to issue after the predecessors.
+};
+
+/**
+ * Result latency on Cortex-A72, by its software optimization guide.
+ */
+int a72Latency(const shared_ptr<MachineIns> &ins) {
+    switch (ins->type) {
+        case mit::MUL:
+        case mit::MLA:
+        case mit::MLS:
+            return 3;
+        case mit::SMULL:
+            return 4;
+        case mit::DIV:
+            return 12; // 4 to 12 cycles by the operands, the worst case is taken.
+        case mit::LOAD:
+        case mit::PSEUDO_LOAD:
+            return 4;
+        case mit::VLOAD:
+        case mit::VGET:
+            return 5;
+        case mit::VADD:
+        case mit::VSUB:
+        case mit::VPADD:
+        case mit::VMOV:
+            return 3;
+        case mit::VMUL:
+        case mit::VMLA:
+            return 4;
+        case mit::VDUP:
+            return 8;
+        case mit::ADD:
+        case mit::SUB:
+        case mit::RSB:
+        case mit::AND:
+        case mit::ORR: {
+            // the shifted register operand takes one more cycle.
+            shared_ptr<BinaryIns> binary = s_p_c<BinaryIns>(ins);
+            return binary->op2->state == REG && binary->shift->type != NONE ? 2 : 1;
+        }
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Add the register of op to the resources, false if it is not a register.
+ */
+bool addRegister(const shared_ptr<Operand> &op, vector<int> &resources) {
+    if (op->state != REG) return false;
+    resources.push_back(op->value);
+    return true;
+}
+
+/**
+ * Add the register of op to the resources if it is a register, false if it is neither a register nor an immediate.
+ */
+bool addRegisterOrImm(const shared_ptr<Operand> &op, vector<int> &resources) {
+    return op->state == IMM || addRegister(op, resources);
+}
+
+bool describeVectorNode(ScheduleNode &node, const shared_ptr<VectorIns> &ins) {
+    int vd = ins->quad ? ins->vd : ins->vd / 2;
+    int vn = ins->quad ? ins->vn : ins->vn / 2;
+    int vm = ins->quad ? ins->vm : ins->vm / 2;
+    switch (ins->type) {
+        case mit::VLOAD:
+        case mit::VSTORE:
+            if (!addRegister(ins->rn, node.uses)) return false;
+            if (ins->writeBack) node.defs.push_back(ins->rn->value);
+            if (ins->type == mit::VLOAD) {
+                node.defs.push_back(Q_RESOURCE(vd));
+                node.loadsMemory = true;
+            } else {
+                node.uses.push_back(Q_RESOURCE(vd));
+                node.storesMemory = true;
+            }
+            return true;
+        case mit::VDUP:
+            node.defs.push_back(Q_RESOURCE(vd));
+            return addRegister(ins->rn, node.uses);
+        case mit::VMOV:
+            node.defs.push_back(Q_RESOURCE(vd));
+            return true;
+        case mit::VGET:
+            // reads a lane of a d register.
+            node.uses.push_back(Q_RESOURCE(ins->vn / 2));
+            return addRegister(ins->rn, node.defs);
+        default:
+            // a d register is half of a q register, so writing it keeps the other half.
+            if (ins->type == mit::VMLA || !ins->quad) node.uses.push_back(Q_RESOURCE(vd));
+            node.uses.push_back(Q_RESOURCE(vn));
+            node.uses.push_back(Q_RESOURCE(vm));
+            node.defs.push_back(Q_RESOURCE(vd));
+            return true;
+    }
+}
+
+/**
+ * Find what the instruction reads and writes, false if it must stay in place, which ends a region.
+ * The labels, branches, calls, stack instructions and the instructions writing PC stay in place.
+ */
+bool describeNode(ScheduleNode &node) {
+    shared_ptr<MachineIns> &ins = node.ins;
+    bool valid;
+    switch (ins->type) {
+        case mit::ADD:
+        case mit::SUB:
+        case mit::RSB:
+        case mit::MUL:
+        case mit::DIV:
+        case mit::AND:
+        case mit::ORR: {
+            shared_ptr<BinaryIns> binary = s_p_c<BinaryIns>(ins);
+            valid = addRegister(binary->op1, node.uses) && addRegisterOrImm(binary->op2, node.uses)
+                    && addRegister(binary->rd, node.defs);
+            break;
+        }
+        case mit::ASR:
+        case mit::LSR:
+        case mit::LSL: {
+            // shifted by the immediate in the shift.
+            shared_ptr<BinaryIns> binary = s_p_c<BinaryIns>(ins);
+            valid = addRegister(binary->op1, node.uses) && addRegister(binary->rd, node.defs);
+            break;
+        }
+        case mit::MLA:
+        case mit::MLS:
+        case mit::SMULL: {
+            shared_ptr<TriIns> tri = s_p_c<TriIns>(ins);
+            // SMULL writes the high word to op1.
+            valid = addRegister(tri->op1, ins->type == mit::SMULL ? node.defs : node.uses)
+                    && addRegister(tri->op2, node.uses) && addRegister(tri->op3, node.uses)
+                    && addRegister(tri->rd, node.defs);
+            break;
+        }
+        case mit::LOAD:
+        case mit::STORE: {
+            shared_ptr<MemoryIns> memory = s_p_c<MemoryIns>(ins);
+            valid = addRegister(memory->base, node.uses) && addRegisterOrImm(memory->offset, node.uses)
+                    && addRegister(memory->rd, ins->type == mit::LOAD ? node.defs : node.uses);
+            node.loadsMemory = ins->type == mit::LOAD;
+            node.storesMemory = ins->type == mit::STORE;
+            if (memory->offset->state == IMM) {
+                node.memoryBase = memory->base->value;
+                node.memoryOffset = memory->offset->value;
+            }
+            break;
+        }
+        case mit::PSEUDO_LOAD:
+            // the constant pool is never written.
+            valid = addRegister(s_p_c<PseudoLoad>(ins)->rd, node.defs);
+            break;
+        case mit::MOV:
+        case mit::MOVW:
+        case mit::MOVT: {
+            shared_ptr<MovIns> move = s_p_c<MovIns>(ins);
+            // MOVT keeps the low half.
+            if (ins->type == mit::MOVT) addRegister(move->op1, node.uses);
+            valid = addRegisterOrImm(move->op2, node.uses) && addRegister(move->op1, node.defs);
+            break;
+        }
+        case mit::CMP: {
+            shared_ptr<CmpIns> cmp = s_p_c<CmpIns>(ins);
+            valid = addRegister(cmp->op1, node.uses) && addRegisterOrImm(cmp->op2, node.uses);
+            node.defs.push_back(FLAGS_RESOURCE);
+            break;
+        }
+        case mit::VLOAD:
+        case mit::VSTORE:
+        case mit::VDUP:
+        case mit::VMOV:
+        case mit::VADD:
+        case mit::VSUB:
+        case mit::VMUL:
+        case mit::VMLA:
+        case mit::VPADD:
+        case mit::VGET:
+            valid = describeVectorNode(node, s_p_c<VectorIns>(ins));
+            break;
+        default:
+            return false;
+    }
+    // writing PC returns or jumps like a branch, such as LDR PC, [SP, #-4] of the function return.
+    if (find(node.defs.begin(), node.defs.end(), PC) != node.defs.end()) return false;
+    if (ins->cond != NON) {
+        // a conditional instruction keeps the former value if it is not executed.
+        node.uses.push_back(FLAGS_RESOURCE);
+        node.uses.insert(node.uses.end(), node.defs.begin(), node.defs.end());
+    }
+    node.latency = a72Latency(ins);
+    return valid;
+}
+
+/**
+ * Whether two memory accesses may touch the same words.
+ * Word accesses at different immediate offsets from the same base register value are independent.
+ */
+bool mayAccessSameWords(const ScheduleNode &a, const ScheduleNode &b) {
+    if (a.memoryBase < 0 || a.memoryBase != b.memoryBase || a.baseVersion != b.baseVersion) return true;
+    return abs(a.memoryOffset - b.memoryOffset) < _W_LEN;
+}
+
+void addDependence(vector<ScheduleNode> &nodes, int from, int to, int latency) {
+    nodes[from].successors.emplace_back(to, latency);
+    nodes[to].predecessors++;
+}
+
+/**
+ * Build the dependence DAG of a region in order. A read waits for the result of the last write, and a write
+ * waits for the former reads and writes to issue. A load waits for the former stores to the same words,
+ * and a store waits for the former loads and stores of them.
+ */
+void buildDependenceGraph(vector<ScheduleNode> &nodes) {
+    vector<int> lastDef(RESOURCE_CNT, -1);
+    vector<int> defCount(RESOURCE_CNT, 0);
+    vector<vector<int>> readers(RESOURCE_CNT);
+    vector<int> loads;
+    vector<int> stores;
+    for (int i = 0; i < nodes.size(); ++i) {
+        ScheduleNode &node = nodes[i];
+        if (node.memoryBase >= 0) node.baseVersion = defCount[node.memoryBase];
+        for (int use : node.uses) {
+            if (lastDef[use] >= 0) addDependence(nodes, lastDef[use], i, nodes[lastDef[use]].latency);
+            readers[use].push_back(i);
+        }
+        for (int def : node.defs) {
+            for (int reader : readers[def]) {
+                if (reader != i) addDependence(nodes, reader, i, 0);
+            }
+            if (lastDef[def] >= 0) addDependence(nodes, lastDef[def], i, 0);
+            readers[def].clear();
+            lastDef[def] = i;
+            defCount[def]++;
+        }
+        if (node.loadsMemory || node.storesMemory) {
+            for (int store : stores) {
+                if (mayAccessSameWords(nodes[store], node)) addDependence(nodes, store, i, node.loadsMemory ? 1 : 0);
+            }
+        }
+        if (node.storesMemory) {
+            for (int load : loads) {
+                if (mayAccessSameWords(nodes[load], node)) addDependence(nodes, load, i, 0);
+            }
+            stores.push_back(i);
+        }
+        if (node.loadsMemory) loads.push_back(i);
+    }
+}
+
+/**
+ * List scheduling of a region by the critical path, the ready node with the longest path to the end of the region
+ * issues first, and the former one in the region if the paths are the same.
+ */
+void scheduleRegion(vector<ScheduleNode> &nodes, list<shared_ptr<MachineIns>> &scheduled) {
+    buildDependenceGraph(nodes);
+    for (int i = (int) nodes.size() - 1; i >= 0; --i) {
+        nodes[i].height = nodes[i].latency;
+        for (auto &succ : nodes[i].successors) {
+            nodes[i].height = max(nodes[i].height, succ.second + nodes[succ.first].height);
+        }
+    }
+    vector<int> ready;
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].predecessors == 0) ready.push_back(i);
+    }
+    int cycle = 0, issued = 0;
+    while (!ready.empty()) {
+        int best = -1;
+        int nextCycle = INT32_MAX;
+        for (int i = 0; i < ready.size(); ++i) {
+            ScheduleNode &node = nodes[ready[i]];
+            if (node.earliest > cycle) {
+                nextCycle = min(nextCycle, node.earliest);
+                continue;
+            }
+            if (best < 0 || node.height > nodes[ready[best]].height
+                || (node.height == nodes[ready[best]].height && ready[i] < ready[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            cycle = nextCycle;
+            issued = 0;
+            continue;
+        }
+        ScheduleNode &node = nodes[ready[best]];
+        ready.erase(ready.begin() + best);
+        scheduled.insert(scheduled.end(), node.comments.begin(), node.comments.end());
+        scheduled.push_back(node.ins);
+        for (auto &succ : node.successors) {
+            ScheduleNode &successor = nodes[succ.first];
+            successor.earliest = max(successor.earliest, cycle + succ.second);
+            if (--successor.predecessors == 0) ready.push_back(succ.first);
+        }
+        if (++issued == ISSUE_WIDTH) {
+            cycle++;
+            issued = 0;
+        }
+    }
+    nodes.clear();
+}
+
+/**
+ * Reorder the instructions between the labels, branches, calls and stack instructions of each block,
+ * after the registers are allocated, so that the results of loads, multiplies and divisions are not used
+ * by the next instructions when there is other work to do. The IR comments move with the instruction after them.
+ */
+void schedule_instructions(shared_ptr<MachineModule> &machineModule) {
+    for (auto &machineFunc:machineModule->machineFunctions) {
+        for (auto &machineBB:machineFunc->machineBlocks) {
+            list<shared_ptr<MachineIns>> scheduled;
+            vector<ScheduleNode> region;
+            vector<shared_ptr<MachineIns>> comments;
+            for (auto &ins:machineBB->MachineInstructions) {
+                if (ins->type == mit::COMMENT) {
+                    comments.push_back(ins);
+                    continue;
+                }
+                ScheduleNode node;
+                node.ins = ins;
+                if (describeNode(node)) {
+                    node.comments.swap(comments);
+                    region.push_back(node);
+                    continue;
+                }
+                scheduleRegion(region, scheduled);
+                scheduled.insert(scheduled.end(), comments.begin(), comments.end());
+                comments.clear();
+                scheduled.push_back(ins);
+            }
+            scheduleRegion(region, scheduled);
+            scheduled.insert(scheduled.end(), comments.begin(), comments.end());
+            machineBB->MachineInstructions.swap(scheduled);
+        }
+    }
+}
@@ -31,4 +31,6 @@ void merge_mla_and_mls(shared_ptr<MachineModule> &machineModule);
 
 void exchange_branch_ins(shared_ptr<MachineModule> &machineModule);
 
+void schedule_instructions(shared_ptr<MachineModule> &machineModule);
+
 #endif
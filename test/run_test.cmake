@@ -0,0 +1,42 @@
+# Compile a SysY program with whitee, then run it on qemu-arm and compare its output and exit code
+# with the expected output, whose last line is the exit code.
+# When the ARM toolchain or qemu-arm is not found, only the compilation is checked.
+
+get_filename_component(NAME ${SOURCE} NAME_WE)
+get_filename_component(DIR ${SOURCE} DIRECTORY)
+set(ASM ${WORK_DIR}/${NAME}-O${LEVEL}.s)
+set(EXE ${WORK_DIR}/${NAME}-O${LEVEL})
+
+execute_process(COMMAND ${COMPILER} -S -o ${ASM} ${SOURCE} -O${LEVEL}
+        RESULT_VARIABLE result OUTPUT_QUIET)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${NAME}: whitee failed at -O${LEVEL}")
+endif ()
+
+find_program(ARM_GCC NAMES arm-linux-gnueabihf-gcc)
+find_program(QEMU_ARM NAMES qemu-arm)
+if (NOT ARM_GCC OR NOT QEMU_ARM)
+    message(STATUS "${NAME}: ARM toolchain or qemu-arm not found, only compiled")
+    return()
+endif ()
+
+execute_process(COMMAND ${ARM_GCC} -march=armv7-a -mfpu=neon -static -o ${EXE} ${ASM} ${LIBSYSY}
+        RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${NAME}: failed to assemble at -O${LEVEL}")
+endif ()
+
+set(input /dev/null)
+if (EXISTS ${DIR}/${NAME}.in)
+    set(input ${DIR}/${NAME}.in)
+endif ()
+execute_process(COMMAND ${QEMU_ARM} ${EXE} INPUT_FILE ${input}
+        OUTPUT_VARIABLE output ERROR_QUIET RESULT_VARIABLE code)
+if (NOT output MATCHES "\n$" AND NOT output STREQUAL "")
+    set(output "${output}\n")
+endif ()
+set(output "${output}${code}\n")
+file(READ ${DIR}/${NAME}.out expected)
+if (NOT output STREQUAL expected)
+    message(FATAL_ERROR "${NAME}: wrong output at -O${LEVEL}\nexpected:\n${expected}\nactual:\n${output}")
+endif ()